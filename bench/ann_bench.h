@@ -0,0 +1,68 @@
+#pragma once
+#include "ann.h"
+#include "bench.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+inline void bench_ann_index()
+{
+    using namespace jsc;
+    std::cout << "bench_ann_index()" << std::endl;
+
+    // Clustered embeddings, 64 centers
+    constexpr std::size_t n = 100000, dim = 64, k = 10, n_queries = 200;
+    std::mt19937 rng(13);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> centers(64 * dim), data(n * dim), queries(n_queries * dim);
+    for (float& x : centers)
+        x = normal(rng);
+    auto sample = [&](float* v) {
+        const float* c = centers.data() + (rng() % 64) * dim;
+        for (std::size_t i = 0; i < dim; i++)
+            v[i] = c[i] + 0.5f * normal(rng);
+    };
+    for (std::size_t i = 0; i < n; i++)
+        sample(data.data() + i * dim);
+    for (std::size_t i = 0; i < n_queries; i++)
+        sample(queries.data() + i * dim);
+
+    // Exact neighbors by brute force scan
+    std::vector<std::vector<std::uint64_t>> exact(n_queries);
+    bench_run("brute force scan", n_queries, [&](std::size_t q) {
+        std::vector<std::pair<float, std::uint64_t>> all(n);
+        const float* qv = queries.data() + q * dim;
+        for (std::size_t i = 0; i < n; i++) {
+            float d = 0;
+            for (std::size_t j = 0; j < dim; j++)
+                d += (qv[j] - data[i * dim + j]) * (qv[j] - data[i * dim + j]);
+            all[i] = {d, i};
+        }
+        std::partial_sort(all.begin(), all.begin() + k, all.end());
+        for (std::size_t i = 0; i < k; i++)
+            exact[q].push_back(all[i].second);
+    });
+
+    for (AnnStorage storage : {AnnStorage::Float32, AnnStorage::Int8}) {
+        const std::string name = storage == AnnStorage::Float32 ? "float32" : "int8";
+        AnnOptions opts;
+        opts.metric = AnnMetric::L2;
+        opts.storage = storage;
+        opts.ef_construction = 100;
+        HnswIndex index(dim, opts);
+        bench_run("insert " + name + " (" + std::to_string(n) + " vectors)", 1, [&](std::size_t) {
+            for (std::size_t i = 0; i < n; i++)
+                index.insert(i, data.data() + i * dim);
+        });
+        std::cout << "  " << index.memory_usage() / 1e6 << " MB" << std::endl;
+
+        for (std::size_t ef : {16, 64, 256}) {
+            std::size_t found = 0;
+            bench_run("search " + name + " k=10 ef=" + std::to_string(ef), n_queries, [&](std::size_t q) {
+                for (auto [label, dist] : index.search(queries.data() + q * dim, k, ef))
+                    found += std::find(exact[q].begin(), exact[q].end(), label) != exact[q].end();
+            });
+            std::cout << "  recall@10 : " << static_cast<double>(found) / (n_queries * k) << std::endl;
+        }
+    }
+}
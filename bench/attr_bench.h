@@ -0,0 +1,95 @@
+#pragma once
+#include "bench.h"
+#include "graph.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Compare interned AttrSet keys against per-object std::string keys
+ */
+inline void bench_attr_keys()
+{
+    using namespace jsc;
+    std::cout << "bench_attr_keys()" << std::endl;
+
+    constexpr std::size_t n = 200000;
+    const std::vector<std::string> keys = {"role", "name", "ignored", "geometry"};
+
+    // Baseline: per-object string keys
+    std::size_t before = bench_live_bytes();
+    std::vector<std::unordered_map<std::string, AttrValue<>>> plain(n);
+    for (auto& m : plain) {
+        m.emplace(keys[0], AttrValue<>(std::string("StaticText")));
+        m.emplace(keys[1], AttrValue<>(std::string("paragraph")));
+        m.emplace(keys[2], AttrValue<>(0));
+        m.emplace(keys[3], AttrValue<>({0.0, 0.0, 1920.0, 1080.0}));
+    }
+    std::size_t plain_bytes = bench_live_bytes() - before;
+
+    before = bench_live_bytes();
+    std::vector<AttrSet<>> sets(n);
+    for (auto& s : sets) {
+        s.set(keys[0], std::string("StaticText"));
+        s.set(keys[1], std::string("paragraph"));
+        s.set(keys[2], AttrValue<>(0));
+        s.set(keys[3], {0.0, 0.0, 1920.0, 1080.0});
+    }
+    std::size_t set_bytes = bench_live_bytes() - before;
+
+    std::cout << "  memory : string keys " << plain_bytes / n << " B/object, interned keys " << set_bytes / n << " B/object" << std::endl;
+
+    const AttrKey geometry = AttrSet<>::key("geometry");
+    double sum = 0;
+    bench_run("lookup (string keys map)", n, [&](std::size_t i) {
+        sum += plain[i].find(keys[3])->second.at_f64(2);
+    });
+    bench_run("lookup (AttrSet, string)", n, [&](std::size_t i) {
+        sum += sets[i].get(keys[3])->at_f64(2);
+    });
+    bench_run("lookup (AttrSet, atom)", n, [&](std::size_t i) {
+        sum += sets[i].get(geometry)->at_f64(2);
+    });
+    bench_keep(sum);
+}
+
+
+template <class TSet>
+inline void bench_attr_storage_impl(const std::string& name)
+{
+    using namespace jsc;
+    constexpr std::size_t n = 200000;
+    const AttrKey role = AttrSet<>::key("role"), geometry = AttrSet<>::key("geometry");
+
+    std::size_t before = bench_live_bytes(), allocs = bench_alloc_count();
+    std::vector<TSet> sets(n);
+    for (auto& s : sets) {
+        s.set(role, std::string("StaticText"));
+        s.set("ignored", AttrValue<>(0));
+        s.set(geometry, {0.0, 0.0, 1920.0, 1080.0});
+    }
+    std::cout << "  " << name << " : " << (bench_live_bytes() - before) / n << " B/object, "
+              << static_cast<double>(bench_alloc_count() - allocs) / n << " allocs/object" << std::endl;
+
+    double sum = 0;
+    bench_run(name + " lookup", n, [&](std::size_t i) {
+        sum += sets[i].get(geometry)->at_f64(2);
+    });
+    bench_run(name + " iterate", n, [&](std::size_t i) {
+        sets[i].each_key([&](AttrKey, const AttrValue<>& v) { sum += v.size(); });
+    });
+    bench_keep(sum);
+}
+
+/**
+ * @brief Compare AttrSet storage backends
+ */
+inline void bench_attr_storage()
+{
+    using namespace jsc;
+    std::cout << "bench_attr_storage()" << std::endl;
+    bench_attr_storage_impl<AttrSet<std::string, HashAttrStorage<>>>("hash");
+    bench_attr_storage_impl<AttrSet<std::string, FlatAttrStorage<>>>("flat");
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "bench.h"
+#include "graph.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+/**
+ * @brief Reference std::variant based AttrValue layout (f64 subset), kept for comparison
+ */
+class VariantAttrValue {
+public:
+    explicit VariantAttrValue(std::initializer_list<double> il) : _array_size(il.size())
+    {
+        std::array<double, 4> a{};
+        std::copy(il.begin(), il.end(), a.begin());
+        _v = a;
+    }
+
+    double &at_f64(std::size_t i)
+    {
+        if (std::holds_alternative<std::array<double, 4>>(_v))
+            return std::get<std::array<double, 4>>(_v).at(i);
+        if (std::holds_alternative<std::vector<double>>(_v))
+            return std::get<std::vector<double>>(_v).at(i);
+        throw std::bad_variant_access{};
+    }
+
+    void push_f64(double v)
+    {
+        if (std::holds_alternative<std::vector<double>>(_v)) {
+            std::get<std::vector<double>>(_v).push_back(v);
+            return;
+        }
+        if (std::holds_alternative<std::array<double, 4>>(_v)) {
+            if (_array_size < 4) {
+                std::get<std::array<double, 4>>(_v)[_array_size++] = v;
+                return;
+            }
+            const auto &a = std::get<std::array<double, 4>>(_v);
+            std::vector<double> vec;
+            for (int i = 0; i < _array_size; i++)
+                vec.push_back(a[i]);
+            vec.push_back(v);
+            _v = std::move(vec);
+            return;
+        }
+        throw std::bad_variant_access{};
+    }
+
+protected:
+    std::variant<std::array<std::int64_t, 4>, std::array<double, 4>, std::string, std::vector<std::int64_t>, std::vector<double>> _v;
+    int _array_size;
+};
+
+
+template <class TValue>
+inline void bench_attr_value_impl(const std::string& name)
+{
+    constexpr std::size_t n = 200000;
+    std::cout << "  " << name << " : sizeof = " << sizeof(TValue) << std::endl;
+
+    std::vector<TValue> values(n, TValue({0.0, 0.0, 1920.0, 1080.0}));
+    double sum = 0;
+    bench_run(name + " at_f64", n, [&](std::size_t i) {
+        TValue& v = values[i];
+        sum += v.at_f64(0) + v.at_f64(1) + v.at_f64(2) + v.at_f64(3);
+    });
+
+    std::size_t allocs = bench_alloc_count();
+    bench_run(name + " push_f64 x8 (spill)", n, [&](std::size_t i) {
+        TValue& v = values[i];
+        for (int j = 0; j < 8; j++)
+            v.push_f64(j);
+    });
+    std::cout << "  " << name << " : " << static_cast<double>(bench_alloc_count() - allocs) / n << " allocs/value" << std::endl;
+    bench_keep(sum);
+}
+
+/**
+ * @brief Compare the tagged union AttrValue against the std::variant layout
+ */
+inline void bench_attr_value()
+{
+    std::cout << "bench_attr_value()" << std::endl;
+    bench_attr_value_impl<VariantAttrValue>("variant");
+    bench_attr_value_impl<jsc::AttrValue<>>("tagged union");
+}
@@ -0,0 +1,289 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "json_reader.h"
+
+/**
+ * @brief Number of bytes allocated through the global operator new and not yet freed (see main.cpp)
+ */
+std::size_t bench_live_bytes();
+
+/**
+ * @brief Total number of calls to the global operator new
+ */
+std::size_t bench_alloc_count();
+
+/**
+ * @brief Total number of bytes requested from the global operator new
+ */
+std::size_t bench_alloc_bytes();
+
+/**
+ * @brief Command line settings of the bench executable (see main.cpp)
+ */
+struct BenchConfig {
+    std::size_t warmup = 1;      // untimed repetitions of bench_repeat() cases
+    std::size_t repetitions = 5; // timed repetitions of bench_repeat() cases
+    double scale = 1.0;          // multiplies the sizes passed to bench_scaled()
+    std::string filter;          // only run the groups whose name contains it
+    std::string json_path;       // write every result there at the end
+    std::string baseline_path;   // compare the results with this earlier JSON output
+    double threshold = 0.1;      // relative slowdown of the median reported as a regression
+};
+
+inline BenchConfig& bench_config()
+{
+    static BenchConfig config;
+    return config;
+}
+
+/**
+ * @brief Size n multiplied by the --scale option, at least 1
+ */
+inline std::size_t bench_scaled(std::size_t n)
+{
+    return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(n) * bench_config().scale));
+}
+
+/**
+ * @brief Timing of one case. Percentiles are taken over the repetitions, each of which runs the case iters times
+ */
+struct BenchResult {
+    std::string group;
+    std::string name;
+    std::size_t iters = 0;
+    std::size_t repetitions = 0;
+    double mean_ns = 0, min_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, max_ns = 0; // per operation
+    double allocs_per_op = 0;
+    double bytes_per_op = 0;
+};
+
+inline std::vector<BenchResult>& bench_results()
+{
+    static std::vector<BenchResult> results;
+    return results;
+}
+
+/**
+ * @brief Name of the running group, stored with its results
+ */
+inline std::string& bench_group()
+{
+    static std::string group;
+    return group;
+}
+
+/**
+ * @brief Nearest-rank percentile of sorted samples
+ */
+inline double bench_percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    std::size_t rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+inline BenchResult bench_record(const std::string& name, std::size_t iters, std::vector<double> samples, std::size_t allocs, std::size_t bytes)
+{
+    BenchResult r;
+    r.group = bench_group();
+    r.name = name;
+    r.iters = iters;
+    r.repetitions = samples.size();
+    std::sort(samples.begin(), samples.end());
+    for (double s : samples)
+        r.mean_ns += s / static_cast<double>(samples.size());
+    r.min_ns = samples.front();
+    r.max_ns = samples.back();
+    r.p50_ns = bench_percentile(samples, 50);
+    r.p90_ns = bench_percentile(samples, 90);
+    r.p99_ns = bench_percentile(samples, 99);
+    const double ops = static_cast<double>(iters * samples.size());
+    r.allocs_per_op = static_cast<double>(allocs) / ops;
+    r.bytes_per_op = static_cast<double>(bytes) / ops;
+    bench_results().push_back(r);
+    return r;
+}
+
+/**
+ * @brief Run func() iters times and print the average time per iteration
+ */
+template<class F>
+inline double bench_run(const std::string& name, std::size_t iters, F func)
+{
+    const std::size_t allocs = bench_alloc_count(), bytes = bench_alloc_bytes();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iters; i++)
+        func(i);
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iters);
+    bench_record(name, iters, {ns}, bench_alloc_count() - allocs, bench_alloc_bytes() - bytes);
+    std::cout << "  " << name << " : " << ns << " ns/op" << std::endl;
+    return ns;
+}
+
+/**
+ * @brief Run setup() then func(i) for i in [0, iters), warmup times untimed and repetitions times timed, and print the percentiles of the time per
+ * iteration over the repetitions. setup() is not timed, so the case may consume its input
+ */
+template<class FSetup, class F>
+inline BenchResult bench_repeat(const std::string& name, std::size_t iters, FSetup setup, F func)
+{
+    const BenchConfig& config = bench_config();
+    for (std::size_t r = 0; r < config.warmup; r++) {
+        setup();
+        for (std::size_t i = 0; i < iters; i++)
+            func(i);
+    }
+
+    std::vector<double> samples;
+    std::size_t allocs = 0, bytes = 0;
+    for (std::size_t r = 0; r < std::max<std::size_t>(config.repetitions, 1); r++) {
+        setup();
+        const std::size_t allocs0 = bench_alloc_count(), bytes0 = bench_alloc_bytes();
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iters; i++)
+            func(i);
+        auto end = std::chrono::steady_clock::now();
+        allocs += bench_alloc_count() - allocs0;
+        bytes += bench_alloc_bytes() - bytes0;
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iters));
+    }
+
+    BenchResult r = bench_record(name, iters, std::move(samples), allocs, bytes);
+    std::cout << "  " << name << " : p50 " << r.p50_ns << " ns/op, p90 " << r.p90_ns << ", min " << r.min_ns << ", " << r.allocs_per_op << " allocs/op"
+              << std::endl;
+    return r;
+}
+
+/**
+ * @brief bench_repeat() for cases which leave their input unchanged
+ */
+template<class F>
+inline BenchResult bench_repeat(const std::string& name, std::size_t iters, F func)
+{
+    return bench_repeat(name, iters, [] {}, func);
+}
+
+/**
+ * @brief Write every recorded result as a JSON document. Returns false if the file cannot be written
+ */
+inline bool bench_write_json(const std::string& path)
+{
+    auto quote = [](const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    };
+
+    std::ofstream out(path);
+    const BenchConfig& config = bench_config();
+    out << "{\n  \"scale\": " << config.scale << ",\n  \"warmup\": " << config.warmup << ",\n  \"repetitions\": " << config.repetitions
+        << ",\n  \"results\": [";
+    const auto& results = bench_results();
+    for (std::size_t k = 0; k < results.size(); k++) {
+        const BenchResult& r = results[k];
+        out << (k ? ",\n" : "\n") << "    {\"group\": " << quote(r.group) << ", \"name\": " << quote(r.name) << ", \"iters\": " << r.iters
+            << ", \"repetitions\": " << r.repetitions << ", \"mean_ns\": " << r.mean_ns << ", \"min_ns\": " << r.min_ns << ", \"p50_ns\": " << r.p50_ns
+            << ", \"p90_ns\": " << r.p90_ns << ", \"p99_ns\": " << r.p99_ns << ", \"max_ns\": " << r.max_ns << ", \"allocs_per_op\": " << r.allocs_per_op
+            << ", \"bytes_per_op\": " << r.bytes_per_op << "}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Read the results of a previous bench_write_json(). Throws std::runtime_error if the file is missing or malformed
+ */
+inline std::vector<BenchResult> bench_read_json(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error{"cannot read " + path};
+    const std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    jsc::MemorySource src(data);
+    jsc::JsonReader<jsc::MemorySource> reader(src);
+
+    std::vector<BenchResult> results;
+    std::string key, field;
+    reader.begin_object();
+    while (reader.next_key(key)) {
+        if (key != "results") {
+            reader.skip();
+            continue;
+        }
+        reader.begin_array();
+        while (reader.next_element()) {
+            BenchResult r;
+            reader.begin_object();
+            while (reader.next_key(field)) {
+                if (field == "group") reader.read_string(r.group);
+                else if (field == "name") reader.read_string(r.name);
+                else if (field == "p50_ns") r.p50_ns = reader.read_double();
+                else if (field == "min_ns") r.min_ns = reader.read_double();
+                else if (field == "allocs_per_op") r.allocs_per_op = reader.read_double();
+                else reader.skip();
+            }
+            results.push_back(std::move(r));
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief Print the cases of this run whose median time grew by more than threshold (0.1 = 10%) or which allocate more than in the baseline.
+ * Single-sample cases (bench_run()) are skipped: they have no warmup and one timing, which is too noisy to compare. Returns the number of regressions
+ */
+inline std::size_t bench_compare(const std::vector<BenchResult>& baseline, double threshold)
+{
+    std::map<std::string, const BenchResult*> before;
+    for (const BenchResult& r : baseline)
+        before[r.group + "/" + r.name] = &r;
+
+    std::size_t n = 0, skipped = 0;
+    std::cout << "Regressions against the baseline (threshold " << threshold * 100 << "%) :" << std::endl;
+    for (const BenchResult& r : bench_results()) {
+        auto it = before.find(r.group + "/" + r.name);
+        if (it == before.end())
+            continue;
+        const BenchResult& b = *it->second;
+        if (r.repetitions < 2 || b.repetitions < 2) {
+            skipped++;
+            continue;
+        }
+        const bool slower = r.p50_ns > b.p50_ns * (1.0 + threshold), allocs = r.allocs_per_op > b.allocs_per_op + 1e-9;
+        if (slower || allocs) {
+            n++;
+            std::cout << "  " << r.group << " / " << r.name << " : " << b.p50_ns << " -> " << r.p50_ns << " ns/op, " << b.allocs_per_op << " -> "
+                      << r.allocs_per_op << " allocs/op" << std::endl;
+        }
+    }
+    if (!n)
+        std::cout << "  none" << std::endl;
+    if (skipped)
+        std::cout << "  " << skipped << " single-sample cases not compared" << std::endl;
+    return n;
+}
+
+/**
+ * @brief Prevent the compiler from optimizing away the value
+ */
+template<class T>
+inline void bench_keep(const T& v)
+{
+    asm volatile("" : : "g"(&v) : "memory");
+}
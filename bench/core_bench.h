@@ -0,0 +1,100 @@
+#pragma once
+#include "bench.h"
+#include "graph.h"
+#include "graph_bench.h"
+#include "widget_bench.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Repeated core operations for tracking regressions between commits : AttrValue spills, AttrSet lookups, add_node/add_edge, del_node on hubs
+ * and widget tree walks. Sizes follow --scale and the timings have percentiles over --repetitions
+ */
+inline void bench_core_ops()
+{
+    using namespace jsc;
+    std::cout << "bench_core_ops()" << std::endl;
+
+    // AttrValue : inline arrays hold 4 numbers, the 5th push moves them to a vector
+    const std::size_t n_values = bench_scaled(200000);
+    std::vector<AttrValue<>> values;
+    bench_repeat("AttrValue push_f64 x8 (spill)", n_values, [&] { values.assign(n_values, AttrValue<>({0.0, 0.0, 1920.0, 1080.0})); },
+                 [&](std::size_t i) {
+                     for (int j = 0; j < 8; j++)
+                         values[i].push_f64(j);
+                 });
+    bench_repeat("AttrValue push_i64 x3 (inline)", n_values, [&] { values.assign(n_values, AttrValue<>(std::int64_t(1))); },
+                 [&](std::size_t i) {
+                     for (std::int64_t j = 0; j < 3; j++)
+                         values[i].push_i64(j);
+                 });
+
+    // AttrSet : widget-like sets of 6 attributes
+    std::vector<AttrSet<>> sets(n_values);
+    for (std::size_t i = 0; i < n_values; i++) {
+        sets[i].set("role", std::string("StaticText"));
+        sets[i].set("name", "item " + std::to_string(i));
+        sets[i].set("ignored", AttrValue<>(std::int64_t(0)));
+        sets[i].set("focusable", AttrValue<>(std::int64_t(i % 2)));
+        sets[i].set("level", AttrValue<>(std::int64_t(i % 6)));
+        sets[i].set("geometry", {0.0, 1.0 * i, 1280.0, 20.0});
+    }
+    const AttrKey geometry = AttrSet<>::key("geometry"), missing = AttrSet<>::key("bench_missing_key");
+    double sum = 0;
+    bench_repeat("AttrSet get (atom)", n_values, [&](std::size_t i) { sum += sets[i].get(geometry)->at_f64(1); });
+    bench_repeat("AttrSet get (string)", n_values, [&](std::size_t i) { sum += sets[i].get("geometry")->at_f64(1); });
+    bench_repeat("AttrSet get (missing atom)", n_values, [&](std::size_t i) { sum += sets[i].get(missing) == nullptr; });
+
+    // AdjGraph insertion on a power-law link graph
+    const std::size_t n_nodes = bench_scaled(50000), out_deg = 8;
+    const auto pairs = bench_make_edges(n_nodes, out_deg);
+    std::vector<Node<>> pages, copies;
+    for (std::size_t i = 0; i < n_nodes; i++)
+        pages.push_back(bench_make_page(i, out_deg));
+    AdjGraph<> g;
+    std::vector<NodeRef> refs(n_nodes);
+    std::vector<std::size_t> used;
+    auto fresh_graph = [&] {
+        g = AdjGraph<>();
+        copies = pages;
+    };
+    bench_repeat("AdjGraph add_node", n_nodes, fresh_graph, [&](std::size_t i) { refs[i] = g.add_node(copies[i]); });
+    bench_repeat("AdjGraph add_edge", pairs.size(), [&] {
+        fresh_graph();
+        for (std::size_t i = 0; i < n_nodes; i++)
+            refs[i] = g.add_node(copies[i]);
+        used.assign(n_nodes, 0);
+    }, [&](std::size_t e) {
+        const auto [from, to] = pairs[e];
+        Hyperlink<> h(g.get_node(refs[from]), g.get_node(refs[to]), g.get_widget(refs[from]).child(used[from]++));
+        g.add_edge(h);
+    });
+
+    // del_node on the hubs, which are the first pages
+    const std::size_t n_hubs = 50;
+    bench_repeat("AdjGraph del_node (hub)", n_hubs, [&] { g = bench_make_graph(n_nodes, out_deg, refs); },
+                 [&](std::size_t i) { g.del_node(refs[i]); });
+
+    // Walks over deep and wide AXTree-shaped widget trees
+    const std::size_t n_widgets = bench_scaled(20000);
+    for (const auto& [shape, depth, fanout] : {std::make_tuple("deep", 48, 4), std::make_tuple("wide", 3, 400)}) {
+        const WidgetTree<> tree = bench_make_axtree(n_widgets, depth, fanout);
+        const std::string suffix = std::string(" (") + shape + ", " + std::to_string(tree.size()) + " widgets)";
+        bench_repeat("WidgetTree preorder walk" + suffix, 20, [&](std::size_t) {
+            tree.each_preorder([&](ConstWidgetView<> w) { sum += w.get(geometry)->at_f64(1); });
+        });
+        bench_repeat("WidgetTree linear sweep" + suffix, 20, [&](std::size_t) {
+            for (const auto& a : tree.attrs_column())
+                sum += a.get(geometry)->at_f64(1);
+        });
+        bench_repeat("WidgetTree ancestor walk" + suffix, tree.size(), [&](std::size_t i) {
+            for (ConstWidgetView<> w = tree.view(static_cast<WidgetIdx>(i)).parent(); w.valid(); w = w.parent())
+                sum += 1;
+        });
+    }
+    bench_keep(sum);
+}
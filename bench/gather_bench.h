@@ -0,0 +1,47 @@
+#pragma once
+#include "bench.h"
+#include "gather.h"
+#include "graph_bench.h"
+#include "graph_builder.h"
+#include <iostream>
+
+/**
+ * @brief Export of a 1M edge graph for GNN training : CSR snapshot, COO edge index, node and edge feature matrices
+ */
+inline void bench_coo_export()
+{
+    using namespace jsc;
+    std::cout << "bench_coo_export()" << std::endl;
+
+    constexpr std::size_t n = 125000, out_deg = 8, dim = 16;
+    GraphBuilder<> builder;
+    builder.reserve(n, n * out_deg);
+    for (std::size_t i = 0; i < n; i++) {
+        Node<> node = bench_make_page(i, out_deg);
+        std::vector<double> emb(dim);
+        for (std::size_t j = 0; j < dim; j++)
+            emb[j] = static_cast<double>((i * 31 + j) % 97);
+        node.set("emb", AttrValue<>(std::move(emb)));
+        builder.add_node(std::move(node));
+    }
+    std::vector<std::size_t> used(n, 0);
+    for (const auto& [from, to] : bench_make_edges(n, out_deg)) {
+        AttrSet<> attrs;
+        attrs.set("weight", AttrValue<>(static_cast<double>(used[from])));
+        builder.add_edge(from, to, static_cast<WidgetIdx>(1 + used[from]++), std::move(attrs));
+    }
+    AdjGraph<> g = builder.build();
+
+    const AttrKey emb = AttrSet<>::key("emb"), weight = AttrSet<>::key("weight");
+    CsrGraph<> csr;
+    bench_run("freeze", 1, [&](std::size_t) { csr = g.freeze(); });
+    const std::size_t m = csr.n_edges();
+    std::cout << "  " << csr.n_nodes() << " nodes, " << m << " edges" << std::endl;
+
+    std::vector<std::int64_t> coo(2 * m);
+    std::vector<float> x(n * dim), edge_attr(m);
+    bench_run("edge_index", 5, [&](std::size_t) { edge_index(csr, coo.data()); });
+    bench_run("gather_node_features", 5, [&](std::size_t) { gather_node_features(g, {emb}, {dim}, x.data()); });
+    bench_run("gather_edge_features", 5, [&](std::size_t) { gather_edge_features(csr, {weight}, {1}, edge_attr.data()); });
+    bench_keep(coo[m] + x[dim] + edge_attr[m - 1]);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "bench.h"
+#include "geometry.h"
+#include "spatial_bench.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Compare the box kernels with the same computations through AttrValue, and the vector kernels with the scalar ones
+ */
+inline void bench_box_kernels()
+{
+    using namespace jsc;
+    std::cout << "bench_box_kernels()" << std::endl;
+
+    std::mt19937 rng(9);
+    WidgetTree<std::string> tree = bench_make_layout(3000, rng);
+    const AttrKey key = AttrSet<std::string>::key("geometry");
+    BoxArray boxes;
+    bench_run("extract boxes", 100, [&](std::size_t) { boxes = BoxArray::from_tree(tree); });
+    const std::size_t n = boxes.size();
+    std::cout << "  " << n << " boxes, " << n * n << " pairs" << std::endl;
+
+    // Pairwise IoU through the attributes, as the Python code does it
+    std::vector<const AttrValue<std::string>*> geoms;
+    for (WidgetIdx w = 0; w < tree.size(); w++)
+        if (const AttrValue<std::string>* g = tree.attrs(w).get(key))
+            geoms.push_back(g);
+    std::vector<double> iou(n * n);
+    bench_run("iou matrix (AttrValue::at_f64)", 1, [&](std::size_t) {
+        for (std::size_t i = 0; i < n; i++) {
+            const AttrValue<std::string>& a = *geoms[i];
+            for (std::size_t j = 0; j < n; j++) {
+                const AttrValue<std::string>& b = *geoms[j];
+                double iw = std::max(0.0, std::min(a.at_f64(0) + a.at_f64(2), b.at_f64(0) + b.at_f64(2)) - std::max(a.at_f64(0), b.at_f64(0)));
+                double ih = std::max(0.0, std::min(a.at_f64(1) + a.at_f64(3), b.at_f64(1) + b.at_f64(3)) - std::max(a.at_f64(1), b.at_f64(1)));
+                double inter = iw * ih, uni = a.at_f64(2) * a.at_f64(3) + b.at_f64(2) * b.at_f64(3) - inter;
+                iou[i * n + j] = uni > 0 ? inter / uni : 0.0;
+            }
+        }
+    });
+    bench_keep(iou);
+
+    for (SimdLevel level : {SimdLevel::Scalar, simd_level()}) {
+        const std::string name = level == SimdLevel::Scalar ? "scalar" : level == SimdLevel::AVX2 ? "avx2" : "neon";
+        double ns = bench_run("iou matrix (" + name + ")", 1, [&](std::size_t) { box_iou(boxes, boxes, iou.data(), level); });
+        std::cout << "  " << ns / static_cast<double>(n * n) << " ns/pair" << std::endl;
+        std::vector<std::uint8_t> mask(n * n);
+        bench_run("contains matrix (" + name + ")", 1, [&](std::size_t) { box_contains(boxes, boxes, mask.data(), level); });
+        std::vector<double> area(n);
+        bench_run("area (" + name + ")", 1000, [&](std::size_t) { box_area(boxes, area.data(), level); });
+        BoxArray clipped = boxes;
+        bench_run("clip to viewport (" + name + ")", 1000, [&](std::size_t) { box_clip(clipped, 0, 1000, 1920, 1080, level); });
+        bench_keep(mask);
+        bench_keep(area);
+        if (level == SimdLevel::Scalar && simd_level() == SimdLevel::Scalar)
+            break;
+    }
+}
@@ -0,0 +1,234 @@
+#pragma once
+#include "bench.h"
+#include "csr.h"
+#include "graph_builder.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * @brief Generate the (from, to) pairs of a link graph with power-law in-degrees: every page has out_deg links, targets are drawn with P(i) ~ 1 / (i + 1)^alpha
+ */
+inline std::vector<std::pair<std::size_t, std::size_t>> bench_make_edges(std::size_t n_nodes, std::size_t out_deg, double alpha = 1.2, unsigned seed = 42)
+{
+    std::mt19937_64 rng(seed);
+
+    // Inverse transform sampling of a bounded Pareto distribution over node ranks
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    const double max_rank = static_cast<double>(n_nodes);
+    auto sample = [&]() {
+        double u = uni(rng);
+        double x = std::pow(1.0 - u * (1.0 - std::pow(max_rank, 1.0 - alpha)), 1.0 / (1.0 - alpha));
+        return std::min<std::size_t>(n_nodes - 1, static_cast<std::size_t>(x) - 1);
+    };
+
+    std::vector<std::pair<std::size_t, std::size_t>> edges;
+    edges.reserve(n_nodes * out_deg);
+    for (std::size_t i = 0; i < n_nodes; i++)
+        for (std::size_t j = 0; j < out_deg; j++)
+            edges.emplace_back(i, sample());
+    return edges;
+}
+
+/**
+ * @brief Page with out_deg link widgets, the children of the root
+ */
+inline jsc::Node<> bench_make_page(std::size_t i, std::size_t out_deg)
+{
+    using namespace jsc;
+    Node<> node("page " + std::to_string(i));
+    WidgetTree<> tree(std::string("RootWebArea"));
+    for (std::size_t j = 0; j < out_deg; j++)
+        tree.add_child(0, "link");
+    node.set_widget(std::move(tree));
+    return node;
+}
+
+/**
+ * @brief Generate a link graph from bench_make_edges() by sequential insertion
+ */
+inline jsc::AdjGraph<> bench_make_graph(std::size_t n_nodes, std::size_t out_deg, std::vector<jsc::NodeRef>& refs, double alpha = 1.2, unsigned seed = 42)
+{
+    using namespace jsc;
+    AdjGraph<> g;
+    g.reserve(n_nodes);
+
+    refs.clear();
+    refs.reserve(n_nodes);
+    for (std::size_t i = 0; i < n_nodes; i++) {
+        Node<> node = bench_make_page(i, out_deg);
+        refs.push_back(g.add_node(node));
+    }
+
+    std::vector<std::size_t> used(n_nodes, 0);
+    for (const auto& [from, to] : bench_make_edges(n_nodes, out_deg, alpha, seed)) {
+        Hyperlink<> h(g.get_node(refs[from]), g.get_node(refs[to]), g.get_widget(refs[from]).child(used[from]++));
+        g.add_edge(h);
+    }
+    return g;
+}
+
+/**
+ * @brief Compare neighbor iteration over the live AdjGraph against its CSR snapshot
+ */
+inline void bench_csr_snapshot()
+{
+    using namespace jsc;
+    std::cout << "bench_csr_snapshot()" << std::endl;
+
+    std::vector<NodeRef> refs;
+    AdjGraph<> g = bench_make_graph(100000, 16, refs);
+
+    CsrGraph<> csr;
+    bench_run("freeze", 1, [&](std::size_t) { csr = g.freeze(); });
+
+    std::size_t sum = 0;
+    bench_run("neighbors (live map, per node)", refs.size(), [&](std::size_t i) {
+        for (const auto& h : g.get_edges(refs[i]))
+            sum += h._id_to();
+    });
+    bench_run("neighbors (CSR, per node)", csr.n_nodes(), [&](std::size_t u) {
+        for (auto v : csr.neighbors(static_cast<CsrGraph<>::index_type>(u)))
+            sum += v;
+    });
+    bench_run("backlinks (live map, per node)", refs.size(), [&](std::size_t i) {
+        for (const auto& b : g.get_backlinks(refs[i]))
+            sum += b.source;
+    });
+    bench_run("backlinks (CSR, per node)", csr.n_nodes(), [&](std::size_t u) {
+        for (auto v : csr.backlinks(static_cast<CsrGraph<>::index_type>(u)))
+            sum += v;
+    });
+    bench_keep(sum);
+}
+
+/**
+ * @brief Compare node lookup in the generational slot map against the previous hash map id index, and check memory under add/delete churn
+ */
+inline void bench_slot_map()
+{
+    using namespace jsc;
+    std::cout << "bench_slot_map()" << std::endl;
+
+    constexpr std::size_t n = 1000000;
+    std::vector<std::size_t> ids;
+    ids.reserve(n);
+    std::unordered_map<std::size_t, std::size_t> hash;
+    SlotMap<std::size_t> slots;
+    for (std::size_t i = 0; i < n; i++) {
+        hash.emplace(i, i);
+        ids.push_back(slots.insert(i));
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<std::size_t> order(n);
+    for (auto& o : order)
+        o = rng() % n;
+
+    std::size_t sum = 0;
+    bench_run("lookup (unordered_map)", n, [&](std::size_t i) { sum += hash.find(order[i])->second; });
+    bench_run("lookup (slot map)", n, [&](std::size_t i) { sum += *slots.find(ids[order[i]]); });
+
+    // Churn: delete and re-add half of the nodes several times
+    std::vector<NodeRef> refs;
+    AdjGraph<> g = bench_make_graph(100000, 4, refs);
+    std::size_t before = bench_live_bytes();
+    bench_run("churn (del_node + add_node)", 4 * refs.size() / 2, [&](std::size_t i) {
+        std::size_t k = (i * 2) % refs.size();
+        g.del_node(refs[k]);
+        Node<> node("page");
+        refs[k] = g.add_node(node);
+    });
+    std::cout << "  churn : " << g.size() << " nodes, " << g.slot_count() << " slots, live bytes delta "
+              << static_cast<long long>(bench_live_bytes()) - static_cast<long long>(before) << std::endl;
+    bench_keep(sum);
+}
+
+/**
+ * @brief Delete the highest in-degree pages (hubs) of a power-law graph
+ */
+inline void bench_del_hubs()
+{
+    using namespace jsc;
+    std::cout << "bench_del_hubs()" << std::endl;
+
+    std::vector<NodeRef> refs;
+    AdjGraph<> g = bench_make_graph(100000, 16, refs);
+
+    // Targets are sampled by rank, so the first pages are the hubs
+    constexpr std::size_t n_hubs = 100;
+    std::size_t degree = 0;
+    for (std::size_t i = 0; i < n_hubs; i++)
+        degree += g.get_backlinks(refs[i]).size() + g.get_edges(refs[i]).size();
+
+    double ns = bench_run("del_node (hub)", n_hubs, [&](std::size_t i) { g.del_node(refs[i]); });
+    std::cout << "  hubs : average degree " << degree / n_hubs << ", " << ns * n_hubs / degree << " ns/edge" << std::endl;
+
+    // Navigation pages linking to every other page, including the popular ones with long backlink lists
+    constexpr std::size_t n_nav = 10;
+    std::vector<NodeRef> nav;
+    for (std::size_t k = 0; k < n_nav; k++) {
+        Node<> node("navigation " + std::to_string(k));
+        WidgetTree<> tree(std::string("RootWebArea"));
+        for (std::size_t i = n_hubs; i < refs.size(); i++)
+            tree.add_child(0, "link");
+        node.set_widget(std::move(tree));
+        nav.push_back(g.add_node(node));
+        for (std::size_t i = n_hubs; i < refs.size(); i++) {
+            Hyperlink<> h(g.get_node(nav.back()), g.get_node(refs[i]), g.get_widget(nav.back()).child(i - n_hubs));
+            g.add_edge(h);
+        }
+    }
+    ns = bench_run("del_node (navigation page)", n_nav, [&](std::size_t k) { g.del_node(nav[k]); });
+    std::cout << "  navigation : degree " << refs.size() - n_hubs << ", " << ns / (refs.size() - n_hubs) << " ns/edge" << std::endl;
+}
+
+/**
+ * @brief Compare sequential add_node/add_edge construction against GraphBuilder
+ */
+inline void bench_graph_builder()
+{
+    using namespace jsc;
+    std::cout << "bench_graph_builder()" << std::endl;
+
+    constexpr std::size_t n = 200000, out_deg = 16;
+    auto pairs = bench_make_edges(n, out_deg);
+    std::vector<Node<>> pages;
+    pages.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+        pages.push_back(bench_make_page(i, out_deg));
+
+    std::size_t sum = 0;
+    bench_run("sequential add_node + add_edge", 1, [&](std::size_t) {
+        AdjGraph<> g;
+        std::vector<NodeRef> refs;
+        for (auto node : pages)
+            refs.push_back(g.add_node(node));
+        for (std::size_t e = 0; e < pairs.size(); e++) {
+            auto [from, to] = pairs[e];
+            Hyperlink<> h(g.get_node(refs[from]), g.get_node(refs[to]), g.get_widget(refs[from]).child(e % out_deg));
+            g.add_edge(h);
+        }
+        sum += g.size();
+    });
+
+    std::vector<std::size_t> threads = {1};
+    if (default_threads() > 1)
+        threads.push_back(default_threads());
+    for (std::size_t n_threads : threads) {
+        bench_run("GraphBuilder, " + std::to_string(n_threads) + " threads", 1, [&](std::size_t) {
+            GraphBuilder<> builder;
+            builder.reserve(n, pairs.size());
+            for (const auto& page : pages)
+                builder.add_node(page);
+            for (std::size_t e = 0; e < pairs.size(); e++)
+                builder.add_edge(pairs[e].first, pairs[e].second, static_cast<WidgetIdx>(1 + e % out_deg));
+            sum += builder.build(n_threads).size();
+        });
+    }
+    bench_keep(sum);
+}
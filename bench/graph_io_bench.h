@@ -0,0 +1,47 @@
+#pragma once
+#include "bench.h"
+#include "graph_bench.h"
+#include "graph_io.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Compare opening a saved graph with mmap against deserializing it and against rebuilding it
+ */
+inline void bench_graph_io()
+{
+    using namespace jsc;
+    std::cout << "bench_graph_io()" << std::endl;
+
+    std::vector<NodeRef> refs;
+    AdjGraph<> g;
+    bench_run("rebuild (add_node + add_edge)", 1, [&](std::size_t) { g = bench_make_graph(200000, 16, refs); });
+    for (std::size_t i = 0; i < refs.size(); i += 7)
+        g.get_node(refs[i]).set("geometry", {0.0, 0.0, 1920.0, static_cast<double>(i)});
+
+    const std::string path = (std::filesystem::temp_directory_path() / "jsc_bench_graph.bin").string();
+    bench_run("save", 1, [&](std::size_t) { g.save(path); });
+    std::cout << "  file size : " << std::filesystem::file_size(path) / (1 << 20) << " MiB" << std::endl;
+
+    MappedGraph m;
+    bench_run("open (mmap, no verification)", 1, [&](std::size_t) { m = MappedGraph(path); });
+    bench_run("verify all sections", 1, [&](std::size_t) {
+        for (std::uint32_t s = 0; s < static_cast<std::uint32_t>(GraphSection::Count); s++)
+            bench_keep(m.verify(static_cast<GraphSection>(s)));
+    });
+
+    std::size_t sum = 0;
+    bench_run("neighbors (mapped, per node)", m.n_nodes(), [&](std::size_t u) {
+        for (auto v : m.neighbors(static_cast<MappedGraph::index_type>(u)))
+            sum += v;
+    });
+    bench_run("attribute lookup (mapped)", m.n_nodes() / 7, [&](std::size_t i) {
+        sum += static_cast<std::size_t>(m.node_attrs(static_cast<MappedGraph::index_type>(i * 7)).get("geometry").at_f64(3));
+    });
+    bench_run("load (deserialize)", 1, [&](std::size_t) { sum += m.load().size(); });
+    bench_keep(sum);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,165 @@
+#include "bench.h"
+#include "attr_bench.h"
+#include "attr_value_bench.h"
+#include "widget_bench.h"
+#include "graph_bench.h"
+#include "graph_io_bench.h"
+#include "webui_bench.h"
+#include "webui_dataset_bench.h"
+#include "spatial_bench.h"
+#include "geometry_bench.h"
+#include "traversal_bench.h"
+#include "pagerank_bench.h"
+#include "ann_bench.h"
+#include "text_index_bench.h"
+#include "gather_bench.h"
+#include "snapshot_bench.h"
+#include "sharded_graph_bench.h"
+#include "core_bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Updated from the worker threads of the parallel benches, relaxed ordering is enough for counters
+static std::atomic<std::size_t> g_live_bytes{0};
+static std::atomic<std::size_t> g_alloc_count{0};
+static std::atomic<std::size_t> g_alloc_bytes{0};
+
+std::size_t bench_live_bytes() { return g_live_bytes.load(std::memory_order_relaxed); }
+std::size_t bench_alloc_count() { return g_alloc_count.load(std::memory_order_relaxed); }
+std::size_t bench_alloc_bytes() { return g_alloc_bytes.load(std::memory_order_relaxed); }
+
+static void count_alloc(std::size_t size)
+{
+    g_live_bytes.fetch_add(size, std::memory_order_relaxed);
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+// Counting allocator: every allocation carries its size in a header
+void* operator new(std::size_t size)
+{
+    auto* p = static_cast<std::size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!p) throw std::bad_alloc{};
+    *p = size;
+    count_alloc(size);
+    return reinterpret_cast<char*>(p) + sizeof(std::max_align_t);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr) return;
+    auto* p = reinterpret_cast<std::size_t*>(static_cast<char*>(ptr) - sizeof(std::max_align_t));
+    g_live_bytes.fetch_sub(*p, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+
+// Over-aligned allocations, the header takes a whole alignment unit so the returned pointer stays aligned
+void* operator new(std::size_t size, std::align_val_t al)
+{
+    const std::size_t align = std::max(static_cast<std::size_t>(al), sizeof(std::max_align_t));
+    auto* p = static_cast<std::size_t*>(std::aligned_alloc(align, (size + 2 * align - 1) / align * align));
+    if (!p) throw std::bad_alloc{};
+    *p = size;
+    count_alloc(size);
+    return reinterpret_cast<char*>(p) + align;
+}
+
+void operator delete(void* ptr, std::align_val_t al) noexcept
+{
+    if (!ptr) return;
+    const std::size_t align = std::max(static_cast<std::size_t>(al), sizeof(std::max_align_t));
+    auto* p = reinterpret_cast<std::size_t*>(static_cast<char*>(ptr) - align);
+    g_live_bytes.fetch_sub(*p, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t al) noexcept { operator delete(ptr, al); }
+
+static const struct {
+    const char* name;
+    void (*run)();
+} g_groups[] = {
+    {"bench_attr_keys", bench_attr_keys},
+    {"bench_attr_storage", bench_attr_storage},
+    {"bench_attr_value", bench_attr_value},
+    {"bench_widget_tree", bench_widget_tree},
+    {"bench_csr_snapshot", bench_csr_snapshot},
+    {"bench_slot_map", bench_slot_map},
+    {"bench_del_hubs", bench_del_hubs},
+    {"bench_graph_builder", bench_graph_builder},
+    {"bench_graph_io", bench_graph_io},
+    {"bench_webui_loader", bench_webui_loader},
+    {"bench_webui_dataset", bench_webui_dataset},
+    {"bench_widget_index", bench_widget_index},
+    {"bench_box_kernels", bench_box_kernels},
+    {"bench_bfs", bench_bfs},
+    {"bench_pagerank", bench_pagerank},
+    {"bench_ann_index", bench_ann_index},
+    {"bench_text_index", bench_text_index},
+    {"bench_coo_export", bench_coo_export},
+    {"bench_graph_snapshot", bench_graph_snapshot},
+    {"bench_sharded_graph", bench_sharded_graph},
+    {"bench_core_ops", bench_core_ops},
+};
+
+static void usage()
+{
+    std::cout << "usage : bench [--filter SUBSTR] [--scale X] [--repetitions N] [--warmup N] [--json PATH] [--baseline PATH] [--threshold X] [--list]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig& config = bench_config();
+    for (int k = 1; k < argc; k++) {
+        const char* arg = argv[k];
+        const bool has_value = k + 1 < argc;
+        if (!std::strcmp(arg, "--list")) {
+            for (const auto& group : g_groups)
+                std::cout << group.name << std::endl;
+            return 0;
+        } else if (!std::strcmp(arg, "--filter") && has_value) {
+            config.filter = argv[++k];
+        } else if (!std::strcmp(arg, "--scale") && has_value) {
+            config.scale = std::atof(argv[++k]);
+        } else if (!std::strcmp(arg, "--repetitions") && has_value) {
+            config.repetitions = static_cast<std::size_t>(std::atol(argv[++k]));
+        } else if (!std::strcmp(arg, "--warmup") && has_value) {
+            config.warmup = static_cast<std::size_t>(std::atol(argv[++k]));
+        } else if (!std::strcmp(arg, "--json") && has_value) {
+            config.json_path = argv[++k];
+        } else if (!std::strcmp(arg, "--baseline") && has_value) {
+            config.baseline_path = argv[++k];
+        } else if (!std::strcmp(arg, "--threshold") && has_value) {
+            config.threshold = std::atof(argv[++k]);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> baseline;
+    if (!config.baseline_path.empty())
+        baseline = bench_read_json(config.baseline_path); // fail before running anything
+
+    for (const auto& group : g_groups) {
+        if (!config.filter.empty() && std::string(group.name).find(config.filter) == std::string::npos)
+            continue;
+        bench_group() = group.name;
+        group.run();
+    }
+    if (!config.json_path.empty() && !bench_write_json(config.json_path)) {
+        std::cerr << "cannot write " << config.json_path << std::endl;
+        return 1;
+    }
+    const std::size_t n_regressions = config.baseline_path.empty() ? 0 : bench_compare(baseline, config.threshold);
+    std::cout << "===========" << std::endl << "BENCH DONE" << std::endl;
+    return n_regressions ? 2 : 0;
+}
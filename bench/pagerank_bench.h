@@ -0,0 +1,47 @@
+#pragma once
+#include "bench.h"
+#include "pagerank.h"
+#include "traversal_bench.h"
+#include <iostream>
+#include <random>
+
+inline void bench_pagerank()
+{
+    using namespace jsc;
+    std::cout << "bench_pagerank()" << std::endl;
+
+    constexpr std::size_t n = 200000;
+    CsrGraph<> g = bench_make_csr(n, 8);
+    std::mt19937 rng(9);
+    std::vector<std::uint32_t> seeds(64);
+    for (auto& s : seeds)
+        s = static_cast<std::uint32_t>(rng() % n);
+
+    std::vector<std::size_t> threads = {1};
+    if (default_threads() > 1)
+        threads.push_back(default_threads());
+    std::size_t sum = 0;
+    for (std::size_t n_threads : threads) {
+        PageRankOptions opts;
+        opts.n_threads = n_threads;
+        opts.tol = 1e-6;
+        PageRankResult res;
+        bench_run("power iteration (tol 1e-6), " + std::to_string(n_threads) + " threads", 4, [&](std::size_t i) {
+            res = personalized_pagerank(g, {seeds[i]}, opts);
+            sum += top_k_scores(res.scores, 10).size();
+        });
+        std::cout << "  " << res.n_iter << " iterations" << std::endl;
+    }
+
+    PprPush<> push(g);
+    for (double epsilon : {1e-4, 1e-6}) {
+        std::size_t touched = 0;
+        bench_run("push (epsilon " + std::to_string(epsilon) + ") + top 10", seeds.size(), [&](std::size_t i) {
+            push.run({seeds[i]}, 0.85, epsilon);
+            sum += push.top_k(10).size();
+            touched += push.n_touched();
+        });
+        std::cout << "  " << touched / seeds.size() << " nodes touched per query" << std::endl;
+    }
+    bench_keep(sum);
+}
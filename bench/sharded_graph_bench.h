@@ -0,0 +1,75 @@
+#pragma once
+#include "bench.h"
+#include "graph_bench.h"
+#include "sharded_graph.h"
+#include <iostream>
+#include <thread>
+
+/**
+ * @brief Insertion of 200k prebuilt pages and 1.6M links : sequential AdjGraph against ShardedGraph with 1 writer and with one writer per core
+ */
+inline void bench_sharded_graph()
+{
+    using namespace jsc;
+    std::cout << "bench_sharded_graph()" << std::endl;
+
+    constexpr std::size_t n = 200000, out_deg = 8;
+    const auto edges = bench_make_edges(n, out_deg);
+    std::vector<std::vector<std::pair<std::size_t, std::size_t>>> by_source(n);
+    for (const auto& [from, to] : edges)
+        by_source[from].emplace_back(to, by_source[from].size() + 1);
+    auto make_pages = [&]() {
+        std::vector<Node<>> pages;
+        pages.reserve(n);
+        for (std::size_t i = 0; i < n; i++)
+            pages.push_back(bench_make_page(i, out_deg));
+        return pages;
+    };
+
+    std::vector<Node<>> pages = make_pages();
+    bench_run("AdjGraph add_node + add_edge", 1, [&](std::size_t) {
+        AdjGraph<> g;
+        std::vector<NodeRef> refs;
+        refs.reserve(n);
+        for (std::size_t i = 0; i < n; i++)
+            refs.push_back(g.add_node(pages[i]));
+        std::vector<std::size_t> used(n, 0);
+        for (const auto& [from, to] : edges) {
+            Hyperlink<> h(g.get_node(refs[from]), g.get_node(refs[to]), g.get_widget(refs[from]).child(used[from]++));
+            g.add_edge(h);
+        }
+        bench_keep(g.size());
+    });
+
+    std::vector<std::size_t> writer_counts{1};
+    if (default_threads() > 1)
+        writer_counts.push_back(default_threads());
+    for (std::size_t n_threads : writer_counts) {
+        ShardedGraph<> g;
+        std::vector<NodeRef> refs(n);
+        pages = make_pages();
+        auto run = [&](auto&& body) {
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < n_threads; t++)
+                threads.emplace_back([&, t] {
+                    auto w = g.writer();
+                    for (std::size_t i = t * n / n_threads; i < (t + 1) * n / n_threads; i++)
+                        body(w, i);
+                });
+            for (auto& th : threads)
+                th.join();
+        };
+        const std::string suffix = " (" + std::to_string(n_threads) + " writers)";
+        bench_run("ShardedGraph add_node" + suffix, 1, [&](std::size_t) {
+            run([&](auto& w, std::size_t i) { refs[i] = w.add_node(std::move(pages[i])); });
+        });
+        bench_run("ShardedGraph add_edge" + suffix, 1, [&](std::size_t) {
+            run([&](auto& w, std::size_t i) {
+                for (const auto& [to, widget] : by_source[i])
+                    w.add_edge(refs[i], refs[to], static_cast<WidgetIdx>(widget));
+            });
+        });
+        bench_run("ShardedGraph sync" + suffix, 1, [&](std::size_t) { g.sync(false, n_threads); });
+        bench_keep(g.n_edges());
+    }
+}
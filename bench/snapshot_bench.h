@@ -0,0 +1,74 @@
+#pragma once
+#include "bench.h"
+#include "graph_bench.h"
+#include "snapshot.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+/**
+ * @brief Reader latency of a VersionedGraph (snapshot + 1-hop lookup) alone and while a writer ingests and publishes, and the cost of a publish
+ */
+inline void bench_graph_snapshot()
+{
+    using namespace jsc;
+    std::cout << "bench_graph_snapshot()" << std::endl;
+
+    constexpr std::size_t n = 100000, out_deg = 8, batch = 1000;
+    VersionedGraph<> g;
+    std::vector<NodeRef> refs;
+    refs.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+        refs.push_back(g.add_node(bench_make_page(i, out_deg)));
+    std::vector<std::size_t> used(n, 0);
+    for (const auto& [from, to] : bench_make_edges(n, out_deg))
+        g.add_edge(refs[from], refs[to], static_cast<WidgetIdx>(1 + used[from]++));
+    g.publish();
+
+    std::mt19937_64 rng(7);
+    std::vector<std::size_t> queries(200000);
+    for (auto& q : queries)
+        q = rng() % n;
+    std::size_t sum = 0;
+    auto query = [&](std::size_t i) {
+        GraphSnapshot<> s = g.snapshot();
+        const NodeRef ref(queries[i % queries.size()]);
+        for (const auto& e : s.get_edges(ref))
+            sum += s.get_backlinks(e.to).size();
+    };
+    bench_run("snapshot + 1-hop, idle writer", queries.size(), query);
+
+    // The writer keeps adding pages linking to the existing ones, publishing every batch
+    std::atomic<bool> stop{false};
+    std::atomic<std::size_t> n_added{0};
+    std::thread writer([&] {
+        std::size_t i = n;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (std::size_t j = 0; j < batch; j++, i++) {
+                NodeRef ref = g.add_node(bench_make_page(i, 2));
+                g.add_edge(ref, refs[i % n], 1);
+                g.add_edge(ref, refs[(i * 31) % n], 2);
+            }
+            g.publish();
+            n_added.fetch_add(batch, std::memory_order_relaxed);
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    bench_run("snapshot + 1-hop, writer ingesting", queries.size(), query);
+    stop = true;
+    writer.join();
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  writer : " << n_added.load() / s << " nodes/s, " << g.version() << " versions, " << g.n_retired() << " retired" << std::endl;
+
+    std::size_t i = 2 * n;
+    bench_run("add 1000 pages + publish", 20, [&](std::size_t) {
+        for (std::size_t j = 0; j < batch; j++, i++) {
+            NodeRef ref = g.add_node(bench_make_page(i, 2));
+            g.add_edge(ref, refs[i % n], 1);
+        }
+        g.publish();
+    });
+    bench_keep(sum);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "bench.h"
+#include "spatial.h"
+
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief AX tree sized page layout (nested boxes, ~10% of the widgets without geometry) for the spatial index benches
+ */
+inline jsc::WidgetTree<std::string> bench_make_layout(std::size_t n, std::mt19937& rng)
+{
+    using namespace jsc;
+    WidgetTree<std::string> tree("RootWebArea");
+    tree.attrs(0).set("geometry", {0.0, 0.0, 1920.0, 8000.0});
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    // Depth-first construction: mostly descend, sometimes climb back up, like a real document. Widgets without geometry pass their parent's box down
+    std::vector<std::pair<WidgetIdx, std::array<double, 4>>> path{{0, {0.0, 0.0, 1920.0, 8000.0}}};
+    while (tree.size() < n) {
+        auto [parent, p] = path.back();
+        WidgetIdx w = tree.add_child(parent, "generic");
+        std::array<double, 4> box = p;
+        if (rng() % 10) {
+            double x = p[0] + unit(rng) * p[2] * 0.5, y = p[1] + unit(rng) * p[3] * 0.5;
+            box = {x, y, (p[0] + p[2] - x) * (0.3 + 0.7 * unit(rng)), (p[1] + p[3] - y) * (0.1 + 0.5 * unit(rng))};
+            tree.attrs(w).set("geometry", {box[0], box[1], box[2], box[3]});
+        }
+        if (rng() % 3 == 0 && path.size() < 40)
+            path.emplace_back(w, box);
+        else if (rng() % 4 == 0 && path.size() > 1)
+            path.pop_back();
+    }
+    return tree;
+}
+
+/**
+ * @brief Compare hit testing, viewport queries and k nearest widgets on the index with full tree walks
+ */
+inline void bench_widget_index()
+{
+    using namespace jsc;
+    std::cout << "bench_widget_index()" << std::endl;
+
+    std::mt19937 rng(5);
+    for (std::size_t n : {2000, 20000}) {
+        WidgetTree<std::string> tree = bench_make_layout(n, rng);
+        const AttrKey key = AttrSet<std::string>::key("geometry");
+        std::cout << "  page : " << n << " widgets" << std::endl;
+
+        WidgetIndex index;
+        bench_run("build", 20, [&](std::size_t) { index.build(tree); });
+
+        std::uniform_real_distribution<double> px(0.0, 1920.0), py(0.0, 8000.0);
+        std::vector<std::pair<double, double>> points(1000);
+        for (auto& p : points)
+            p = {px(rng), py(rng)};
+
+        std::size_t sum = 0;
+        bench_run("deepest_at (tree walk)", points.size(), [&](std::size_t i) {
+            auto [x, y] = points[i];
+            std::vector<std::size_t> depth(tree.size(), 0);
+            WidgetIdx best = widget_npos;
+            for (WidgetIdx w = 0; w < tree.size(); w++) {
+                if (w)
+                    depth[w] = depth[tree.links(w).parent] + 1;
+                const AttrValue<std::string>* g = tree.attrs(w).get(key);
+                if (g && g->at_f64(0) <= x && x <= g->at_f64(0) + g->at_f64(2) && g->at_f64(1) <= y && y <= g->at_f64(1) + g->at_f64(3) &&
+                    (best == widget_npos || depth[w] >= depth[best]))
+                    best = w;
+            }
+            sum += best;
+        });
+        bench_run("deepest_at (index)", points.size(), [&](std::size_t i) { sum += index.deepest_at(points[i].first, points[i].second); });
+        bench_run("viewport 1920x1080 (tree walk)", points.size(), [&](std::size_t i) {
+            double y = points[i].second;
+            for (WidgetIdx w = 0; w < tree.size(); w++) {
+                const AttrValue<std::string>* g = tree.attrs(w).get(key);
+                sum += g && g->at_f64(1) <= y + 1080 && y <= g->at_f64(1) + g->at_f64(3);
+            }
+        });
+        bench_run("viewport 1920x1080 (index)", points.size(), [&](std::size_t i) {
+            index.query(0, points[i].second, 1920, 1080, [&](WidgetIdx) { sum++; });
+        });
+        bench_run("nearest 10 (index)", points.size(), [&](std::size_t i) { sum += index.nearest(points[i].first, points[i].second, 10).size(); });
+
+        for (WidgetIdx w = 1; w < tree.size(); w += 50)
+            if (AttrValue<std::string>* g = tree.attrs(w).get(key))
+                g->at_f64(1) += 10;
+        bench_run("refresh (2% moved)", 1, [&](std::size_t) { sum += index.refresh(tree); });
+        bench_keep(sum);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "bench.h"
+#include "text_index.h"
+#include <iostream>
+#include <random>
+
+inline void bench_text_index()
+{
+    using namespace jsc;
+    std::cout << "bench_text_index()" << std::endl;
+
+    // Widget labels over a skewed vocabulary of 20k words
+    constexpr std::size_t n = 20000, n_widgets = 16, vocab = 20000;
+    std::mt19937 rng(21);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto word = [&]() {
+        const double u = unit(rng);
+        return "w" + std::to_string(static_cast<std::size_t>(vocab * u * u * u));
+    };
+    auto sentence = [&](std::size_t len) {
+        std::string s = word();
+        for (std::size_t i = 1; i < len; i++)
+            s += " " + word();
+        return s;
+    };
+
+    AdjGraph<> g;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<> node("page " + std::to_string(i));
+        WidgetTree<> tree{std::string()};
+        for (std::size_t j = 0; j < n_widgets; j++) {
+            // Named like WebUI widgets, after their AX name
+            const std::string label = sentence(1 + rng() % 8);
+            WidgetIdx w = tree.add_child(0, label);
+            tree.attrs(w).set("role", AttrValue<>(std::string(j % 2 ? "link" : "button")));
+            tree.attrs(w).set("name", AttrValue<>(label));
+        }
+        node.set_widget(std::move(tree));
+        g.add_node(node);
+    }
+    std::vector<std::string> queries(64);
+    for (auto& q : queries)
+        q = sentence(2 + rng() % 3);
+
+    TextIndex<> index;
+    std::size_t sum = 0;
+    bench_run("text_index build", 1, [&](std::size_t) { sum += index.build(g); });
+    std::cout << "  " << index.n_docs() << " docs, " << index.n_terms() << " terms, " << index.memory_usage() / 1024 << " KiB of postings" << std::endl;
+
+    for (std::size_t k : {10, 100}) {
+        const std::string suffix = " k=" + std::to_string(k);
+        bench_run("text_index search wand" + suffix, queries.size(), [&](std::size_t i) { sum += index.search(queries[i], k).size(); });
+        bench_run("text_index search exhaustive" + suffix, queries.size(), [&](std::size_t i) { sum += index.search_exhaustive(queries[i], k).size(); });
+    }
+
+    // Baseline : tokenize every widget label and count the query terms
+    const AttrKey name = AttrSet<>::key("name");
+    bench_run("widget walk", 4, [&](std::size_t i) {
+        std::vector<std::string> terms;
+        text_tokenize(queries[i], [&](std::string_view t) { terms.emplace_back(t); });
+        g.each([&](const AdjGraph<>::NodeData& nd) {
+            const WidgetTree<>& tree = nd.node.widget_tree();
+            for (WidgetIdx w = 0; w < tree.size(); w++) {
+                const AttrValue<>* v = tree.attrs(w).get(name);
+                if (v && v->is_str())
+                    text_tokenize(v->str(), [&](std::string_view t) {
+                        for (const auto& term : terms)
+                            sum += term == t;
+                    });
+            }
+        });
+    });
+
+    // Incremental updates : replace a node, drop and re-add it
+    std::vector<NodeRef> refs;
+    g.each([&](const AdjGraph<>::NodeData& nd) { refs.push_back(NodeRef(nd.node)); });
+    bench_run("text_index remove + add node", 1000, [&](std::size_t i) {
+        const NodeRef& ref = refs[(i * 7919) % refs.size()];
+        index.remove_node(ref);
+        sum += index.add_node(g.get_node(ref));
+    });
+    bench_keep(sum);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "bench.h"
+#include "graph_bench.h"
+#include "graph_builder.h"
+#include "traversal.h"
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Power-law link graph (see bench_make_edges()) frozen into a CsrGraph, in-degrees follow a Pareto distribution
+ */
+inline jsc::CsrGraph<> bench_make_csr(std::size_t n, std::size_t out_deg)
+{
+    using namespace jsc;
+    GraphBuilder<> builder;
+    builder.reserve(n, n * out_deg);
+    for (std::size_t i = 0; i < n; i++)
+        builder.add_node(bench_make_page(i, out_deg));
+    std::vector<std::size_t> used(n, 0);
+    for (const auto& [from, to] : bench_make_edges(n, out_deg))
+        builder.add_edge(from, to, static_cast<WidgetIdx>(1 + used[from]++));
+    return builder.build().freeze();
+}
+
+inline void bench_bfs()
+{
+    using namespace jsc;
+    std::cout << "bench_bfs()" << std::endl;
+
+    constexpr std::size_t n = 200000;
+    CsrGraph<> g = bench_make_csr(n, 8);
+
+    std::mt19937 rng(3);
+    std::vector<std::uint32_t> seeds(16);
+    for (auto& s : seeds)
+        s = static_cast<std::uint32_t>(rng() % n);
+
+    std::vector<std::size_t> threads = {1};
+    if (default_threads() > 1)
+        threads.push_back(default_threads());
+    std::size_t sum = 0;
+    for (Direction dir : {Direction::Out, Direction::Both}) {
+        const std::string name = dir == Direction::Out ? "out" : "both";
+        for (std::size_t n_threads : threads) {
+            const std::string suffix = ", " + std::to_string(n_threads) + " threads";
+            BfsOptions opts;
+            opts.direction = dir;
+            opts.n_threads = n_threads;
+            opts.alpha = 1e-9; // never bottom-up
+            bench_run("bfs " + name + " top-down" + suffix, seeds.size(), [&](std::size_t i) { sum += bfs(g, {seeds[i]}, opts).n_reached; });
+            opts.alpha = BfsOptions{}.alpha;
+            bench_run("bfs " + name + " direction-optimizing" + suffix, seeds.size(), [&](std::size_t i) { sum += bfs(g, {seeds[i]}, opts).n_reached; });
+        }
+    }
+    BfsResult res = bfs(g, {seeds[0]}, BfsOptions{Direction::Both});
+    std::cout << "  " << res.n_reached << " nodes reached in " << res.n_levels << " levels, " << res.n_bottom_up << " bottom-up" << std::endl;
+
+    for (std::uint32_t k : {1, 2, 3})
+        bench_run("k_hop both k=" + std::to_string(k), seeds.size(), [&](std::size_t i) { sum += k_hop(g, {seeds[i]}, k).size(); });
+    bench_keep(sum);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "bench.h"
+#include "webui.h"
+
+#include <filesystem>
+#include <string>
+#include <zlib.h>
+
+
+/**
+ * @brief Synthetic AX tree in the WebUI layout : a chain of containers with `fanout` children each, every node carries the usual CDP noise (properties, sources)
+ */
+inline std::string bench_make_axtree(std::size_t n_nodes, std::size_t fanout)
+{
+    std::string s = "{\"nodes\": [";
+    for (std::size_t i = 0; i < n_nodes; i++) {
+        if (i) s += ", ";
+        s += "{\"nodeId\": \"" + std::to_string(i + 1) + "\", \"ignored\": " + (i % 5 == 3 ? "true" : "false");
+        s += ", \"role\": {\"type\": \"role\", \"value\": \"" + std::string(i % 3 ? "link" : "generic") + "\"}";
+        s += ", \"name\": {\"type\": \"computedString\", \"value\": \"Widget \\\"" + std::to_string(i) + "\\\" caf\\u00e9\", \"sources\": [{\"type\": \"attribute\", \"attribute\": \"aria-label\"}]}";
+        s += ", \"properties\": [{\"name\": \"focusable\", \"value\": {\"type\": \"booleanOrUndefined\", \"value\": true}}]";
+        if (i) s += ", \"parentId\": \"" + std::to_string((i - 1) / fanout + 1) + "\"";
+        s += ", \"childIds\": [";
+        for (std::size_t c = i * fanout + 1; c <= i * fanout + fanout && c < n_nodes; c++)
+            s += (c == i * fanout + 1 ? "\"" : ", \"") + std::to_string(c + 1) + "\"";
+        s += "], \"backendDOMNodeId\": " + std::to_string(i + 100) + "}";
+    }
+    return s + "]}";
+}
+
+inline void bench_webui_loader()
+{
+    using namespace jsc;
+    std::cout << "bench_webui_loader()" << std::endl;
+
+    const std::size_t n_ax = 20000;
+    std::string axtree = bench_make_axtree(n_ax, 4), bb = "{";
+    for (std::size_t i = 0; i < n_ax; i++)
+        bb += (i ? ", \"" : "\"") + std::to_string(i + 100) + "\": {\"x\": " + std::to_string(i % 1280) + ", \"y\": " + std::to_string(i) +
+              ", \"width\": 120.5, \"height\": 18, \"top\": 0, \"left\": 0}";
+    bb += "}";
+
+    const auto dir = std::filesystem::temp_directory_path() / "jsc_bench_webui";
+    std::filesystem::create_directories(dir);
+    for (auto [name, data] : {std::pair{"page-axtree.json.gz", &axtree}, std::pair{"page-bb.json.gz", &bb}}) {
+        gzFile f = gzopen((dir / name).string().c_str(), "wb");
+        gzwrite(f, data->data(), static_cast<unsigned>(data->size()));
+        gzclose(f);
+    }
+    std::cout << "  page : " << n_ax << " AX nodes, " << (axtree.size() + bb.size()) / 1024 << " KiB of JSON" << std::endl;
+
+    std::size_t sum = 0;
+    bench_run("parse (memory, no geometry)", 1, [&](std::size_t) {
+        MemorySource src(axtree);
+        sum += WebuiPageLoader<>().load_source("page", src).widget_tree().size();
+    });
+    double ns = bench_run("load page (gzip, axtree + bb)", 10, [&](std::size_t) {
+        sum += load_webui_page<>(dir.string(), "page").widget_tree().size();
+    });
+    std::cout << "  " << (axtree.size() + bb.size()) / (ns / 1e3) << " MB/s of JSON, " << 1e9 / ns << " pages/s" << std::endl;
+    bench_keep(sum);
+    std::filesystem::remove_all(dir);
+}
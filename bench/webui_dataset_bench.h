@@ -0,0 +1,53 @@
+#pragma once
+#include "bench.h"
+#include "webui_bench.h"
+#include "webui_dataset.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+
+/**
+ * @brief Load a synthetic dataset split (pages with three screen variants each) with an increasing number of workers
+ */
+inline void bench_webui_dataset()
+{
+    using namespace jsc;
+    std::cout << "bench_webui_dataset()" << std::endl;
+
+    const std::size_t n_pages = 200, n_ax = 2000;
+    const std::string axtree = bench_make_axtree(n_ax, 4);
+    const auto root = std::filesystem::temp_directory_path() / "jsc_bench_webui_dataset";
+    std::filesystem::remove_all(root);
+    for (std::size_t i = 0; i < n_pages; i++) {
+        const auto dir = root / std::to_string(1655885631145 + i);
+        std::filesystem::create_directories(dir);
+        for (const std::string screen : {"default_1280-720", "default_1920-1080", "iPhone-13 Pro"}) {
+            for (const auto& type : webui_file_types())
+                std::ofstream((dir / (screen + "-" + type)).string()) << (type == "screenshot-full.webp" ? "RIFF" : "");
+            for (auto [type, data] : {std::pair<std::string, std::string>{"axtree", axtree}, {"bb", "{}"}, {"box", "{}"}}) {
+                gzFile f = gzopen((dir / (screen + "-" + type + ".json.gz")).string().c_str(), "wb");
+                gzwrite(f, data.data(), static_cast<unsigned>(data.size()));
+                gzclose(f);
+            }
+        }
+    }
+
+    std::vector<std::size_t> threads = {1};
+    for (std::size_t t = 2; t <= default_threads(); t *= 2)
+        threads.push_back(t);
+    if (threads.back() != default_threads())
+        threads.push_back(default_threads());
+    for (std::size_t n_threads : threads) {
+        WebuiDatasetOptions opts;
+        opts.n_threads = n_threads;
+        AdjGraph<> g;
+        WebuiDatasetStats stats = WebuiDatasetLoader<>(opts).load(root.string(), g);
+        std::cout << "  " << n_threads << " workers : " << stats.n_pages << " pages in " << stats.seconds << " s, " << stats.pages_per_sec() << " pages/s, "
+                  << stats.mb_per_sec() << " MB/s (gzip)" << std::endl;
+    }
+    std::filesystem::remove_all(root);
+}
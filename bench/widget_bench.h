@@ -0,0 +1,88 @@
+#pragma once
+#include "bench.h"
+#include "graph.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Build an AXTree-shaped widget: fanout children per level, every widget carries a role and a geometry
+ */
+inline jsc::Widget<> bench_make_widget(std::size_t depth, std::size_t fanout)
+{
+    jsc::Widget<> w("widget");
+    w.set("role", std::string("generic"));
+    w.set("geometry", {0.0, 0.0, 100.0, 20.0});
+    if (depth > 0)
+        for (std::size_t i = 0; i < fanout; i++)
+            w.add_child(bench_make_widget(depth - 1, fanout));
+    return w;
+}
+
+/**
+ * @brief Build a WidgetTree shaped like a WebUI AXTree with about n_widgets widgets, in preorder. Each section is a chain of depth generic containers
+ * hanging from a random ancestor of the previous section, ending in a list of fanout items (listitem > link > StaticText). Large depth gives deep
+ * trees, large fanout wide ones. Every widget carries a role, a name and a geometry
+ */
+inline jsc::WidgetTree<> bench_make_axtree(std::size_t n_widgets, std::size_t depth, std::size_t fanout, unsigned seed = 42)
+{
+    using namespace jsc;
+    std::mt19937 rng(seed);
+    WidgetTree<> tree;
+    auto add = [&](WidgetIdx parent, const char* role) {
+        WidgetIdx w = parent == widget_npos ? tree.add_root(role) : tree.add_child(parent, role);
+        AttrSet<>& attrs = tree.attrs(w);
+        attrs.set("role", std::string(role));
+        attrs.set("name", std::string(role) + " " + std::to_string(w));
+        attrs.set("geometry", {0.0, 20.0 * w, 1280.0, 20.0});
+        return w;
+    };
+
+    std::vector<WidgetIdx> path{add(widget_npos, "RootWebArea")}; // containers on the rightmost path
+    while (tree.size() < n_widgets) {
+        path.resize(1 + rng() % path.size());
+        for (std::size_t d = 0; d < depth && tree.size() < n_widgets; d++)
+            path.push_back(add(path.back(), "generic"));
+        const WidgetIdx list = add(path.back(), "list");
+        for (std::size_t k = 0; k < fanout && tree.size() + 3 <= n_widgets; k++)
+            add(add(add(list, "listitem"), "link"), "StaticText");
+    }
+    return tree;
+}
+
+inline double bench_walk_widget(const jsc::Widget<>& w, jsc::AttrKey geometry)
+{
+    double sum = w.get(geometry)->at_f64(2);
+    for (const auto& c : w.children())
+        sum += bench_walk_widget(c, geometry);
+    return sum;
+}
+
+/**
+ * @brief Compare full-tree scans over the recursive Widget and the flattened WidgetTree
+ */
+inline void bench_widget_tree()
+{
+    using namespace jsc;
+    std::cout << "bench_widget_tree()" << std::endl;
+
+    const AttrKey geometry = AttrSet<>::key("geometry");
+    Widget<> root = bench_make_widget(6, 4); // 5461 widgets
+    WidgetTree<> tree(root);
+    std::cout << "  widgets : " << tree.size() << std::endl;
+
+    double sum = 0;
+    bench_run("recursive Widget walk", 200, [&](std::size_t) {
+        sum += bench_walk_widget(root, geometry);
+    });
+    bench_run("WidgetTree linear sweep", 200, [&](std::size_t) {
+        for (const auto& a : tree.attrs_column())
+            sum += a.get(geometry)->at_f64(2);
+    });
+    bench_run("WidgetTree preorder walk", 200, [&](std::size_t) {
+        tree.each_preorder([&](ConstWidgetView<> w) { sum += w.get(geometry)->at_f64(2); });
+    });
+    bench_keep(sum);
+}
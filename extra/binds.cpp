@@ -1,4 +1,10 @@
 #include "graph.h"
+#include "geometry.h"
+#include "csr.h"
+#include "pagerank.h"
+#include "gather.h"
+#include "graph_builder.h"
+#include "stats.h"
 
 
 #include <nanobind/nanobind.h>
@@ -6,7 +12,12 @@
 #include <nanobind/stl/vector.h>
 #include <nanobind/stl/array.h>
 #include <nanobind/stl/variant.h>
+#include <nanobind/stl/pair.h>
+#include <nanobind/stl/tuple.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/make_iterator.h>
+#include <nanobind/ndarray.h>
+#include <optional>
 #include <sstream>
 
 
@@ -14,6 +25,230 @@ namespace nb = nanobind;
 using namespace nb::literals;
 using namespace jsc;
 
+/**
+ * @brief TraceScope as a Python context manager
+ */
+struct PyTraceScope {
+    std::string name;
+    std::optional<TraceScope> scope;
+};
+
+/**
+ * @brief Move a vector into a numpy array which owns it
+ */
+template <class T>
+nb::ndarray<nb::numpy, T> to_numpy(std::vector<T>&& v, std::initializer_list<std::size_t> shape)
+{
+    auto* owned = new std::vector<T>(std::move(v));
+    nb::capsule owner(owned, [](void* p) noexcept { delete static_cast<std::vector<T>*>(p); });
+    return nb::ndarray<nb::numpy, T>(owned->data(), shape, owner);
+}
+
+/**
+ * @brief Move a 0/1 byte vector into a numpy bool array which owns it
+ */
+inline nb::ndarray<nb::numpy, bool> to_numpy_mask(std::vector<std::uint8_t>&& v, std::initializer_list<std::size_t> shape)
+{
+    // The 0/1 bytes are valid numpy booleans
+    auto* owned = new std::vector<std::uint8_t>(std::move(v));
+    nb::capsule owner(owned, [](void* p) noexcept { delete static_cast<std::vector<std::uint8_t>*>(p); });
+    return nb::ndarray<nb::numpy, bool>(reinterpret_cast<bool*>(owned->data()), shape, owner);
+}
+
+template <class T>
+using Array1D = nb::ndarray<const T, nb::ndim<1>, nb::c_contig, nb::device::cpu>;
+
+template <class T>
+using Matrix = nb::ndarray<T, nb::ndim<2>, nb::c_contig, nb::device::cpu>;
+
+/**
+ * @brief Copy a 1D array into a vector in one pass, numpy converts other dtypes and strides first
+ */
+template <class T>
+std::vector<T> array_to_vector(nb::handle h)
+{
+    auto a = nb::cast<Array1D<T>>(h);
+    return std::vector<T>(a.data(), a.data() + a.shape(0));
+}
+
+/**
+ * @brief AttrValue of a numpy array, int64 for integer dtypes and float64 otherwise
+ */
+inline AttrValue<> array_to_attr(nb::handle h)
+{
+    const auto code = nb::cast<nb::ndarray<>>(h).dtype().code;
+    if (code == static_cast<std::uint8_t>(nb::dlpack::dtype_code::Int) || code == static_cast<std::uint8_t>(nb::dlpack::dtype_code::UInt))
+        return AttrValue<>(array_to_vector<std::int64_t>(h));
+    return AttrValue<>(array_to_vector<double>(h));
+}
+
+/**
+ * @brief Fill a preallocated (n_nodes, dim) matrix with a node attribute, returns the node ids and the mask of the rows set
+ */
+template <class T>
+auto gather_nodes_into(const AdjGraph<>& g, const std::string& key, Matrix<T> out)
+{
+    if (out.shape(0) != g.size())
+        throw nb::value_error("out must have one row per node");
+    std::vector<std::size_t> ids(g.size());
+    std::vector<std::uint8_t> found(g.size());
+    {
+        nb::gil_scoped_release release;
+        gather_node_attr(g, AttrSet<>::key(key), out.shape(1), out.data(), found.data(), ids.data());
+    }
+    return std::make_tuple(to_numpy(std::move(ids), {g.size()}), to_numpy_mask(std::move(found), {g.size()}));
+}
+
+/**
+ * @brief Fill a preallocated (n_widgets, dim) matrix with a widget attribute, returns the node id and widget index of each row and the mask of the rows set
+ */
+template <class T>
+auto gather_widgets_into(const AdjGraph<>& g, const std::string& key, Matrix<T> out)
+{
+    const std::size_t n = count_widgets(g);
+    if (out.shape(0) != n)
+        throw nb::value_error("out must have one row per widget");
+    std::vector<std::size_t> ids(n);
+    std::vector<WidgetIdx> widgets(n);
+    std::vector<std::uint8_t> found(n);
+    {
+        nb::gil_scoped_release release;
+        gather_widget_attr(g, AttrSet<>::key(key), out.shape(1), out.data(), found.data(), ids.data(), widgets.data());
+    }
+    return std::make_tuple(to_numpy(std::move(ids), {n}), to_numpy(std::move(widgets), {n}), to_numpy_mask(std::move(found), {n}));
+}
+
+/**
+ * @brief AttrValue of a Python object, checking the types instead of trying casts : str, int, float, AttrValue, numpy array, list or tuple of ints
+ * (int64) or of numbers (float64)
+ */
+inline AttrValue<> attr_from_object(nb::handle value)
+{
+    if (nb::isinstance<nb::str>(value))
+        return AttrValue<>(nb::cast<std::string>(value));
+    if (nb::isinstance<nb::float_>(value))
+        return AttrValue<>(nb::cast<double>(value));
+    if (nb::isinstance<nb::int_>(value))
+        return AttrValue<>(nb::cast<std::int64_t>(value));
+    if (nb::isinstance<AttrValue<>>(value))
+        return nb::cast<const AttrValue<>&>(value);
+    if (nb::ndarray_check(value))
+        return array_to_attr(value);
+    if (nb::isinstance<nb::list>(value) || nb::isinstance<nb::tuple>(value)) {
+        bool all_int = true;
+        for (nb::handle item : value) {
+            if (nb::isinstance<nb::float_>(item))
+                all_int = false;
+            else if (!nb::isinstance<nb::int_>(item))
+                throw nb::type_error("List must contain all ints or all floats");
+        }
+        if (all_int) {
+            std::vector<std::int64_t> v;
+            v.reserve(nb::len(value));
+            for (nb::handle item : value)
+                v.push_back(nb::cast<std::int64_t>(item));
+            return AttrValue<>(std::move(v));
+        }
+        std::vector<double> v;
+        v.reserve(nb::len(value));
+        for (nb::handle item : value)
+            v.push_back(nb::cast<double>(item));
+        return AttrValue<>(std::move(v));
+    }
+    throw nb::type_error("Unsupported value type");
+}
+
+/**
+ * @brief Set an attribute on n targets from a column : rows of a 2D array become float64 vectors, a 1D float or int array gives scalars, a list gives
+ * strings, replacing the values of existing keys. attrs_of(i) returns the attribute set of target i. The GIL is released while setting, so the
+ * object which owns the targets must not be used by another thread meanwhile
+ */
+template <class F>
+void set_column(std::size_t n, const std::string& key, nb::handle values, F attrs_of)
+{
+    const AttrKey k = AttrSet<>::key(key);
+    if (nb::ndarray_check(values)) {
+        auto a = nb::cast<nb::ndarray<>>(values);
+        if (a.ndim() < 1 || a.ndim() > 2 || a.shape(0) != n)
+            throw nb::value_error("values must be a 1D or 2D array with one row per target");
+        if (a.ndim() == 2) {
+            auto m = nb::cast<Matrix<const double>>(values);
+            const std::size_t dim = m.shape(1);
+            nb::gil_scoped_release release;
+            for (std::size_t i = 0; i < n; i++)
+                attrs_of(i).assign(k, AttrValue<>(std::vector<double>(m.data() + i * dim, m.data() + (i + 1) * dim)));
+            return;
+        }
+        const auto code = a.dtype().code;
+        if (code == static_cast<std::uint8_t>(nb::dlpack::dtype_code::Int) || code == static_cast<std::uint8_t>(nb::dlpack::dtype_code::UInt)) {
+            auto col = nb::cast<Array1D<std::int64_t>>(values);
+            nb::gil_scoped_release release;
+            for (std::size_t i = 0; i < n; i++)
+                attrs_of(i).assign(k, AttrValue<>(col.data()[i]));
+        } else {
+            auto col = nb::cast<Array1D<double>>(values);
+            nb::gil_scoped_release release;
+            for (std::size_t i = 0; i < n; i++)
+                attrs_of(i).assign(k, AttrValue<>(col.data()[i]));
+        }
+        return;
+    }
+    if (nb::isinstance<nb::list>(values) || nb::isinstance<nb::tuple>(values)) {
+        auto strs = nb::cast<std::vector<std::string>>(values);
+        if (strs.size() != n)
+            throw nb::value_error("values must have one entry per target");
+        nb::gil_scoped_release release;
+        for (std::size_t i = 0; i < n; i++)
+            attrs_of(i).assign(k, AttrValue<>(std::move(strs[i])));
+        return;
+    }
+    throw nb::type_error("values must be a numpy array or a list of strings");
+}
+
+/**
+ * @brief Iterator which maps the elements of another one with Map, for Python iterators over the graph which yield references instead of edges
+ */
+template <class It, auto Map>
+class MapIterator {
+public:
+    using value_type = decltype(Map(*std::declval<It>()));
+
+    MapIterator() = default;
+    explicit MapIterator(It it) : _it(it) {}
+
+    value_type operator*() const { return Map(*_it); }
+    MapIterator& operator++() { ++_it; return *this; }
+    bool operator==(const MapIterator& other) const { return _it == other._it; }
+    bool operator!=(const MapIterator& other) const { return _it != other._it; }
+
+protected:
+    It _it{};
+};
+
+inline NodeRef edge_target_ref(const Hyperlink<>& h) { return NodeRef(h._id_to()); }
+inline EdgeRef edge_ref(const Hyperlink<>& h) { return EdgeRef(h); }
+inline NodeRef backlink_source_ref(const AdjGraph<>::Backlink& b) { return NodeRef(b.source); }
+
+using EdgeIt = std::vector<Hyperlink<>>::const_iterator;
+using BacklinkIt = AdjGraph<>::Backlinks::const_iterator;
+
+/**
+ * @brief Zero-copy view of a vector owned by self (rv_policy::reference_internal keeps self alive)
+ */
+template <class T>
+nb::ndarray<nb::numpy, const T, nb::ndim<1>> vector_view(const std::vector<T>& v)
+{
+    return nb::ndarray<nb::numpy, const T, nb::ndim<1>>(v.data(), {v.size()}, nb::handle());
+}
+
+inline AttrSet<>& widget_attrs(Node<>& node, WidgetIdx w)
+{
+    WidgetTree<>& tree = node.widget_tree();
+    if (w >= tree.size()) [[unlikely]]
+        throw std::out_of_range{"Widget index out of range"};
+    return tree.attrs(w);
+}
+
 // Module definition
 NB_MODULE(jsc_common, m) {
     m.doc() = "Python bindings for common jarvis-core classes";
@@ -25,6 +260,12 @@ NB_MODULE(jsc_common, m) {
         .def(nb::init<std::int64_t>(), "value"_a, "Construct from int64")
         .def(nb::init<double>(), "value"_a, "Construct from double")
         .def(nb::init<std::string>(), "value"_a, "Construct from string")
+        .def("__init__", [](AttrValue<>* self, Array1D<std::int64_t> a) {
+            new (self) AttrValue<>(std::vector<std::int64_t>(a.data(), a.data() + a.shape(0)));
+        }, "values"_a, "Construct from an int64 array, copied in one pass")
+        .def("__init__", [](AttrValue<>* self, Array1D<double> a) {
+            new (self) AttrValue<>(std::vector<double>(a.data(), a.data() + a.shape(0)));
+        }, "values"_a, "Construct from a float64 array, copied in one pass")
         .def(nb::init<std::vector<std::int64_t>>(), "values"_a, "Construct from vector of int64")
         .def(nb::init<std::vector<double>>(), "values"_a, "Construct from vector of double")
 
@@ -52,13 +293,13 @@ NB_MODULE(jsc_common, m) {
              "Get string value (const)")
 
         // Scalar access
-        .def("i64", &AttrValue<>::i64,
+        .def("i64", nb::overload_cast<>(&AttrValue<>::i64),
              nb::rv_policy::reference_internal,
              "Get int64 scalar value")
-        .def("ui64", &AttrValue<>::ui64,
+        .def("ui64", nb::overload_cast<>(&AttrValue<>::ui64),
              nb::rv_policy::reference_internal,
              "Get uint64 scalar value")
-        .def("f64", &AttrValue<>::f64,
+        .def("f64", nb::overload_cast<>(&AttrValue<>::f64),
              nb::rv_policy::reference_internal,
              "Get double scalar value")
 
@@ -90,6 +331,16 @@ NB_MODULE(jsc_common, m) {
              nb::rv_policy::reference_internal,
              "Get double value at index (const)")
 
+        // Zero-copy view
+        .def("numpy", [](AttrValue<>& self) {
+            if (self.is_vec_f64())
+                return nb::ndarray<nb::numpy>(self.data_f64(), {self.size()}, nb::handle(), {}, nb::dtype<double>());
+            if (self.is_vec_i64())
+                return nb::ndarray<nb::numpy>(self.data_i64(), {self.size()}, nb::handle(), {}, nb::dtype<std::int64_t>());
+            throw nb::type_error("Cannot view a string as an array");
+        }, nb::rv_policy::reference_internal,
+        "Writable 1D view of the numbers without a copy, keeps the owner alive. Invalid after push/pop or after adding attributes to the owner")
+
         // Push/pop operations
         .def("push_i64", &AttrValue<>::push_i64, "value"_a, "Push int64 value")
         .def("push_f64", &AttrValue<>::push_f64, "value"_a, "Push double value")
@@ -148,84 +399,97 @@ NB_MODULE(jsc_common, m) {
             return oss.str();
         });
 
+    // Bind AttrKey class
+    nb::class_<AttrKey>(m, "AttrKey")
+        .def("valid", &AttrKey::valid, "Check if the key was interned")
+        .def_prop_ro("id", &AttrKey::_internal_id, "Atom id")
+        .def("__eq__", [](const AttrKey& a, const AttrKey& b) { return a == b; })
+        .def("__hash__", [](const AttrKey& self) { return self._internal_id(); })
+        .def("__repr__", [](const AttrKey& self) {
+            return "AttrKey('" + AttrSet<>::key_name(self) + "')";
+        });
+
     nb::class_<AttrSet<>>(m, "AttrSet")
         .def(nb::init<>(), "Default constructor")
 
         // Set methods
         .def("set", [](AttrSet<>& self, const std::string& k, const AttrValue<>& v) {
-            self.set(k, std::move(v));
-        }, "key"_a, "value"_a, "Set attribute with AttrValue")
+            self.assign(k, v);
+        }, "key"_a, "value"_a, "Set attribute with AttrValue, replacing the current value")
 
         .def("set", [](AttrSet<>& self, const std::string& k, const std::string& v) {
-            self.set(k, v);
+            self.assign(k, AttrValue<>(v));
         }, "key"_a, "value"_a, "Set attribute with string")
 
         .def("set", [](AttrSet<>& self, const std::string& k, std::int64_t v) {
-            self.set(k, AttrValue<>(v));
+            self.assign(k, AttrValue<>(v));
         }, "key"_a, "value"_a, "Set attribute with int64")
 
         .def("set", [](AttrSet<>& self, const std::string& k, double v) {
-            self.set(k, AttrValue<>(v));
+            self.assign(k, AttrValue<>(v));
         }, "key"_a, "value"_a, "Set attribute with double")
 
+        .def("set", [](AttrSet<>& self, const std::string& k, Array1D<std::int64_t> v) {
+            self.assign(k, AttrValue<>(std::vector<std::int64_t>(v.data(), v.data() + v.shape(0))));
+        }, "key"_a, "value"_a, "Set attribute with int64 array")
+
+        .def("set", [](AttrSet<>& self, const std::string& k, Array1D<double> v) {
+            self.assign(k, AttrValue<>(std::vector<double>(v.data(), v.data() + v.shape(0))));
+        }, "key"_a, "value"_a, "Set attribute with float64 array")
+
         .def("set", [](AttrSet<>& self, const std::string& k, const std::vector<std::int64_t>& v) {
-            self.set(k, v);
+            self.assign(k, AttrValue<>(v));
         }, "key"_a, "value"_a, "Set attribute with int64 list")
 
         .def("set", [](AttrSet<>& self, const std::string& k, const std::vector<double>& v) {
-            self.set(k, v);
+            self.assign(k, AttrValue<>(v));
         }, "key"_a, "value"_a, "Set attribute with double list")
 
         // Get and contains
-        .def("contains", &AttrSet<>::contains, "key"_a, "Check if key exists")
+        .def("contains", nb::overload_cast<const std::string&>(&AttrSet<>::contains, nb::const_), "key"_a, "Check if key exists")
+        .def("contains", nb::overload_cast<AttrKey>(&AttrSet<>::contains, nb::const_), "key"_a, "Check if interned key exists")
 
-        .def("get", nb::overload_cast<const std::string&>(&AttrSet<>::get),
+        // Values are returned by copy : the flat storage moves them when a key is added, so a reference would dangle
+        .def("get", nb::overload_cast<const std::string&>(&AttrSet<>::get, nb::const_),
              "key"_a,
-             nb::rv_policy::reference_internal,
-             "Get attribute value (returns None if not found)")
+             nb::rv_policy::copy,
+             "Copy of the attribute value (returns None if not found). Write changes back with set()")
 
-        .def("get", nb::overload_cast<const std::string&>(&AttrSet<>::get, nb::const_),
+        .def("get", nb::overload_cast<AttrKey>(&AttrSet<>::get, nb::const_),
              "key"_a,
-             nb::rv_policy::reference_internal,
-             "Get attribute value (const, returns None if not found)")
+             nb::rv_policy::copy,
+             "Copy of the attribute value by interned key (returns None if not found)")
+
+        .def_static("key", &AttrSet<>::key, "key"_a, "Intern a key")
+        .def("__len__", &AttrSet<>::size)
 
         // Python dict-like interface
-        .def("__getitem__", [](AttrSet<>& self, const std::string& key) -> AttrValue<>& {
+        .def("__getitem__", [](const AttrSet<>& self, const std::string& key) {
             auto* val = self.get(key);
             if (!val) throw nb::key_error(key.c_str());
             return *val;
-        }, "key"_a, nb::rv_policy::reference_internal)
-
-        .def("__setitem__", [](AttrSet<>& self, const std::string& key, const nb::object& value) {
-            // Try to determine type from Python object
-            if (nb::isinstance<nb::str>(value)) {
-                self.set(std::move(key), nb::cast<std::string>(value));
-            } else if (nb::isinstance<nb::int_>(value)) {
-                self.set(std::move(key), AttrValue<>(nb::cast<std::int64_t>(value)));
-            } else if (nb::isinstance<nb::float_>(value)) {
-                self.set(std::move(key), AttrValue<>(nb::cast<double>(value)));
-            } else if (nb::isinstance<AttrValue<>>(value)) {
-                self.set(std::move(key), nb::cast<AttrValue<>>(value));
-            } else if (nb::isinstance<nb::list>(value) || nb::isinstance<nb::tuple>(value)) {
-                // Try int list first
-                try {
-                    auto vec = nb::cast<std::vector<std::int64_t>>(value);
-                    self.set(std::move(key), vec);
-                    return;
-                } catch (...) {}
-                // Try float list
-                try {
-                    auto vec = nb::cast<std::vector<double>>(value);
-                    self.set(std::move(key), vec);
-                    return;
-                } catch (...) {
-                    throw nb::type_error("List must contain all ints or all floats");
-                }
-            } else {
-                throw nb::type_error("Unsupported value type");
-            }
+        }, "key"_a, "Copy of the attribute value. Write changes back with a[key] = value")
+
+        .def("__setitem__", [](AttrSet<>& self, const std::string& key, nb::handle value) {
+            self.assign(key, attr_from_object(value));
         }, "key"_a, "value"_a)
 
+        // Batched and typed setters
+        .def("update", [](AttrSet<>& self, const nb::dict& items) {
+            for (auto [k, v] : items)
+                self.assign(nb::cast<std::string>(k), attr_from_object(v));
+        }, "items"_a, "Set the attributes of a dict")
+
+        .def("set_i64", [](AttrSet<>& self, const std::string& k, std::int64_t v) { self.assign(k, AttrValue<>(v)); }, "key"_a, "value"_a)
+        .def("set_f64", [](AttrSet<>& self, const std::string& k, double v) { self.assign(k, AttrValue<>(v)); }, "key"_a, "value"_a)
+        .def("set_str", [](AttrSet<>& self, const std::string& k, const std::string& v) { self.assign(k, AttrValue<>(v)); }, "key"_a, "value"_a)
+        .def("set_vec_i64", [](AttrSet<>& self, const std::string& k, std::vector<std::int64_t> v) {
+            self.assign(k, AttrValue<>(std::move(v)));
+        }, "key"_a, "values"_a)
+        .def("set_vec_f64", [](AttrSet<>& self, const std::string& k, std::vector<double> v) {
+            self.assign(k, AttrValue<>(std::move(v)));
+        }, "key"_a, "values"_a)
+
         .def("__iter__", [](const AttrSet<>& self){
                 return nb::make_key_iterator(nb::type<AttrSet<>>(), "key_iterator", self.begin(), self.end());
         }, nb::keep_alive<0, 1>())
@@ -236,7 +500,7 @@ NB_MODULE(jsc_common, m) {
                 return nb::make_value_iterator(nb::type<AttrSet<>>(), "value_iterator", self.begin(), self.end());
         }, nb::keep_alive<0, 1>())
 
-        .def("__contains__", &AttrSet<>::contains, "key"_a);
+        .def("__contains__", nb::overload_cast<const std::string&>(&AttrSet<>::contains, nb::const_), "key"_a);
 
     // Bind Widget class
     nb::class_<Widget<>, AttrSet<>>(m, "Widget")
@@ -282,6 +546,71 @@ NB_MODULE(jsc_common, m) {
                    std::to_string(self.children().size()) + ")";
         });
 
+    // Bind WidgetView class (widget stored in a node widget tree)
+    nb::class_<WidgetView<>>(m, "WidgetView")
+        .def_prop_rw("name",
+            [](const WidgetView<>& self) { return self.name(); },
+            [](WidgetView<>& self, const std::string& n) { self.name() = n; },
+            "Widget name")
+
+        .def("index", &WidgetView<>::index, "Index of the widget in the tree")
+
+        // Attributes are returned by copy : they live in a vector of the tree, which moves when widgets are added
+        .def("attrs", [](const WidgetView<>& self) { return self.attrs(); },
+             "Copy of the widget attributes. Write changes back with set_attrs() or w[key] = value")
+
+        .def("set_attrs", [](const WidgetView<>& self, const AttrSet<>& attrs) { self.attrs() = attrs; }, "attrs"_a,
+             "Replace the widget attributes")
+
+        .def("get", [](const WidgetView<>& self, const std::string& key) -> std::optional<AttrValue<>> {
+            const AttrValue<>* v = self.get(key);
+            return v ? std::optional<AttrValue<>>(*v) : std::nullopt;
+        }, "key"_a, "Copy of a widget attribute (None if not found)")
+
+        .def("__getitem__", [](const WidgetView<>& self, const std::string& key) {
+            const AttrValue<>* v = self.get(key);
+            if (!v) throw nb::key_error(key.c_str());
+            return *v;
+        }, "key"_a, "Copy of a widget attribute")
+
+        .def("__setitem__", [](const WidgetView<>& self, const std::string& key, nb::handle value) {
+            self.attrs().assign(key, attr_from_object(value));
+        }, "key"_a, "value"_a, "Set a widget attribute in place, replacing the current value")
+
+        .def("__contains__", [](const WidgetView<>& self, const std::string& key) { return self.contains(key); }, "key"_a)
+
+        .def("add_child", nb::overload_cast<const std::string&>(&WidgetView<>::add_child<>, nb::const_), "name"_a,
+             nb::keep_alive<0, 1>(),
+             "Add child widget and return it")
+
+        .def("add_child", nb::overload_cast<const Widget<>&>(&WidgetView<>::add_child<>, nb::const_), "widget"_a,
+             nb::keep_alive<0, 1>(),
+             "Add a copy of the widget subtree and return it")
+
+        .def("child", &WidgetView<>::child, "index"_a,
+             nb::keep_alive<0, 1>(),
+             "Get child by index")
+
+        .def("children", [](const WidgetView<>& self) {
+                auto r = self.children();
+                return nb::make_iterator(nb::type<WidgetView<>>(), "child_iterator", r.begin(), r.end());
+        }, nb::keep_alive<0, 1>(), "Iterate over children")
+
+        .def("parent", &WidgetView<>::parent, nb::keep_alive<0, 1>(), "Get parent widget")
+
+        .def("to_widget", [](const WidgetView<>& self) {
+            return self.tree()->to_widget(self.index());
+        }, "Copy the subtree into a standalone Widget")
+
+        .def("__len__", [](const WidgetView<>& self) {
+            return self.children().size();
+        })
+
+        .def("__repr__", [](const WidgetView<>& self) {
+            return "WidgetView(name='" + self.name() + "', children=" +
+                   std::to_string(self.children().size()) + ")";
+        });
+
     // Bind Node class
     nb::class_<Node<>, AttrSet<>>(m, "Node")
         // Constructors
@@ -295,23 +624,138 @@ NB_MODULE(jsc_common, m) {
             "Node name")
 
         // Widget access
-        .def("set_widget", &Node<>::set_widget, "widget"_a,
-             nb::rv_policy::reference_internal,
-             "Set widget and return reference to it")
+        .def("set_widget", nb::overload_cast<const Widget<>&>(&Node<>::set_widget), "widget"_a,
+             nb::keep_alive<0, 1>(),
+             "Flatten the widget into the node widget tree and return the root")
 
         .def("widget", nb::overload_cast<>(&Node<>::widget),
-             nb::rv_policy::reference_internal,
-             "Get widget (mutable)")
+             nb::keep_alive<0, 1>(),
+             "Get the root widget")
 
-        .def("widget", nb::overload_cast<>(&Node<>::widget, nb::const_),
-             nb::rv_policy::reference_internal,
-             "Get widget (const)")
+        .def("add_widgets", [](Node<>& self, Array1D<WidgetIdx> parents, const std::vector<std::string>& names) {
+            const std::size_t n = names.size();
+            if (parents.shape(0) != n)
+                throw nb::value_error("parents and names must have the same length");
+            std::vector<WidgetIdx> out(n);
+            {
+                nb::gil_scoped_release release;
+                WidgetTree<>& tree = self.widget_tree();
+                for (std::size_t i = 0; i < n; i++)
+                    out[i] = tree.add_child(parents.data()[i], names[i]);
+            }
+            return to_numpy(std::move(out), {n});
+        }, "parents"_a, "names"_a,
+        "Append widgets under the given parent indices, which may be widgets of the same batch. Returns the new indices. Releases the GIL: the node must not be used by another thread meanwhile")
+
+        .def("set_widget_attr", [](Node<>& self, Array1D<WidgetIdx> widgets, const std::string& key, nb::handle values) {
+            set_column(widgets.shape(0), key, values, [&](std::size_t i) -> AttrSet<>& { return widget_attrs(self, widgets.data()[i]); });
+        }, "widgets"_a, "key"_a, "values"_a,
+        "Set an attribute on many widgets from a (n, dim) array (vectors), a 1D array (scalars) or a list of strings. Releases the GIL: the node must not be used by another thread meanwhile")
+
+        .def("gather_widgets", [](const Node<>& self, const std::string& key, std::size_t dim) {
+            const WidgetTree<>& tree = self.widget_tree();
+            const AttrKey k = AttrSet<>::key(key);
+            if (!dim)
+                dim = attr_dim(tree, k);
+            std::vector<double> values(tree.size() * dim);
+            std::vector<std::uint8_t> found(tree.size());
+            gather_widget_attr(tree, k, dim, values.data(), found.data());
+            return std::make_tuple(to_numpy(std::move(values), {tree.size(), dim}), to_numpy_mask(std::move(found), {tree.size()}));
+        }, "key"_a, "dim"_a = 0,
+        "Numeric attribute of every widget as (values (n_widgets, dim) float64, found mask), dim 0 takes the size of the first value")
 
         .def("__repr__", [](const Node<>& self) {
             return "Node(name='" + self.name() + "')";
         });
 
 
+    // Bind BoxArray class and the geometry kernels
+    nb::class_<BoxArray>(m, "BoxArray")
+        .def(nb::init<>(), "Default constructor")
+
+        .def_static("from_node", [](const Node<>& node, const std::string& key, bool all_widgets) {
+            return BoxArray::from_tree(node.widget_tree(), key, all_widgets);
+        }, "node"_a, "key"_a = "geometry", "all_widgets"_a = false,
+        "Extract the widget boxes (x, y, width, height attribute) of a node")
+
+        .def("push_back", &BoxArray::push_back, "x0"_a, "y0"_a, "x1"_a, "y1"_a, "widget"_a = widget_npos, "Append a box given by its corners")
+
+        .def_prop_ro("boxes", [](BoxArray& self) {
+            return nb::ndarray<nb::numpy, double, nb::ndim<2>>(self.data(), {self.size(), 4}, nb::handle(),
+                                                               {1, static_cast<std::int64_t>(self.stride())});
+        }, nb::rv_policy::reference_internal, "(n, 4) view of the x0, y0, x1, y1 columns")
+
+        .def_prop_ro("widgets", [](const BoxArray& self) {
+            return to_numpy(std::vector<WidgetIdx>(self.widgets()), {self.size()});
+        }, "Widget index of each box")
+
+        .def("area", [](const BoxArray& self) {
+            return to_numpy(box_area(self), {self.size()});
+        }, "Area of every box")
+
+        .def("iou", [](const BoxArray& self, const BoxArray& other) {
+            return to_numpy(box_iou(self, other), {self.size(), other.size()});
+        }, "other"_a, "Pairwise intersection over union matrix")
+
+        .def("contains", [](const BoxArray& self, const BoxArray& other) {
+            return to_numpy_mask(box_contains(self, other), {self.size(), other.size()});
+        }, "other"_a, "Pairwise mask, [i, j] is set if box i contains box j of other")
+
+        .def("clip", [](BoxArray& self, double x, double y, double width, double height) {
+            box_clip(self, x, y, width, height);
+        }, "x"_a, "y"_a, "width"_a, "height"_a, "Clip the boxes in place to the viewport")
+
+        .def("__len__", &BoxArray::size)
+
+        .def("__repr__", [](const BoxArray& self) {
+            return "BoxArray(size=" + std::to_string(self.size()) + ")";
+        });
+
+    m.def("simd_level", []() {
+        switch (simd_level()) {
+            case SimdLevel::AVX2: return "avx2";
+            case SimdLevel::NEON: return "neon";
+            default: return "scalar";
+        }
+    }, "Instruction set used by the geometry kernels");
+
+    // Hot path statistics and tracing (stats.h)
+    m.attr("stats_enabled") = stats_enabled();
+
+    m.def("stats", []() {
+        const StatsSnapshot s = stats_snapshot();
+        nb::dict counters, timers;
+        for (std::size_t i = 0; i < n_counters; i++)
+            counters[counter_name(static_cast<Counter>(i))] = s.counters[i];
+        for (std::size_t i = 0; i < n_timers; i++)
+            timers[timer_name(static_cast<Timer>(i))] = nb::make_tuple(s.timer_calls[i], s.timer_ns[i]);
+        nb::dict out;
+        out["enabled"] = s.enabled;
+        out["counters"] = counters;
+        out["timers"] = timers;
+        return out;
+    }, "Hot path counters ({name: count}) and timers ({name: (calls, ns)}) summed over all threads. All zeros unless built with JSC_STATS");
+
+    m.def("stats_reset", &stats_reset, "Set every counter and timer to 0");
+    m.def("stats_enable_timers", &stats_enable_timers, "on"_a, "Turn the scoped timers on or off (off by default)");
+
+    m.def("trace_start", []() { Tracer::instance().start(); }, "Drop the previous trace events and start recording");
+    m.def("trace_stop", [](const std::string& path) {
+        Tracer::instance().stop();
+        if (!path.empty() && !Tracer::instance().write(path))
+            throw nb::value_error(("cannot write " + path).c_str());
+    }, "path"_a = "", "Stop recording and write the events as Chrome trace JSON if path is given");
+
+    nb::class_<PyTraceScope>(m, "TraceScope", "Context manager which records its duration as a trace event")
+        .def(nb::init<std::string>(), "name"_a)
+        .def("__enter__", [](PyTraceScope& self) -> PyTraceScope& {
+            self.scope.emplace(self.name);
+            return self;
+        }, nb::rv_policy::reference)
+        .def("__exit__", [](PyTraceScope& self, nb::handle, nb::handle, nb::handle) { self.scope.reset(); },
+             nb::arg().none(), nb::arg().none(), nb::arg().none());
+
+
     // Bind Hyperlink class
     nb::class_<Hyperlink<>, AttrSet<>>(m, "Hyperlink")
         // Constructors
@@ -321,4 +765,354 @@ NB_MODULE(jsc_common, m) {
         .def("__repr__", [](const Widget<>& self) {
             return "Hyperlink()";
         });
+
+
+    // Bind NodeRef class
+    nb::class_<NodeRef>(m, "NodeRef")
+        .def_prop_ro("id", &NodeRef::_internal_id, "Node id in the graph")
+        .def("__eq__", [](const NodeRef& a, const NodeRef& b) { return a._internal_id() == b._internal_id(); })
+        .def("__hash__", [](const NodeRef& self) { return self._internal_id(); })
+        .def("__repr__", [](const NodeRef& self) {
+            return "NodeRef(" + std::to_string(self._internal_id()) + ")";
+        });
+
+    nb::class_<EdgeRef>(m, "EdgeRef")
+        .def(nb::init<std::size_t, std::size_t, std::size_t>(), "from_id"_a, "to_id"_a, "hyperlink_id"_a)
+        .def_prop_ro("from_node", [](const EdgeRef& self) { return NodeRef(self._id_from()); }, "Source node")
+        .def_prop_ro("to_node", [](const EdgeRef& self) { return NodeRef(self._id_to()); }, "Target node")
+        .def_prop_ro("hyperlink_id", &EdgeRef::_widget_id, "Hyperlink id of the widget in the source node")
+        .def("__eq__", [](const EdgeRef& a, const EdgeRef& b) {
+            return a._id_from() == b._id_from() && a._id_to() == b._id_to() && a._widget_id() == b._widget_id();
+        })
+        .def("__hash__", [](const EdgeRef& self) { return self._id_from() * 0x9e3779b97f4a7c15ull ^ self._id_to() * 31 ^ self._widget_id(); })
+        .def("__repr__", [](const EdgeRef& self) {
+            return "EdgeRef(" + std::to_string(self._id_from()) + " -> " + std::to_string(self._id_to()) + ", hyperlink " +
+                   std::to_string(self._widget_id()) + ")";
+        });
+
+    nb::class_<WidgetRef>(m, "WidgetRef")
+        .def(nb::init<std::size_t, std::size_t>(), "node_id"_a, "hyperlink_id"_a)
+        .def_prop_ro("node", &WidgetRef::node_ref, "Node of the widget")
+        .def_prop_ro("hyperlink_id", &WidgetRef::_hyperlink_id, "Hyperlink id of the widget in its node")
+        .def("__eq__", [](const WidgetRef& a, const WidgetRef& b) {
+            return a._node_internal_id() == b._node_internal_id() && a._hyperlink_id() == b._hyperlink_id();
+        })
+        .def("__hash__", [](const WidgetRef& self) { return self._node_internal_id() * 0x9e3779b97f4a7c15ull ^ self._hyperlink_id(); })
+        .def("__repr__", [](const WidgetRef& self) {
+            return "WidgetRef(" + std::to_string(self._node_internal_id()) + ", hyperlink " + std::to_string(self._hyperlink_id()) + ")";
+        });
+
+    nb::enum_<Direction>(m, "Direction")
+        .value("Out", Direction::Out, "Follow the hyperlinks")
+        .value("In", Direction::In, "Follow the backlinks")
+        .value("Both", Direction::Both, "Follow both");
+
+    // Bind CsrGraph class and the ranking queries
+    nb::class_<CsrGraph<>>(m, "CsrGraph")
+        .def_prop_ro("n_nodes", &CsrGraph<>::n_nodes)
+        .def_prop_ro("n_edges", &CsrGraph<>::n_edges)
+        .def("node_ref", &CsrGraph<>::node_ref, "index"_a, "Node of a dense index")
+        .def("index_of", &CsrGraph<>::index_of, "node"_a, "Dense index of a node")
+
+        // Zero-copy CSR arrays, valid as long as the snapshot
+        .def_prop_ro("out_offsets", [](const CsrGraph<>& self) { return vector_view(self.out_offsets()); }, nb::rv_policy::reference_internal,
+                     "Out-edges of u are [out_offsets[u], out_offsets[u + 1])")
+        .def_prop_ro("out_targets", [](const CsrGraph<>& self) { return vector_view(self.out_targets()); }, nb::rv_policy::reference_internal,
+                     "Dense target of each out-edge")
+        .def_prop_ro("in_offsets", [](const CsrGraph<>& self) { return vector_view(self.in_offsets()); }, nb::rv_policy::reference_internal,
+                     "In-edges of u are [in_offsets[u], in_offsets[u + 1])")
+        .def_prop_ro("in_sources", [](const CsrGraph<>& self) { return vector_view(self.in_sources()); }, nb::rv_policy::reference_internal,
+                     "Dense source of each in-edge")
+
+        .def("edge_index", [](const CsrGraph<>& self, std::size_t n_threads) {
+            const std::size_t m = self.n_edges();
+            std::vector<std::int64_t> coo(2 * m);
+            {
+                nb::gil_scoped_release release;
+                edge_index(self, coo.data(), n_threads);
+            }
+            return to_numpy(std::move(coo), {2, m});
+        }, "n_threads"_a = 0, "COO (2, n_edges) int64 array of the dense sources and targets, in CSR edge order")
+
+        .def("personalized_pagerank", [](const CsrGraph<>& self, const std::vector<NodeRef>& seeds, std::size_t k, double damping, Direction direction,
+                                         double tol, std::size_t max_iter, std::size_t n_threads) {
+            std::vector<CsrGraph<>::index_type> idx;
+            for (const NodeRef& s : seeds)
+                idx.push_back(self.index_of(s));
+            std::vector<std::pair<NodeRef, double>> out;
+            {
+                nb::gil_scoped_release release;
+                PageRankOptions opts{damping, direction, tol, max_iter, n_threads};
+                for (auto [u, score] : top_k_scores(personalized_pagerank(self, idx, opts).scores, k))
+                    out.emplace_back(self.node_ref(u), score);
+            }
+            return out;
+        }, "seeds"_a, "k"_a = 10, "damping"_a = 0.85, "direction"_a = Direction::Out, "tol"_a = 1e-9, "max_iter"_a = 100, "n_threads"_a = 0,
+        "Top-k personalized PageRank by power iteration as [(NodeRef, score)], no seeds gives the global PageRank");
+
+    nb::class_<PprPush<>>(m, "PprPush")
+        .def(nb::init<const CsrGraph<>&, Direction>(), "graph"_a, "direction"_a = Direction::Out, nb::keep_alive<1, 2>(),
+             "Approximate personalized PageRank by local pushes, reuse the object between queries")
+
+        .def("query", [](PprPush<>& self, const std::vector<NodeRef>& seeds, std::size_t k, double damping, double epsilon) {
+            const CsrGraph<>& graph = self.graph();
+            std::vector<CsrGraph<>::index_type> idx;
+            for (const NodeRef& s : seeds)
+                idx.push_back(graph.index_of(s));
+            self.run(idx, damping, epsilon);
+            std::vector<std::pair<NodeRef, double>> out;
+            for (auto [u, score] : self.top_k(k))
+                out.emplace_back(graph.node_ref(u), score);
+            return out;
+        }, "seeds"_a, "k"_a = 10, "damping"_a = 0.85, "epsilon"_a = 1e-6,
+        "Top-k approximate scores as [(NodeRef, score)]")
+
+        .def_prop_ro("residual", &PprPush<>::residual, "Bound of the L1 error of the last query")
+        .def_prop_ro("n_touched", &PprPush<>::n_touched, "Nodes touched by the last query");
+
+    // Bind AdjGraph class
+    nb::class_<AdjGraph<>>(m, "AdjGraph")
+        .def(nb::init<>(), "Default constructor")
+
+        .def("add_node", [](AdjGraph<>& self, const Node<>& node) {
+            Node<> copy(node);
+            return self.add_node(copy);
+        }, "node"_a, "Copy the node into the graph and return its reference")
+
+        .def("add_nodes", [](AdjGraph<>& self, std::vector<Node<>> nodes) {
+            nb::gil_scoped_release release;
+            std::vector<NodeRef> refs;
+            refs.reserve(nodes.size());
+            for (Node<>& node : nodes)
+                refs.push_back(self.add_node(node));
+            return refs;
+        }, "nodes"_a, "Copy the nodes into the graph and return their references. Releases the GIL: the graph must not be used by another thread meanwhile")
+
+        .def("add_edge", [](AdjGraph<>& self, const NodeRef& from, const NodeRef& to, WidgetIdx widget) {
+            self.add_edge(from, to, widget);
+        }, "from"_a, "to"_a, "widget"_a, "Link the widget (index in the widget tree of from) to the node to")
+
+        .def("add_edges", [](AdjGraph<>& self, Array1D<std::size_t> from, Array1D<std::size_t> to, Array1D<WidgetIdx> widgets) {
+            const std::size_t n = from.shape(0);
+            if (to.shape(0) != n || widgets.shape(0) != n)
+                throw nb::value_error("from, to and widgets must have the same length");
+            nb::gil_scoped_release release;
+            for (std::size_t i = 0; i < n; i++)
+                self.add_edge(NodeRef(from.data()[i]), NodeRef(to.data()[i]), widgets.data()[i]);
+        }, "from"_a, "to"_a, "widgets"_a, "Add many edges given by node ids (NodeRef.id) and widget indices in the source nodes. Releases the GIL: the graph must not be used by another thread meanwhile")
+
+        .def("set_node_attr", [](AdjGraph<>& self, Array1D<std::size_t> nodes, const std::string& key, nb::handle values) {
+            set_column(nodes.shape(0), key, values, [&](std::size_t i) -> AttrSet<>& { return self.get_node(NodeRef(nodes.data()[i])); });
+        }, "nodes"_a, "key"_a, "values"_a,
+        "Set an attribute on many nodes (ids) from a (n, dim) array (vectors), a 1D array (scalars) or a list of strings. Releases the GIL: the graph must not be used by another thread meanwhile")
+
+        .def("set_widget_attr", [](AdjGraph<>& self, Array1D<std::size_t> nodes, Array1D<WidgetIdx> widgets, const std::string& key, nb::handle values) {
+            if (widgets.shape(0) != nodes.shape(0))
+                throw nb::value_error("nodes and widgets must have the same length");
+            set_column(nodes.shape(0), key, values, [&](std::size_t i) -> AttrSet<>& {
+                return widget_attrs(self.get_node(NodeRef(nodes.data()[i])), widgets.data()[i]);
+            });
+        }, "nodes"_a, "widgets"_a, "key"_a, "values"_a,
+        "Set an attribute on many (node id, widget index) pairs, the rows of gather_widgets. Releases the GIL: the graph must not be used by another thread meanwhile")
+
+        .def("freeze", [](const AdjGraph<>& self, std::size_t n_threads) {
+            nb::gil_scoped_release release;
+            return self.freeze(n_threads);
+        }, "n_threads"_a = 0, "Build an immutable CSR snapshot for traversal and ranking")
+
+        .def("personalized_pagerank", [](const AdjGraph<>& self, const std::vector<NodeRef>& seeds, std::size_t k, double damping, Direction direction,
+                                         std::size_t n_threads) {
+            nb::gil_scoped_release release;
+            return personalized_pagerank(self, seeds, k, PageRankOptions{damping, direction, 1e-9, 100, n_threads});
+        }, "seeds"_a, "k"_a = 10, "damping"_a = 0.85, "direction"_a = Direction::Out, "n_threads"_a = 0,
+        "Top-k personalized PageRank as [(NodeRef, score)], freezes the graph first")
+
+        .def("contains", &AdjGraph<>::contains, "node"_a)
+        .def("__contains__", &AdjGraph<>::contains, "node"_a)
+
+        // Copies : the slot map moves the stored nodes when it grows, so a reference would dangle after the next add_node
+        .def("get_node", &AdjGraph<>::get_node, "node"_a, nb::rv_policy::copy,
+             "Copy of the node stored in the graph. Write changes back with set_attr() or set_node_attr()")
+
+        .def("get_attr", [](AdjGraph<>& self, const NodeRef& node, const std::string& key) -> std::optional<AttrValue<>> {
+            const AttrValue<>* v = self.get_node(node).get(key);
+            return v ? std::optional<AttrValue<>>(*v) : std::nullopt;
+        }, "node"_a, "key"_a, "Copy of a node attribute (None if not found)")
+
+        .def("set_attr", [](AdjGraph<>& self, const NodeRef& node, const std::string& key, nb::handle value) {
+            self.get_node(node).assign(key, attr_from_object(value));
+        }, "node"_a, "key"_a, "value"_a, "Set a node attribute in place, replacing the current value")
+
+        .def("out_degree", [](const AdjGraph<>& self, const NodeRef& node) { return self.get_edges(node).size(); }, "node"_a)
+        .def("in_degree", [](const AdjGraph<>& self, const NodeRef& node) { return self.get_backlinks(node).size(); }, "node"_a)
+
+        .def("neighbors", [](const AdjGraph<>& self, const NodeRef& node) {
+            const auto& edges = self.get_edges(node);
+            using It = MapIterator<EdgeIt, edge_target_ref>;
+            return nb::make_iterator<nb::rv_policy::move>(nb::type<AdjGraph<>>(), "neighbor_iterator", It(edges.begin()), It(edges.end()));
+        }, "node"_a, nb::keep_alive<0, 1>(), "Iterate over the targets of the out-edges, once per edge. Do not modify the graph meanwhile")
+
+        .def("backlinks", [](const AdjGraph<>& self, const NodeRef& node) {
+            const auto& backlinks = self.get_backlinks(node);
+            using It = MapIterator<BacklinkIt, backlink_source_ref>;
+            return nb::make_iterator<nb::rv_policy::move>(nb::type<AdjGraph<>>(), "backlink_iterator", It(backlinks.begin()), It(backlinks.end()));
+        }, "node"_a, nb::keep_alive<0, 1>(), "Iterate over the sources of the in-edges, once per edge. Do not modify the graph meanwhile")
+
+        .def("edges", [](const AdjGraph<>& self, const NodeRef& node) {
+            const auto& edges = self.get_edges(node);
+            using It = MapIterator<EdgeIt, edge_ref>;
+            return nb::make_iterator<nb::rv_policy::move>(nb::type<AdjGraph<>>(), "edge_iterator", It(edges.begin()), It(edges.end()));
+        }, "node"_a, nb::keep_alive<0, 1>(), "Iterate over the out-edges as EdgeRef. Do not modify the graph meanwhile")
+
+        .def("neighbor_ids", [](const AdjGraph<>& self, const NodeRef& node) {
+            const auto& edges = self.get_edges(node);
+            std::vector<std::size_t> ids(edges.size());
+            for (std::size_t i = 0; i < edges.size(); i++)
+                ids[i] = edges[i]._id_to();
+            return to_numpy(std::move(ids), {ids.size()});
+        }, "node"_a, "Ids of the targets of the out-edges as an array")
+
+        .def("backlink_ids", [](const AdjGraph<>& self, const NodeRef& node) {
+            const auto& backlinks = self.get_backlinks(node);
+            std::vector<std::size_t> ids(backlinks.size());
+            for (std::size_t i = 0; i < backlinks.size(); i++)
+                ids[i] = backlinks[i].source;
+            return to_numpy(std::move(ids), {ids.size()});
+        }, "node"_a, "Ids of the sources of the in-edges as an array")
+
+        .def("to_coo", [](const AdjGraph<>& self, const std::vector<std::string>& node_keys, const std::vector<std::string>& edge_keys,
+                          std::size_t n_threads) {
+            std::vector<AttrKey> nkeys, ekeys;
+            for (const auto& k : node_keys)
+                nkeys.push_back(AttrSet<>::key(k));
+            for (const auto& k : edge_keys)
+                ekeys.push_back(AttrSet<>::key(k));
+
+            std::vector<std::size_t> ids, ndims, edims;
+            std::vector<std::int64_t> coo;
+            std::vector<float> x, edge_attr;
+            std::size_t n = 0, m = 0, nwidth = 0, ewidth = 0;
+            {
+                nb::gil_scoped_release release;
+                CsrGraph<> csr = self.freeze(n_threads);
+                n = csr.n_nodes();
+                m = csr.n_edges();
+                ids.resize(n);
+                for (std::size_t u = 0; u < n; u++)
+                    ids[u] = csr.node_ref(static_cast<CsrGraph<>::index_type>(u))._internal_id();
+                coo.resize(2 * m);
+                edge_index(csr, coo.data(), n_threads);
+
+                for (AttrKey k : nkeys)
+                    nwidth += ndims.emplace_back(attr_dim(self, k));
+                x.resize(n * nwidth);
+                gather_node_features(self, nkeys, ndims, x.data());
+
+                for (AttrKey k : ekeys)
+                    ewidth += edims.emplace_back(attr_dim(csr, k));
+                edge_attr.resize(m * ewidth);
+                gather_edge_features(csr, ekeys, edims, edge_attr.data(), nullptr, n_threads);
+            }
+            nb::dict out;
+            out["node_ids"] = to_numpy(std::move(ids), {n});
+            out["edge_index"] = to_numpy(std::move(coo), {2, m});
+            out["x"] = to_numpy(std::move(x), {n, nwidth});
+            out["edge_attr"] = to_numpy(std::move(edge_attr), {m, ewidth});
+            return out;
+        }, "node_keys"_a = std::vector<std::string>{}, "edge_keys"_a = std::vector<std::string>{}, "n_threads"_a = 0,
+        "Export for GNN training as a dict : node_ids (n,), edge_index (2, E) int64 in dense node indices, x (n, F) and edge_attr (E, F_e) float32 "
+        "with the numeric attributes of the keys side by side (missing values are zeros)")
+
+        .def("node_ids", [](const AdjGraph<>& self) {
+            std::vector<std::size_t> ids;
+            ids.reserve(self.size());
+            self.each([&](const AdjGraph<>::NodeData& nd) { ids.push_back(nd.node._internal_id()); });
+            return to_numpy(std::move(ids), {self.size()});
+        }, "Node ids in iteration order, the row order of the gather methods")
+
+        .def("gather_nodes", [](const AdjGraph<>& self, const std::string& key, std::size_t dim) {
+            const AttrKey k = AttrSet<>::key(key);
+            if (!dim)
+                dim = attr_dim(self, k);
+            const std::size_t n = self.size();
+            std::vector<double> values(n * dim);
+            std::vector<std::size_t> ids(n);
+            std::vector<std::uint8_t> found(n);
+            {
+                nb::gil_scoped_release release;
+                gather_node_attr(self, k, dim, values.data(), found.data(), ids.data());
+            }
+            return std::make_tuple(to_numpy(std::move(ids), {n}), to_numpy(std::move(values), {n, dim}), to_numpy_mask(std::move(found), {n}));
+        }, "key"_a, "dim"_a = 0,
+        "Numeric attribute of every node as (node ids, values (n_nodes, dim) float64, found mask), dim 0 takes the size of the first value")
+
+        .def("gather_nodes", &gather_nodes_into<float>, "key"_a, nb::arg("out").noconvert(),
+             "Fill a float32 (n_nodes, dim) array with a node attribute, returns (node ids, found mask)")
+        .def("gather_nodes", &gather_nodes_into<double>, "key"_a, nb::arg("out").noconvert(),
+             "Fill a float64 (n_nodes, dim) array with a node attribute, returns (node ids, found mask)")
+
+        .def("gather_widgets", [](const AdjGraph<>& self, const std::string& key, std::size_t dim) {
+            const AttrKey k = AttrSet<>::key(key);
+            if (!dim)
+                dim = attr_dim(self, k, true);
+            const std::size_t n = count_widgets(self);
+            std::vector<double> values(n * dim);
+            std::vector<std::size_t> ids(n);
+            std::vector<WidgetIdx> widgets(n);
+            std::vector<std::uint8_t> found(n);
+            {
+                nb::gil_scoped_release release;
+                gather_widget_attr(self, k, dim, values.data(), found.data(), ids.data(), widgets.data());
+            }
+            return std::make_tuple(to_numpy(std::move(ids), {n}), to_numpy(std::move(widgets), {n}), to_numpy(std::move(values), {n, dim}),
+                                   to_numpy_mask(std::move(found), {n}));
+        }, "key"_a, "dim"_a = 0,
+        "Numeric attribute of every widget of every node as (node ids, widget indices, values (n_widgets, dim) float64, found mask)")
+
+        .def("gather_widgets", &gather_widgets_into<float>, "key"_a, nb::arg("out").noconvert(),
+             "Fill a float32 (n_widgets, dim) array with a widget attribute, returns (node ids, widget indices, found mask)")
+        .def("gather_widgets", &gather_widgets_into<double>, "key"_a, nb::arg("out").noconvert(),
+             "Fill a float64 (n_widgets, dim) array with a widget attribute, returns (node ids, widget indices, found mask)")
+
+        .def("n_widgets", [](const AdjGraph<>& self) { return count_widgets(self); }, "Total number of widgets, the rows of gather_widgets")
+
+        .def("__len__", &AdjGraph<>::size)
+
+        .def("__repr__", [](const AdjGraph<>& self) {
+            return "AdjGraph(size=" + std::to_string(self.size()) + ")";
+        });
+
+    // Bind GraphBuilder class
+    nb::class_<GraphBuilder<>>(m, "GraphBuilder")
+        .def(nb::init<>(), "Collect nodes and edges, then build the graph in one pass")
+        .def_prop_ro("n_nodes", &GraphBuilder<>::n_nodes)
+        .def_prop_ro("n_edges", &GraphBuilder<>::n_edges)
+        .def("reserve", &GraphBuilder<>::reserve, "n_nodes"_a, "n_edges"_a)
+
+        .def("add_node", [](GraphBuilder<>& self, const Node<>& node) { return self.add_node(node); }, "node"_a,
+             "Copy the node into the builder and return its builder index")
+
+        .def("add_nodes", [](GraphBuilder<>& self, std::vector<Node<>> nodes) {
+            nb::gil_scoped_release release;
+            return self.add_nodes(std::move(nodes));
+        }, "nodes"_a, "Copy the nodes into the builder and return the builder index of the first one. Releases the GIL: the builder must not be used by another thread meanwhile")
+
+        .def("add_edges", [](GraphBuilder<>& self, Array1D<std::size_t> from, Array1D<std::size_t> to, Array1D<WidgetIdx> widgets) {
+            const std::size_t n = from.shape(0);
+            if (to.shape(0) != n || widgets.shape(0) != n)
+                throw nb::value_error("from, to and widgets must have the same length");
+            nb::gil_scoped_release release;
+            std::vector<GraphBuilder<>::EdgeSpec> edges;
+            edges.reserve(n);
+            for (std::size_t i = 0; i < n; i++)
+                edges.push_back(GraphBuilder<>::EdgeSpec{from.data()[i], to.data()[i], widgets.data()[i], {}});
+            self.add_edges(std::move(edges));
+        }, "from"_a, "to"_a, "widgets"_a, "Add many edges given by builder indices and widget indices in the source nodes. Releases the GIL: the builder must not be used by another thread meanwhile")
+
+        .def("build", [](GraphBuilder<>& self, std::size_t n_threads) {
+            nb::gil_scoped_release release;
+            return self.build(n_threads);
+        }, "n_threads"_a = 0, "Build the AdjGraph, the builder is left empty")
+
+        .def_static("node_ref", &GraphBuilder<>::node_ref, "index"_a, "Reference of a builder index in the built graph");
 }
@@ -0,0 +1,714 @@
+#ifndef JSC_ANN_H
+#define JSC_ANN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "graph.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Distance of an ANN index : squared euclidean distance or 1 - cosine similarity
+ */
+enum class AnnMetric : std::uint8_t {
+    L2,
+    Cosine,
+};
+
+/**
+ * @brief Vector storage of an ANN index. Int8 stores every vector with its own scale, max |x| / 127, and uses 4x less memory
+ */
+enum class AnnStorage : std::uint8_t {
+    Float32,
+    Int8,
+};
+
+/**
+ * @brief Options of HnswIndex
+ */
+struct AnnOptions {
+    AnnMetric metric = AnnMetric::Cosine;
+    AnnStorage storage = AnnStorage::Float32;
+    std::size_t M = 16;                  // links per vector on the upper layers, 2 * M on the bottom layer
+    std::size_t ef_construction = 200;   // candidate list size when inserting
+    std::size_t ef_search = 64;          // default candidate list size when searching, raised to k
+    std::uint64_t seed = 42;             // seed of the layer assignment
+};
+
+
+// Dot product kernels for each instruction set. The SIMD ones return the number of elements done, the caller adds the tail with the scalar code
+namespace ann_kernels {
+
+namespace scalar {
+
+template <class T>
+inline float dot(const float* a, const T* b, std::size_t begin, std::size_t n)
+{
+    float sum = 0;
+    for (std::size_t i = begin; i < n; i++)
+        sum += a[i] * static_cast<float>(b[i]);
+    return sum;
+}
+
+}
+
+#ifdef JSC_GEOMETRY_AVX2
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline float hsum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2"))) inline std::size_t dot(const float* a, const float* b, std::size_t n, float& sum)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8)
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    sum = hsum(_mm256_add_ps(acc0, acc1));
+    return i;
+}
+
+__attribute__((target("avx2"))) inline std::size_t dot(const float* a, const std::int8_t* b, std::size_t n, float& sum)
+{
+    __m256 acc = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 bf = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i))));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), bf));
+    }
+    sum = hsum(acc);
+    return i;
+}
+
+}
+#endif
+
+#ifdef JSC_GEOMETRY_NEON
+namespace neon {
+
+inline std::size_t dot(const float* a, const float* b, std::size_t n, float& sum)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+    return i;
+}
+
+inline std::size_t dot(const float* a, const std::int8_t* b, std::size_t n, float& sum)
+{
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t w = vmovl_s8(vld1_s8(b + i));
+        acc = vfmaq_f32(acc, vld1q_f32(a + i), vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))));
+        acc = vfmaq_f32(acc, vld1q_f32(a + i + 4), vcvtq_f32_s32(vmovl_s16(vget_high_s16(w))));
+    }
+    sum = vaddvq_f32(acc);
+    return i;
+}
+
+}
+#endif
+
+}
+
+/**
+ * @brief Dot product of a float vector with a float or int8 vector of size n
+ */
+template <class T>
+inline float ann_dot(const float* a, const T* b, std::size_t n, SimdLevel level = simd_level())
+{
+    level = usable_simd_level(level);
+    float sum = 0;
+    std::size_t done = 0;
+#ifdef JSC_GEOMETRY_AVX2
+    if (level == SimdLevel::AVX2)
+        done = ann_kernels::avx2::dot(a, b, n, sum);
+#endif
+#ifdef JSC_GEOMETRY_NEON
+    if (level == SimdLevel::NEON)
+        done = ann_kernels::neon::dot(a, b, n, sum);
+#endif
+    return sum + ann_kernels::scalar::dot(a, b, done, n);
+}
+
+
+/**
+ * @brief Hierarchical navigable small world graph (Malkov, Yashunin) over fixed size vectors identified by 64-bit labels
+ *
+ * Vectors are stored contiguously, as float32 or int8 with a per-vector scale, with their squared norm so that both metrics reduce to one dot product
+ * kernel. Cosine vectors are normalized on insertion. Every vector gets a random top layer, links are chosen with the neighbor selection heuristic and
+ * stored in flat arrays (2 * M per vector on the bottom layer). remove() leaves a tombstone which still routes searches but is never returned, the index
+ * is rebuilt without them once they outnumber the live vectors. search() may run concurrently from several threads, insert(), remove() and compact() need
+ * exclusive access
+ */
+class HnswIndex {
+public:
+    using label_type = std::uint64_t;
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    explicit HnswIndex(std::size_t dim, AnnOptions opts = {}) : _dim(dim), _opts(opts), _m0(2 * opts.M), _ml(1.0 / std::log(static_cast<double>(opts.M))),
+        _rng(opts.seed), _level(simd_level()), _visited(new VisitedPool)
+    {
+        if (dim == 0 || opts.M < 2) [[unlikely]]
+            throw std::invalid_argument{"HnswIndex : the dimension must be positive and M at least 2"};
+    }
+
+    std::size_t dim() const { return _dim; }
+    const AnnOptions& options() const { return _opts; }
+
+    /**
+     * @brief Number of live vectors
+     */
+    std::size_t size() const { return _slot_of.size(); }
+    bool empty() const { return _slot_of.empty(); }
+    std::size_t n_deleted() const { return _n_deleted; }
+    bool contains(label_type label) const { return _slot_of.count(label) != 0; }
+
+    /**
+     * @brief Add a vector of dim() floats, replacing the vector of the label if there is one
+     */
+    void insert(label_type label, const float* v)
+    {
+        remove(label);
+        if (_labels.size() >= npos) [[unlikely]]
+            throw std::length_error{"HnswIndex : too many vectors"};
+        const std::uint32_t slot = static_cast<std::uint32_t>(_labels.size());
+
+        std::vector<float> q(v, v + _dim);
+        prepare(q);
+        store(q);
+        const int level = static_cast<int>(-std::log(1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(_rng)) * _ml);
+        _labels.push_back(label);
+        _deleted.push_back(0);
+        _levels.push_back(static_cast<std::uint8_t>(std::min(level, 255)));
+        _links0.resize(_links0.size() + _m0 + 1, 0);
+        _upper.emplace_back(static_cast<std::size_t>(_levels.back()) * (_opts.M + 1), 0);
+        _slot_of[label] = slot;
+
+        if (_entry == npos) {
+            _entry = slot;
+            _max_level = _levels.back();
+            return;
+        }
+
+        // The new vector is searched with its stored form, so that the links match the distances seen by later searches
+        std::vector<float> buf;
+        const Query query = stored(slot, buf);
+        std::uint32_t ep = _entry;
+        float ep_dist = distance(query, ep);
+        for (int l = _max_level; l > _levels.back(); l--)
+            greedy(query, ep, ep_dist, l);
+        for (int l = std::min<int>(_levels.back(), _max_level); l >= 0; l--) {
+            std::vector<Candidate> cand = search_layer(query, ep, ep_dist, _opts.ef_construction, l, false);
+            std::vector<Candidate> chosen = select(cand, l == 0 ? _m0 : _opts.M);
+            std::uint32_t* out = links(slot, l);
+            out[0] = static_cast<std::uint32_t>(chosen.size());
+            for (std::size_t i = 0; i < chosen.size(); i++)
+                out[1 + i] = chosen[i].slot;
+            for (const Candidate& c : chosen)
+                connect(c.slot, slot, c.dist, l);
+            ep = cand.front().slot;
+            ep_dist = cand.front().dist;
+        }
+        if (_levels.back() > _max_level) {
+            _max_level = _levels.back();
+            _entry = slot;
+        }
+    }
+
+    void insert(label_type label, const std::vector<float>& v)
+    {
+        if (v.size() != _dim) [[unlikely]]
+            throw std::invalid_argument{"HnswIndex : wrong vector size"};
+        insert(label, v.data());
+    }
+
+    /**
+     * @brief Remove the vector of the label. Returns false if there is none
+     */
+    bool remove(label_type label)
+    {
+        auto it = _slot_of.find(label);
+        if (it == _slot_of.end())
+            return false;
+        _deleted[it->second] = 1;
+        _slot_of.erase(it);
+        _n_deleted++;
+        if (_n_deleted > 64 && _n_deleted > size())
+            compact();
+        return true;
+    }
+
+    /**
+     * @brief The k nearest live vectors as (label, distance), closest first. ef = 0 uses options().ef_search
+     */
+    std::vector<std::pair<label_type, float>> search(const float* v, std::size_t k, std::size_t ef = 0) const
+    {
+        std::vector<std::pair<label_type, float>> out;
+        if (_entry == npos || k == 0)
+            return out;
+        std::vector<float> q(v, v + _dim);
+        const Query query{q.data(), prepare(q)};
+
+        std::uint32_t ep = _entry;
+        float ep_dist = distance(query, ep);
+        for (int l = _max_level; l > 0; l--)
+            greedy(query, ep, ep_dist, l);
+        std::vector<Candidate> cand = search_layer(query, ep, ep_dist, std::max(k, ef ? ef : _opts.ef_search), 0, true);
+        for (std::size_t i = 0; i < cand.size() && i < k; i++)
+            out.emplace_back(_labels[cand[i].slot], cand[i].dist);
+        return out;
+    }
+
+    std::vector<std::pair<label_type, float>> search(const std::vector<float>& v, std::size_t k, std::size_t ef = 0) const
+    {
+        if (v.size() != _dim) [[unlikely]]
+            throw std::invalid_argument{"HnswIndex : wrong vector size"};
+        return search(v.data(), k, ef);
+    }
+
+    /**
+     * @brief Stored vector of the label (normalized for the cosine metric, dequantized for int8). Empty if there is none
+     */
+    std::vector<float> get(label_type label) const
+    {
+        auto it = _slot_of.find(label);
+        if (it == _slot_of.end())
+            return {};
+        std::vector<float> buf;
+        const Query q = stored(it->second, buf);
+        return std::vector<float>(q.v, q.v + _dim);
+    }
+
+    /**
+     * @brief Rebuild the graph from the live vectors only
+     */
+    void compact()
+    {
+        HnswIndex fresh(_dim, _opts);
+        for (std::uint32_t slot = 0; slot < _labels.size(); slot++) {
+            if (_deleted[slot])
+                continue;
+            std::vector<float> buf;
+            fresh.insert(_labels[slot], stored(slot, buf).v);
+        }
+        *this = std::move(fresh);
+    }
+
+    /**
+     * @brief Bytes used by the vectors and the links
+     */
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = _f32.size() * sizeof(float) + _i8.size() + (_scales.size() + _norms.size()) * sizeof(float) + _links0.size() * sizeof(std::uint32_t);
+        for (const auto& up : _upper)
+            bytes += up.size() * sizeof(std::uint32_t);
+        return bytes + _labels.size() * (sizeof(label_type) + 2);
+    }
+
+protected:
+    struct Query {
+        const float* v;
+        float norm2;
+    };
+
+    struct Candidate {
+        float dist;
+        std::uint32_t slot;
+        bool operator<(const Candidate& o) const { return dist < o.dist; }
+        bool operator>(const Candidate& o) const { return dist > o.dist; }
+    };
+
+    // Visit marks reused between searches : a node is visited if its tag equals the current epoch
+    struct VisitedList {
+        std::vector<std::uint16_t> tags;
+        std::uint16_t epoch = 0;
+    };
+
+    struct VisitedPool {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<VisitedList>> free;
+    };
+
+    class Visited {
+    public:
+        Visited(VisitedPool& pool, std::size_t n) : _pool(pool)
+        {
+            {
+                std::lock_guard<std::mutex> lock(pool.mtx);
+                if (!pool.free.empty()) {
+                    _list = std::move(pool.free.back());
+                    pool.free.pop_back();
+                }
+            }
+            if (!_list)
+                _list.reset(new VisitedList);
+            if (_list->tags.size() < n)
+                _list->tags.resize(n, 0);
+            if (++_list->epoch == 0) {
+                std::fill(_list->tags.begin(), _list->tags.end(), 0);
+                _list->epoch = 1;
+            }
+        }
+        ~Visited()
+        {
+            std::lock_guard<std::mutex> lock(_pool.mtx);
+            _pool.free.push_back(std::move(_list));
+        }
+
+        // Returns true the first time a slot is visited
+        bool visit(std::uint32_t slot)
+        {
+            if (_list->tags[slot] == _list->epoch)
+                return false;
+            _list->tags[slot] = _list->epoch;
+            return true;
+        }
+
+    protected:
+        VisitedPool& _pool;
+        std::unique_ptr<VisitedList> _list;
+    };
+
+    // Normalize for the cosine metric, returns the squared norm
+    float prepare(std::vector<float>& v) const
+    {
+        float norm2 = ann_dot(v.data(), v.data(), _dim, _level);
+        if (_opts.metric == AnnMetric::Cosine && norm2 > 0) {
+            const float inv = 1.0f / std::sqrt(norm2);
+            for (float& x : v)
+                x *= inv;
+            norm2 = 1.0f;
+        }
+        return norm2;
+    }
+
+    void store(const std::vector<float>& v)
+    {
+        if (_opts.storage == AnnStorage::Float32) {
+            _f32.insert(_f32.end(), v.begin(), v.end());
+            _norms.push_back(ann_dot(v.data(), v.data(), _dim, _level));
+            return;
+        }
+        float max_abs = 0;
+        for (float x : v)
+            max_abs = std::max(max_abs, std::abs(x));
+        const float scale = max_abs > 0 ? max_abs / 127.0f : 1.0f;
+        float norm2 = 0;
+        for (float x : v) {
+            auto q = static_cast<std::int8_t>(std::lround(std::clamp(x / scale, -127.0f, 127.0f)));
+            _i8.push_back(q);
+            norm2 += (q * scale) * (q * scale);
+        }
+        _scales.push_back(scale);
+        _norms.push_back(norm2);
+    }
+
+    // Stored vector as a query, dequantized into buf for int8
+    Query stored(std::uint32_t slot, std::vector<float>& buf) const
+    {
+        if (_opts.storage == AnnStorage::Float32)
+            return {_f32.data() + static_cast<std::size_t>(slot) * _dim, _norms[slot]};
+        buf.resize(_dim);
+        const std::int8_t* row = _i8.data() + static_cast<std::size_t>(slot) * _dim;
+        for (std::size_t i = 0; i < _dim; i++)
+            buf[i] = row[i] * _scales[slot];
+        return {buf.data(), _norms[slot]};
+    }
+
+    float distance(const Query& q, std::uint32_t slot) const
+    {
+        const std::size_t off = static_cast<std::size_t>(slot) * _dim;
+        float dot = _opts.storage == AnnStorage::Float32 ? ann_dot(q.v, _f32.data() + off, _dim, _level)
+                                                          : ann_dot(q.v, _i8.data() + off, _dim, _level) * _scales[slot];
+        if (_opts.metric == AnnMetric::Cosine)
+            return 1.0f - dot;
+        return std::max(0.0f, q.norm2 + _norms[slot] - 2.0f * dot);
+    }
+
+    // [count, ids...] of a slot on a layer
+    std::uint32_t* links(std::uint32_t slot, int level)
+    {
+        if (level == 0)
+            return _links0.data() + static_cast<std::size_t>(slot) * (_m0 + 1);
+        return _upper[slot].data() + static_cast<std::size_t>(level - 1) * (_opts.M + 1);
+    }
+    const std::uint32_t* links(std::uint32_t slot, int level) const { return const_cast<HnswIndex*>(this)->links(slot, level); }
+
+    void greedy(const Query& q, std::uint32_t& ep, float& ep_dist, int level) const
+    {
+        for (bool changed = true; changed;) {
+            changed = false;
+            const std::uint32_t* l = links(ep, level);
+            for (std::uint32_t i = 1; i <= l[0]; i++) {
+                float d = distance(q, l[i]);
+                if (d < ep_dist) {
+                    ep_dist = d;
+                    ep = l[i];
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Best-first search of a layer, returns up to ef candidates sorted by distance. Tombstones are expanded but not returned with skip_deleted
+    std::vector<Candidate> search_layer(const Query& q, std::uint32_t ep, float ep_dist, std::size_t ef, int level, bool skip_deleted) const
+    {
+        Visited visited(*_visited, _labels.size());
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier;
+        std::priority_queue<Candidate> best;
+        visited.visit(ep);
+        frontier.push({ep_dist, ep});
+        if (!skip_deleted || !_deleted[ep])
+            best.push({ep_dist, ep});
+
+        while (!frontier.empty()) {
+            Candidate c = frontier.top();
+            if (best.size() >= ef && c.dist > best.top().dist)
+                break;
+            frontier.pop();
+            const std::uint32_t* l = links(c.slot, level);
+            for (std::uint32_t i = 1; i <= l[0]; i++) {
+                std::uint32_t v = l[i];
+                if (!visited.visit(v))
+                    continue;
+                float d = distance(q, v);
+                if (best.size() < ef || d < best.top().dist) {
+                    frontier.push({d, v});
+                    if (!skip_deleted || !_deleted[v]) {
+                        best.push({d, v});
+                        if (best.size() > ef)
+                            best.pop();
+                    }
+                }
+            }
+        }
+
+        std::vector<Candidate> out(best.size());
+        for (std::size_t i = out.size(); i > 0; i--) {
+            out[i - 1] = best.top();
+            best.pop();
+        }
+        return out;
+    }
+
+    // Neighbor selection heuristic : keep a candidate only if it is closer to the base than to every kept one, which spreads the links around the base
+    std::vector<Candidate> select(const std::vector<Candidate>& cand, std::size_t m) const
+    {
+        std::vector<Candidate> kept;
+        std::vector<float> buf;
+        for (const Candidate& c : cand) {
+            if (kept.size() >= m)
+                break;
+            const Query cq = stored(c.slot, buf);
+            bool good = true;
+            for (const Candidate& k : kept) {
+                if (distance(cq, k.slot) < c.dist) {
+                    good = false;
+                    break;
+                }
+            }
+            if (good)
+                kept.push_back(c);
+        }
+        return kept;
+    }
+
+    // Add the link from -> to, pruning the links of from with the heuristic when they are full
+    void connect(std::uint32_t from, std::uint32_t to, float dist, int level)
+    {
+        std::uint32_t* l = links(from, level);
+        const std::size_t max_links = level == 0 ? _m0 : _opts.M;
+        if (l[0] < max_links) {
+            l[++l[0]] = to;
+            return;
+        }
+        std::vector<float> buf;
+        const Query fq = stored(from, buf);
+        std::vector<Candidate> cand{{dist, to}};
+        for (std::uint32_t i = 1; i <= l[0]; i++)
+            cand.push_back({distance(fq, l[i]), l[i]});
+        std::sort(cand.begin(), cand.end());
+        std::vector<Candidate> kept = select(cand, max_links);
+        l[0] = static_cast<std::uint32_t>(kept.size());
+        for (std::size_t i = 0; i < kept.size(); i++)
+            l[1 + i] = kept[i].slot;
+    }
+
+    std::size_t _dim;
+    AnnOptions _opts;
+    std::size_t _m0;
+    double _ml;
+    std::mt19937_64 _rng;
+    SimdLevel _level;
+
+    std::vector<float> _f32;
+    std::vector<std::int8_t> _i8;
+    std::vector<float> _scales, _norms;
+    std::vector<label_type> _labels;
+    std::vector<std::uint8_t> _deleted, _levels;
+    std::vector<std::uint32_t> _links0;               // (2 * M + 1) per slot
+    std::vector<std::vector<std::uint32_t>> _upper;   // (M + 1) per slot and upper layer
+    std::unordered_map<label_type, std::uint32_t> _slot_of;
+    std::uint32_t _entry = npos;
+    int _max_level = 0;
+    std::size_t _n_deleted = 0;
+    std::unique_ptr<VisitedPool> _visited;
+};
+
+
+/**
+ * @brief Result of an EmbeddingIndex search. widget is widget_npos for node embeddings
+ */
+struct AnnHit {
+    NodeRef node;
+    WidgetIdx widget = widget_npos;
+    float distance = 0;
+};
+
+/**
+ * @brief HnswIndex over an embedding attribute (a vector of dim() doubles) of the nodes or of the widgets of an AdjGraph
+ *
+ * Values of another type or size are skipped and counted in n_skipped(). add_node() replaces the vectors of a node, so it also handles updates, and
+ * remove_node() drops them. Widgets are returned by their index in the node widget tree, since WidgetRef only addresses the widgets with a hyperlink
+ */
+template <class TStr = std::string>
+class EmbeddingIndex {
+public:
+    using label_type = HnswIndex::label_type;
+
+    EmbeddingIndex(const TStr& key, std::size_t dim, AnnOptions opts = {}, bool widgets = false)
+        : _key(AttrSet<TStr>::key(key)), _widgets(widgets), _index(dim, opts), _buf(dim) {}
+
+    /**
+     * @brief Index every node of the graph, dropping the previous content. Returns the number of vectors
+     */
+    std::size_t build(const AdjGraph<TStr>& g)
+    {
+        _index = HnswIndex(_index.dim(), _index.options());
+        _hits.clear();
+        _by_node.clear();
+        _n_skipped = 0;
+        std::size_t n = 0;
+        g.each([&](const typename AdjGraph<TStr>::NodeData& nd) { n += add_node(nd.node); });
+        return n;
+    }
+
+    /**
+     * @brief Index the embeddings of a node of the graph, replacing its previous ones. Returns the number of vectors
+     */
+    std::size_t add_node(const Node<TStr>& node)
+    {
+        remove_node(NodeRef(node));
+        const std::size_t id = node._internal_id();
+        std::vector<label_type> labels;
+        auto add = [&](const AttrSet<TStr>& attrs, WidgetIdx w) {
+            const AttrValue<TStr>* v = attrs.get(_key);
+            if (!v)
+                return;
+            if (!v->is_vec_f64() || v->size() != _index.dim()) {
+                _n_skipped++;
+                return;
+            }
+            for (std::size_t i = 0; i < _buf.size(); i++)
+                _buf[i] = static_cast<float>(v->at_f64(i));
+            const label_type label = _next_label++;
+            _index.insert(label, _buf.data());
+            _hits.emplace(label, std::make_pair(id, w));
+            labels.push_back(label);
+        };
+        if (_widgets) {
+            const WidgetTree<TStr>& tree = node.widget_tree();
+            for (WidgetIdx w = 0; w < tree.size(); w++)
+                add(tree.attrs(w), w);
+        } else {
+            add(node, widget_npos);
+        }
+        const std::size_t n = labels.size();
+        if (n)
+            _by_node.emplace(id, std::move(labels));
+        return n;
+    }
+
+    /**
+     * @brief Drop the embeddings of a node. Returns false if it had none
+     */
+    bool remove_node(const NodeRef& node)
+    {
+        auto it = _by_node.find(node._internal_id());
+        if (it == _by_node.end())
+            return false;
+        for (label_type label : it->second) {
+            _index.remove(label);
+            _hits.erase(label);
+        }
+        _by_node.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief The k nearest embeddings, closest first
+     */
+    std::vector<AnnHit> search(const float* q, std::size_t k, std::size_t ef = 0) const
+    {
+        std::vector<AnnHit> out;
+        for (auto [label, dist] : _index.search(q, k, ef)) {
+            auto [node, widget] = _hits.at(label);
+            out.push_back(AnnHit{NodeRef(node), widget, dist});
+        }
+        return out;
+    }
+
+    std::vector<AnnHit> search(const std::vector<float>& q, std::size_t k, std::size_t ef = 0) const
+    {
+        if (q.size() != _index.dim()) [[unlikely]]
+            throw std::invalid_argument{"EmbeddingIndex : wrong query size"};
+        return search(q.data(), k, ef);
+    }
+
+    std::size_t size() const { return _index.size(); }
+    std::size_t n_skipped() const { return _n_skipped; }
+    const HnswIndex& index() const { return _index; }
+
+protected:
+    AttrKey _key;
+    bool _widgets;
+    HnswIndex _index;
+    std::vector<float> _buf;
+    std::unordered_map<label_type, std::pair<std::size_t, WidgetIdx>> _hits; // label -> (node id, widget)
+    std::unordered_map<std::size_t, std::vector<label_type>> _by_node;       // node id -> labels
+    label_type _next_label = 0;
+    std::size_t _n_skipped = 0;
+};
+
+}
+
+#endif // JSC_ANN_H
@@ -0,0 +1,198 @@
+#ifndef JSC_CSR_H
+#define JSC_CSR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Read-only view of a contiguous range
+ */
+template <class T>
+class CsrRange {
+public:
+    CsrRange(const T* begin, const T* end) : _begin(begin), _end(end) {}
+
+    const T* begin() const { return _begin; }
+    const T* end() const { return _end; }
+    std::size_t size() const { return _end - _begin; }
+    bool empty() const { return _begin == _end; }
+    const T& operator[](std::size_t i) const { return _begin[i]; }
+
+protected:
+    const T* _begin;
+    const T* _end;
+};
+
+
+/**
+ * @brief Immutable compressed sparse row snapshot of an AdjGraph, built with AdjGraph::freeze()
+ *
+ * Nodes get dense indices [0, n_nodes()). Out-edges of node u are the edge indices [out_offset(u), out_offset(u + 1)), stored as parallel columns
+ * (target, hyperlink id, attributes). In-edges (backlinks) are stored the same way, ordered by source and pointing back into the out-edge columns.
+ * The snapshot does not reference the graph, so it stays valid after the graph is modified
+ */
+template <class TStr = std::string>
+class CsrGraph {
+public:
+    using index_type = std::uint32_t;
+    static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+    CsrGraph() : _out_offsets{0}, _in_offsets{0} {}
+
+    /**
+     * @brief Build the snapshot in O(V + E) using up to n_threads threads (0 = all cores)
+     */
+    explicit CsrGraph(const AdjGraph<TStr>& g, std::size_t n_threads = 0)
+    {
+        JSC_TRACE_SCOPE("AdjGraph::freeze");
+        using NodeData = typename AdjGraph<TStr>::NodeData;
+
+        // Dense node indices
+        std::vector<const NodeData*> nodes;
+        nodes.reserve(g.size());
+        g.each([&](const NodeData& nd) { nodes.push_back(&nd); });
+
+        const std::size_t n = nodes.size();
+        if (n >= npos) [[unlikely]]
+            throw std::length_error{"CsrGraph : too many nodes"};
+        _ids.resize(n);
+        _index.assign(g.slot_count(), npos);
+        for (std::size_t u = 0; u < n; u++) {
+            _ids[u] = nodes[u]->node._internal_id();
+            _index[SlotMap<int>::slot_of(_ids[u])] = static_cast<index_type>(u);
+        }
+
+        // Out-edges : degrees -> offsets -> parallel fill
+        _out_offsets.assign(n + 1, 0);
+        for (std::size_t u = 0; u < n; u++)
+            _out_offsets[u + 1] = _out_offsets[u] + nodes[u]->edges.size();
+        const std::size_t m = _out_offsets[n];
+        _out_targets.resize(m);
+        _out_sources.resize(m);
+        _out_widgets.resize(m);
+        _edge_attrs.resize(m);
+
+        parallel_for(n, [&](std::size_t u) {
+            std::size_t e = _out_offsets[u];
+            for (const auto& h : nodes[u]->edges) {
+                _out_targets[e] = index_of(NodeRef(h._id_to()));
+                _out_sources[e] = static_cast<index_type>(u);
+                _out_widgets[e] = h._widget_id();
+                _edge_attrs[e] = static_cast<const AttrSet<TStr>&>(h);
+                e++;
+            }
+        }, n_threads, 256);
+
+        // In-edges : counting sort of the out-edges by target
+        _in_offsets.assign(n + 1, 0);
+        for (std::size_t u = 0; u < n; u++)
+            _in_offsets[u + 1] = _in_offsets[u] + nodes[u]->backlinks.size();
+        _in_sources.resize(m);
+        _in_edges.resize(m);
+
+        std::unique_ptr<std::atomic<std::size_t>[]> cursor(new std::atomic<std::size_t>[n]);
+        for (std::size_t u = 0; u < n; u++)
+            cursor[u].store(_in_offsets[u], std::memory_order_relaxed);
+
+        parallel_for(n, [&](std::size_t u) {
+            for (std::size_t e = _out_offsets[u]; e < _out_offsets[u + 1]; e++) {
+                std::size_t pos = cursor[_out_targets[e]].fetch_add(1, std::memory_order_relaxed);
+                _in_edges[pos] = e;
+            }
+        }, n_threads, 256);
+
+        // Scatter order depends on the thread schedule, sort each segment by edge index to make the snapshot deterministic
+        parallel_for(n, [&](std::size_t v) {
+            std::sort(_in_edges.begin() + _in_offsets[v], _in_edges.begin() + _in_offsets[v + 1]);
+            for (std::size_t i = _in_offsets[v]; i < _in_offsets[v + 1]; i++)
+                _in_sources[i] = _out_sources[_in_edges[i]];
+        }, n_threads, 256);
+    }
+
+    // NODES
+    // =====
+
+    std::size_t n_nodes() const { return _ids.size(); }
+    std::size_t n_edges() const { return _out_targets.size(); }
+
+    NodeRef node_ref(index_type u) const { return NodeRef(_ids[u]); }
+
+    /**
+     * @brief Dense index of the node, npos if the node is not in the snapshot (or was deleted and its slot reused before the snapshot)
+     */
+    index_type index_of(const NodeRef& node) const
+    {
+        std::size_t id = node._internal_id();
+        std::uint32_t slot = SlotMap<int>::slot_of(id);
+        if (slot >= _index.size() || _index[slot] == npos || _ids[_index[slot]] != id) [[unlikely]]
+            return npos;
+        return _index[slot];
+    }
+
+    // EDGES
+    // =====
+
+    std::size_t out_degree(index_type u) const { return _out_offsets[u + 1] - _out_offsets[u]; }
+    std::size_t in_degree(index_type u) const { return _in_offsets[u + 1] - _in_offsets[u]; }
+    std::size_t out_offset(index_type u) const { return _out_offsets[u]; }
+    std::size_t in_offset(index_type u) const { return _in_offsets[u]; }
+
+    /**
+     * @brief Dense targets of the out-edges of u. Multi-edges appear once per edge
+     */
+    CsrRange<index_type> neighbors(index_type u) const { return range(_out_targets, _out_offsets[u], _out_offsets[u + 1]); }
+
+    /**
+     * @brief Dense sources of the in-edges of u, one per edge
+     */
+    CsrRange<index_type> backlinks(index_type u) const { return range(_in_sources, _in_offsets[u], _in_offsets[u + 1]); }
+
+    /**
+     * @brief Out-edge indices of the in-edges of u, parallel to backlinks(u)
+     */
+    CsrRange<std::size_t> in_edges(index_type u) const { return range(_in_edges, _in_offsets[u], _in_offsets[u + 1]); }
+
+    index_type edge_target(std::size_t e) const { return _out_targets[e]; }
+    index_type edge_source(std::size_t e) const { return _out_sources[e]; }
+    std::size_t edge_widget(std::size_t e) const { return _out_widgets[e]; }
+    const AttrSet<TStr>& edge_attrs(std::size_t e) const { return _edge_attrs[e]; }
+
+    EdgeRef edge_ref(std::size_t e) const { return EdgeRef(_ids[_out_sources[e]], _ids[_out_targets[e]], _out_widgets[e]); }
+
+    // Raw columns
+    const std::vector<std::size_t>& out_offsets() const { return _out_offsets; }
+    const std::vector<index_type>& out_targets() const { return _out_targets; }
+    const std::vector<std::size_t>& in_offsets() const { return _in_offsets; }
+    const std::vector<index_type>& in_sources() const { return _in_sources; }
+
+protected:
+    template <class T>
+    static CsrRange<T> range(const std::vector<T>& v, std::size_t begin, std::size_t end) { return CsrRange<T>(v.data() + begin, v.data() + end); }
+
+    std::vector<std::size_t> _ids; // dense index -> node id
+    std::vector<index_type> _index; // node slot -> dense index, validated against _ids
+
+    std::vector<std::size_t> _out_offsets;
+    std::vector<index_type> _out_targets;
+    std::vector<index_type> _out_sources;
+    std::vector<std::size_t> _out_widgets;
+    std::vector<AttrSet<TStr>> _edge_attrs;
+
+    std::vector<std::size_t> _in_offsets;
+    std::vector<index_type> _in_sources;
+    std::vector<std::size_t> _in_edges;
+};
+
+}
+
+#endif // JSC_CSR_H
@@ -0,0 +1,221 @@
+#ifndef JSC_GATHER_H
+#define JSC_GATHER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "csr.h"
+#include "graph.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Copy a numeric attribute value of exactly dim numbers into row. Other values (missing, string, another size) give a row of zeros and false
+ */
+template <class T, class TStr>
+bool gather_row(const AttrValue<TStr>* v, std::size_t dim, T* row)
+{
+    if (v && v->size() == dim) {
+        if (v->is_vec_f64()) {
+            const double* p = v->data_f64();
+            for (std::size_t i = 0; i < dim; i++)
+                row[i] = static_cast<T>(p[i]);
+            return true;
+        }
+        if (v->is_vec_i64()) {
+            const std::int64_t* p = v->data_i64();
+            for (std::size_t i = 0; i < dim; i++)
+                row[i] = static_cast<T>(p[i]);
+            return true;
+        }
+    }
+    std::fill(row, row + dim, T(0));
+    return false;
+}
+
+/**
+ * @brief Size of the first numeric value of the attribute on the widgets of the tree. 0 if there is none
+ */
+template <class TStr>
+std::size_t attr_dim(const WidgetTree<TStr>& tree, AttrKey key)
+{
+    for (WidgetIdx w = 0; w < tree.size(); w++) {
+        const AttrValue<TStr>* v = tree.attrs(w).get(key);
+        if (v && !v->is_str())
+            return v->size();
+    }
+    return 0;
+}
+
+/**
+ * @brief Size of the first numeric value of the attribute on the nodes (or on the widgets) of the graph, in each() order. 0 if there is none
+ */
+template <class TStr>
+std::size_t attr_dim(const AdjGraph<TStr>& g, AttrKey key, bool widgets = false)
+{
+    std::size_t dim = 0;
+    g.each([&](const typename AdjGraph<TStr>::NodeData& nd) {
+        if (dim)
+            return;
+        if (widgets) {
+            dim = attr_dim(nd.node.widget_tree(), key);
+        } else {
+            const AttrValue<TStr>* v = nd.node.get(key);
+            if (v && !v->is_str())
+                dim = v->size();
+        }
+    });
+    return dim;
+}
+
+/**
+ * @brief Total number of widgets over the nodes of the graph
+ */
+template <class TStr>
+std::size_t count_widgets(const AdjGraph<TStr>& g)
+{
+    std::size_t n = 0;
+    g.each([&](const typename AdjGraph<TStr>::NodeData& nd) { n += nd.node.widget_tree().size(); });
+    return n;
+}
+
+/**
+ * @brief Fill the (tree.size(), dim) row-major matrix out with an attribute of every widget of the tree. found[i] tells whether row i was set.
+ * Returns the number of rows set
+ */
+template <class T, class TStr>
+std::size_t gather_widget_attr(const WidgetTree<TStr>& tree, AttrKey key, std::size_t dim, T* out, std::uint8_t* found = nullptr)
+{
+    std::size_t n = 0;
+    for (WidgetIdx w = 0; w < tree.size(); w++) {
+        const bool ok = gather_row(tree.attrs(w).get(key), dim, out + w * dim);
+        n += ok;
+        if (found)
+            found[w] = ok;
+    }
+    return n;
+}
+
+/**
+ * @brief Fill the (g.size(), dim) row-major matrix out with an attribute of every node, in each() order. node_ids receives the node id of each row.
+ * Returns the number of rows set
+ */
+template <class T, class TStr>
+std::size_t gather_node_attr(const AdjGraph<TStr>& g, AttrKey key, std::size_t dim, T* out, std::uint8_t* found = nullptr, std::size_t* node_ids = nullptr)
+{
+    std::size_t row = 0, n = 0;
+    g.each([&](const typename AdjGraph<TStr>::NodeData& nd) {
+        const bool ok = gather_row(nd.node.get(key), dim, out + row * dim);
+        n += ok;
+        if (found)
+            found[row] = ok;
+        if (node_ids)
+            node_ids[row] = nd.node._internal_id();
+        row++;
+    });
+    return n;
+}
+
+/**
+ * @brief Fill the (count_widgets(g), dim) row-major matrix out with an attribute of every widget of every node, node by node in each() order. node_ids
+ * and widgets receive the node id and the widget index of each row. Returns the number of rows set
+ */
+template <class T, class TStr>
+std::size_t gather_widget_attr(const AdjGraph<TStr>& g, AttrKey key, std::size_t dim, T* out, std::uint8_t* found = nullptr,
+                               std::size_t* node_ids = nullptr, WidgetIdx* widgets = nullptr)
+{
+    std::size_t row = 0, n = 0;
+    g.each([&](const typename AdjGraph<TStr>::NodeData& nd) {
+        const WidgetTree<TStr>& tree = nd.node.widget_tree();
+        n += gather_widget_attr(tree, key, dim, out + row * dim, found ? found + row : nullptr);
+        for (WidgetIdx w = 0; w < tree.size(); w++) {
+            if (node_ids)
+                node_ids[row + w] = nd.node._internal_id();
+            if (widgets)
+                widgets[row + w] = w;
+        }
+        row += tree.size();
+    });
+    return n;
+}
+
+/**
+ * @brief Fill the (n_nodes, sum(dims)) row-major matrix out with several node attributes side by side, in each() order (the dense order of a CsrGraph
+ * frozen from the same graph). found is (n_nodes, keys.size())
+ */
+template <class T, class TStr>
+void gather_node_features(const AdjGraph<TStr>& g, const std::vector<AttrKey>& keys, const std::vector<std::size_t>& dims, T* out,
+                          std::uint8_t* found = nullptr)
+{
+    std::size_t width = 0;
+    for (std::size_t d : dims)
+        width += d;
+    std::size_t row = 0;
+    g.each([&](const typename AdjGraph<TStr>::NodeData& nd) {
+        T* dst = out + row * width;
+        for (std::size_t k = 0; k < keys.size(); k++) {
+            const bool ok = gather_row(nd.node.get(keys[k]), dims[k], dst);
+            if (found)
+                found[row * keys.size() + k] = ok;
+            dst += dims[k];
+        }
+        row++;
+    });
+}
+
+/**
+ * @brief Size of the first numeric value of the attribute on the edges of the snapshot. 0 if there is none
+ */
+template <class TStr>
+std::size_t attr_dim(const CsrGraph<TStr>& csr, AttrKey key)
+{
+    for (std::size_t e = 0; e < csr.n_edges(); e++) {
+        const AttrValue<TStr>* v = csr.edge_attrs(e).get(key);
+        if (v && !v->is_str())
+            return v->size();
+    }
+    return 0;
+}
+
+/**
+ * @brief Fill the (n_edges, sum(dims)) row-major matrix out with several edge attributes side by side, in CSR edge order. found is (n_edges, keys.size())
+ */
+template <class T, class TStr>
+void gather_edge_features(const CsrGraph<TStr>& csr, const std::vector<AttrKey>& keys, const std::vector<std::size_t>& dims, T* out,
+                          std::uint8_t* found = nullptr, std::size_t n_threads = 0)
+{
+    std::size_t width = 0;
+    for (std::size_t d : dims)
+        width += d;
+    parallel_for(csr.n_edges(), [&](std::size_t e) {
+        T* dst = out + e * width;
+        for (std::size_t k = 0; k < keys.size(); k++) {
+            const bool ok = gather_row(csr.edge_attrs(e).get(keys[k]), dims[k], dst);
+            if (found)
+                found[e * keys.size() + k] = ok;
+            dst += dims[k];
+        }
+    }, n_threads, 4096);
+}
+
+/**
+ * @brief Write the COO edge index of the snapshot into the (2, n_edges) row-major matrix out : the dense sources, then the dense targets, in CSR edge order
+ */
+template <class T, class TStr>
+void edge_index(const CsrGraph<TStr>& csr, T* out, std::size_t n_threads = 0)
+{
+    const std::size_t m = csr.n_edges();
+    parallel_chunks(m, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t e = begin; e < end; e++) {
+            out[e] = static_cast<T>(csr.edge_source(e));
+            out[m + e] = static_cast<T>(csr.edge_target(e));
+        }
+    }, n_threads, 1 << 16);
+}
+
+}
+
+#endif // JSC_GATHER_H
@@ -0,0 +1,406 @@
+#ifndef JSC_GEOMETRY_H
+#define JSC_GEOMETRY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define JSC_GEOMETRY_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#define JSC_GEOMETRY_NEON
+#include <arm_neon.h>
+#endif
+
+#include "graph.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Instruction set used by the geometry kernels
+ */
+enum class SimdLevel : std::uint8_t {
+    Scalar,
+    AVX2,
+    NEON,
+};
+
+/**
+ * @brief Best instruction set available on this CPU, detected once. The kernels take it as their last argument, a level the CPU does not support
+ * falls back to the scalar code
+ */
+inline SimdLevel simd_level()
+{
+#if defined(JSC_GEOMETRY_NEON)
+    return SimdLevel::NEON;
+#elif defined(JSC_GEOMETRY_AVX2)
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::Scalar;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+
+/**
+ * @brief Widget boxes in a structure of arrays : x0, y0, x1, y1 columns (corners, not x, y, width, height) in one buffer
+ *
+ * Column k starts at data() + k * stride(), so the boxes can be exposed as an (n, 4) array with strides (1, stride) without copying. widgets() maps
+ * each box to its widget when the array was extracted from a tree
+ */
+class BoxArray {
+public:
+    BoxArray() : _n(0), _cap(0) {}
+    explicit BoxArray(std::size_t n) : _data(4 * n, 0.0), _widgets(n, widget_npos), _n(n), _cap(n) {}
+
+    /**
+     * @brief Extract the geometry (x, y, width, height) of the widgets which have one. With all_widgets, every widget gets a box, the missing ones are empty
+     */
+    template <class TStr>
+    static BoxArray from_tree(const WidgetTree<TStr>& tree, const TStr& geometry_key = "geometry", bool all_widgets = false)
+    {
+        const AttrKey key = AttrSet<TStr>::key(geometry_key);
+        BoxArray boxes;
+        boxes.reserve(tree.size());
+        for (WidgetIdx i = 0; i < tree.size(); i++) {
+            const AttrValue<TStr>* g = tree.attrs(i).get(key);
+            if (g && g->is_vec_f64() && g->size() >= 4)
+                boxes.push_back(g->at_f64(0), g->at_f64(1), g->at_f64(0) + g->at_f64(2), g->at_f64(1) + g->at_f64(3), i);
+            else if (all_widgets)
+                boxes.push_back(0, 0, 0, 0, i);
+        }
+        return boxes;
+    }
+
+    std::size_t size() const { return _n; }
+    bool empty() const { return _n == 0; }
+    std::size_t stride() const { return _cap; }
+
+    void reserve(std::size_t n)
+    {
+        if (n <= _cap)
+            return;
+        std::vector<double> data(4 * n, 0.0);
+        for (std::size_t k = 0; k < 4; k++)
+            std::copy(col(k), col(k) + _n, data.begin() + k * n);
+        _data.swap(data);
+        _cap = n;
+        _widgets.reserve(n);
+    }
+
+    void push_back(double x0, double y0, double x1, double y1, WidgetIdx widget = widget_npos)
+    {
+        if (_n == _cap)
+            reserve(std::max<std::size_t>(16, 2 * _cap));
+        col(0)[_n] = x0;
+        col(1)[_n] = y0;
+        col(2)[_n] = x1;
+        col(3)[_n] = y1;
+        _widgets.push_back(widget);
+        _n++;
+    }
+
+    double* data() { return _data.data(); }
+    const double* data() const { return _data.data(); }
+
+    double* x0() { return col(0); }
+    double* y0() { return col(1); }
+    double* x1() { return col(2); }
+    double* y1() { return col(3); }
+    const double* x0() const { return col(0); }
+    const double* y0() const { return col(1); }
+    const double* x1() const { return col(2); }
+    const double* y1() const { return col(3); }
+
+    /**
+     * @brief Widget of each box, widget_npos for boxes added without one
+     */
+    const std::vector<WidgetIdx>& widgets() const { return _widgets; }
+
+protected:
+    double* col(std::size_t k) { return _data.data() + k * _cap; }
+    const double* col(std::size_t k) const { return _data.data() + k * _cap; }
+
+    std::vector<double> _data;
+    std::vector<WidgetIdx> _widgets;
+    std::size_t _n, _cap;
+};
+
+
+inline SimdLevel usable_simd_level(SimdLevel level) { return level == simd_level() ? level : SimdLevel::Scalar; }
+
+
+// Kernels for each instruction set. All of them handle the tails with the scalar code
+namespace box_kernels {
+
+namespace scalar {
+
+inline double area(double x0, double y0, double x1, double y1) { return std::max(0.0, x1 - x0) * std::max(0.0, y1 - y0); }
+
+inline void area(const BoxArray& a, std::size_t begin, double* out)
+{
+    for (std::size_t i = begin; i < a.size(); i++)
+        out[i] = area(a.x0()[i], a.y0()[i], a.x1()[i], a.y1()[i]);
+}
+
+inline void iou_row(const BoxArray& b, const double* b_area, std::size_t begin, double x0, double y0, double x1, double y1, double a_area, double* out)
+{
+    for (std::size_t j = begin; j < b.size(); j++) {
+        double inter = area(std::max(x0, b.x0()[j]), std::max(y0, b.y0()[j]), std::min(x1, b.x1()[j]), std::min(y1, b.y1()[j]));
+        double uni = a_area + b_area[j] - inter;
+        out[j] = uni > 0 ? inter / uni : 0.0;
+    }
+}
+
+inline void contains_row(const BoxArray& b, std::size_t begin, double x0, double y0, double x1, double y1, std::uint8_t* out)
+{
+    for (std::size_t j = begin; j < b.size(); j++)
+        out[j] = x0 <= b.x0()[j] && y0 <= b.y0()[j] && b.x1()[j] <= x1 && b.y1()[j] <= y1;
+}
+
+inline void clip(BoxArray& a, std::size_t begin, double vx0, double vy0, double vx1, double vy1)
+{
+    for (std::size_t i = begin; i < a.size(); i++) {
+        a.x0()[i] = std::min(std::max(a.x0()[i], vx0), vx1);
+        a.y0()[i] = std::min(std::max(a.y0()[i], vy0), vy1);
+        a.x1()[i] = std::min(std::max(a.x1()[i], vx0), vx1);
+        a.y1()[i] = std::min(std::max(a.y1()[i], vy0), vy1);
+    }
+}
+
+}
+
+#ifdef JSC_GEOMETRY_AVX2
+namespace avx2 {
+
+__attribute__((target("avx2"))) inline __m256d area4(__m256d x0, __m256d y0, __m256d x1, __m256d y1)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    return _mm256_mul_pd(_mm256_max_pd(zero, _mm256_sub_pd(x1, x0)), _mm256_max_pd(zero, _mm256_sub_pd(y1, y0)));
+}
+
+__attribute__((target("avx2"))) inline std::size_t area(const BoxArray& a, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= a.size(); i += 4)
+        _mm256_storeu_pd(out + i, area4(_mm256_loadu_pd(a.x0() + i), _mm256_loadu_pd(a.y0() + i), _mm256_loadu_pd(a.x1() + i), _mm256_loadu_pd(a.y1() + i)));
+    return i;
+}
+
+__attribute__((target("avx2"))) inline std::size_t iou_row(const BoxArray& b, const double* b_area, double x0, double y0, double x1, double y1, double a_area, double* out)
+{
+    const __m256d ax0 = _mm256_set1_pd(x0), ay0 = _mm256_set1_pd(y0), ax1 = _mm256_set1_pd(x1), ay1 = _mm256_set1_pd(y1), aa = _mm256_set1_pd(a_area);
+    const __m256d zero = _mm256_setzero_pd();
+    std::size_t j = 0;
+    for (; j + 4 <= b.size(); j += 4) {
+        __m256d inter = area4(_mm256_max_pd(ax0, _mm256_loadu_pd(b.x0() + j)), _mm256_max_pd(ay0, _mm256_loadu_pd(b.y0() + j)),
+                              _mm256_min_pd(ax1, _mm256_loadu_pd(b.x1() + j)), _mm256_min_pd(ay1, _mm256_loadu_pd(b.y1() + j)));
+        __m256d uni = _mm256_sub_pd(_mm256_add_pd(aa, _mm256_loadu_pd(b_area + j)), inter);
+        __m256d pos = _mm256_cmp_pd(uni, zero, _CMP_GT_OQ);
+        _mm256_storeu_pd(out + j, _mm256_and_pd(pos, _mm256_div_pd(inter, _mm256_blendv_pd(_mm256_set1_pd(1.0), uni, pos))));
+    }
+    return j;
+}
+
+__attribute__((target("avx2"))) inline std::size_t contains_row(const BoxArray& b, double x0, double y0, double x1, double y1, std::uint8_t* out)
+{
+    const __m256d ax0 = _mm256_set1_pd(x0), ay0 = _mm256_set1_pd(y0), ax1 = _mm256_set1_pd(x1), ay1 = _mm256_set1_pd(y1);
+    std::size_t j = 0;
+    for (; j + 4 <= b.size(); j += 4) {
+        __m256d m = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(ax0, _mm256_loadu_pd(b.x0() + j), _CMP_LE_OQ), _mm256_cmp_pd(ay0, _mm256_loadu_pd(b.y0() + j), _CMP_LE_OQ)),
+                                  _mm256_and_pd(_mm256_cmp_pd(_mm256_loadu_pd(b.x1() + j), ax1, _CMP_LE_OQ), _mm256_cmp_pd(_mm256_loadu_pd(b.y1() + j), ay1, _CMP_LE_OQ)));
+        int bits = _mm256_movemask_pd(m);
+        for (int k = 0; k < 4; k++)
+            out[j + k] = (bits >> k) & 1;
+    }
+    return j;
+}
+
+__attribute__((target("avx2"))) inline std::size_t clip(BoxArray& a, double vx0, double vy0, double vx1, double vy1)
+{
+    const __m256d lx = _mm256_set1_pd(vx0), ly = _mm256_set1_pd(vy0), hx = _mm256_set1_pd(vx1), hy = _mm256_set1_pd(vy1);
+    double* cols[4] = {a.x0(), a.y0(), a.x1(), a.y1()};
+    const __m256d lo[4] = {lx, ly, lx, ly}, hi[4] = {hx, hy, hx, hy};
+    std::size_t i = 0;
+    for (; i + 4 <= a.size(); i += 4)
+        for (int k = 0; k < 4; k++)
+            _mm256_storeu_pd(cols[k] + i, _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(cols[k] + i), lo[k]), hi[k]));
+    return i;
+}
+
+}
+#endif
+
+#ifdef JSC_GEOMETRY_NEON
+namespace neon {
+
+inline float64x2_t area2(float64x2_t x0, float64x2_t y0, float64x2_t x1, float64x2_t y1)
+{
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    return vmulq_f64(vmaxq_f64(zero, vsubq_f64(x1, x0)), vmaxq_f64(zero, vsubq_f64(y1, y0)));
+}
+
+inline std::size_t area(const BoxArray& a, double* out)
+{
+    std::size_t i = 0;
+    for (; i + 2 <= a.size(); i += 2)
+        vst1q_f64(out + i, area2(vld1q_f64(a.x0() + i), vld1q_f64(a.y0() + i), vld1q_f64(a.x1() + i), vld1q_f64(a.y1() + i)));
+    return i;
+}
+
+inline std::size_t iou_row(const BoxArray& b, const double* b_area, double x0, double y0, double x1, double y1, double a_area, double* out)
+{
+    const float64x2_t ax0 = vdupq_n_f64(x0), ay0 = vdupq_n_f64(y0), ax1 = vdupq_n_f64(x1), ay1 = vdupq_n_f64(y1), aa = vdupq_n_f64(a_area);
+    const float64x2_t zero = vdupq_n_f64(0.0), one = vdupq_n_f64(1.0);
+    std::size_t j = 0;
+    for (; j + 2 <= b.size(); j += 2) {
+        float64x2_t inter = area2(vmaxq_f64(ax0, vld1q_f64(b.x0() + j)), vmaxq_f64(ay0, vld1q_f64(b.y0() + j)),
+                                  vminq_f64(ax1, vld1q_f64(b.x1() + j)), vminq_f64(ay1, vld1q_f64(b.y1() + j)));
+        float64x2_t uni = vsubq_f64(vaddq_f64(aa, vld1q_f64(b_area + j)), inter);
+        uint64x2_t pos = vcgtq_f64(uni, zero);
+        float64x2_t iou = vdivq_f64(inter, vbslq_f64(pos, uni, one));
+        vst1q_f64(out + j, vreinterpretq_f64_u64(vandq_u64(pos, vreinterpretq_u64_f64(iou))));
+    }
+    return j;
+}
+
+inline std::size_t contains_row(const BoxArray& b, double x0, double y0, double x1, double y1, std::uint8_t* out)
+{
+    const float64x2_t ax0 = vdupq_n_f64(x0), ay0 = vdupq_n_f64(y0), ax1 = vdupq_n_f64(x1), ay1 = vdupq_n_f64(y1);
+    std::size_t j = 0;
+    for (; j + 2 <= b.size(); j += 2) {
+        uint64x2_t m = vandq_u64(vandq_u64(vcleq_f64(ax0, vld1q_f64(b.x0() + j)), vcleq_f64(ay0, vld1q_f64(b.y0() + j))),
+                                 vandq_u64(vcleq_f64(vld1q_f64(b.x1() + j), ax1), vcleq_f64(vld1q_f64(b.y1() + j), ay1)));
+        out[j] = vgetq_lane_u64(m, 0) & 1;
+        out[j + 1] = vgetq_lane_u64(m, 1) & 1;
+    }
+    return j;
+}
+
+inline std::size_t clip(BoxArray& a, double vx0, double vy0, double vx1, double vy1)
+{
+    double* cols[4] = {a.x0(), a.y0(), a.x1(), a.y1()};
+    const double lo[4] = {vx0, vy0, vx0, vy0}, hi[4] = {vx1, vy1, vx1, vy1};
+    std::size_t i = 0;
+    for (; i + 2 <= a.size(); i += 2)
+        for (int k = 0; k < 4; k++)
+            vst1q_f64(cols[k] + i, vminq_f64(vmaxq_f64(vld1q_f64(cols[k] + i), vdupq_n_f64(lo[k])), vdupq_n_f64(hi[k])));
+    return i;
+}
+
+}
+#endif
+
+}
+
+
+/**
+ * @brief Area of every box (0 for inverted boxes). out has a.size() elements
+ */
+inline void box_area(const BoxArray& a, double* out, SimdLevel level = simd_level())
+{
+    level = usable_simd_level(level);
+    std::size_t done = 0;
+#ifdef JSC_GEOMETRY_AVX2
+    if (level == SimdLevel::AVX2)
+        done = box_kernels::avx2::area(a, out);
+#endif
+#ifdef JSC_GEOMETRY_NEON
+    if (level == SimdLevel::NEON)
+        done = box_kernels::neon::area(a, out);
+#endif
+    box_kernels::scalar::area(a, done, out);
+}
+
+inline std::vector<double> box_area(const BoxArray& a, SimdLevel level = simd_level())
+{
+    std::vector<double> out(a.size());
+    box_area(a, out.data(), level);
+    return out;
+}
+
+/**
+ * @brief Pairwise intersection over union, out[i * b.size() + j] = IoU(a[i], b[j]). Pairs with an empty union get 0
+ */
+inline void box_iou(const BoxArray& a, const BoxArray& b, double* out, SimdLevel level = simd_level())
+{
+    level = usable_simd_level(level);
+    std::vector<double> a_area = box_area(a, level), b_area = box_area(b, level);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        double* row = out + i * b.size();
+        const double x0 = a.x0()[i], y0 = a.y0()[i], x1 = a.x1()[i], y1 = a.y1()[i];
+        std::size_t done = 0;
+#ifdef JSC_GEOMETRY_AVX2
+        if (level == SimdLevel::AVX2)
+            done = box_kernels::avx2::iou_row(b, b_area.data(), x0, y0, x1, y1, a_area[i], row);
+#endif
+#ifdef JSC_GEOMETRY_NEON
+        if (level == SimdLevel::NEON)
+            done = box_kernels::neon::iou_row(b, b_area.data(), x0, y0, x1, y1, a_area[i], row);
+#endif
+        box_kernels::scalar::iou_row(b, b_area.data(), done, x0, y0, x1, y1, a_area[i], row);
+    }
+}
+
+inline std::vector<double> box_iou(const BoxArray& a, const BoxArray& b, SimdLevel level = simd_level())
+{
+    std::vector<double> out(a.size() * b.size());
+    box_iou(a, b, out.data(), level);
+    return out;
+}
+
+/**
+ * @brief Pairwise containment mask, out[i * b.size() + j] = 1 if a[i] contains b[j] (borders included). box_contains(b, a) gives the contained-by mask
+ */
+inline void box_contains(const BoxArray& a, const BoxArray& b, std::uint8_t* out, SimdLevel level = simd_level())
+{
+    level = usable_simd_level(level);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        std::uint8_t* row = out + i * b.size();
+        const double x0 = a.x0()[i], y0 = a.y0()[i], x1 = a.x1()[i], y1 = a.y1()[i];
+        std::size_t done = 0;
+#ifdef JSC_GEOMETRY_AVX2
+        if (level == SimdLevel::AVX2)
+            done = box_kernels::avx2::contains_row(b, x0, y0, x1, y1, row);
+#endif
+#ifdef JSC_GEOMETRY_NEON
+        if (level == SimdLevel::NEON)
+            done = box_kernels::neon::contains_row(b, x0, y0, x1, y1, row);
+#endif
+        box_kernels::scalar::contains_row(b, done, x0, y0, x1, y1, row);
+    }
+}
+
+inline std::vector<std::uint8_t> box_contains(const BoxArray& a, const BoxArray& b, SimdLevel level = simd_level())
+{
+    std::vector<std::uint8_t> out(a.size() * b.size());
+    box_contains(a, b, out.data(), level);
+    return out;
+}
+
+/**
+ * @brief Clip the boxes in place to the viewport (x, y, width, height). Boxes outside of it get an empty area
+ */
+inline void box_clip(BoxArray& a, double x, double y, double width, double height, SimdLevel level = simd_level())
+{
+    level = usable_simd_level(level);
+    const double vx0 = x, vy0 = y, vx1 = x + width, vy1 = y + height;
+    std::size_t done = 0;
+#ifdef JSC_GEOMETRY_AVX2
+    if (level == SimdLevel::AVX2)
+        done = box_kernels::avx2::clip(a, vx0, vy0, vx1, vy1);
+#endif
+#ifdef JSC_GEOMETRY_NEON
+    if (level == SimdLevel::NEON)
+        done = box_kernels::neon::clip(a, vx0, vy0, vx1, vy1);
+#endif
+    box_kernels::scalar::clip(a, done, vx0, vy0, vx1, vy1);
+}
+
+}
+
+#endif // JSC_GEOMETRY_H
@@ -4,116 +4,198 @@
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <new>
+#include <memory>
+#include <algorithm>
 #include <vector>
 #include <cassert>
 #include <stdexcept>
 #include <iostream>
 
 #include "common.h"
+#include "intern.h"
+#include "small_vector.h"
+#include "slot_map.h"
+#include "stats.h"
 
 namespace jsc {
 
-template <class TStr = std::string>
-using AttrVariant = std::variant<
-    std::array<std::int64_t, 4>,
-    std::array<double, 4>,
-    TStr,
-    std::vector<std::int64_t>,
-    std::vector<double>
->;
-
-
+/**
+ * @brief Type of the value stored in AttrValue
+ */
+enum class AttrKind : std::uint8_t {
+    ArrayI64 = 0, // up to 4 inline int64 values
+    ArrayF64 = 1, // up to 4 inline double values
+    Str = 2,
+    VecI64 = 3,
+    VecF64 = 4,
+};
 
 
+/**
+ * @brief Dynamic attribute value. A hand-rolled tagged union of 4 inline int64/double values, a string or a vector of int64/double values
+ *
+ * The kind and the inline array size are packed into a single header byte, the strings rely on the small string optimization of TStr
+ */
 template <class TStr = std::string>
 class AttrValue {
 public:
-    using variant_type = AttrVariant<TStr>;
-
-    AttrValue() : _array_size(0) {}
-    explicit AttrValue(std::initializer_list<std::int64_t> il) { to_array(il); }
-    explicit AttrValue(std::initializer_list<double> il) { to_array(il); }
-    explicit AttrValue(const std::vector<std::int64_t>& vec) : _v(vec) {}
-    explicit AttrValue(const std::vector<double>& vec) : _v(vec) {}
+    AttrValue() : _ai64{}, _hdr(pack(AttrKind::ArrayI64, 0)) {}
+    explicit AttrValue(std::initializer_list<std::int64_t> il) : AttrValue() { to_array(il); }
+    explicit AttrValue(std::initializer_list<double> il) : AttrValue() { to_array(il); }
+    explicit AttrValue(const std::vector<std::int64_t>& vec) : _vi64(vec), _hdr(pack(AttrKind::VecI64, 0)) {}
+    explicit AttrValue(const std::vector<double>& vec) : _vf64(vec), _hdr(pack(AttrKind::VecF64, 0)) {}
+    explicit AttrValue(std::vector<std::int64_t>&& vec) : _vi64(std::move(vec)), _hdr(pack(AttrKind::VecI64, 0)) {}
+    explicit AttrValue(std::vector<double>&& vec) : _vf64(std::move(vec)), _hdr(pack(AttrKind::VecF64, 0)) {}
 
     template <class TVal, class = std::enable_if_t<!std::is_same_v<std::decay_t<TVal>, AttrValue>>>
-    explicit AttrValue(TVal&& v) { init(std::forward<TVal>(v)); }
+    explicit AttrValue(TVal&& v) : AttrValue() { init(std::forward<TVal>(v)); }
+
+    AttrValue(const AttrValue& other) : _hdr(other._hdr) { copy_from(other); }
+    AttrValue(AttrValue&& other) noexcept : _hdr(other._hdr) { move_from(std::move(other)); }
+
+    AttrValue& operator=(const AttrValue& other)
+    {
+        if (this != &other) {
+            destroy();
+            _hdr = other._hdr;
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    AttrValue& operator=(AttrValue&& other) noexcept
+    {
+        if (this != &other) {
+            destroy();
+            _hdr = other._hdr;
+            move_from(std::move(other));
+        }
+        return *this;
+    }
+
+    ~AttrValue() { destroy(); }
 
-    //AttrValue(AttrValue<TStr>&& v) = default;
+    /**
+     * @brief Access the underlying storage: std::array<T, 4>, TStr or std::vector<T>. Throws std::bad_variant_access on kind mismatch
+     */
+    template <class T> T &get() { return const_cast<T&>(static_cast<const AttrValue*>(this)->get<T>()); }
+    template <class T> const T &get() const
+    {
+        if constexpr (std::is_same_v<T, std::array<std::int64_t, 4>>) {
+            if (kind() == AttrKind::ArrayI64) return _ai64;
+        } else if constexpr (std::is_same_v<T, std::array<double, 4>>) {
+            if (kind() == AttrKind::ArrayF64) return _af64;
+        } else if constexpr (std::is_same_v<T, TStr>) {
+            if (kind() == AttrKind::Str) return _str;
+        } else if constexpr (std::is_same_v<T, std::vector<std::int64_t>>) {
+            if (kind() == AttrKind::VecI64) return _vi64;
+        } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+            if (kind() == AttrKind::VecF64) return _vf64;
+        }
+        throw std::bad_variant_access{};
+    }
 
-    template <class T> T &get() { return std::get<T>(_v); }
-    template <class T> const T &get() const { return std::get<T>(_v); }
+    AttrKind kind() const { return static_cast<AttrKind>(_hdr & kind_mask); }
 
     std::size_t size() const {
-        if (std::holds_alternative<std::array<std::int64_t, 4>>(_v) || std::holds_alternative<std::array<double, 4>>(_v))
-            return _array_size;
-        else {
-            if (std::holds_alternative<std::vector<double>>(_v))
-                return std::get<std::vector<double>>(_v).size();
-            else if (std::holds_alternative<std::vector<std::int64_t>>(_v))
-                return std::get<std::vector<std::int64_t>>(_v).size();
-            else
-                return std::get<TStr>(_v).size();
+        switch (kind()) {
+            case AttrKind::ArrayI64:
+            case AttrKind::ArrayF64: return array_size();
+            case AttrKind::Str: return _str.size();
+            case AttrKind::VecI64: return _vi64.size();
+            case AttrKind::VecF64: return _vf64.size();
         }
+        return 0;
     }
 
     bool is_str() const {
-        return std::holds_alternative<TStr>(_v);
+        return kind() == AttrKind::Str;
     }
     bool is_vec_i64() const {
-        return std::holds_alternative<std::array<std::int64_t,4>>(_v) ||
-               std::holds_alternative<std::vector<std::int64_t>>(_v);
+        return kind() == AttrKind::ArrayI64 || kind() == AttrKind::VecI64;
     }
     bool is_vec_f64() const {
-        return std::holds_alternative<std::array<double,4>>(_v) ||
-               std::holds_alternative<std::vector<double>>(_v);
+        return kind() == AttrKind::ArrayF64 || kind() == AttrKind::VecF64;
     }
 
-    TStr &str() { return std::get<TStr>(_v); }
-    const TStr &str() const { return std::get<TStr>(_v); }
+    TStr &str() { return get<TStr>(); }
+    const TStr &str() const { return get<TStr>(); }
 
     int64_t &i64() { return at_i64(0); }
     uint64_t &ui64() { return reinterpret_cast<uint64_t&>(at_i64(0)); }
     double &f64() { return at_f64(0); }
+    const int64_t &i64() const { return at_i64(0); }
+    const uint64_t &ui64() const { return at_ui64(0); }
+    const double &f64() const { return at_f64(0); }
 
     int64_t &at_i64 (std::size_t i) {
-        if (std::holds_alternative<std::array<std::int64_t,4>>(_v))
-            return std::get<std::array<std::int64_t,4>>(_v).at(i);
-        if (std::holds_alternative<std::vector<std::int64_t>>(_v))
-            return std::get<std::vector<std::int64_t>>(_v).at(i);
+        if (kind() == AttrKind::ArrayI64) {
+            JSC_STAT_COUNT(AtI64Array);
+            if (i >= array_size()) [[unlikely]] throw std::out_of_range{"AttrValue::at_i64"};
+            return _ai64[i];
+        }
+        if (kind() == AttrKind::VecI64) {
+            JSC_STAT_COUNT(AtI64Vector);
+            return _vi64.at(i);
+        }
         throw std::bad_variant_access{}; // The least problematic way to handle bad access
     }
 
     uint64_t &at_ui64(std::size_t i) { return reinterpret_cast<uint64_t&>(at_i64(i)); }
 
     double &at_f64 (std::size_t i) {
-        if (std::holds_alternative<std::array<double,4>>(_v))
-            return std::get<std::array<double,4>>(_v).at(i);
-        if (std::holds_alternative<std::vector<double>>(_v))
-            return std::get<std::vector<double>>(_v).at(i);
+        if (kind() == AttrKind::ArrayF64) {
+            JSC_STAT_COUNT(AtF64Array);
+            if (i >= array_size()) [[unlikely]] throw std::out_of_range{"AttrValue::at_f64"};
+            return _af64[i];
+        }
+        if (kind() == AttrKind::VecF64) {
+            JSC_STAT_COUNT(AtF64Vector);
+            return _vf64.at(i);
+        }
         throw std::bad_variant_access{}; // The least problematic way to handle bad access
     }
-    
+
     const int64_t &at_i64 (std::size_t i) const { return const_cast<AttrValue*>(this)->at_i64(i); }
     const uint64_t &at_ui64(std::size_t i) const { return reinterpret_cast<const uint64_t&>(at_i64(i)); }
     const double &at_f64 (std::size_t i) const { return const_cast<AttrValue*>(this)->at_f64(i); }
 
+    /**
+     * @brief Contiguous storage of the size() numbers. Throws std::bad_variant_access on kind mismatch. Invalidated by push/pop and by moving the value
+     * (short arrays are stored inline)
+     */
+    int64_t *data_i64() {
+        if (kind() == AttrKind::ArrayI64) return _ai64.data();
+        if (kind() == AttrKind::VecI64) return _vi64.data();
+        throw std::bad_variant_access{};
+    }
+
+    double *data_f64() {
+        if (kind() == AttrKind::ArrayF64) return _af64.data();
+        if (kind() == AttrKind::VecF64) return _vf64.data();
+        throw std::bad_variant_access{};
+    }
+
+    const int64_t *data_i64() const { return const_cast<AttrValue*>(this)->data_i64(); }
+    const double *data_f64() const { return const_cast<AttrValue*>(this)->data_f64(); }
+
     void push_i64(int64_t v) { do_push<std::int64_t>(v); }
     void push_f64(double v) { do_push<double>(v); }
 
     bool pop() {
-        if (std::holds_alternative<std::array<std::int64_t,4>>(_v) ||
-            std::holds_alternative<std::vector<std::int64_t>>(_v)) {
+        if (is_vec_i64()) {
             do_pop<std::int64_t>();
             return true;
         }
-        if (std::holds_alternative<std::array<double,4>>(_v) ||
-            std::holds_alternative<std::vector<double>>(_v)) {
+        if (is_vec_f64()) {
             do_pop<double>();
             return true;
         }
@@ -126,55 +208,127 @@ public:
     }
 
 protected:
-    variant_type _v{};
-    int _array_size;
+    // Header byte layout : [ 0 | size (3 bits) | kind (3 bits) ]
+    static constexpr std::uint8_t kind_mask = 0x7;
+    static constexpr std::uint8_t size_shift = 3;
+
+    static constexpr std::uint8_t pack(AttrKind k, std::size_t array_size) { return static_cast<std::uint8_t>(static_cast<std::uint8_t>(k) | (array_size << size_shift)); }
+    std::size_t array_size() const { return _hdr >> size_shift; }
+    void set_array_size(std::size_t n) { _hdr = pack(kind(), n); }
+
+    union {
+        std::array<std::int64_t, 4> _ai64;
+        std::array<double, 4> _af64;
+        TStr _str;
+        std::vector<std::int64_t> _vi64;
+        std::vector<double> _vf64;
+    };
+    std::uint8_t _hdr;
+
+    void destroy()
+    {
+        switch (kind()) {
+            case AttrKind::Str: std::destroy_at(&_str); break;
+            case AttrKind::VecI64: std::destroy_at(&_vi64); break;
+            case AttrKind::VecF64: std::destroy_at(&_vf64); break;
+            default: break; // trivial
+        }
+        _hdr = pack(AttrKind::ArrayI64, 0);
+    }
+
+    // Expects uninitialized storage and _hdr copied from other
+    void copy_from(const AttrValue& other)
+    {
+        switch (kind()) {
+            case AttrKind::ArrayI64: ::new (&_ai64) std::array<std::int64_t, 4>(other._ai64); break;
+            case AttrKind::ArrayF64: ::new (&_af64) std::array<double, 4>(other._af64); break;
+            case AttrKind::Str: ::new (&_str) TStr(other._str); break;
+            case AttrKind::VecI64: ::new (&_vi64) std::vector<std::int64_t>(other._vi64); break;
+            case AttrKind::VecF64: ::new (&_vf64) std::vector<double>(other._vf64); break;
+        }
+    }
+
+    void move_from(AttrValue&& other)
+    {
+        switch (kind()) {
+            case AttrKind::ArrayI64: ::new (&_ai64) std::array<std::int64_t, 4>(other._ai64); break;
+            case AttrKind::ArrayF64: ::new (&_af64) std::array<double, 4>(other._af64); break;
+            case AttrKind::Str: ::new (&_str) TStr(std::move(other._str)); break;
+            case AttrKind::VecI64: ::new (&_vi64) std::vector<std::int64_t>(std::move(other._vi64)); break;
+            case AttrKind::VecF64: ::new (&_vf64) std::vector<double>(std::move(other._vf64)); break;
+        }
+    }
 
+    // Expects a trivial (array) alternative
     template <class TVal>
     void init(TVal&& v) {
         using raw = std::decay_t<TVal>;
         if constexpr (std::is_integral_v<raw>) {
-            std::array<std::int64_t,4> a{};
-            a[0] = static_cast<std::int64_t>(v);
-            _array_size = 1;
-            _v = a;
+            _ai64 = {static_cast<std::int64_t>(v), 0, 0, 0};
+            _hdr = pack(AttrKind::ArrayI64, 1);
         } else if constexpr (std::is_floating_point_v<raw>) {
-            std::array<double,4> a{};
-            _array_size = 1;
-            a[0] = static_cast<double>(v);
-            _v = a;
+            ::new (&_af64) std::array<double, 4>{static_cast<double>(v), 0, 0, 0};
+            _hdr = pack(AttrKind::ArrayF64, 1);
+        } else if constexpr (std::is_same_v<raw, std::vector<std::int64_t>>) {
+            ::new (&_vi64) std::vector<std::int64_t>(std::forward<TVal>(v));
+            _hdr = pack(AttrKind::VecI64, 0);
+        } else if constexpr (std::is_same_v<raw, std::vector<double>>) {
+            ::new (&_vf64) std::vector<double>(std::forward<TVal>(v));
+            _hdr = pack(AttrKind::VecF64, 0);
         } else {
-            // string or vec
-            _v = std::forward<TVal>(v);
+            // string
+            ::new (&_str) TStr(std::forward<TVal>(v));
+            _hdr = pack(AttrKind::Str, 0);
         }
     }
 
+    template <class T>
+    static constexpr AttrKind array_kind() { return std::is_same_v<T, double> ? AttrKind::ArrayF64 : AttrKind::ArrayI64; }
+    template <class T>
+    static constexpr AttrKind vec_kind() { return std::is_same_v<T, double> ? AttrKind::VecF64 : AttrKind::VecI64; }
+
+    template <class T>
+    std::array<T, 4>& array_ref() { if constexpr (std::is_same_v<T, double>) return _af64; else return _ai64; }
+    template <class T>
+    std::vector<T>& vec_ref() { if constexpr (std::is_same_v<T, double>) return _vf64; else return _vi64; }
+
+    // Expects a trivial (array) alternative
     template <class T>
     void to_array(std::initializer_list<T> il) {
         if (il.size() <= 4) {
-            _array_size = il.size();
-            std::array<T,4> a{};
-            for (auto it = il.begin(); it != il.end(); it++)
-                a[std::distance(il.begin(), it)] = *it;
-            _v = a;
+            std::array<T, 4> a{};
+            std::copy(il.begin(), il.end(), a.begin());
+            ::new (&array_ref<T>()) std::array<T, 4>(a);
+            _hdr = pack(array_kind<T>(), il.size());
         } else {
-            _v = std::vector<std::decay_t<T>>(il);
+            ::new (&vec_ref<T>()) std::vector<T>(il);
+            _hdr = pack(vec_kind<T>(), 0);
         }
     }
 
     template <class T>
     bool do_push(T v) {
-        if (std::holds_alternative<std::vector<T>>(_v)) {
-            std::get<std::vector<T>>(_v).push_back(v);
+        if (kind() == vec_kind<T>()) {
+            vec_ref<T>().push_back(v);
             return true;
         }
-        if (std::holds_alternative<std::array<T,4>>(_v)) {
-            const auto &a = std::get<std::array<T,4>>(_v);
+        if (kind() == array_kind<T>()) {
+            std::size_t n = array_size();
+            if (n < 4) {
+                array_ref<T>()[n] = v;
+                set_array_size(n + 1);
+                return true;
+            }
+            // Spill to the heap, reserving room for further growth
+            JSC_STAT_COUNT(AttrSpill);
+            JSC_STAT_TIMER(AttrSpill);
+            std::array<T, 4> a = array_ref<T>();
             std::vector<T> vec;
-            //vec.reserve(a.size() + 1);
-            for (std::size_t i = 0; i < _array_size; i++)
-                vec.push_back(a[i]);
+            vec.reserve(2 * a.size());
+            vec.assign(a.begin(), a.end());
             vec.push_back(v);
-            _v = std::move(vec);
+            ::new (&vec_ref<T>()) std::vector<T>(std::move(vec));
+            _hdr = pack(vec_kind<T>(), 0);
             return true;
         }
 #ifdef ALWAYS_THROW_ON_ERROR
@@ -186,14 +340,13 @@ protected:
 
     template <class T>
     bool do_pop() {
-        if (std::holds_alternative<std::array<T,4>>(_v)) {
-            auto &a = std::get<std::array<T,4>>(_v);
-            if (_array_size > 0)
-                _array_size--;
+        if (kind() == array_kind<T>()) {
+            if (array_size() > 0)
+                set_array_size(array_size() - 1);
             return true;
         }
-        if (std::holds_alternative<std::vector<T>>(_v)) {
-            auto &vec = std::get<std::vector<T>>(_v);
+        if (kind() == vec_kind<T>()) {
+            auto &vec = vec_ref<T>();
             if (!vec.empty()) vec.pop_back();
             return true;
         }
@@ -202,43 +355,138 @@ protected:
 #else
         return false; // cannot pop a string
 #endif
-        //assert((std::holds_alternative<std::array<T,4>>(_v) ||
-        //        std::holds_alternative<std::vector<T>>(_v)) &&
-        //        "do_pop<T>: wrong variant alternative");
     }
 };
 
 
 #ifdef OPTIMAL_STRUCTS
+    static_assert(sizeof(AttrValue<std::string>) <= sizeof(std::string) + alignof(std::string), "AttrValue should fit the largest alternative and one header byte. You may set FORCE_OPTIMAL_STRUCTS to OFF to disable this warning");
     static_assert(sizeof(AttrValue<std::string>) <= 64, "AttrValue size is not optimal for the cache line size of 64 bytes. You may set FORCE_OPTIMAL_STRUCTS to OFF to disable this warning");
 #endif
 
 
 
-template<class TStr = std::string>
+/**
+ * @brief AttrSet storage backed by a hashmap. Each entry is a separate heap node
+ */
+template <class TStr = std::string>
+using HashAttrStorage = std::unordered_map<AttrKey, AttrValue<TStr>>;
+
+/**
+ * @brief AttrSet storage backed by a key-sorted vector with N inline slots. Sets with up to N attributes do not allocate, but every set takes the
+ * room of N attributes even when empty (208 bytes for N = 4 against 56 for HashAttrStorage)
+ */
+template <class TStr = std::string, std::size_t N = 4>
+using FlatAttrStorage = SmallFlatMap<AttrKey, AttrValue<TStr>, N>;
+
+#ifdef FLAT_ATTR_STORAGE
+template <class TStr = std::string>
+using DefaultAttrStorage = FlatAttrStorage<TStr>;
+#else
+template <class TStr = std::string>
+using DefaultAttrStorage = HashAttrStorage<TStr>;
+#endif
+
+
+/**
+ * @brief Set of dynamic attributes. Keys are interned into AttrKey atoms, so lookups by atom never hash or compare strings
+ *
+ * TStorage is a map AttrKey -> AttrValue<TStr>, see HashAttrStorage and FlatAttrStorage. The default is selected by the FLAT_ATTR_STORAGE build option
+ */
+template<class TStr = std::string, class TStorage = DefaultAttrStorage<TStr>>
 class AttrSet {
+protected:
+    using map_type = TStorage;
+
 public:
-    void set(const TStr& k, const AttrValue<TStr>& v) { _dyn.emplace(std::move(k), std::move(v)); }
-    void set(const TStr& k, const TStr& v) { _dyn.emplace(std::move(k), AttrValue<TStr>(v)); }
-    void set(const TStr& k, std::initializer_list<std::int64_t> v) { _dyn.emplace(std::move(k), AttrValue<TStr>(v)); }
-    void set(const TStr& k, std::initializer_list<double> v) { _dyn.emplace(std::move(k), AttrValue<TStr>(v)); }
-    void set(const TStr& k, const std::vector<std::int64_t>& v) { _dyn.emplace(std::move(k), AttrValue<TStr>(v)); }
-    void set(const TStr& k, const std::vector<double>& v) { _dyn.emplace(std::move(k), AttrValue<TStr>(v)); }
-
-    bool contains(const TStr& k) const { return _dyn.find(k) != _dyn.end(); }
-    AttrValue<TStr>* get(const TStr &k) { auto it = _dyn.find(k); return it != _dyn.end() ? &it->second : nullptr; }
-    const AttrValue<TStr>* get(const TStr &k) const { auto it = _dyn.find(k); return it != _dyn.end() ? &it->second : nullptr; }
-
-    const std::unordered_map<TStr, AttrValue<TStr>> attrs_map() const { return _dyn; }
-    std::unordered_map<TStr, AttrValue<TStr>> attrs_map() { return _dyn; }
+    /**
+     * @brief Iterator over (key, value) pairs, where the key is resolved back to the string
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const TStr&, const AttrValue<TStr>&>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+
+        const_iterator() = default;
+        explicit const_iterator(typename map_type::const_iterator it) : _it(it) {}
+
+        reference operator*() const { return {AttrSet::key_name(_it->first), _it->second}; }
+        const_iterator& operator++() { ++_it; return *this; }
+        const_iterator operator++(int) { const_iterator tmp = *this; ++_it; return tmp; }
+        bool operator==(const const_iterator& other) const { return _it == other._it; }
+        bool operator!=(const const_iterator& other) const { return _it != other._it; }
+
+        AttrKey key() const { return _it->first; }
+
+    protected:
+        typename map_type::const_iterator _it;
+    };
+
+    /**
+     * @brief Intern a key using the global interner
+     */
+    static AttrKey key(const TStr& k) { return KeyInterner<TStr>::global().intern(k); }
+    static const TStr& key_name(AttrKey k) { return KeyInterner<TStr>::global().name(k); }
+
+    void set(AttrKey k, const AttrValue<TStr>& v) { _dyn.emplace(k, v); }
+    void set(AttrKey k, AttrValue<TStr>&& v) { _dyn.emplace(k, std::move(v)); }
+    void set(AttrKey k, const TStr& v) { _dyn.emplace(k, AttrValue<TStr>(v)); }
+    void set(AttrKey k, std::initializer_list<std::int64_t> v) { _dyn.emplace(k, AttrValue<TStr>(v)); }
+    void set(AttrKey k, std::initializer_list<double> v) { _dyn.emplace(k, AttrValue<TStr>(v)); }
+    void set(AttrKey k, const std::vector<std::int64_t>& v) { _dyn.emplace(k, AttrValue<TStr>(v)); }
+    void set(AttrKey k, const std::vector<double>& v) { _dyn.emplace(k, AttrValue<TStr>(v)); }
+
+    void set(const TStr& k, const AttrValue<TStr>& v) { set(key(k), v); }
+    void set(const TStr& k, AttrValue<TStr>&& v) { set(key(k), std::move(v)); }
+    void set(const TStr& k, const TStr& v) { set(key(k), v); }
+    void set(const TStr& k, std::initializer_list<std::int64_t> v) { set(key(k), v); }
+    void set(const TStr& k, std::initializer_list<double> v) { set(key(k), v); }
+    void set(const TStr& k, const std::vector<std::int64_t>& v) { set(key(k), v); }
+    void set(const TStr& k, const std::vector<double>& v) { set(key(k), v); }
+
+    /**
+     * @brief Set the attribute, replacing the value of an existing key. set() keeps the existing value
+     */
+    void assign(AttrKey k, const AttrValue<TStr>& v) { _dyn.insert_or_assign(k, v); }
+    void assign(AttrKey k, AttrValue<TStr>&& v) { _dyn.insert_or_assign(k, std::move(v)); }
+    void assign(const TStr& k, const AttrValue<TStr>& v) { assign(key(k), v); }
+    void assign(const TStr& k, AttrValue<TStr>&& v) { assign(key(k), std::move(v)); }
+
+    bool contains(AttrKey k) const { return _dyn.find(k) != _dyn.end(); }
+    AttrValue<TStr>* get(AttrKey k) { auto it = _dyn.find(k); return it != _dyn.end() ? &it->second : nullptr; }
+    const AttrValue<TStr>* get(AttrKey k) const { auto it = _dyn.find(k); return it != _dyn.end() ? &it->second : nullptr; }
+
+    // String lookups never insert into the interner: an unknown key cannot be present in any set
+    bool contains(const TStr& k) const { return contains(KeyInterner<TStr>::global().find(k)); }
+    AttrValue<TStr>* get(const TStr &k) { return get(KeyInterner<TStr>::global().find(k)); }
+    const AttrValue<TStr>* get(const TStr &k) const { return get(KeyInterner<TStr>::global().find(k)); }
+
+    std::size_t size() const { return _dyn.size(); }
+
+    std::unordered_map<TStr, AttrValue<TStr>> attrs_map() const
+    {
+        std::unordered_map<TStr, AttrValue<TStr>> res;
+        for (const auto& v : _dyn)
+            res.emplace(key_name(v.first), v.second);
+        return res;
+    }
+
+    template<class F>
+    void each(F func) const { for (const auto& v : _dyn) { func(key_name(v.first), v.second); } }
+
+    /**
+     * @brief Iterate over (AttrKey, value) pairs without resolving key strings
+     */
     template<class F>
-    void each(F func) const { for (const auto& v : _dyn) { func(v.first, v.second); } }
+    void each_key(F func) const { for (const auto& v : _dyn) { func(v.first, v.second); } }
 
-    auto begin() const { return _dyn.cbegin(); }
-    auto end() const { return _dyn.cend(); }
+    const_iterator begin() const { return const_iterator(_dyn.cbegin()); }
+    const_iterator end() const { return const_iterator(_dyn.cend()); }
 
 protected:
-    std::unordered_map<TStr, AttrValue<TStr>> _dyn;
+    map_type _dyn;
 };
 
 
@@ -266,14 +514,395 @@ protected:
 };
 
 
+/**
+ * @brief Index of a widget in a WidgetTree. Stable across insertions
+ */
+using WidgetIdx = std::uint32_t;
+constexpr WidgetIdx widget_npos = std::numeric_limits<WidgetIdx>::max();
+
+template <class TStr>
+class WidgetTree;
+
+
+/**
+ * @brief Lightweight handle to a widget stored in a WidgetTree. Mirrors the Widget interface
+ *
+ * Holds the tree pointer and the widget index, so it stays valid across insertions as long as the tree itself is not moved
+ */
+template <class TStr, bool Const>
+class BasicWidgetView {
+public:
+    using tree_type = std::conditional_t<Const, const WidgetTree<TStr>, WidgetTree<TStr>>;
+    using attrs_type = std::conditional_t<Const, const AttrSet<TStr>, AttrSet<TStr>>;
+    using name_type = std::conditional_t<Const, const TStr, TStr>;
+
+    /**
+     * @brief Iterates over the children of a widget by following the sibling links
+     */
+    class child_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BasicWidgetView;
+        using reference = BasicWidgetView;
+        using difference_type = std::ptrdiff_t;
+
+        child_iterator(tree_type* tree, WidgetIdx idx) : _tree(tree), _idx(idx) {}
+
+        BasicWidgetView operator*() const { return BasicWidgetView(_tree, _idx); }
+        child_iterator& operator++() { _idx = _tree->links(_idx).next_sibling; return *this; }
+        child_iterator operator++(int) { child_iterator tmp = *this; ++*this; return tmp; }
+        bool operator==(const child_iterator& other) const { return _idx == other._idx; }
+        bool operator!=(const child_iterator& other) const { return _idx != other._idx; }
+
+    protected:
+        tree_type* _tree;
+        WidgetIdx _idx;
+    };
+
+    class child_range {
+    public:
+        child_range(tree_type* tree, WidgetIdx first, std::size_t n) : _tree(tree), _first(first), _n(n) {}
+        child_iterator begin() const { return child_iterator(_tree, _first); }
+        child_iterator end() const { return child_iterator(_tree, widget_npos); }
+        std::size_t size() const { return _n; }
+        bool empty() const { return _n == 0; }
+
+    protected:
+        tree_type* _tree;
+        WidgetIdx _first;
+        std::size_t _n;
+    };
+
+    BasicWidgetView() : _tree(nullptr), _idx(widget_npos) {}
+    BasicWidgetView(tree_type* tree, WidgetIdx idx) : _tree(tree), _idx(idx) {}
+    template <bool C = Const, class = std::enable_if_t<C>>
+    BasicWidgetView(const BasicWidgetView<TStr, false>& other) : _tree(other.tree()), _idx(other.index()) {}
+
+    bool valid() const { return _tree && _idx != widget_npos; }
+    WidgetIdx index() const { return _idx; }
+    tree_type* tree() const { return _tree; }
+
+    name_type& name() const { return _tree->name(_idx); }
+    attrs_type& attrs() const { return _tree->attrs(_idx); }
+
+    std::size_t _hyperlink_id() const { return _tree->hyperlink_id(_idx); }
+    template <bool C = Const, class = std::enable_if_t<!C>>
+    void _set_hyperlink_id(std::size_t new_id) const { _tree->_set_hyperlink_id(_idx, new_id); }
+
+    // CHILDREN
+    // ========
+
+    BasicWidgetView parent() const { return BasicWidgetView(_tree, _tree->links(_idx).parent); }
+    child_range children() const { return child_range(_tree, _tree->links(_idx).first_child, _tree->links(_idx).n_children); }
+
+    /**
+     * @brief Get the i-th child. Takes O(i) steps along the sibling links, prefer children() for iteration
+     */
+    BasicWidgetView child(std::size_t i) const
+    {
+        if (i >= _tree->links(_idx).n_children) [[unlikely]]
+            throw std::out_of_range{"BasicWidgetView::child"};
+        WidgetIdx c = _tree->links(_idx).first_child;
+        for (; i > 0; i--)
+            c = _tree->links(c).next_sibling;
+        return BasicWidgetView(_tree, c);
+    }
+
+    template <bool C = Const, class = std::enable_if_t<!C>>
+    BasicWidgetView add_child(const TStr& name) const { return BasicWidgetView(_tree, _tree->add_child(_idx, name)); }
+    template <bool C = Const, class = std::enable_if_t<!C>>
+    BasicWidgetView add_child(const Widget<TStr>& w) const { return BasicWidgetView(_tree, _tree->add_subtree(_idx, w)); }
+
+    // ATTRIBUTES
+    // ==========
+
+    template <class K, class V>
+    void set(const K& k, V&& v) const { attrs().set(k, std::forward<V>(v)); }
+    template <class K>
+    void set(const K& k, std::initializer_list<std::int64_t> v) const { attrs().set(k, v); }
+    template <class K>
+    void set(const K& k, std::initializer_list<double> v) const { attrs().set(k, v); }
+
+    template <class K>
+    bool contains(const K& k) const { return attrs().contains(k); }
+    template <class K>
+    auto get(const K& k) const { return attrs().get(k); }
+
+protected:
+    tree_type* _tree;
+    WidgetIdx _idx;
+};
+
+template <class TStr = std::string>
+using WidgetView = BasicWidgetView<TStr, false>;
+template <class TStr = std::string>
+using ConstWidgetView = BasicWidgetView<TStr, true>;
+
+
+/**
+ * @brief Widgets of a page stored in flat arrays (structure of arrays). Links, names and hyperlink ids live in parallel arrays, attributes in a side arena
+ *
+ * Widgets are only ever appended, so a WidgetIdx stays valid across insertions. While every widget is appended as a child of the last subtree
+ * (which is the case for trees built depth-first, e.g. from a Widget or a loader), the storage order is the preorder and subtree_end() is valid.
+ * Full-tree scans are then linear memory sweeps
+ */
+template <class TStr = std::string>
+class WidgetTree {
+public:
+    struct Links {
+        WidgetIdx parent;
+        WidgetIdx first_child;
+        WidgetIdx last_child;
+        WidgetIdx next_sibling;
+        WidgetIdx subtree_end; // One past the last descendant, valid while is_preorder()
+        WidgetIdx n_children;
+    };
+
+    WidgetTree() : _preorder(true) {}
+    explicit WidgetTree(const TStr& root_name) : WidgetTree() { add_root(root_name); }
+    explicit WidgetTree(const Widget<TStr>& root) : WidgetTree() { add_subtree(widget_npos, root); }
+
+    // ACCESS
+    // ======
+
+    std::size_t size() const { return _links.size(); }
+    bool empty() const { return _links.empty(); }
+
+    /**
+     * @brief True if the storage order is the preorder of the tree
+     */
+    bool is_preorder() const { return _preorder; }
+
+    WidgetView<TStr> root() { return view(0); }
+    ConstWidgetView<TStr> root() const { return view(0); }
+
+    WidgetView<TStr> view(WidgetIdx i)
+    {
+        if (i >= size()) [[unlikely]]
+            throw std::out_of_range{"WidgetTree::view"};
+        return WidgetView<TStr>(this, i);
+    }
+    ConstWidgetView<TStr> view(WidgetIdx i) const
+    {
+        if (i >= size()) [[unlikely]]
+            throw std::out_of_range{"WidgetTree::view"};
+        return ConstWidgetView<TStr>(this, i);
+    }
+    WidgetView<TStr> operator[](WidgetIdx i) { return WidgetView<TStr>(this, i); }
+    ConstWidgetView<TStr> operator[](WidgetIdx i) const { return ConstWidgetView<TStr>(this, i); }
+
+    const Links& links(WidgetIdx i) const { return _links[i]; }
+    WidgetIdx subtree_end(WidgetIdx i) const { return _links[i].subtree_end; }
+
+    TStr& name(WidgetIdx i) { return _names[i]; }
+    const TStr& name(WidgetIdx i) const { return _names[i]; }
+    AttrSet<TStr>& attrs(WidgetIdx i) { return _attrs[i]; }
+    const AttrSet<TStr>& attrs(WidgetIdx i) const { return _attrs[i]; }
+
+    std::size_t hyperlink_id(WidgetIdx i) const { return _hl_ids[i]; }
+
+    /**
+     * @brief Set the hyperlink id of a widget and update the hyperlink id -> widget index
+     */
+    void _set_hyperlink_id(WidgetIdx i, std::size_t new_id)
+    {
+        std::size_t old_id = _hl_ids[i];
+        if (old_id < _hl_index.size() && _hl_index[old_id] == i)
+            _hl_index[old_id] = widget_npos;
+        _hl_ids[i] = new_id;
+        if (new_id != std::numeric_limits<std::size_t>::max()) {
+            if (new_id >= _hl_index.size())
+                _hl_index.resize(new_id + 1, widget_npos);
+            _hl_index[new_id] = i;
+        }
+    }
+
+    /**
+     * @brief Find the widget with the hyperlink id in O(1). Returns widget_npos if there is none
+     */
+    WidgetIdx find_hyperlink(std::size_t hyperlink_id) const
+    {
+        return hyperlink_id < _hl_index.size() ? _hl_index[hyperlink_id] : widget_npos;
+    }
+
+    // Columns for linear sweeps
+    const std::vector<Links>& links_column() const { return _links; }
+    const std::vector<TStr>& names_column() const { return _names; }
+    const std::vector<std::size_t>& hyperlink_ids_column() const { return _hl_ids; }
+    const std::vector<AttrSet<TStr>>& attrs_column() const { return _attrs; }
+
+    /**
+     * @brief Call func(view) for every widget in the storage order
+     */
+    template <class F>
+    void each(F func) { for (WidgetIdx i = 0; i < size(); i++) func(WidgetView<TStr>(this, i)); }
+    template <class F>
+    void each(F func) const { for (WidgetIdx i = 0; i < size(); i++) func(ConstWidgetView<TStr>(this, i)); }
+
+    /**
+     * @brief Call func(view) for every widget in preorder. A linear sweep if is_preorder(), a stack-based walk over the links otherwise
+     */
+    template <class F>
+    void each_preorder(F func) const
+    {
+        if (_preorder) {
+            each(func);
+            return;
+        }
+        if (empty())
+            return;
+        std::vector<WidgetIdx> stack{0};
+        while (!stack.empty()) {
+            WidgetIdx i = stack.back();
+            stack.pop_back();
+            func(ConstWidgetView<TStr>(this, i));
+
+            std::size_t top = stack.size();
+            for (WidgetIdx c = _links[i].first_child; c != widget_npos; c = _links[c].next_sibling)
+                stack.push_back(c);
+            std::reverse(stack.begin() + top, stack.end());
+        }
+    }
+
+    // MODIFIERS
+    // =========
+
+    void reserve(std::size_t n)
+    {
+        _links.reserve(n);
+        _names.reserve(n);
+        _hl_ids.reserve(n);
+        _attrs.reserve(n);
+    }
+
+    void clear()
+    {
+        _links.clear();
+        _names.clear();
+        _hl_ids.clear();
+        _attrs.clear();
+        _hl_index.clear();
+        _preorder = true;
+    }
+
+    /**
+     * @brief Create the root widget of an empty tree
+     */
+    WidgetIdx add_root(const TStr& name)
+    {
+        if (!empty()) [[unlikely]]
+            throw std::invalid_argument{"WidgetTree::add_root : the tree already has a root"};
+        return append(widget_npos, name);
+    }
+
+    /**
+     * @brief Append a widget as the last child of parent
+     */
+    WidgetIdx add_child(WidgetIdx parent, const TStr& name)
+    {
+        if (parent >= size()) [[unlikely]]
+            throw std::out_of_range{"WidgetTree::add_child"};
+        return append(parent, name);
+    }
+
+    WidgetIdx add_child(WidgetIdx parent, const TStr& name, AttrSet<TStr> attrs)
+    {
+        WidgetIdx i = add_child(parent, name);
+        _attrs[i] = std::move(attrs);
+        return i;
+    }
+
+    /**
+     * @brief Append a copy of the widget and all of its descendants in preorder. Pass widget_npos as parent to create the root of an empty tree
+     */
+    WidgetIdx add_subtree(WidgetIdx parent, const Widget<TStr>& w)
+    {
+        WidgetIdx i = parent == widget_npos ? add_root(w.name()) : add_child(parent, w.name());
+        _set_hyperlink_id(i, w._hyperlink_id());
+        _attrs[i] = static_cast<const AttrSet<TStr>&>(w);
+        for (const Widget<TStr>& c : w.children())
+            add_subtree(i, c);
+        return i;
+    }
+
+    /**
+     * @brief Convert the subtree back to the recursive Widget representation
+     */
+    Widget<TStr> to_widget(WidgetIdx i = 0) const
+    {
+        Widget<TStr> w(_names.at(i));
+        static_cast<AttrSet<TStr>&>(w) = _attrs[i];
+        w._set_hyperlink_id(_hl_ids[i]);
+        for (WidgetIdx c = _links[i].first_child; c != widget_npos; c = _links[c].next_sibling)
+            w.add_child(to_widget(c));
+        return w;
+    }
+
+protected:
+    WidgetIdx append(WidgetIdx parent, const TStr& name)
+    {
+        WidgetIdx i = static_cast<WidgetIdx>(size());
+        if (i == widget_npos) [[unlikely]]
+            throw std::length_error{"WidgetTree : too many widgets"};
+
+        _links.push_back(Links{parent, widget_npos, widget_npos, widget_npos, i + 1, 0});
+        _names.push_back(name);
+        _hl_ids.push_back(std::numeric_limits<std::size_t>::max());
+        _attrs.emplace_back();
+
+        if (parent == widget_npos)
+            return i;
+
+        Links& p = _links[parent];
+        if (p.last_child == widget_npos)
+            p.first_child = i;
+        else
+            _links[p.last_child].next_sibling = i;
+        p.last_child = i;
+        p.n_children++;
+
+        // The order stays the preorder only if parent's subtree is the last one
+        if (_preorder && p.subtree_end == i) {
+            for (WidgetIdx a = parent; a != widget_npos; a = _links[a].parent)
+                _links[a].subtree_end = i + 1;
+        } else {
+            _preorder = false;
+        }
+        return i;
+    }
+
+    std::vector<Links> _links;
+    std::vector<TStr> _names;
+    std::vector<std::size_t> _hl_ids; // Sequential hyperlink id of the widget in a node, see Widget::_hyperlink_id()
+    std::vector<AttrSet<TStr>> _attrs;
+    std::vector<WidgetIdx> _hl_index; // hyperlink id -> widget. Hyperlink ids are sequential per node, so the index is dense
+    bool _preorder;
+};
+
+
 template <class TStr = std::string>
 class Node : public AttrSet<TStr> {
 public:
-    explicit Node(const TStr &n = {}) : _id(std::numeric_limits<std::size_t>::max()), _name(n), _widget_hl_cnt(0) {}
+    explicit Node(const TStr &n = {}) : _name(n), _id(std::numeric_limits<std::size_t>::max()), _widget_hl_cnt(0) {}
 
-    /*Widget<TStr>& set_widget(Widget<TStr> w) { _widget = std::move(w); return _widget; }
-    const Widget<TStr>& widget() const { return _widget; }
-    Widget<TStr>& widget() { return _widget; }*/
+    /**
+     * @brief Replace the widget tree of the node with a flattened copy of w. Returns the root widget
+     */
+    WidgetView<TStr> set_widget(const Widget<TStr>& w) { _widgets = WidgetTree<TStr>(w); return _widgets.root(); }
+
+    /**
+     * @brief Replace the widget tree of the node. The tree may be empty
+     */
+    void set_widget(WidgetTree<TStr> tree) { _widgets = std::move(tree); }
+
+    /**
+     * @brief Get the root widget. The view is invalid (valid() is false) if the node has no widgets
+     */
+    ConstWidgetView<TStr> widget() const { return _widgets.empty() ? ConstWidgetView<TStr>() : _widgets.root(); }
+    WidgetView<TStr> widget() { return _widgets.empty() ? WidgetView<TStr>() : _widgets.root(); }
+
+    const WidgetTree<TStr>& widget_tree() const { return _widgets; }
+    WidgetTree<TStr>& widget_tree() { return _widgets; }
 
     const TStr& name() const { return _name; }
     TStr& name() { return _name; }
@@ -285,8 +914,8 @@ public:
     void _set_widget_hyperlinks_cnt(std::size_t new_cnt) { _widget_hl_cnt = new_cnt; }
 protected:
     TStr _name;
-    //Widget<TStr> _widget;
     std::size_t _id; // Sequential id of a node in a graph
+    WidgetTree<TStr> _widgets;
 
     // Temporary fields
     std::size_t _widget_hl_cnt; // Used for assigning widget hyperlinks ids
@@ -297,7 +926,14 @@ template <class TStr = std::string>
 class Hyperlink : public AttrSet<TStr> {
 public:
     Hyperlink() : _from(std::numeric_limits<std::size_t>::max()), _to(std::numeric_limits<std::size_t>::max()), _widget(std::numeric_limits<std::size_t>::max()) {}
-    Hyperlink(Node<TStr>& from, const Node<TStr>& to, Widget<TStr>& widget) : _from(from._internal_id()), _to(to._internal_id()) {
+    /**
+     * @brief Link the widget of from to the node to. A widget which already has a hyperlink id keeps it, so AdjGraph::add_edge() rejects a second edge
+     * from it. Prefer AdjGraph::add_edge(from, to, widget), which checks everything before assigning the id
+     */
+    Hyperlink(Node<TStr>& from, const Node<TStr>& to, WidgetView<TStr> widget) : _from(from._internal_id()), _to(to._internal_id()) {
+        _widget = widget._hyperlink_id();
+        if (_widget != std::numeric_limits<std::size_t>::max())
+            return;
         // Assign widget id
         std::size_t cnt = from._widget_hyperlinks_cnt();
         widget._set_hyperlink_id(cnt);
@@ -305,6 +941,11 @@ public:
         from._set_widget_hyperlinks_cnt(cnt + 1);
     }
 
+    /**
+     * @brief Construct the edge from raw ids without assigning the widget hyperlink id. Used by GraphBuilder
+     */
+    Hyperlink(std::size_t from, std::size_t to, std::size_t widget_id) : _from(from), _to(to), _widget(widget_id) {}
+
     std::size_t _id_from() const { return _from; }
     std::size_t _id_to() const { return _to; } // TODO do we need to store ids?
     std::size_t _widget_id() const { return _widget; }
@@ -336,7 +977,7 @@ public:
     EdgeRef() : _from(std::numeric_limits<std::size_t>::max()), _to(std::numeric_limits<std::size_t>::max()), _widget(std::numeric_limits<std::size_t>::max()) {}
     EdgeRef(std::size_t from, std::size_t to, std::size_t widget_id) : _from(from), _to(to), _widget(widget_id) {}
     template<class TStr>
-    EdgeRef(const Hyperlink<TStr>& edge) : _from(edge._id_from()), _to(edge._id_to()), _widget(edge._widget()) {}
+    EdgeRef(const Hyperlink<TStr>& edge) : _from(edge._id_from()), _to(edge._id_to()), _widget(edge._widget_id()) {}
 
     std::size_t _id_from() const { return _from; }
     std::size_t _id_to() const { return _to; }
@@ -355,6 +996,8 @@ public:
     WidgetRef(std::size_t node_id, std::size_t widget_id) : _node_id(node_id), _widget_id(widget_id) {}
     template<class TStr>
     WidgetRef(const Node<TStr>& node, const Widget<TStr>& widget) : _node_id(node._internal_id()), _widget_id(widget._hyperlink_id()) {}
+    template<class TStr, bool Const>
+    WidgetRef(const Node<TStr>& node, const BasicWidgetView<TStr, Const>& widget) : _node_id(node._internal_id()), _widget_id(widget._hyperlink_id()) {}
 
     NodeRef node_ref() const { return NodeRef(_node_id); }
     std::size_t _node_internal_id() const { return _node_id; }
@@ -366,235 +1009,390 @@ protected:
 };
 
 
+template <class TStr>
+class CsrGraph;
+
+template <class TStr>
+class GraphBuilder;
+
+class MappedGraph;
+
+
 /**
  * @brief Basic AdjGraph class implementation, supports multigraphs
  *
- * Graph data is stored in a mapping id -> {node, edges, backlinks, widget}, where backlinks is a list of non-unique backlinks.
+ * Graph data is stored in a slot map id -> {node, edges, backlinks, edge slots}, where backlinks hold one entry per incoming edge. Each node owns the WidgetTree of its page.
+ * Node ids carry a generation (see SlotMap), so references to deleted nodes are detected instead of resolving to a node which reused the slot.
+ * Edges of a node are addressed by the hyperlink id of their widget: the widget tree maps the hyperlink id to the widget and the edge slots map it to the position
+ * in the edges list, so both lookups are O(1). Every edge also knows the position of its backlink in the target, so deleting an edge is O(1) and deleting a node is
+ * O(degree).
  */
 template <class TStr = std::string>
 class AdjGraph {
 public:
-    AdjGraph() : next_id(0) {}
+    /**
+     * @brief Per-node graph data
+     */
+    struct Backlink {
+        std::size_t source;    // source node id
+        std::size_t hyperlink; // hyperlink id of the edge in the source node
+    };
+
+    using Backlinks = SmallVec<Backlink, 2>;
+
+    struct NodeData {
+        Node<TStr> node;
+        std::vector<Hyperlink<TStr>> edges;
+        Backlinks backlinks;
+        std::vector<std::size_t> edge_slots; // hyperlink id -> position in edges
+        std::vector<std::size_t> edge_backs; // position in edges -> position of the backlink in the target
+    };
+
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    AdjGraph() = default;
 
     // GETTERS
     // =======
 
+    std::size_t size() const { return data.size(); }
+    bool contains(const NodeRef& node) const { return data.contains(node._internal_id()); }
+
+    /**
+     * @brief Number of node slots, bounded by the peak number of nodes
+     */
+    std::size_t slot_count() const { return data.slot_count(); }
+
+    /**
+     * @brief Pre-size the node storage. Use GraphBuilder to construct large graphs in bulk
+     */
+    void reserve(std::size_t n_nodes) { data.reserve(n_nodes); }
+
     /**
      * @brief Get the node by its reference. May be invalidated after insertion
      */
     Node<TStr>& get_node(const NodeRef& node)
     {
-        if (node._internal_id() == std::numeric_limits<std::size_t>::max()) [[unlikely]]
-            throw std::invalid_argument{}; // The node does not exist
-        return std::get<0>(data[node._internal_id()]);
+        return entry(node._internal_id()).node;
     }
 
     /**
-     * @brief Get the root widget of a node. May be invalidated after insertion
+     * @brief Get the root widget of a node, or an invalid view if the node has no widgets. May be invalidated after insertion
      */
-    Widget<TStr>& get_widget(const NodeRef& node)
+    WidgetView<TStr> get_widget(const NodeRef& node)
     {
-        if (node._internal_id() == std::numeric_limits<std::size_t>::max()) [[unlikely]]
-            throw std::invalid_argument{}; // The node does not exist
-        return std::get<3>(data[node._internal_id()]);
+        return get_node(node).widget();
     }
 
     /**
-     * @brief Get the widget by its reference. May be invalidated after insertion
+     * @brief Get the widget by its reference in O(1). May be invalidated after insertion
      */
-    Widget<TStr>& get_widget(const WidgetRef& widget)
+    WidgetView<TStr> get_widget(const WidgetRef& widget)
     {
-        if (widget._node_internal_id() == std::numeric_limits<std::size_t>::max() || widget._hyperlink_id() == std::numeric_limits<std::size_t>::max()) [[unlikely]]
-            throw std::invalid_argument{}; // The node does not exist
-        Widget<TStr>* wid = find_widget_in_node(get_node(widget.node_ref())); // Not implemented
-        if (!wid) {
-            throw std::invalid_argument{}; // Not found
+        if (widget._node_internal_id() == npos || widget._hyperlink_id() == npos) [[unlikely]]
+            throw std::invalid_argument{"The node does not exist"};
+        WidgetView<TStr> wid = find_widget_in_node(get_node(widget.node_ref()), widget._hyperlink_id());
+        if (!wid.valid()) {
+            throw std::invalid_argument{"Not found"};
         }
         return wid;
     }
 
     /**
-     * @brief Get the starting (edge.from) node of the edge. May be invalidated after insertion. Behavior is undefined if edge.from does not exist
+     * @brief Get the starting (edge.from) node of the edge. May be invalidated after insertion
      */
     Node<TStr>& get_from(const EdgeRef& edge)
     {
-        std::size_t id = edge._id_from();
-        if (id == std::numeric_limits<std::size_t>::max()) [[unlikely]] {
-            throw std::invalid_argument{}; // The node is uninitialized
-        }
-        return std::get<0>(data[id]);
+        return entry(edge._id_from()).node;
     }
 
     /**
-     * @brief Get the ending (edge.to) node of the edge. May be invalidated after insertion. Behavior is undefined if edge.to does not exist
+     * @brief Get the ending (edge.to) node of the edge. May be invalidated after insertion
      */
     Node<TStr>& get_to(const EdgeRef& edge)
     {
-        std::size_t id = edge._id_to();
-        if (id == std::numeric_limits<std::size_t>::max()) [[unlikely]] {
-            throw std::invalid_argument{}; // The node is uninitialized
-        }
-        return std::get<0>(data[id]);
+        return entry(edge._id_to()).node;
+    }
+
+    /**
+     * @brief Get the outgoing edges of a node. The order is not preserved by deletions. May be invalidated after insertion
+     */
+    const std::vector<Hyperlink<TStr>>& get_edges(const NodeRef& node) const
+    {
+        return entry(node._internal_id()).edges;
+    }
+
+    /**
+     * @brief Get the incoming edges of a node as (source, hyperlink id) pairs, one per edge. The order is not preserved by deletions. May be invalidated after insertion
+     */
+    const Backlinks& get_backlinks(const NodeRef& node) const
+    {
+        return entry(node._internal_id()).backlinks;
+    }
+
+    /**
+     * @brief Get the edge which starts at the widget in O(1). May be invalidated after insertion
+     */
+    Hyperlink<TStr>& get_edge(const EdgeRef& edge)
+    {
+        NodeData& from = entry(edge._id_from());
+        std::size_t slot = edge_slot(from, edge._widget_id());
+        if (slot == npos || from.edges[slot]._id_to() != edge._id_to()) [[unlikely]]
+            throw std::out_of_range{"The edge does not exist"};
+        return from.edges[slot];
     }
 
+    /**
+     * @brief Build an immutable CSR snapshot for read-heavy traversal. Requires csr.h
+     */
+    template<class TSnapshot = CsrGraph<TStr>>
+    TSnapshot freeze(std::size_t n_threads = 0) const { return TSnapshot(*this, n_threads); }
+
+    /**
+     * @brief Write the graph to a binary file which can be opened with MappedGraph. Requires graph_io.h
+     */
+    template<class TFile = MappedGraph>
+    void save(const std::string& path) const { TFile::save(*this, path); }
+
+    /**
+     * @brief Call func(const NodeData&) for every node
+     */
+    template<class F>
+    void each(F func) const { data.each([&](std::size_t, const NodeData& nd) { func(nd); }); }
+
     // MODIFIERS
     // =========
 
     /**
      * @brief Add a node to the graph. If ALWAYS_THROW_ON_ERROR, throws if the node already has an id
      */
-    const NodeRef add_node(Node<TStr>& node, Widget<TStr>& widget)  // node is now initialized
+    const NodeRef add_node(Node<TStr>& node, const Widget<TStr>& widget)  // node is now initialized
     {
-        if (node._internal_id() != std::numeric_limits<std::size_t>::max()) [[unlikely]] {
-            throw std::invalid_argument{}; // The node cannot be added twice
+        if (node._internal_id() != npos) [[unlikely]] {
+            throw std::invalid_argument{"The node cannot be added twice"};
         }
-        node._set_internal_id(next_id);
-        data.insert({next_id, {std::move(node), std::vector<Hyperlink<TStr>>(), std::vector<std::size_t>(), std::move(widget)}});
-        next_id++;
-        return NodeRef(node);
+        node.set_widget(widget);
+        return add_node(node);
     }
 
     /**
-     * @brief Add a node to the graph with empty widget. If ALWAYS_THROW_ON_ERROR, throws if the node already has an id
+     * @brief Add a node to the graph with its current widget tree. If ALWAYS_THROW_ON_ERROR, throws if the node already has an id
      */
     const NodeRef add_node(Node<TStr>& node)  // node is now initialized
     {
-        return add_node(node, Widget<TStr>());
+        if (node._internal_id() != npos) [[unlikely]] {
+            throw std::invalid_argument{"The node cannot be added twice"};
+        }
+        std::size_t id = data.next_id();
+        node._set_internal_id(id);
+        data.insert(NodeData{std::move(node), {}, {}, {}, {}});
+        return NodeRef(id);
     }
 
     /**
-     * @brief Delete a node from the graph. Behavior is undefined if node does not exist
+     * @brief Delete a node and all of its edges from the graph
      */
     bool del_node(Node<TStr>& node)
     {
-        if (node._internal_id() == std::numeric_limits<std::size_t>::max()) [[unlikely]] {
+        if (node._internal_id() == npos) [[unlikely]] {
 #ifdef ALWAYS_THROW_ON_ERROR
-            throw std::invalid_argument{}; // The node is uninitialized
+            throw std::invalid_argument{"The node is uninitialized"};
 #else
             return false;
 #endif
         }
         std::size_t id = node._internal_id();
+        node._set_internal_id(npos); // node may be the stored one, which is destroyed below
+        return del_node(NodeRef(id));
+    }
 
-        // delete all edges [...] -> [node] using backlinks
-        for (std::size_t from : std::get<2>(data[id])) {
-            auto& edges = std::get<1>(data[from]);
-
-            for (auto it = edges.begin(); it != edges.end();) {
-                if (it._id_to() == id)
-                    it = edges.erase(it);
-                else it++;
-            }
+    bool del_node(const NodeRef& ref)
+    {
+        std::size_t id = ref._internal_id();
+        NodeData* it_node = data.find(id);
+        if (!it_node) [[unlikely]] {
+#ifdef ALWAYS_THROW_ON_ERROR
+            throw std::invalid_argument{"The node does not exist"};
+#else
+            return false;
+#endif
+        }
+        NodeData& nd = *it_node;
+        JSC_STAT_COUNT(DelNode);
+        JSC_STAT_ADD(DelNodeEdges, nd.backlinks.size() + nd.edges.size());
+        JSC_STAT_TIMER(DelNode);
+
+        // delete all edges [...] -> [node] using backlinks, O(1) per edge. Their backlinks are destroyed with the node
+        for (const Backlink& b : nd.backlinks) {
+            if (b.source == id)
+                continue;
+            NodeData& src = entry(b.source);
+            remove_edge_at(src, edge_slot(src, b.hyperlink));
         }
 
-        auto& edges = std::get<1>(data[id]);
-        // delete all backlinks of [node] -> [...] (targets)
-        for (auto it = edges.begin(); it != edges.end(); it++) {
-            // iterate over all N backlinks
-            auto& backlinks = std::get<2>(data[it._id_to()]);
-            for (auto bl = backlinks.begin(); bl != backlinks.end();) {
-                if (*bl == id)
-                    bl = backlinks.erase(bl); // don't need to increment
-                else
-                    bl++;
-            }
+        // delete all backlinks of [node] -> [...] (targets), O(1) per edge
+        for (std::size_t i = 0; i < nd.edges.size(); i++) {
+            std::size_t to = nd.edges[i]._id_to();
+            if (to != id)
+                remove_backlink_at(entry(to), nd.edge_backs[i]);
         }
 
         data.erase(id);
-        node._set_internal_id(std::numeric_limits<std::size_t>::max());
         return true;
     }
 
     /**
-     * @brief Add a new edge to the graph and returns the reference to the created edge. May be invalidated after insertion. Behavior is undefined if edge.from or edge.to do not exist
+     * @brief Add a new edge to the graph and returns the reference to the created edge. The widget with the edge hyperlink id must exist in edge.from
      */
     const EdgeRef add_edge(Hyperlink<TStr>& edge)
     {
         std::size_t from = edge._id_from(), to = edge._id_to(), wid = edge._widget_id();
-        if (from == std::numeric_limits<std::size_t>::max() || to == std::numeric_limits<std::size_t>::max() || wid == std::numeric_limits<std::size_t>::max()) [[unlikely]] {
-            throw std::invalid_argument{}; // The node is uninitialized
+        if (from == npos || to == npos || wid == npos) [[unlikely]] {
+            throw std::invalid_argument{"The node is uninitialized"};
         }
 
-        auto& elems = data[from]; // no rehashing will occur
-        std::get<1>(elems).push_back(std::move(edge));
-        std::get<2>(data[to]).push_back(from); // add backlink, we may have duplicate backlinks
-        return EdgeRef(edge);
+        NodeData& src = entry(from);
+        NodeData& dst = entry(to);
+        if (!find_widget_in_node(src.node, wid).valid()) [[unlikely]]
+            throw std::invalid_argument{"The widget does not exist in the source node"};
+        if (edge_slot(src, wid) != npos) [[unlikely]]
+            throw std::invalid_argument{"The widget already has a hyperlink"};
+
+        if (wid >= src.edge_slots.size())
+            src.edge_slots.resize(wid + 1, npos);
+        src.edge_slots[wid] = src.edges.size();
+        src.edges.push_back(std::move(edge));
+        src.edge_backs.push_back(dst.backlinks.size());
+        dst.backlinks.push_back(Backlink{from, wid}); // one backlink per edge, a source may appear several times
+        return EdgeRef(from, to, wid);
+    }
+
+    /**
+     * @brief Link the widget (index in the widget tree of from) to the node to and return the reference to the created edge. The nodes and the widget
+     * are checked before the widget gets its hyperlink id, so a failed call leaves the graph unchanged
+     */
+    const EdgeRef add_edge(const NodeRef& from, const NodeRef& to, WidgetIdx widget, AttrSet<TStr> attrs = {})
+    {
+        NodeData& src = entry(from._internal_id());
+        entry(to._internal_id());
+        WidgetTree<TStr>& tree = src.node.widget_tree();
+        if (widget >= tree.size()) [[unlikely]]
+            throw std::invalid_argument{"The widget does not exist in the source node"};
+        std::size_t wid = tree.hyperlink_id(widget);
+        if (wid != npos && edge_slot(src, wid) != npos) [[unlikely]]
+            throw std::invalid_argument{"The widget already has a hyperlink"};
+
+        if (wid == npos) {
+            wid = src.node._widget_hyperlinks_cnt();
+            tree._set_hyperlink_id(widget, wid);
+            src.node._set_widget_hyperlinks_cnt(wid + 1);
+        }
+        Hyperlink<TStr> edge(from._internal_id(), to._internal_id(), wid);
+        static_cast<AttrSet<TStr>&>(edge) = std::move(attrs);
+        return add_edge(edge);
     }
 
     /**
-     * @brief Delete a single edge in the multigraph. Behavior is undefined if edge.from does not exist
+     * @brief Delete a single edge in the multigraph
      */
     bool del_edge(const EdgeRef& edge)
     {
         std::size_t from = edge._id_from(), to = edge._id_to(), wid = edge._widget_id();
-        if (from == std::numeric_limits<std::size_t>::max() || to == std::numeric_limits<std::size_t>::max() || wid == std::numeric_limits<std::size_t>::max()) [[unlikely]] {
+        if (from == npos || to == npos || wid == npos) [[unlikely]] {
 #ifdef ALWAYS_THROW_ON_ERROR
-            throw std::invalid_argument{}; // The node is uninitialized
+            throw std::invalid_argument{"The node is uninitialized"};
 #else
             return false;
 #endif
         }
-        auto& node_data = data[from];
-        auto& edges = std::get<1>(node_data);
+        JSC_STAT_COUNT(DelEdge);
+        JSC_STAT_TIMER(DelEdge);
+        NodeData& src = entry(from);
 
-        // Iterate over all links between from->to and perform deletion
-        bool found = false;
-        for (auto it = edges.begin(); it != edges.end(); it++) {
-            if (*it == edge) { // TODO implement explicit operator== for edges
-                edges.erase(it);
-                found = true;
-                break;
-            }
-        }
-        if (!found) [[unlikely]] {
+        // The hyperlink id identifies the edge within the source node
+        std::size_t slot = edge_slot(src, wid);
+        if (slot == npos || src.edges[slot]._id_to() != to) [[unlikely]] {
 #ifdef ALWAYS_THROW_ON_ERROR
-            throw std::out_of_range{}; // The edge does not exist
+            throw std::out_of_range{"The edge does not exist"};
 #else
             return false;
 #endif
         }
+        // In a multigraph we would have n backlinks, the edge knows the position of its own one
+        NodeData& dst = entry(to);
+        std::size_t back = src.edge_backs[slot];
+        if (back >= dst.backlinks.size() || dst.backlinks[back].source != from || dst.backlinks[back].hyperlink != wid) [[unlikely]] {
+            internal_err_begin();
+            std::cerr << "AdjGraph::del_edge() : internal error : missing backlink for an existing edge" << std::endl;
+            internal_err("adjgraph_missing_backlinks", __FILE__, __LINE__);
+        }
+        remove_edge_at(src, slot);
+        remove_backlink_at(dst, back);
+        return true;
+    }
 
-        // We need to unset the widget hyperlink id
-        const Node<TStr>& node_from = std::get<0>(node_data);
-        Widget<TStr>* widget = find_widget_in_node(node_from, wid);
+protected:
+    friend class GraphBuilder<TStr>;
+    friend class MappedGraph;
 
-        if (!widget) {
-#ifdef ALWAYS_THROW_ON_ERROR
-            throw std::out_of_range{}; // The edge does not exist
-#else
-            return false;
-#endif
-        }
-        widget->_set_hyperlink_id(std::numeric_limits<std::size_t>::max());
+    NodeData& entry(std::size_t id)
+    {
+        NodeData* nd = data.find(id);
+        if (!nd) [[unlikely]]
+            throw std::invalid_argument{"The node does not exist"};
+        return *nd;
+    }
 
-        // In a multigraph we would have n backlinks, so we would need to delete exactly one
-        auto& backlinks = std::get<2>(data[to]);
-        for (auto it = backlinks.begin(); it != backlinks.end(); it++) {
-            if (*it == from) {
-                backlinks.erase(it);
-                return true;
-            }
+    const NodeData& entry(std::size_t id) const { return const_cast<AdjGraph*>(this)->entry(id); }
+
+    static std::size_t edge_slot(const NodeData& nd, std::size_t widget_id)
+    {
+        return widget_id < nd.edge_slots.size() ? nd.edge_slots[widget_id] : npos;
+    }
+
+    /**
+     * @brief Remove the edge at the position by moving the last edge into its place, unset the widget hyperlink id. Does not touch backlinks
+     */
+    static void remove_edge_at(NodeData& nd, std::size_t slot)
+    {
+        std::size_t wid = nd.edges[slot]._widget_id();
+        WidgetView<TStr> widget = find_widget_in_node(nd.node, wid);
+        if (widget.valid())
+            widget._set_hyperlink_id(npos);
+        nd.edge_slots[wid] = npos;
+
+        if (slot + 1 != nd.edges.size()) {
+            nd.edges[slot] = std::move(nd.edges.back());
+            nd.edge_backs[slot] = nd.edge_backs.back();
+            nd.edge_slots[nd.edges[slot]._widget_id()] = slot;
         }
-        // Internal error
-        [[unlikely]] {
-        internal_err_begin();
-        std::cerr << "AdjGraph::del_edge() : internal error : missing backlink for an existing edge" << std::endl;
-        internal_err("adjgraph_missing_backlinks", __FILE__, __LINE__);
+        nd.edges.pop_back();
+        nd.edge_backs.pop_back();
+    }
+
+    /**
+     * @brief Remove the backlink at the position by moving the last backlink into its place and repointing its edge
+     */
+    void remove_backlink_at(NodeData& nd, std::size_t pos)
+    {
+        std::size_t last = nd.backlinks.size() - 1;
+        if (pos != last) {
+            JSC_STAT_COUNT(BacklinkMoves);
+            const Backlink& moved = nd.backlinks[last];
+            NodeData& src = entry(moved.source);
+            src.edge_backs[edge_slot(src, moved.hyperlink)] = pos;
         }
+        nd.backlinks.swap_erase(pos);
     }
 
-protected:
-    Widget<TStr>& find_widget_in_node(const Node<TStr>& node, std::size_t widget_id)
+    static WidgetView<TStr> find_widget_in_node(Node<TStr>& node, std::size_t widget_id)
     {
-        // TODO implement node search
-        abort();
-        return Widget<TStr>();
+        WidgetIdx i = node.widget_tree().find_hyperlink(widget_id);
+        return i != widget_npos ? WidgetView<TStr>(&node.widget_tree(), i) : WidgetView<TStr>();
     }
 
 protected:
-    // We can theoretically use a vector, but insertions would be not O(1)
-    std::unordered_map<std::size_t, std::tuple<Node<TStr>, std::vector<Hyperlink<TStr>>, std::vector<std::size_t>, Widget<TStr>>> data; // TODO use a small vector for backlinks
-    std::size_t next_id;
+    SlotMap<NodeData> data;
 };
 
 }
@@ -0,0 +1,214 @@
+#ifndef JSC_GRAPH_BUILDER_H
+#define JSC_GRAPH_BUILDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Bulk constructor of an AdjGraph
+ *
+ * Nodes and (from, to, widget) edges are collected in batches and build() creates the graph in one pass: the storage is pre-sized, adjacency lists and
+ * backlinks are filled in parallel with counting sorts of the edges by source and by target. Node indices in the builder are the insertion order, the
+ * resulting graph is identical to adding the same nodes and then the same edges one by one with AdjGraph::add_node() and AdjGraph::add_edge()
+ */
+template <class TStr = std::string>
+class GraphBuilder {
+public:
+    /**
+     * @brief Edge from the widget of the node `from` to the node `to`. Nodes are builder indices, the widget is an index in the widget tree of `from`
+     */
+    struct EdgeSpec {
+        std::size_t from;
+        std::size_t to;
+        WidgetIdx widget;
+        AttrSet<TStr> attrs;
+    };
+
+    GraphBuilder() = default;
+
+    std::size_t n_nodes() const { return _nodes.size(); }
+    std::size_t n_edges() const { return _edges.size(); }
+
+    void reserve(std::size_t n_nodes, std::size_t n_edges)
+    {
+        _nodes.reserve(n_nodes);
+        _edges.reserve(n_edges);
+    }
+
+    /**
+     * @brief Add a node with its widget tree. Returns the builder index of the node
+     */
+    std::size_t add_node(Node<TStr> node)
+    {
+        if (node._internal_id() != AdjGraph<TStr>::npos) [[unlikely]]
+            throw std::invalid_argument{"The node cannot be added twice"};
+        _nodes.push_back(std::move(node));
+        return _nodes.size() - 1;
+    }
+
+    /**
+     * @brief Add a batch of nodes. Returns the builder index of the first node
+     */
+    std::size_t add_nodes(std::vector<Node<TStr>> nodes)
+    {
+        std::size_t first = _nodes.size();
+        _nodes.reserve(first + nodes.size());
+        for (auto& node : nodes)
+            add_node(std::move(node));
+        return first;
+    }
+
+    void add_edge(std::size_t from, std::size_t to, WidgetIdx widget, AttrSet<TStr> attrs = {})
+    {
+        _edges.push_back(EdgeSpec{from, to, widget, std::move(attrs)});
+    }
+
+    void add_edges(std::vector<EdgeSpec> edges)
+    {
+        if (_edges.empty()) {
+            _edges = std::move(edges);
+            return;
+        }
+        _edges.reserve(_edges.size() + edges.size());
+        std::move(edges.begin(), edges.end(), std::back_inserter(_edges));
+    }
+
+    /**
+     * @brief Reference of the node with the builder index i in the graph returned by build()
+     */
+    static NodeRef node_ref(std::size_t i) { return NodeRef(SlotMap<int>::make_id(static_cast<std::uint32_t>(i), 0)); }
+
+    /**
+     * @brief Build the graph using up to n_threads threads (0 = all cores). The builder is left empty
+     *
+     * Throws std::out_of_range if an edge references a missing node or widget and std::invalid_argument if a widget is used by several edges. Edges are validated
+     * before the builder is modified, so the builder is left unchanged if build() throws
+     */
+    AdjGraph<TStr> build(std::size_t n_threads = 0)
+    {
+        JSC_TRACE_SCOPE("GraphBuilder::build");
+        using NodeData = typename AdjGraph<TStr>::NodeData;
+        using Backlink = typename AdjGraph<TStr>::Backlink;
+        const std::size_t n = _nodes.size(), m = _edges.size();
+
+        parallel_for(m, [&](std::size_t e) {
+            const EdgeSpec& spec = _edges[e];
+            if (spec.from >= n || spec.to >= n) [[unlikely]]
+                throw std::out_of_range{"GraphBuilder : the edge references a missing node"};
+            if (spec.widget >= _nodes[spec.from].widget_tree().size()) [[unlikely]]
+                throw std::out_of_range{"GraphBuilder : the edge references a missing widget"};
+        }, n_threads);
+
+        // Stable counting sorts of the edges by source and by target
+        std::vector<std::size_t> out_offsets, out_edges, in_offsets, in_edges;
+        sort_edges(n, [&](std::size_t e) { return _edges[e].from; }, out_offsets, out_edges, n_threads);
+
+        // A widget has at most one edge : look for duplicates among the widgets of each source
+        parallel_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+            std::vector<WidgetIdx> widgets;
+            for (std::size_t u = begin; u < end; u++) {
+                widgets.clear();
+                for (std::size_t k = out_offsets[u]; k < out_offsets[u + 1]; k++)
+                    widgets.push_back(_edges[out_edges[k]].widget);
+                std::sort(widgets.begin(), widgets.end());
+                if (std::adjacent_find(widgets.begin(), widgets.end()) != widgets.end()) [[unlikely]]
+                    throw std::invalid_argument{"GraphBuilder : the widget already has a hyperlink"};
+            }
+        }, n_threads, 256);
+        sort_edges(n, [&](std::size_t e) { return _edges[e].to; }, in_offsets, in_edges, n_threads);
+
+        // Nodes get the ids of sequential insertion into an empty graph
+        AdjGraph<TStr> g;
+        g.data.reserve(n);
+        for (std::size_t i = 0; i < n; i++) {
+            _nodes[i]._set_internal_id(node_ref(i)._internal_id());
+            g.data.insert(NodeData{std::move(_nodes[i]), {}, {}, {}, {}});
+        }
+        _nodes.clear();
+
+        // Adjacency : hyperlink ids continue the counter of the source node in the edge order
+        std::vector<std::size_t> hyperlinks(m), out_rank(m);
+        parallel_for(n, [&](std::size_t u) {
+            NodeData& nd = g.data.value_at(static_cast<std::uint32_t>(u));
+            WidgetTree<TStr>& tree = nd.node.widget_tree();
+            const std::size_t first = nd.node._widget_hyperlinks_cnt(), k = out_offsets[u + 1] - out_offsets[u];
+
+            nd.edges.reserve(k);
+            nd.edge_backs.resize(k);
+            nd.edge_slots.assign(first + k, AdjGraph<TStr>::npos);
+            for (std::size_t r = 0; r < k; r++) {
+                std::size_t e = out_edges[out_offsets[u] + r], hl = first + r;
+                EdgeSpec& spec = _edges[e];
+                tree._set_hyperlink_id(spec.widget, hl);
+
+                Hyperlink<TStr> h(node_ref(u)._internal_id(), node_ref(spec.to)._internal_id(), hl);
+                static_cast<AttrSet<TStr>&>(h) = std::move(spec.attrs);
+                nd.edges.push_back(std::move(h));
+                nd.edge_slots[hl] = r;
+                hyperlinks[e] = hl;
+                out_rank[e] = r;
+            }
+            nd.node._set_widget_hyperlinks_cnt(first + k);
+        }, n_threads, 256);
+
+        // Backlinks in the global edge order. Each edge_backs element is written by exactly one target
+        parallel_for(n, [&](std::size_t v) {
+            NodeData& nd = g.data.value_at(static_cast<std::uint32_t>(v));
+            const std::size_t k = in_offsets[v + 1] - in_offsets[v];
+            nd.backlinks.reserve(k);
+            for (std::size_t r = 0; r < k; r++) {
+                std::size_t e = in_edges[in_offsets[v] + r], u = _edges[e].from;
+                nd.backlinks.push_back(Backlink{node_ref(u)._internal_id(), hyperlinks[e]});
+                g.data.value_at(static_cast<std::uint32_t>(u)).edge_backs[out_rank[e]] = r;
+            }
+        }, n_threads, 256);
+
+        _edges.clear();
+        return g;
+    }
+
+protected:
+    /**
+     * @brief Counting sort of the edge indices by key(e) in [0, n), stable in the edge order
+     */
+    template <class FKey>
+    void sort_edges(std::size_t n, FKey key, std::vector<std::size_t>& offsets, std::vector<std::size_t>& sorted, std::size_t n_threads) const
+    {
+        const std::size_t m = _edges.size();
+        std::unique_ptr<std::atomic<std::size_t>[]> cursor(new std::atomic<std::size_t>[n]);
+        for (std::size_t u = 0; u < n; u++)
+            cursor[u].store(0, std::memory_order_relaxed);
+        parallel_for(m, [&](std::size_t e) { cursor[key(e)].fetch_add(1, std::memory_order_relaxed); }, n_threads);
+
+        offsets.assign(n + 1, 0);
+        for (std::size_t u = 0; u < n; u++) {
+            offsets[u + 1] = offsets[u] + cursor[u].load(std::memory_order_relaxed);
+            cursor[u].store(offsets[u], std::memory_order_relaxed);
+        }
+
+        sorted.resize(m);
+        parallel_for(m, [&](std::size_t e) { sorted[cursor[key(e)].fetch_add(1, std::memory_order_relaxed)] = e; }, n_threads);
+
+        // Scatter order depends on the thread schedule, sort each segment to restore the edge order
+        parallel_for(n, [&](std::size_t u) { std::sort(sorted.begin() + offsets[u], sorted.begin() + offsets[u + 1]); }, n_threads, 256);
+    }
+
+    std::vector<Node<TStr>> _nodes;
+    std::vector<EdgeSpec> _edges;
+};
+
+}
+
+#endif // JSC_GRAPH_BUILDER_H
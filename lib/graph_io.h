@@ -0,0 +1,837 @@
+#ifndef JSC_GRAPH_IO_H
+#define JSC_GRAPH_IO_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "csr.h"
+#include "graph_builder.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of the buffer, continuing from crc
+ */
+inline std::uint32_t checksum_crc32(const void* data, std::size_t n, std::uint32_t crc = 0)
+{
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; i++)
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+/**
+ * @brief Sections of the binary graph file. Nodes are stored in dense order [0, n_nodes), edges are grouped by source (CSR)
+ */
+enum class GraphSection : std::uint32_t {
+    NodeIds,           // u64[n] node ids in the saved graph
+    SlotIndex,         // u32[slots] node slot -> dense index
+    NodeNames,         // u32[n] string index
+    NodeHyperlinkCnt,  // u64[n] hyperlink id counters
+    OutOffsets,        // u64[n + 1]
+    OutTargets,        // u32[m] dense target
+    OutHyperlinks,     // u64[m] hyperlink id in the source
+    InOffsets,         // u64[n + 1]
+    InSources,         // u32[m] dense source, in AdjGraph backlink order
+    InHyperlinks,      // u64[m]
+    WidgetOffsets,     // u64[n + 1] first widget of each node
+    Widgets,           // graph_file::Widget[n_widgets]
+    NodeAttrOffsets,   // u64[n + 1]
+    WidgetAttrOffsets, // u64[n_widgets + 1]
+    EdgeAttrOffsets,   // u64[m + 1]
+    Attrs,             // graph_file::Attr[n_attrs]
+    Payload,           // 8-byte words of numeric attributes
+    StringOffsets,     // u64[n_strings + 1]
+    StringData,        // char[]
+    Count
+};
+
+/**
+ * @brief On-disk structures. All integers are little-endian, sections are aligned to graph_file::alignment bytes
+ */
+namespace graph_file {
+
+constexpr char magic[8] = {'J', 'S', 'C', 'G', 'R', 'A', 'P', 'H'};
+constexpr std::uint32_t version = 1;
+constexpr std::uint32_t endian_tag = 0x01020304;
+constexpr std::size_t alignment = 64;
+constexpr std::uint32_t npos32 = std::numeric_limits<std::uint32_t>::max();
+constexpr std::uint32_t n_sections = static_cast<std::uint32_t>(GraphSection::Count);
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endian;
+    std::uint64_t n_nodes;
+    std::uint64_t n_edges;
+    std::uint64_t n_widgets;
+    std::uint64_t n_attrs;
+    std::uint64_t n_strings;
+    std::uint64_t n_slots;
+    std::uint32_t n_sections;
+    std::uint32_t crc; // CRC of the header (with crc = 0) and of the section table
+};
+
+struct Section {
+    std::uint32_t id;
+    std::uint32_t crc;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct Widget {
+    std::uint32_t parent;
+    std::uint32_t first_child;
+    std::uint32_t last_child;
+    std::uint32_t next_sibling;
+    std::uint32_t subtree_end;
+    std::uint32_t n_children;
+    std::uint32_t name; // string index
+    std::uint32_t pad;
+    std::uint64_t hyperlink;
+};
+
+struct Attr {
+    std::uint32_t key; // string index
+    std::uint8_t kind; // AttrKind
+    std::uint8_t pad[3];
+    std::uint64_t count;   // number of elements, 1 for strings
+    std::uint64_t payload; // first word in Payload, or string index
+};
+
+static_assert(sizeof(Header) == 72 && sizeof(Section) == 24 && sizeof(Widget) == 40 && sizeof(Attr) == 24);
+
+}
+
+
+class MappedGraph;
+
+/**
+ * @brief Read-only view of an attribute stored in a MappedGraph
+ */
+class MappedAttr {
+public:
+    MappedAttr() : _g(nullptr), _a(nullptr) {}
+    MappedAttr(const MappedGraph* g, const graph_file::Attr* a) : _g(g), _a(a) {}
+
+    bool valid() const { return _a != nullptr; }
+    std::string_view key() const;
+    AttrKind kind() const { return static_cast<AttrKind>(_a->kind); }
+    bool is_str() const { return kind() == AttrKind::Str; }
+    bool is_vec_i64() const { return kind() == AttrKind::ArrayI64 || kind() == AttrKind::VecI64; }
+    bool is_vec_f64() const { return kind() == AttrKind::ArrayF64 || kind() == AttrKind::VecF64; }
+
+    /**
+     * @brief Number of elements, string length for strings
+     */
+    std::size_t size() const { return is_str() ? str().size() : _a->count; }
+
+    std::string_view str() const;
+    std::int64_t at_i64(std::size_t i) const;
+    double at_f64(std::size_t i) const;
+    std::int64_t i64() const { return at_i64(0); }
+    double f64() const { return at_f64(0); }
+
+    /**
+     * @brief Copy into an AttrValue with the same alternative
+     */
+    template <class TStr = std::string>
+    AttrValue<TStr> to_value() const;
+
+protected:
+    const std::uint64_t* words() const;
+
+    const MappedGraph* _g;
+    const graph_file::Attr* _a;
+};
+
+/**
+ * @brief Attributes of a node, widget or edge in a MappedGraph
+ */
+class MappedAttrs {
+public:
+    MappedAttrs(const MappedGraph* g, const graph_file::Attr* begin, const graph_file::Attr* end) : _g(g), _begin(begin), _end(end) {}
+
+    std::size_t size() const { return _end - _begin; }
+    bool empty() const { return _begin == _end; }
+    MappedAttr operator[](std::size_t i) const { return MappedAttr(_g, _begin + i); }
+
+    /**
+     * @brief Find the attribute by its key in O(size). The result is invalid if there is none
+     */
+    MappedAttr get(std::string_view key) const
+    {
+        for (const auto* a = _begin; a != _end; a++)
+            if (MappedAttr(_g, a).key() == key)
+                return MappedAttr(_g, a);
+        return MappedAttr();
+    }
+
+    bool contains(std::string_view key) const { return get(key).valid(); }
+
+    std::uint32_t _key_index(std::size_t i) const { return _begin[i].key; }
+
+protected:
+    const MappedGraph* _g;
+    const graph_file::Attr* _begin;
+    const graph_file::Attr* _end;
+};
+
+
+/**
+ * @brief Binary graph file opened with mmap
+ *
+ * Queries run directly against the mapped file: the constructor only validates the header and the section table, pages are read by the OS on first
+ * access, so only the sections which are actually used get loaded. Section checksums are verified on open for the sections in the verify mask and
+ * can be verified later with verify(); the header and the section table are always checked. Offsets stored inside the sections are trusted, so verify
+ * the checksums of files from untrusted sources. Use load() to get a mutable AdjGraph and AdjGraph::save() (or MappedGraph::save()) to write the file
+ */
+class MappedGraph {
+public:
+    using index_type = std::uint32_t;
+    static constexpr index_type npos = graph_file::npos32;
+    static constexpr std::uint32_t verify_none = 0;
+    static constexpr std::uint32_t verify_all = (1u << graph_file::n_sections) - 1;
+
+    static constexpr std::uint32_t section_bit(GraphSection s) { return 1u << static_cast<std::uint32_t>(s); }
+
+    MappedGraph() : _data(nullptr), _size(0) {}
+
+    /**
+     * @brief Map the file and verify the checksums of the sections in verify_mask (verify_all reads the whole file).
+     * Throws std::runtime_error if the file cannot be opened, has a different version or is corrupted
+     */
+    explicit MappedGraph(const std::string& path, std::uint32_t verify_mask = verify_none) : MappedGraph()
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : cannot open " + path};
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(graph_file::Header))) [[unlikely]] {
+            ::close(fd);
+            throw std::runtime_error{"MappedGraph : not a graph file : " + path};
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : mmap failed : " + path};
+        _data = static_cast<const char*>(p);
+
+        try {
+            read_table();
+            for (std::uint32_t s = 0; s < graph_file::n_sections; s++)
+                if ((verify_mask & (1u << s)) && !verify(static_cast<GraphSection>(s)))
+                    throw std::runtime_error{"MappedGraph : checksum mismatch in section " + std::to_string(s) + " : " + path};
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    MappedGraph(const MappedGraph&) = delete;
+    MappedGraph& operator=(const MappedGraph&) = delete;
+    MappedGraph(MappedGraph&& other) noexcept : MappedGraph() { *this = std::move(other); }
+    MappedGraph& operator=(MappedGraph&& other) noexcept
+    {
+        if (this != &other) {
+            unmap();
+            _data = other._data;
+            _size = other._size;
+            _header = other._header;
+            _sections = other._sections;
+            other._data = nullptr;
+            other._size = 0;
+        }
+        return *this;
+    }
+    ~MappedGraph() { unmap(); }
+
+    bool is_open() const { return _data != nullptr; }
+    std::size_t file_size() const { return _size; }
+
+    /**
+     * @brief Check the CRC of a section. Touches all of its pages
+     */
+    bool verify(GraphSection s) const
+    {
+        const auto& sec = _sections[static_cast<std::uint32_t>(s)];
+        return checksum_crc32(_data + sec.offset, sec.size) == sec.crc;
+    }
+
+    /**
+     * @brief Hint the OS to read the section ahead
+     */
+    void prefetch(GraphSection s) const
+    {
+        const auto& sec = _sections[static_cast<std::uint32_t>(s)];
+        std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)), begin = sec.offset / page * page;
+        if (sec.size)
+            ::madvise(const_cast<char*>(_data) + begin, sec.offset + sec.size - begin, MADV_WILLNEED);
+    }
+
+    // NODES
+    // =====
+
+    std::size_t n_nodes() const { return _header.n_nodes; }
+    std::size_t n_edges() const { return _header.n_edges; }
+    std::size_t n_widgets() const { return _header.n_widgets; }
+
+    /**
+     * @brief Id of the node in the saved graph
+     */
+    std::size_t node_id(index_type u) const { return column<std::uint64_t>(GraphSection::NodeIds)[u]; }
+
+    /**
+     * @brief Dense index of a node of the saved graph in O(1), npos if there is none
+     */
+    index_type index_of(const NodeRef& node) const
+    {
+        std::size_t id = node._internal_id();
+        std::uint32_t slot = SlotMap<int>::slot_of(id);
+        if (slot >= _header.n_slots)
+            return npos;
+        index_type u = column<std::uint32_t>(GraphSection::SlotIndex)[slot];
+        return u != npos && node_id(u) == id ? u : npos;
+    }
+
+    std::string_view node_name(index_type u) const { return string(column<std::uint32_t>(GraphSection::NodeNames)[u]); }
+    MappedAttrs node_attrs(index_type u) const { return attrs(GraphSection::NodeAttrOffsets, u); }
+
+    // EDGES
+    // =====
+
+    std::size_t out_degree(index_type u) const { return out_offset(u + 1) - out_offset(u); }
+    std::size_t in_degree(index_type u) const { return in_offset(u + 1) - in_offset(u); }
+    std::size_t out_offset(index_type u) const { return column<std::uint64_t>(GraphSection::OutOffsets)[u]; }
+    std::size_t in_offset(index_type u) const { return column<std::uint64_t>(GraphSection::InOffsets)[u]; }
+
+    /**
+     * @brief Dense targets of the out-edges of u, in the AdjGraph edge order
+     */
+    CsrRange<index_type> neighbors(index_type u) const
+    {
+        const auto* t = column<std::uint32_t>(GraphSection::OutTargets);
+        return CsrRange<index_type>(t + out_offset(u), t + out_offset(u + 1));
+    }
+
+    /**
+     * @brief Dense sources of the in-edges of u, in the AdjGraph backlink order
+     */
+    CsrRange<index_type> backlinks(index_type u) const
+    {
+        const auto* s = column<std::uint32_t>(GraphSection::InSources);
+        return CsrRange<index_type>(s + in_offset(u), s + in_offset(u + 1));
+    }
+
+    index_type edge_target(std::size_t e) const { return column<std::uint32_t>(GraphSection::OutTargets)[e]; }
+    std::size_t edge_hyperlink(std::size_t e) const { return column<std::uint64_t>(GraphSection::OutHyperlinks)[e]; }
+    std::size_t backlink_hyperlink(std::size_t i) const { return column<std::uint64_t>(GraphSection::InHyperlinks)[i]; }
+    MappedAttrs edge_attrs(std::size_t e) const { return attrs(GraphSection::EdgeAttrOffsets, e); }
+
+    // WIDGETS
+    // =======
+
+    /**
+     * @brief Number of widgets in the tree of u. Widget indices are the WidgetIdx of the saved tree
+     */
+    std::size_t n_widgets(index_type u) const { return widget_offset(u + 1) - widget_offset(u); }
+    const graph_file::Widget& widget(index_type u, WidgetIdx w) const { return column<graph_file::Widget>(GraphSection::Widgets)[widget_offset(u) + w]; }
+    std::string_view widget_name(index_type u, WidgetIdx w) const { return string(widget(u, w).name); }
+    MappedAttrs widget_attrs(index_type u, WidgetIdx w) const { return attrs(GraphSection::WidgetAttrOffsets, widget_offset(u) + w); }
+
+    // LOADING
+    // =======
+
+    /**
+     * @brief Deserialize into a mutable AdjGraph using up to n_threads threads. Attributes are skipped if with_attrs is false
+     *
+     * Node ids are renumbered in the dense order (see GraphBuilder::node_ref()), use node_id() to map them to the saved ids
+     */
+    template <class TStr = std::string>
+    AdjGraph<TStr> load(bool with_attrs = true, std::size_t n_threads = 0) const;
+
+    /**
+     * @brief Write the graph. Throws std::runtime_error on I/O errors
+     */
+    template <class TStr>
+    static void save(const AdjGraph<TStr>& g, const std::string& path);
+
+    std::string_view string(std::uint32_t i) const
+    {
+        const auto* off = column<std::uint64_t>(GraphSection::StringOffsets);
+        return std::string_view(column<char>(GraphSection::StringData) + off[i], off[i + 1] - off[i]);
+    }
+
+    template <class T>
+    const T* column(GraphSection s) const { return reinterpret_cast<const T*>(_data + _sections[static_cast<std::uint32_t>(s)].offset); }
+
+protected:
+    std::size_t widget_offset(index_type u) const { return column<std::uint64_t>(GraphSection::WidgetOffsets)[u]; }
+
+    MappedAttrs attrs(GraphSection offsets, std::size_t i) const
+    {
+        const auto* off = column<std::uint64_t>(offsets);
+        const auto* a = column<graph_file::Attr>(GraphSection::Attrs);
+        return MappedAttrs(this, a + off[i], a + off[i + 1]);
+    }
+
+    void read_table()
+    {
+        std::memcpy(&_header, _data, sizeof(_header));
+        if (std::memcmp(_header.magic, graph_file::magic, sizeof(graph_file::magic)) != 0) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : not a graph file"};
+        if (_header.endian != graph_file::endian_tag) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : the file has a different byte order"};
+        if (_header.version != graph_file::version) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : unsupported version " + std::to_string(_header.version)};
+        if (_header.n_sections != graph_file::n_sections || _size < sizeof(_header) + sizeof(_sections)) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : bad section table"};
+
+        std::memcpy(_sections.data(), _data + sizeof(_header), sizeof(_sections));
+        graph_file::Header h = _header;
+        h.crc = 0;
+        if (checksum_crc32(_sections.data(), sizeof(_sections), checksum_crc32(&h, sizeof(h))) != _header.crc) [[unlikely]]
+            throw std::runtime_error{"MappedGraph : header checksum mismatch"};
+
+        // Section sizes must match the counts, so that accessors never read past the mapping
+        const std::uint64_t n = _header.n_nodes, m = _header.n_edges, w = _header.n_widgets;
+        constexpr std::uint64_t any = std::numeric_limits<std::uint64_t>::max();
+        const std::uint64_t expected[graph_file::n_sections] = {
+            n * 8, _header.n_slots * 4, n * 4, n * 8,
+            (n + 1) * 8, m * 4, m * 8,
+            (n + 1) * 8, m * 4, m * 8,
+            (n + 1) * 8, w * sizeof(graph_file::Widget),
+            (n + 1) * 8, (w + 1) * 8, (m + 1) * 8, _header.n_attrs * sizeof(graph_file::Attr),
+            any, (_header.n_strings + 1) * 8, any
+        };
+        for (std::uint32_t s = 0; s < graph_file::n_sections; s++) {
+            const auto& sec = _sections[s];
+            if (sec.id != s || sec.offset % graph_file::alignment || sec.offset > _size || sec.size > _size - sec.offset
+                || (expected[s] != any && sec.size != expected[s])) [[unlikely]]
+                throw std::runtime_error{"MappedGraph : bad section " + std::to_string(s)};
+        }
+    }
+
+    void unmap()
+    {
+        if (_data)
+            ::munmap(const_cast<char*>(_data), _size);
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const char* _data;
+    std::size_t _size;
+    graph_file::Header _header{};
+    std::array<graph_file::Section, graph_file::n_sections> _sections{};
+};
+
+
+inline std::string_view MappedAttr::key() const { return _g->string(_a->key); }
+
+inline std::string_view MappedAttr::str() const
+{
+    if (!is_str()) [[unlikely]]
+        throw std::bad_variant_access{};
+    return _g->string(static_cast<std::uint32_t>(_a->payload));
+}
+
+inline const std::uint64_t* MappedAttr::words() const { return _g->column<std::uint64_t>(GraphSection::Payload) + _a->payload; }
+
+inline std::int64_t MappedAttr::at_i64(std::size_t i) const
+{
+    if (!is_vec_i64()) [[unlikely]]
+        throw std::bad_variant_access{};
+    if (i >= _a->count) [[unlikely]]
+        throw std::out_of_range{"MappedAttr::at_i64"};
+    std::int64_t v;
+    std::memcpy(&v, words() + i, sizeof(v));
+    return v;
+}
+
+inline double MappedAttr::at_f64(std::size_t i) const
+{
+    if (!is_vec_f64()) [[unlikely]]
+        throw std::bad_variant_access{};
+    if (i >= _a->count) [[unlikely]]
+        throw std::out_of_range{"MappedAttr::at_f64"};
+    double v;
+    std::memcpy(&v, words() + i, sizeof(v));
+    return v;
+}
+
+template <class TStr>
+AttrValue<TStr> MappedAttr::to_value() const
+{
+    const std::size_t n = _a->count;
+    switch (kind()) {
+        case AttrKind::ArrayI64: {
+            AttrValue<TStr> v(std::initializer_list<std::int64_t>{});
+            for (std::size_t i = 0; i < n; i++)
+                v.push_i64(at_i64(i));
+            return v;
+        }
+        case AttrKind::ArrayF64: {
+            AttrValue<TStr> v(std::initializer_list<double>{});
+            for (std::size_t i = 0; i < n; i++)
+                v.push_f64(at_f64(i));
+            return v;
+        }
+        case AttrKind::Str: {
+            std::string_view s = str();
+            return AttrValue<TStr>(TStr(s.data(), s.size()));
+        }
+        case AttrKind::VecI64: {
+            std::vector<std::int64_t> vec(n);
+            std::memcpy(vec.data(), words(), n * sizeof(std::int64_t));
+            return AttrValue<TStr>(std::move(vec));
+        }
+        case AttrKind::VecF64: {
+            std::vector<double> vec(n);
+            std::memcpy(vec.data(), words(), n * sizeof(double));
+            return AttrValue<TStr>(std::move(vec));
+        }
+    }
+    throw std::bad_variant_access{};
+}
+
+
+template <class TStr>
+AdjGraph<TStr> MappedGraph::load(bool with_attrs, std::size_t n_threads) const
+{
+    using NodeData = typename AdjGraph<TStr>::NodeData;
+    using Backlink = typename AdjGraph<TStr>::Backlink;
+    const std::size_t n = n_nodes();
+    auto to_str = [](std::string_view s) { return TStr(s.data(), s.size()); };
+
+    // Intern every attribute key once
+    std::vector<AttrKey> keys;
+    if (with_attrs) {
+        keys.resize(_header.n_strings);
+        const auto* a = column<graph_file::Attr>(GraphSection::Attrs);
+        for (std::size_t i = 0; i < _header.n_attrs; i++)
+            if (!keys[a[i].key].valid())
+                keys[a[i].key] = AttrSet<TStr>::key(to_str(string(a[i].key)));
+    }
+    auto copy_attrs = [&](MappedAttrs src, AttrSet<TStr>& dst) {
+        if (!with_attrs)
+            return;
+        for (std::size_t i = 0; i < src.size(); i++)
+            dst.set(keys[src._key_index(i)], src[i].to_value<TStr>());
+    };
+
+    // Nodes with widget trees and edges. Widgets are appended in index order, which reproduces the saved indices
+    std::vector<NodeData> nodes(n);
+    const auto* hl_cnt = column<std::uint64_t>(GraphSection::NodeHyperlinkCnt);
+    parallel_for(n, [&](std::size_t u) {
+        index_type ui = static_cast<index_type>(u);
+        NodeData& nd = nodes[u];
+        nd.node = Node<TStr>(to_str(node_name(ui)));
+        nd.node._set_internal_id(GraphBuilder<TStr>::node_ref(u)._internal_id());
+        copy_attrs(node_attrs(ui), nd.node);
+
+        WidgetTree<TStr> tree;
+        tree.reserve(n_widgets(ui));
+        for (WidgetIdx w = 0; w < n_widgets(ui); w++) {
+            const graph_file::Widget& fw = widget(ui, w);
+            WidgetIdx i = w == 0 ? tree.add_root(to_str(string(fw.name))) : tree.add_child(fw.parent, to_str(string(fw.name)));
+            tree._set_hyperlink_id(i, fw.hyperlink);
+            copy_attrs(widget_attrs(ui, w), tree.attrs(i));
+        }
+        nd.node.widget_tree() = std::move(tree); // may be empty
+        nd.node._set_widget_hyperlinks_cnt(hl_cnt[u]);
+
+        nd.edges.reserve(out_degree(ui));
+        nd.edge_backs.resize(out_degree(ui));
+        // Edges built with a raw Hyperlink may carry ids at or above the node counter
+        std::size_t n_slots = hl_cnt[u];
+        for (std::size_t e = out_offset(ui); e < out_offset(ui + 1); e++)
+            n_slots = std::max(n_slots, edge_hyperlink(e) + 1);
+        nd.edge_slots.assign(n_slots, AdjGraph<TStr>::npos);
+        for (std::size_t e = out_offset(ui), r = 0; e < out_offset(ui + 1); e++, r++) {
+            Hyperlink<TStr> h(nd.node._internal_id(), GraphBuilder<TStr>::node_ref(edge_target(e))._internal_id(), edge_hyperlink(e));
+            copy_attrs(edge_attrs(e), h);
+            nd.edge_slots[edge_hyperlink(e)] = r;
+            nd.edges.push_back(std::move(h));
+        }
+    }, n_threads, 256);
+
+    // Backlinks, each edge_backs element is written by exactly one target
+    const auto* sources = column<std::uint32_t>(GraphSection::InSources);
+    parallel_for(n, [&](std::size_t v) {
+        NodeData& nd = nodes[v];
+        nd.backlinks.reserve(in_degree(static_cast<index_type>(v)));
+        for (std::size_t i = in_offset(static_cast<index_type>(v)), r = 0; i < in_offset(static_cast<index_type>(v + 1)); i++, r++) {
+            NodeData& src = nodes[sources[i]];
+            nd.backlinks.push_back(Backlink{src.node._internal_id(), backlink_hyperlink(i)});
+            src.edge_backs[src.edge_slots[backlink_hyperlink(i)]] = r;
+        }
+    }, n_threads, 256);
+
+    AdjGraph<TStr> g;
+    g.data.reserve(n);
+    for (auto& nd : nodes)
+        g.data.insert(std::move(nd));
+    return g;
+}
+
+
+/**
+ * @brief Sequential section writer with alignment and running checksums
+ */
+class GraphFileWriter {
+public:
+    explicit GraphFileWriter(const std::string& path) : _out(path, std::ios::binary | std::ios::trunc), _pos(0), _path(path)
+    {
+        if (!_out) [[unlikely]]
+            throw std::runtime_error{"GraphFileWriter : cannot open " + path};
+        // Placeholder for the header and the section table
+        pad_to(sizeof(graph_file::Header) + sizeof(_sections));
+    }
+
+    void begin(GraphSection s)
+    {
+        pad_to((_pos + graph_file::alignment - 1) / graph_file::alignment * graph_file::alignment);
+        _cur = static_cast<std::uint32_t>(s);
+        _sections[_cur] = graph_file::Section{_cur, 0, _pos, 0};
+    }
+
+    void write(const void* data, std::size_t n)
+    {
+        _out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        _sections[_cur].crc = checksum_crc32(data, n, _sections[_cur].crc);
+        _sections[_cur].size += n;
+        _pos += n;
+    }
+
+    template <class T>
+    void put(const T& v) { write(&v, sizeof(v)); }
+
+    template <class T>
+    void put(const std::vector<T>& v) { write(v.data(), v.size() * sizeof(T)); }
+
+    void finish(graph_file::Header header)
+    {
+        header.n_sections = graph_file::n_sections;
+        header.crc = 0;
+        header.crc = checksum_crc32(_sections.data(), sizeof(_sections), checksum_crc32(&header, sizeof(header)));
+        _out.seekp(0);
+        _out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _out.write(reinterpret_cast<const char*>(_sections.data()), sizeof(_sections));
+        _out.flush();
+        if (!_out) [[unlikely]]
+            throw std::runtime_error{"GraphFileWriter : write failed : " + _path};
+    }
+
+protected:
+    void pad_to(std::size_t pos)
+    {
+        static const char zeros[graph_file::alignment] = {};
+        while (_pos < pos) {
+            std::size_t k = std::min(pos - _pos, sizeof(zeros));
+            _out.write(zeros, static_cast<std::streamsize>(k));
+            _pos += k;
+        }
+    }
+
+    std::ofstream _out;
+    std::size_t _pos;
+    std::string _path;
+    std::uint32_t _cur = 0;
+    std::array<graph_file::Section, graph_file::n_sections> _sections{};
+};
+
+
+template <class TStr>
+void MappedGraph::save(const AdjGraph<TStr>& g, const std::string& path)
+{
+    const std::uint32_t tag = graph_file::endian_tag;
+    if (reinterpret_cast<const unsigned char*>(&tag)[0] != 0x04) [[unlikely]]
+        throw std::runtime_error{"MappedGraph::save : big-endian hosts are not supported"};
+
+    using NodeData = typename AdjGraph<TStr>::NodeData;
+    std::vector<const NodeData*> nodes;
+    nodes.reserve(g.size());
+    g.each([&](const NodeData& nd) { nodes.push_back(&nd); });
+    const std::size_t n = nodes.size();
+    if (n >= npos) [[unlikely]]
+        throw std::length_error{"MappedGraph::save : too many nodes"};
+
+    std::vector<std::uint32_t> slot_index(g.slot_count(), npos);
+    for (std::size_t u = 0; u < n; u++)
+        slot_index[SlotMap<int>::slot_of(nodes[u]->node._internal_id())] = static_cast<std::uint32_t>(u);
+    auto dense = [&](std::size_t id) { return slot_index[SlotMap<int>::slot_of(id)]; };
+
+    // Strings are deduplicated into one pool
+    std::vector<std::uint64_t> str_offsets{0};
+    std::string str_data;
+    std::unordered_map<std::string, std::uint32_t> str_index;
+    auto intern = [&](const TStr& s) {
+        auto [it, inserted] = str_index.emplace(std::string(s.data(), s.size()), static_cast<std::uint32_t>(str_offsets.size() - 1));
+        if (inserted) {
+            str_data.append(s.data(), s.size());
+            str_offsets.push_back(str_data.size());
+        }
+        return it->second;
+    };
+
+    // Attributes of all owners, in the order nodes, widgets, edges
+    std::vector<graph_file::Attr> attrs;
+    std::vector<std::uint64_t> payload;
+    auto add_attrs = [&](const AttrSet<TStr>& set, std::vector<std::uint64_t>& offsets) {
+        set.each_key([&](AttrKey k, const AttrValue<TStr>& v) {
+            graph_file::Attr a{};
+            a.key = intern(AttrSet<TStr>::key_name(k));
+            a.kind = static_cast<std::uint8_t>(v.kind());
+            if (v.is_str()) {
+                a.count = 1;
+                a.payload = intern(v.str());
+            } else {
+                a.count = v.size();
+                a.payload = payload.size();
+                for (std::size_t i = 0; i < v.size(); i++) {
+                    std::uint64_t w;
+                    if (v.is_vec_i64())
+                        std::memcpy(&w, &v.at_i64(i), sizeof(w));
+                    else
+                        std::memcpy(&w, &v.at_f64(i), sizeof(w));
+                    payload.push_back(w);
+                }
+            }
+            attrs.push_back(a);
+        });
+        offsets.push_back(attrs.size());
+    };
+
+    GraphFileWriter out(path);
+    graph_file::Header header{};
+    std::memcpy(header.magic, graph_file::magic, sizeof(header.magic));
+    header.version = graph_file::version;
+    header.endian = graph_file::endian_tag;
+    header.n_nodes = n;
+    header.n_slots = slot_index.size();
+
+    out.begin(GraphSection::NodeIds);
+    for (const auto* nd : nodes)
+        out.put<std::uint64_t>(nd->node._internal_id());
+    out.begin(GraphSection::SlotIndex);
+    out.put(slot_index);
+    out.begin(GraphSection::NodeNames);
+    for (const auto* nd : nodes)
+        out.put<std::uint32_t>(intern(nd->node.name()));
+    out.begin(GraphSection::NodeHyperlinkCnt);
+    for (const auto* nd : nodes)
+        out.put<std::uint64_t>(nd->node._widget_hyperlinks_cnt());
+
+    std::uint64_t m = 0;
+    out.begin(GraphSection::OutOffsets);
+    out.put(m);
+    for (const auto* nd : nodes)
+        out.put<std::uint64_t>(m += nd->edges.size());
+    header.n_edges = m;
+    out.begin(GraphSection::OutTargets);
+    for (const auto* nd : nodes)
+        for (const auto& h : nd->edges)
+            out.put<std::uint32_t>(dense(h._id_to()));
+    out.begin(GraphSection::OutHyperlinks);
+    for (const auto* nd : nodes)
+        for (const auto& h : nd->edges)
+            out.put<std::uint64_t>(h._widget_id());
+
+    std::uint64_t k = 0;
+    out.begin(GraphSection::InOffsets);
+    out.put(k);
+    for (const auto* nd : nodes)
+        out.put<std::uint64_t>(k += nd->backlinks.size());
+    out.begin(GraphSection::InSources);
+    for (const auto* nd : nodes)
+        for (const auto& b : nd->backlinks)
+            out.put<std::uint32_t>(dense(b.source));
+    out.begin(GraphSection::InHyperlinks);
+    for (const auto* nd : nodes)
+        for (const auto& b : nd->backlinks)
+            out.put<std::uint64_t>(b.hyperlink);
+
+    std::uint64_t w = 0;
+    out.begin(GraphSection::WidgetOffsets);
+    out.put(w);
+    for (const auto* nd : nodes)
+        out.put<std::uint64_t>(w += nd->node.widget_tree().size());
+    header.n_widgets = w;
+    out.begin(GraphSection::Widgets);
+    for (const auto* nd : nodes) {
+        const WidgetTree<TStr>& tree = nd->node.widget_tree();
+        for (WidgetIdx i = 0; i < tree.size(); i++) {
+            const auto& l = tree.links(i);
+            std::uint64_t hl = tree.hyperlink_id(i);
+            out.put(graph_file::Widget{l.parent, l.first_child, l.last_child, l.next_sibling, l.subtree_end, l.n_children, intern(tree.name(i)), 0, hl});
+        }
+    }
+
+    std::vector<std::uint64_t> node_attr_offsets{0}, widget_attr_offsets{0}, edge_attr_offsets{0};
+    node_attr_offsets.reserve(n + 1);
+    widget_attr_offsets.reserve(w + 1);
+    edge_attr_offsets.reserve(m + 1);
+    for (const auto* nd : nodes)
+        add_attrs(nd->node, node_attr_offsets);
+    for (const auto* nd : nodes)
+        for (const auto& set : nd->node.widget_tree().attrs_column())
+            add_attrs(set, widget_attr_offsets);
+    for (const auto* nd : nodes)
+        for (const auto& h : nd->edges)
+            add_attrs(h, edge_attr_offsets);
+    header.n_attrs = attrs.size();
+
+    out.begin(GraphSection::NodeAttrOffsets);
+    out.put(node_attr_offsets);
+    out.begin(GraphSection::WidgetAttrOffsets);
+    out.put(widget_attr_offsets);
+    out.begin(GraphSection::EdgeAttrOffsets);
+    out.put(edge_attr_offsets);
+    out.begin(GraphSection::Attrs);
+    out.put(attrs);
+    out.begin(GraphSection::Payload);
+    out.put(payload);
+
+    header.n_strings = str_offsets.size() - 1;
+    out.begin(GraphSection::StringOffsets);
+    out.put(str_offsets);
+    out.begin(GraphSection::StringData);
+    out.write(str_data.data(), str_data.size());
+    out.finish(header);
+}
+
+}
+
+#endif // JSC_GRAPH_IO_H
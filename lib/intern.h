@@ -0,0 +1,118 @@
+#ifndef JSC_INTERN_H
+#define JSC_INTERN_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace jsc {
+
+/**
+ * @brief Interned attribute key (atom). Hashing and comparing keys never touches the underlying string
+ */
+class AttrKey {
+public:
+    AttrKey() : _id(std::numeric_limits<std::uint32_t>::max()) {}
+    explicit AttrKey(std::uint32_t id) : _id(id) {}
+
+    bool valid() const { return _id != std::numeric_limits<std::uint32_t>::max(); }
+    std::uint32_t _internal_id() const { return _id; }
+
+    bool operator==(const AttrKey& other) const { return _id == other._id; }
+    bool operator!=(const AttrKey& other) const { return _id != other._id; }
+    bool operator<(const AttrKey& other) const { return _id < other._id; }
+
+protected:
+    std::uint32_t _id;
+};
+
+
+/**
+ * @brief Thread-safe string -> AttrKey interner. Keys are never removed, so atoms and names stay valid for the lifetime of the process
+ */
+template <class TStr = std::string>
+class KeyInterner {
+public:
+    /**
+     * @brief The interner shared by all AttrSet objects with the same string type
+     */
+    static KeyInterner& global()
+    {
+        static KeyInterner inst;
+        return inst;
+    }
+
+    /**
+     * @brief Get the atom of a key, inserting the key if it is new
+     */
+    AttrKey intern(const TStr& k)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(_mtx);
+            auto it = _ids.find(k);
+            if (it != _ids.end())
+                return AttrKey(it->second);
+        }
+        std::unique_lock<std::shared_mutex> lock(_mtx);
+        auto it = _ids.find(k); // may have been inserted by another thread
+        if (it != _ids.end())
+            return AttrKey(it->second);
+
+        std::uint32_t id = static_cast<std::uint32_t>(_names.size());
+        _names.push_back(k);
+        _ids.emplace(k, id);
+        return AttrKey(id);
+    }
+
+    /**
+     * @brief Get the atom of a key without inserting it. Returns an invalid key if the key was never interned
+     */
+    AttrKey find(const TStr& k) const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mtx);
+        auto it = _ids.find(k);
+        return it != _ids.end() ? AttrKey(it->second) : AttrKey();
+    }
+
+    /**
+     * @brief Get the string of an atom. The reference is never invalidated
+     */
+    const TStr& name(AttrKey k) const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mtx);
+        return _names.at(k._internal_id());
+    }
+
+    std::size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mtx);
+        return _names.size();
+    }
+
+protected:
+    KeyInterner() = default;
+
+    mutable std::shared_mutex _mtx;
+    std::unordered_map<TStr, std::uint32_t> _ids;
+    std::deque<TStr> _names; // deque does not relocate elements on push_back
+};
+
+}
+
+
+namespace std {
+
+template<>
+struct hash<jsc::AttrKey> {
+    std::size_t operator()(const jsc::AttrKey& k) const noexcept { return k._internal_id(); }
+};
+
+}
+
+#endif // JSC_INTERN_H
@@ -0,0 +1,516 @@
+#ifndef JSC_JSON_READER_H
+#define JSC_JSON_READER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace jsc {
+
+/**
+ * @brief Byte source over a memory buffer, for JsonReader
+ */
+class MemorySource {
+public:
+    explicit MemorySource(std::string_view data) : _data(data), _pos(0) {}
+
+    std::size_t read(char* buf, std::size_t n)
+    {
+        n = std::min(n, _data.size() - _pos);
+        std::memcpy(buf, _data.data() + _pos, n);
+        _pos += n;
+        return n;
+    }
+
+protected:
+    std::string_view _data;
+    std::size_t _pos;
+};
+
+
+/**
+ * @brief Parse a decimal integer of at most 18 digits with an optional '-'. Returns false for anything else
+ */
+inline bool parse_json_int(std::string_view s, std::int64_t& out)
+{
+    const bool neg = !s.empty() && s[0] == '-';
+    const std::size_t n = s.size() - neg;
+    if (n == 0 || n > 18)
+        return false;
+    std::int64_t v = 0;
+    for (std::size_t i = neg; i < s.size(); i++) {
+        const unsigned d = static_cast<unsigned>(s[i] - '0');
+        if (d > 9)
+            return false;
+        v = v * 10 + d;
+    }
+    out = neg ? -v : v;
+    return true;
+}
+
+
+/**
+ * @brief Streaming pull (on-demand) JSON parser
+ *
+ * The document is consumed front to back from TSource (std::size_t read(char*, std::size_t), 0 at the end) through a fixed buffer, so memory does not
+ * depend on the document size. The caller walks the structure it expects and calls skip() for values it does not need, which are validated but never
+ * materialized. Syntax errors throw std::runtime_error with the byte offset.
+ *
+ *     reader.begin_object();
+ *     while (reader.next_key(key)) {
+ *         if (key == "name") reader.read_string(name);
+ *         else reader.skip();
+ *     }
+ */
+template <class TSource>
+class JsonReader {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object, End };
+
+    explicit JsonReader(TSource& src, std::size_t buffer_size = 1 << 18) : _src(src), _buf(buffer_size), _cur(nullptr), _end(nullptr), _offset(0), _first(true) {}
+
+    /**
+     * @brief Type of the next value, without consuming it
+     */
+    Type peek_type()
+    {
+        switch (peek_token()) {
+            case 'n': return Type::Null;
+            case 't': case 'f': return Type::Bool;
+            case '"': return Type::String;
+            case '[': return Type::Array;
+            case '{': return Type::Object;
+            case -1: return Type::End;
+            default: return Type::Number;
+        }
+    }
+
+    // OBJECTS AND ARRAYS
+    // ==================
+
+    void begin_object() { expect('{'); _first = true; }
+    void begin_array() { expect('['); _first = true; }
+
+    /**
+     * @brief Read the next key of the current object into key. Returns false (and consumes '}') at the end of the object
+     */
+    bool next_key(std::string& key)
+    {
+        if (!next_member('}'))
+            return false;
+        read_string(key);
+        expect(':');
+        return true;
+    }
+
+    /**
+     * @brief Same as next_key(std::string&), but the key is a view which is valid until the next call on the reader. Keys are only copied if they have
+     * escapes or cross a refill of the buffer
+     */
+    bool next_key(std::string_view& key)
+    {
+        if (!next_member('}'))
+            return false;
+        key = read_string_view();
+        // The ':' may need a refill, which would overwrite a key in the buffer
+        const char* p = _cur;
+        while (p < _end && is_space(*p))
+            p++;
+        if (p == _end && key.data() != _scratch.data()) {
+            _scratch.assign(key.data(), key.size());
+            key = _scratch;
+        }
+        expect(':');
+        return true;
+    }
+
+    /**
+     * @brief Advance to the next element of the current array. Returns false (and consumes ']') at the end of the array
+     */
+    bool next_element() { return next_member(']'); }
+
+    // VALUES
+    // ======
+
+    void read_string(std::string& out)
+    {
+        expect('"');
+        out.clear();
+        read_string_rest(out);
+    }
+
+    /**
+     * @brief Read a string as a view which is valid until the next call on the reader. Only strings with escapes or across a refill are copied
+     */
+    std::string_view read_string_view()
+    {
+        expect('"');
+        const char* p = find_quote(_cur, _end);
+        if (p < _end && *p == '"') {
+            std::string_view s(_cur, static_cast<std::size_t>(p - _cur));
+            _cur = p + 1;
+            return s;
+        }
+        _scratch.clear();
+        read_string_rest(_scratch);
+        return _scratch;
+    }
+
+    std::string read_string()
+    {
+        std::string s;
+        read_string(s);
+        return s;
+    }
+
+    double read_double()
+    {
+        read_number_token();
+        double v;
+        if (parse_simple_double(_numv, v))
+            return v;
+        if (_numv.data() != _num.data())
+            _num.assign(_numv.data(), _numv.size());
+        char* end = nullptr;
+        v = std::strtod(_num.c_str(), &end);
+        if (end != _num.c_str() + _num.size()) [[unlikely]]
+            error("bad number");
+        return v;
+    }
+
+    std::int64_t read_int()
+    {
+        read_number_token();
+        std::int64_t v;
+        if (parse_json_int(_numv, v))
+            return v;
+        if (_numv.data() != _num.data())
+            _num.assign(_numv.data(), _numv.size());
+        return static_cast<std::int64_t>(std::strtod(_num.c_str(), nullptr));
+    }
+
+
+    bool read_bool()
+    {
+        int c = peek_token();
+        if (c == 't') { literal("true"); return true; }
+        if (c == 'f') { literal("false"); return false; }
+        error("expected a boolean");
+    }
+
+    /**
+     * @brief Consume null and return true if the next value is null
+     */
+    bool read_null()
+    {
+        if (peek_token() != 'n')
+            return false;
+        literal("null");
+        return true;
+    }
+
+    /**
+     * @brief Skip the next value with all of its children
+     */
+    void skip()
+    {
+        switch (peek_type()) {
+            case Type::Null: literal("null"); return;
+            case Type::Bool: read_bool(); return;
+            case Type::Number: read_number_token(); return;
+            case Type::String: skip_string(); return;
+            case Type::Array:
+                begin_array();
+                while (next_element())
+                    skip();
+                return;
+            case Type::Object:
+                begin_object();
+                while (next_member('}')) {
+                    skip_string();
+                    expect(':');
+                    skip();
+                }
+                return;
+            case Type::End: error("unexpected end of input");
+        }
+    }
+
+    /**
+     * @brief Number of bytes consumed so far
+     */
+    std::size_t offset() const { return _offset - static_cast<std::size_t>(_end - _cur); }
+
+protected:
+    static bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    static bool is_number_char(char c) { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; }
+
+    /**
+     * @brief First '"' or '\\' in [p, end), or end
+     */
+    static const char* find_quote(const char* p, const char* end)
+    {
+        // 8 bytes at a time : a byte of w is '"' or '\\' iff the same byte of w ^ 0x22.. or w ^ 0x5c.. is zero
+        constexpr std::uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+        for (; end - p >= 8; p += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, 8);
+            const std::uint64_t q = w ^ (ones * '"'), b = w ^ (ones * '\\');
+            if (((q - ones) & ~q & highs) | ((b - ones) & ~b & highs))
+                break;
+        }
+        while (p < end && *p != '"' && *p != '\\')
+            p++;
+        return p;
+    }
+
+    /**
+     * @brief Exact conversion of decimals whose digits fit in 53 bits with a power of ten up to 1e22 (Clinger's fast path), false otherwise
+     */
+    static bool parse_simple_double(std::string_view s, double& out)
+    {
+        static constexpr double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        std::size_t i = 0;
+        const bool neg = !s.empty() && s[0] == '-';
+        i += neg;
+        std::uint64_t m = 0;
+        int n_digits = 0, exp10 = 0;
+        bool digits = false;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits = true) {
+            m = m * 10 + static_cast<unsigned>(s[i] - '0');
+            n_digits += m != 0;
+        }
+        if (i < s.size() && s[i] == '.') {
+            for (i++; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++, digits = true) {
+                m = m * 10 + static_cast<unsigned>(s[i] - '0');
+                n_digits += m != 0;
+                exp10--;
+            }
+        }
+        if (!digits || i != s.size() || n_digits > 15 || exp10 < -22) // exponents and long mantissas go through strtod
+            return false;
+        const double v = exp10 < 0 ? static_cast<double>(m) / pow10[-exp10] : static_cast<double>(m);
+        out = neg ? -v : v;
+        return true;
+    }
+
+    bool refill()
+    {
+        std::size_t n = _src.read(_buf.data(), _buf.size());
+        _cur = _buf.data();
+        _end = _cur + n;
+        _offset += n;
+        return n != 0;
+    }
+
+    int peek_char()
+    {
+        if (_cur == _end && !refill())
+            return -1;
+        return static_cast<unsigned char>(*_cur);
+    }
+
+    int get_char()
+    {
+        int c = peek_char();
+        if (c >= 0)
+            _cur++;
+        return c;
+    }
+
+    int peek_token()
+    {
+        for (;;) {
+            int c = peek_char();
+            if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+                return c;
+            _cur++;
+        }
+    }
+
+    void expect(char c)
+    {
+        if (peek_token() != c) [[unlikely]]
+            error(std::string("expected '") + c + "'");
+        _cur++;
+    }
+
+    bool next_member(char close)
+    {
+        int c = peek_token();
+        if (c == close) {
+            _cur++;
+            _first = false;
+            return false;
+        }
+        if (!_first)
+            expect(',');
+        _first = false;
+        return true;
+    }
+
+    void literal(const char* s)
+    {
+        peek_token();
+        const std::size_t n = std::strlen(s);
+        if (static_cast<std::size_t>(_end - _cur) >= n && std::memcmp(_cur, s, n) == 0) {
+            _cur += n;
+            return;
+        }
+        for (; *s; s++)
+            if (get_char() != *s) [[unlikely]]
+                error("bad literal");
+    }
+
+    /**
+     * @brief Read the characters of a number into _numv, which points into the buffer unless the number crosses a refill
+     */
+    void read_number_token()
+    {
+        peek_token();
+        const char* p = _cur;
+        while (p < _end && is_number_char(*p))
+            p++;
+        if (p < _end) {
+            _numv = std::string_view(_cur, static_cast<std::size_t>(p - _cur));
+            _cur = p;
+        } else {
+            _num.assign(_cur, p);
+            _cur = p;
+            for (int c = peek_char(); c >= 0 && is_number_char(static_cast<char>(c)); c = peek_char())
+                _num.push_back(static_cast<char>(get_char()));
+            _numv = _num;
+        }
+        if (_numv.empty()) [[unlikely]]
+            error("expected a value");
+    }
+
+    /**
+     * @brief Append the rest of a string whose opening quote was consumed to out
+     */
+    void read_string_rest(std::string& out)
+    {
+        for (;;) {
+            // Copy unescaped runs in bulk
+            const char* p = find_quote(_cur, _end);
+            out.append(_cur, p);
+            _cur = p;
+            if (_cur == _end) {
+                if (!refill())
+                    error("unterminated string");
+                continue;
+            }
+            char c = *_cur++;
+            if (c == '"')
+                return;
+            read_escape(out);
+        }
+    }
+
+    void skip_string()
+    {
+        expect('"');
+        for (;;) {
+            _cur = find_quote(_cur, _end);
+            if (_cur == _end) {
+                if (!refill())
+                    error("unterminated string");
+                continue;
+            }
+            if (*_cur++ == '"')
+                return;
+            if (get_char() < 0) [[unlikely]]
+                error("unterminated string");
+            // \uXXXX digits are plain characters
+        }
+    }
+
+    unsigned read_hex4()
+    {
+        unsigned v = 0;
+        for (int i = 0; i < 4; i++) {
+            int c = get_char();
+            v <<= 4;
+            if (c >= '0' && c <= '9') v |= c - '0';
+            else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+            else error("bad unicode escape");
+        }
+        return v;
+    }
+
+    void read_escape(std::string& out)
+    {
+        int c = get_char();
+        switch (c) {
+            case '"': out.push_back('"'); return;
+            case '\\': out.push_back('\\'); return;
+            case '/': out.push_back('/'); return;
+            case 'b': out.push_back('\b'); return;
+            case 'f': out.push_back('\f'); return;
+            case 'n': out.push_back('\n'); return;
+            case 'r': out.push_back('\r'); return;
+            case 't': out.push_back('\t'); return;
+            case 'u': break;
+            default: error("bad escape");
+        }
+
+        unsigned cp = read_hex4();
+        if (cp >= 0xd800 && cp < 0xdc00) {
+            // Surrogate pair, an unpaired surrogate becomes U+FFFD
+            if (peek_char() == '\\') {
+                _cur++;
+                if (get_char() != 'u') [[unlikely]]
+                    error("bad surrogate pair");
+                unsigned lo = read_hex4();
+                cp = lo >= 0xdc00 && lo < 0xe000 ? 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00) : 0xfffd;
+            } else {
+                cp = 0xfffd;
+            }
+        } else if (cp >= 0xdc00 && cp < 0xe000) {
+            cp = 0xfffd;
+        }
+
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        } else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        } else {
+            out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    [[noreturn]] void error(const std::string& msg) const
+    {
+        throw std::runtime_error{"JsonReader : " + msg + " at byte " + std::to_string(offset())};
+    }
+
+    TSource& _src;
+    std::vector<char> _buf;
+    const char* _cur;
+    const char* _end;
+    std::size_t _offset; // bytes read from the source
+    bool _first;         // no member of the current container was read yet
+    std::string _num;      // number token crossing a refill, or null-terminated copy for strtod
+    std::string_view _numv; // last number token
+    std::string _scratch;  // string or key returned as a view when it could not point into the buffer
+};
+
+}
+
+#endif // JSC_JSON_READER_H
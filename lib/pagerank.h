@@ -0,0 +1,294 @@
+#ifndef JSC_PAGERANK_H
+#define JSC_PAGERANK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "csr.h"
+#include "graph.h"
+#include "parallel.h"
+#include "traversal.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Options of personalized_pagerank()
+ */
+struct PageRankOptions {
+    double damping = 0.85;                // probability to follow an edge, the walk restarts at a seed otherwise
+    Direction direction = Direction::Out; // edges followed by the walk
+    double tol = 1e-9;                    // stop when the L1 change of an iteration is below tol
+    std::size_t max_iter = 100;
+    std::size_t n_threads = 0;            // 0 = all cores
+};
+
+/**
+ * @brief Result of personalized_pagerank(), scores are indexed by the CsrGraph node index and sum to 1
+ */
+struct PageRankResult {
+    std::vector<double> scores;
+    std::size_t n_iter = 0;
+    double delta = 0; // L1 change of the last iteration
+};
+
+/**
+ * @brief Keep the k highest (index, score) pairs, in decreasing order of score, ties by index
+ */
+inline std::vector<std::pair<std::uint32_t, double>> top_k_pairs(std::vector<std::pair<std::uint32_t, double>> items, std::size_t k)
+{
+    auto cmp = [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); };
+    if (items.size() > k) {
+        std::nth_element(items.begin(), items.begin() + k, items.end(), cmp);
+        items.resize(k);
+    }
+    std::sort(items.begin(), items.end(), cmp);
+    return items;
+}
+
+/**
+ * @brief The k highest scores as (index, score), in decreasing order, ties by index. Zero scores are omitted
+ */
+inline std::vector<std::pair<std::uint32_t, double>> top_k_scores(const std::vector<double>& scores, std::size_t k)
+{
+    std::vector<std::pair<std::uint32_t, double>> items;
+    for (std::size_t u = 0; u < scores.size(); u++)
+        if (scores[u] > 0)
+            items.emplace_back(static_cast<std::uint32_t>(u), scores[u]);
+    return top_k_pairs(std::move(items), k);
+}
+
+/**
+ * @brief Personalized PageRank (random walk with restart to the seeds) by power iteration over a CsrGraph snapshot
+ *
+ * The walk follows a random edge with probability damping and jumps back to a random seed otherwise, including from nodes without edges. A seed listed
+ * twice gets twice the restart probability, no seeds gives the global PageRank. Each iteration scales the scores by the inverse degrees in one pass, then
+ * every node sums the scaled scores of its predecessors (pull, so there are no write conflicts), both passes split over n_threads threads
+ */
+template <class TStr>
+PageRankResult personalized_pagerank(const CsrGraph<TStr>& g, const std::vector<typename CsrGraph<TStr>::index_type>& seeds, const PageRankOptions& opts = {})
+{
+    using index_type = typename CsrGraph<TStr>::index_type;
+    const std::size_t n = g.n_nodes();
+    const bool follow_out = static_cast<std::uint8_t>(opts.direction) & static_cast<std::uint8_t>(Direction::Out);
+    const bool follow_in = static_cast<std::uint8_t>(opts.direction) & static_cast<std::uint8_t>(Direction::In);
+    const std::size_t n_threads = opts.n_threads ? opts.n_threads : default_threads();
+    const double d = opts.damping;
+
+    PageRankResult res;
+    if (n == 0)
+        return res;
+
+    std::vector<double> restart(n, seeds.empty() ? 1.0 / static_cast<double>(n) : 0.0);
+    for (index_type s : seeds) {
+        if (s >= n) [[unlikely]]
+            throw std::out_of_range{"personalized_pagerank : the seed is not in the graph"};
+        restart[s] += 1.0 / static_cast<double>(seeds.size());
+    }
+
+    std::vector<double> inv_degree(n), contrib(n), next(n);
+    parallel_for(n, [&](std::size_t u) {
+        std::size_t deg = (follow_out ? g.out_degree(static_cast<index_type>(u)) : 0) + (follow_in ? g.in_degree(static_cast<index_type>(u)) : 0);
+        inv_degree[u] = deg ? 1.0 / static_cast<double>(deg) : 0.0;
+    }, n_threads);
+    res.scores = restart;
+
+    std::vector<double> partial(n_threads);
+    auto reduce = [&]() {
+        double sum = 0;
+        for (double& p : partial) {
+            sum += p;
+            p = 0;
+        }
+        return sum;
+    };
+
+    for (res.n_iter = 0; res.n_iter < opts.max_iter;) {
+        // Scaled scores, and the mass of the nodes without edges which restarts
+        parallel_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t t) {
+            const double* x = res.scores.data();
+            const double* inv = inv_degree.data();
+            double* c = contrib.data();
+            double lost = 0;
+            for (std::size_t u = begin; u < end; u++) {
+                c[u] = x[u] * inv[u];
+                lost += inv[u] == 0.0 ? x[u] : 0.0;
+            }
+            partial[t] = lost;
+        }, n_threads);
+        const double jump = d * reduce() + (1.0 - d);
+
+        parallel_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t t) {
+            double delta = 0;
+            for (std::size_t v = begin; v < end; v++) {
+                double sum = 0;
+                if (follow_out)
+                    for (index_type u : g.backlinks(static_cast<index_type>(v)))
+                        sum += contrib[u];
+                if (follow_in)
+                    for (index_type u : g.neighbors(static_cast<index_type>(v)))
+                        sum += contrib[u];
+                next[v] = d * sum + jump * restart[v];
+                delta += std::abs(next[v] - res.scores[v]);
+            }
+            partial[t] = delta;
+        }, n_threads);
+        res.scores.swap(next);
+        res.n_iter++;
+        res.delta = reduce();
+        if (res.delta < opts.tol)
+            break;
+    }
+    return res;
+}
+
+/**
+ * @brief Top-k personalized PageRank of an AdjGraph. Freezes the graph first, use the CsrGraph overload or PprPush for repeated queries
+ */
+template <class TStr>
+std::vector<std::pair<NodeRef, double>> personalized_pagerank(const AdjGraph<TStr>& g, const std::vector<NodeRef>& seeds, std::size_t k,
+                                                              const PageRankOptions& opts = {})
+{
+    CsrGraph<TStr> csr(g, opts.n_threads);
+    std::vector<typename CsrGraph<TStr>::index_type> idx;
+    idx.reserve(seeds.size());
+    for (const NodeRef& s : seeds)
+        idx.push_back(csr.index_of(s));
+    std::vector<std::pair<NodeRef, double>> out;
+    for (auto [u, score] : top_k_scores(personalized_pagerank(csr, idx, opts).scores, k))
+        out.emplace_back(csr.node_ref(u), score);
+    return out;
+}
+
+
+/**
+ * @brief Approximate personalized PageRank by local pushes (Andersen, Chung, Lang, "Local Graph Partitioning using PageRank Vectors")
+ *
+ * Every node holds an estimate and a residual. The seeds start with the whole residual, and a node whose residual reaches epsilon * degree keeps
+ * 1 - damping of it and spreads the rest over its edges. The work only depends on the mass pushed, not on the graph size, so a query touches the
+ * neighborhood of the seeds only. The scores converge to the ones of personalized_pagerank() with the same damping and direction, the L1 error is at
+ * most residual(). The object keeps dense buffers of the graph size and clears only the touched entries between queries, so it should be reused
+ */
+template <class TStr = std::string>
+class PprPush {
+public:
+    using index_type = typename CsrGraph<TStr>::index_type;
+
+    explicit PprPush(const CsrGraph<TStr>& g, Direction direction = Direction::Out) : _g(g),
+        _follow_out(static_cast<std::uint8_t>(direction) & static_cast<std::uint8_t>(Direction::Out)),
+        _follow_in(static_cast<std::uint8_t>(direction) & static_cast<std::uint8_t>(Direction::In)),
+        _estimate(g.n_nodes(), 0.0), _residual(g.n_nodes(), 0.0), _flags(g.n_nodes(), 0) {}
+
+    /**
+     * @brief Run a query, the estimates are then available with score() and top_k(). A seed listed twice gets twice the restart probability
+     */
+    void run(const std::vector<index_type>& seeds, double damping = 0.85, double epsilon = 1e-6)
+    {
+        for (index_type u : _touched) {
+            _estimate[u] = _residual[u] = 0.0;
+            _flags[u] = 0;
+        }
+        _touched.clear();
+        _queue.clear();
+        _n_pushes = 0;
+        _seeds = seeds;
+        if (seeds.empty())
+            return;
+        for (index_type s : seeds)
+            if (s >= _g.n_nodes()) [[unlikely]]
+                throw std::out_of_range{"PprPush : the seed is not in the graph"};
+
+        const double restart = 1.0 / static_cast<double>(seeds.size());
+        for (index_type s : seeds)
+            add(s, restart, epsilon);
+
+        while (!_queue.empty()) {
+            index_type u = _queue.front();
+            _queue.pop_front();
+            _flags[u] &= ~queued;
+            double r = _residual[u];
+            _residual[u] = 0.0;
+            _estimate[u] += (1.0 - damping) * r;
+            _n_pushes++;
+
+            std::size_t deg = degree(u);
+            if (deg == 0) {
+                for (index_type s : _seeds)
+                    add(s, damping * r * restart, epsilon);
+                continue;
+            }
+            const double share = damping * r / static_cast<double>(deg);
+            if (_follow_out)
+                for (index_type v : _g.neighbors(u))
+                    add(v, share, epsilon);
+            if (_follow_in)
+                for (index_type v : _g.backlinks(u))
+                    add(v, share, epsilon);
+        }
+    }
+
+    const CsrGraph<TStr>& graph() const { return _g; }
+    double score(index_type u) const { return _estimate[u]; }
+
+    /**
+     * @brief The k highest estimates as (index, score), in decreasing order, ties by index
+     */
+    std::vector<std::pair<index_type, double>> top_k(std::size_t k) const
+    {
+        std::vector<std::pair<index_type, double>> items;
+        for (index_type u : _touched)
+            if (_estimate[u] > 0)
+                items.emplace_back(u, _estimate[u]);
+        return top_k_pairs(std::move(items), k);
+    }
+
+    /**
+     * @brief Residual mass left by the last run(), bounds the L1 error of the estimates
+     */
+    double residual() const
+    {
+        double sum = 0;
+        for (index_type u : _touched)
+            sum += _residual[u];
+        return sum;
+    }
+
+    std::size_t n_pushes() const { return _n_pushes; }
+    std::size_t n_touched() const { return _touched.size(); }
+
+protected:
+    static constexpr std::uint8_t touched = 1, queued = 2;
+
+    std::size_t degree(index_type u) const { return (_follow_out ? _g.out_degree(u) : 0) + (_follow_in ? _g.in_degree(u) : 0); }
+
+    void add(index_type v, double mass, double epsilon)
+    {
+        if (!(_flags[v] & touched)) {
+            _flags[v] |= touched;
+            _touched.push_back(v);
+        }
+        _residual[v] += mass;
+        if (!(_flags[v] & queued) && _residual[v] >= epsilon * static_cast<double>(std::max<std::size_t>(degree(v), 1))) {
+            _flags[v] |= queued;
+            _queue.push_back(v);
+        }
+    }
+
+    const CsrGraph<TStr>& _g;
+    bool _follow_out, _follow_in;
+    std::vector<double> _estimate, _residual;
+    std::vector<std::uint8_t> _flags;
+    std::vector<index_type> _touched, _seeds;
+    std::deque<index_type> _queue; // FIFO
+    std::size_t _n_pushes = 0;
+};
+
+}
+
+#endif // JSC_PAGERANK_H
@@ -0,0 +1,143 @@
+#ifndef JSC_PARALLEL_H
+#define JSC_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace jsc {
+
+/**
+ * @brief Number of threads to use when the caller passes 0
+ */
+inline std::size_t default_threads()
+{
+    std::size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/**
+ * @brief Split [0, n) into contiguous chunks and call func(begin, end, thread_idx) for each chunk on its own thread
+ *
+ * Runs inline if there is only one chunk. The first exception thrown by a worker is rethrown in the caller
+ */
+template <class F>
+void parallel_chunks(std::size_t n, F func, std::size_t n_threads = 0, std::size_t min_chunk = 1024)
+{
+    if (n_threads == 0)
+        n_threads = default_threads();
+    n_threads = std::max<std::size_t>(1, std::min(n_threads, (n + min_chunk - 1) / std::max<std::size_t>(min_chunk, 1)));
+
+    if (n_threads <= 1) {
+        func(std::size_t(0), n, std::size_t(0));
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads);
+    std::exception_ptr error;
+    std::mutex error_mtx;
+
+    std::size_t chunk = (n + n_threads - 1) / n_threads;
+    for (std::size_t t = 0; t < n_threads; t++) {
+        std::size_t begin = t * chunk, end = std::min(n, begin + chunk);
+        workers.emplace_back([&, begin, end, t]() {
+            try {
+                func(begin, end, t);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mtx);
+                if (!error)
+                    error = std::current_exception();
+            }
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/**
+ * @brief Call func(i) for every i in [0, n) using up to n_threads threads
+ */
+template <class F>
+void parallel_for(std::size_t n, F func, std::size_t n_threads = 0, std::size_t min_chunk = 1024)
+{
+    parallel_chunks(n, [&](std::size_t begin, std::size_t end, std::size_t) {
+        for (std::size_t i = begin; i < end; i++)
+            func(i);
+    }, n_threads, min_chunk);
+}
+
+
+/**
+ * @brief Blocking multi-producer multi-consumer FIFO with a fixed capacity
+ *
+ * push() waits while the queue is full, which gives backpressure to the producers. After close(), push() fails and pop() returns the remaining items, then fails
+ */
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : _capacity(std::max<std::size_t>(capacity, 1)), _closed(false) {}
+
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _not_full.wait(lock, [&]() { return _closed || _items.size() < _capacity; });
+        if (_closed)
+            return false;
+        _items.push_back(std::move(item));
+        lock.unlock();
+        _not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _not_empty.wait(lock, [&]() { return _closed || !_items.empty(); });
+        if (_items.empty())
+            return false;
+        item = std::move(_items.front());
+        _items.pop_front();
+        lock.unlock();
+        _not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _closed = true;
+        }
+        _not_full.notify_all();
+        _not_empty.notify_all();
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _items.size();
+    }
+
+    std::size_t capacity() const { return _capacity; }
+
+protected:
+    mutable std::mutex _mtx;
+    std::condition_variable _not_full, _not_empty;
+    std::deque<T> _items;
+    std::size_t _capacity;
+    bool _closed;
+};
+
+}
+
+#endif // JSC_PARALLEL_H
@@ -0,0 +1,333 @@
+#ifndef JSC_SHARDED_GRAPH_H
+#define JSC_SHARDED_GRAPH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "graph_builder.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Graph which several threads can fill at once
+ *
+ * Nodes are partitioned into shards by id (id % n_shards, ids being sequential), each with its own lock, so writers only contend when they touch the
+ * same shard. Each thread inserts through its own Writer, which takes node ids from the global counter in blocks. add_edge() locks the shard of the
+ * source only : the backlink is queued in a thread-local outbox, moved to the mailbox of the target shard in batches, and sync() applies the mailboxes.
+ * Backlinks are therefore only complete after the writers are flushed and sync() ran. Reads are not synchronized and need the writers to be idle.
+ * build() turns the result into an AdjGraph
+ */
+template <class TStr = std::string>
+class ShardedGraph {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    struct Edge {
+        std::size_t to;
+        WidgetIdx widget;
+        AttrSet<TStr> attrs;
+    };
+
+    struct NodeData {
+        Node<TStr> node;
+        std::vector<Edge> edges;
+        std::vector<std::size_t> backlinks; // source of each incoming edge, complete after sync()
+        std::vector<bool> linked;           // widgets which already have an edge
+        bool live = false;
+    };
+
+    /**
+     * @brief Per-thread insertion handle. Flushes its outboxes when destroyed, must not outlive the graph
+     */
+    class Writer {
+    public:
+        Writer(ShardedGraph& g, std::size_t id_block, std::size_t batch) : _g(&g), _block(std::max<std::size_t>(id_block, 1)),
+            _batch(std::max<std::size_t>(batch, 1)), _next(0), _end(0), _outboxes(g._shards.size()) {}
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        Writer(Writer&&) = default;
+        Writer& operator=(Writer&&) = default;
+        ~Writer() { if (_g) flush(); }
+
+        /**
+         * @brief Add a node. Throws if the node already has an id
+         */
+        NodeRef add_node(Node<TStr> node)
+        {
+            if (node._internal_id() != npos) [[unlikely]]
+                throw std::invalid_argument{"The node cannot be added twice"};
+            if (_next == _end) {
+                _next = _g->_next_id.fetch_add(_block, std::memory_order_relaxed);
+                _end = _next + _block;
+            }
+            const std::size_t id = _next++;
+            node._set_internal_id(id);
+
+            Shard& shard = _g->shard(id);
+            const std::size_t local = id / _g->_shards.size();
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            if (shard.nodes.size() <= local)
+                shard.nodes.resize(std::max(local + 1, shard.nodes.size() * 2));
+            NodeData& nd = shard.nodes[local];
+            nd.linked.assign(node.widget_tree().size(), false);
+            nd.node = std::move(node);
+            nd.live = true;
+            shard.n_nodes++;
+            return NodeRef(id);
+        }
+
+        /**
+         * @brief Add an edge from a widget of the source node, which must have been added. The target may be added later by any writer, as long as it
+         * is added before the last sync(). Throws if the source or the widget does not exist, or if the widget already has an edge
+         */
+        void add_edge(NodeRef from, NodeRef to, WidgetIdx widget, AttrSet<TStr> attrs = {})
+        {
+            const std::size_t u = from._internal_id(), v = to._internal_id();
+            {
+                Shard& shard = _g->shard(u);
+                std::lock_guard<std::mutex> lock(shard.mtx);
+                NodeData* nd = shard.find(u / _g->_shards.size());
+                if (!nd) [[unlikely]]
+                    throw std::invalid_argument{"The node does not exist"};
+                if (widget >= nd->linked.size()) [[unlikely]]
+                    throw std::invalid_argument{"The widget does not exist in the source node"};
+                if (nd->linked[widget]) [[unlikely]]
+                    throw std::invalid_argument{"The widget already has a hyperlink"};
+                nd->linked[widget] = true;
+                nd->edges.push_back(Edge{v, widget, std::move(attrs)});
+                shard.n_edges++;
+            }
+            const std::size_t s = v % _g->_shards.size();
+            _outboxes[s].emplace_back(v, u);
+            if (_outboxes[s].size() >= _batch)
+                flush(s);
+        }
+
+        /**
+         * @brief Move the queued backlinks to the mailboxes of their shards
+         */
+        void flush()
+        {
+            for (std::size_t s = 0; s < _outboxes.size(); s++)
+                flush(s);
+        }
+
+    protected:
+        void flush(std::size_t s)
+        {
+            if (_outboxes[s].empty())
+                return;
+            Shard& shard = _g->_shards[s];
+            {
+                std::lock_guard<std::mutex> lock(shard.mail_mtx);
+                if (shard.mailbox.empty())
+                    shard.mailbox.swap(_outboxes[s]);
+                else
+                    shard.mailbox.insert(shard.mailbox.end(), _outboxes[s].begin(), _outboxes[s].end());
+            }
+            _outboxes[s].clear();
+        }
+
+        ShardedGraph* _g;
+        std::size_t _block, _batch;
+        std::size_t _next, _end; // current id block
+        std::vector<std::vector<std::pair<std::size_t, std::size_t>>> _outboxes; // (target, source) per target shard
+    };
+
+    explicit ShardedGraph(std::size_t n_shards = 0) : _shards(n_shards ? n_shards : 4 * default_threads()) {}
+
+    ShardedGraph(const ShardedGraph&) = delete;
+    ShardedGraph& operator=(const ShardedGraph&) = delete;
+
+    /**
+     * @brief Create an insertion handle for the calling thread. Node ids are reserved id_block at a time, backlinks are handed over batch at a time
+     */
+    Writer writer(std::size_t id_block = 1024, std::size_t batch = 256) { return Writer(*this, id_block, batch); }
+
+    /**
+     * @brief Apply the flushed backlinks, one shard per task, using up to n_threads threads (0 = all cores). May run while writers insert.
+     * Backlinks to nodes which do not exist yet stay queued, or are dropped along with their edge if drop_dangling. Returns the number still queued
+     */
+    std::size_t sync(bool drop_dangling = false, std::size_t n_threads = 0)
+    {
+        std::vector<std::vector<std::pair<std::size_t, std::size_t>>> dangling(_shards.size());
+        parallel_for(_shards.size(), [&](std::size_t s) {
+            Shard& shard = _shards[s];
+            std::vector<std::pair<std::size_t, std::size_t>> mail;
+            {
+                std::lock_guard<std::mutex> lock(shard.mail_mtx);
+                mail.swap(shard.mailbox);
+            }
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (const auto& [v, u] : mail) {
+                if (NodeData* nd = shard.find(v / _shards.size()))
+                    nd->backlinks.push_back(u);
+                else
+                    dangling[s].emplace_back(v, u);
+            }
+        }, n_threads, 1);
+
+        std::size_t pending = 0;
+        for (std::size_t s = 0; s < _shards.size(); s++) {
+            if (drop_dangling) {
+                for (const auto& [v, u] : dangling[s])
+                    drop_edge(u, v);
+            } else if (!dangling[s].empty()) {
+                std::lock_guard<std::mutex> lock(_shards[s].mail_mtx);
+                _shards[s].mailbox.insert(_shards[s].mailbox.end(), dangling[s].begin(), dangling[s].end());
+                pending += dangling[s].size();
+            }
+        }
+        return pending;
+    }
+
+    // Reads below are not synchronized with the writers
+
+    bool contains(NodeRef ref) const { return find(ref._internal_id()) != nullptr; }
+
+    /**
+     * @brief Get a node. Throws if it does not exist
+     */
+    const Node<TStr>& get_node(NodeRef ref) const { return entry(ref._internal_id()).node; }
+    const std::vector<Edge>& get_edges(NodeRef ref) const { return entry(ref._internal_id()).edges; }
+    const std::vector<std::size_t>& get_backlinks(NodeRef ref) const { return entry(ref._internal_id()).backlinks; }
+
+    /**
+     * @brief Call func(const NodeData&) on every node, in id order
+     */
+    template <class F>
+    void each(F&& func) const
+    {
+        const std::size_t bound = id_bound();
+        for (std::size_t id = 0; id < bound; id++) {
+            if (const NodeData* nd = find(id))
+                func(*nd);
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (const Shard& shard : _shards)
+            n += shard.n_nodes;
+        return n;
+    }
+
+    std::size_t n_edges() const
+    {
+        std::size_t n = 0;
+        for (const Shard& shard : _shards)
+            n += shard.n_edges;
+        return n;
+    }
+
+    std::size_t n_shards() const { return _shards.size(); }
+
+    /**
+     * @brief Every node id is lower. Ids of unused block tails are never assigned
+     */
+    std::size_t id_bound() const { return _next_id.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Move the nodes and the edges into an AdjGraph with a GraphBuilder, after the writers are done and sync(true) ran. Nodes are added in id
+     * order, so the node with index i in ids gets GraphBuilder::node_ref(i). The graph is left empty
+     */
+    AdjGraph<TStr> build(std::vector<std::size_t>* ids = nullptr, std::size_t n_threads = 0)
+    {
+        const std::size_t bound = id_bound();
+        std::vector<std::size_t> index(bound, npos), order;
+        order.reserve(size());
+        for (std::size_t id = 0; id < bound; id++) {
+            if (find(id)) {
+                index[id] = order.size();
+                order.push_back(id);
+            }
+        }
+
+        GraphBuilder<TStr> builder;
+        builder.reserve(order.size(), n_edges());
+        for (std::size_t id : order) {
+            NodeData& nd = *find(id);
+            nd.node._set_internal_id(npos);
+            builder.add_node(std::move(nd.node));
+        }
+        for (std::size_t id : order) {
+            for (Edge& e : find(id)->edges) {
+                if (index[e.to] == npos) [[unlikely]]
+                    throw std::out_of_range{"ShardedGraph : the edge references a missing node, call sync(true) first"};
+                builder.add_edge(index[id], index[e.to], e.widget, std::move(e.attrs));
+            }
+        }
+        for (Shard& shard : _shards) {
+            shard.nodes.clear();
+            shard.mailbox.clear();
+            shard.n_nodes = shard.n_edges = 0;
+        }
+        _next_id.store(0, std::memory_order_relaxed);
+        if (ids)
+            *ids = std::move(order);
+        return builder.build(n_threads);
+    }
+
+protected:
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::vector<NodeData> nodes; // node id / n_shards -> node
+        std::size_t n_nodes = 0, n_edges = 0;
+
+        std::mutex mail_mtx;
+        std::vector<std::pair<std::size_t, std::size_t>> mailbox; // (target, source) backlinks waiting for sync()
+
+        NodeData* find(std::size_t local) { return local < nodes.size() && nodes[local].live ? &nodes[local] : nullptr; }
+        const NodeData* find(std::size_t local) const { return local < nodes.size() && nodes[local].live ? &nodes[local] : nullptr; }
+    };
+
+    Shard& shard(std::size_t id) { return _shards[id % _shards.size()]; }
+
+    NodeData* find(std::size_t id) { return shard(id).find(id / _shards.size()); }
+    const NodeData* find(std::size_t id) const { return _shards[id % _shards.size()].find(id / _shards.size()); }
+
+    const NodeData& entry(std::size_t id) const
+    {
+        const NodeData* nd = find(id);
+        if (!nd) [[unlikely]]
+            throw std::invalid_argument{"The node does not exist"};
+        return *nd;
+    }
+
+    /**
+     * @brief Remove one edge u -> v whose target does not exist
+     */
+    void drop_edge(std::size_t u, std::size_t v)
+    {
+        Shard& shard = this->shard(u);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        NodeData* nd = shard.find(u / _shards.size());
+        if (!nd)
+            return;
+        auto it = std::find_if(nd->edges.begin(), nd->edges.end(), [&](const Edge& e) { return e.to == v; });
+        if (it != nd->edges.end()) {
+            nd->linked[it->widget] = false;
+            nd->edges.erase(it);
+            shard.n_edges--;
+        }
+    }
+
+    std::vector<Shard> _shards;
+    std::atomic<std::size_t> _next_id{0};
+};
+
+}
+
+#endif // JSC_SHARDED_GRAPH_H
@@ -0,0 +1,186 @@
+#ifndef JSC_SLOT_MAP_H
+#define JSC_SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "stats.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Container with stable generational ids, dense value storage and O(1) unhashed access
+ *
+ * An id packs the slot index (low 32 bits) and the slot generation (high 32 bits). Erasing a value bumps the generation of its slot and puts the slot
+ * on a free list, so the slot is reused by a later insertion while stale ids are detected by the generation mismatch.
+ * Values are kept contiguous (erase moves the last value into the hole), so references are invalidated by any insertion or erasure
+ */
+template <class T>
+class SlotMap {
+public:
+    using id_type = std::size_t;
+    static constexpr id_type npos = std::numeric_limits<id_type>::max();
+    static constexpr std::uint32_t slot_npos = std::numeric_limits<std::uint32_t>::max();
+
+    static std::uint32_t slot_of(id_type id) { return static_cast<std::uint32_t>(id & 0xffffffffu); }
+    static std::uint32_t generation_of(id_type id) { return static_cast<std::uint32_t>(id >> 32); }
+    static id_type make_id(std::uint32_t slot, std::uint32_t gen) { return (static_cast<id_type>(gen) << 32) | slot; }
+
+    SlotMap() : _free_head(slot_npos) {}
+
+    // ACCESS
+    // ======
+
+    std::size_t size() const { return _values.size(); }
+    bool empty() const { return _values.empty(); }
+
+    /**
+     * @brief Number of slots ever allocated. Bounded by the peak size, since freed slots are reused
+     */
+    std::size_t slot_count() const { return _slots.size(); }
+
+    /**
+     * @brief The id which the next insert() will return
+     */
+    id_type next_id() const
+    {
+        if (_free_head != slot_npos)
+            return make_id(_free_head, _slots[_free_head].gen);
+        return make_id(static_cast<std::uint32_t>(_slots.size()), 0);
+    }
+
+    bool contains(id_type id) const { return dense_of(id) != slot_npos; }
+
+    /**
+     * @brief Get the value or nullptr if the id is stale or was never issued
+     */
+    T* find(id_type id)
+    {
+        std::uint32_t d = dense_of(id);
+        return d != slot_npos ? &_values[d] : nullptr;
+    }
+    const T* find(id_type id) const { return const_cast<SlotMap*>(this)->find(id); }
+
+    T& at(id_type id)
+    {
+        T* v = find(id);
+        if (!v) [[unlikely]]
+            throw std::out_of_range{"SlotMap::at : stale or invalid id"};
+        return *v;
+    }
+    const T& at(id_type id) const { return const_cast<SlotMap*>(this)->at(id); }
+
+    /**
+     * @brief Position of the value in the dense storage, slot_npos if the id is stale. Invalidated by erasure
+     */
+    std::uint32_t dense_of(id_type id) const
+    {
+        std::uint32_t s = slot_of(id);
+        if (s >= _slots.size() || _slots[s].gen != generation_of(id)) [[unlikely]]
+            return slot_npos;
+        return _slots[s].dense;
+    }
+
+    id_type id_at(std::uint32_t dense) const { std::uint32_t s = _dense_slots[dense]; return make_id(s, _slots[s].gen); }
+    T& value_at(std::uint32_t dense) { return _values[dense]; }
+    const T& value_at(std::uint32_t dense) const { return _values[dense]; }
+
+    /**
+     * @brief Call func(id, value) for every value in the dense storage order
+     */
+    template <class F>
+    void each(F func) { for (std::uint32_t d = 0; d < _values.size(); d++) func(id_at(d), _values[d]); }
+    template <class F>
+    void each(F func) const { for (std::uint32_t d = 0; d < _values.size(); d++) func(id_at(d), _values[d]); }
+
+    // MODIFIERS
+    // =========
+
+    void reserve(std::size_t n)
+    {
+        _values.reserve(n);
+        _dense_slots.reserve(n);
+        _slots.reserve(n);
+    }
+
+    id_type insert(T value)
+    {
+        std::uint32_t s = _free_head;
+        if (s != slot_npos) {
+            _free_head = _slots[s].next_free;
+        } else {
+            if (_slots.size() >= slot_npos) [[unlikely]]
+                throw std::length_error{"SlotMap : too many slots"};
+            s = static_cast<std::uint32_t>(_slots.size());
+            _slots.push_back(Slot{0, slot_npos, slot_npos});
+        }
+
+        _slots[s].dense = static_cast<std::uint32_t>(_values.size());
+        _slots[s].next_free = slot_npos;
+        if (_values.size() == _values.capacity()) [[unlikely]] {
+            JSC_STAT_COUNT(SlotMapGrow);
+            JSC_STAT_ADD(SlotMapGrowMoves, _values.size());
+            JSC_STAT_TIMER(SlotMapGrow);
+            _values.push_back(std::move(value));
+        } else {
+            _values.push_back(std::move(value));
+        }
+        _dense_slots.push_back(s);
+        return make_id(s, _slots[s].gen);
+    }
+
+    bool erase(id_type id)
+    {
+        std::uint32_t d = dense_of(id);
+        if (d == slot_npos)
+            return false;
+        std::uint32_t s = slot_of(id);
+
+        // Move the last value into the hole
+        std::uint32_t last = static_cast<std::uint32_t>(_values.size() - 1);
+        if (d != last) {
+            _values[d] = std::move(_values[last]);
+            _dense_slots[d] = _dense_slots[last];
+            _slots[_dense_slots[d]].dense = d;
+        }
+        _values.pop_back();
+        _dense_slots.pop_back();
+
+        // Invalidate the outstanding ids and recycle the slot. A generation which would make the id equal to npos is skipped
+        Slot& slot = _slots[s];
+        slot.gen++;
+        if (make_id(s, slot.gen) == npos) [[unlikely]]
+            slot.gen++;
+        slot.dense = slot_npos;
+        slot.next_free = _free_head;
+        _free_head = s;
+        return true;
+    }
+
+    void clear()
+    {
+        while (!_values.empty())
+            erase(id_at(static_cast<std::uint32_t>(_values.size() - 1)));
+    }
+
+protected:
+    struct Slot {
+        std::uint32_t gen;
+        std::uint32_t dense;     // position in _values, slot_npos if free
+        std::uint32_t next_free; // free list link
+    };
+
+    std::vector<T> _values;
+    std::vector<std::uint32_t> _dense_slots; // dense position -> slot
+    std::vector<Slot> _slots;
+    std::uint32_t _free_head;
+};
+
+}
+
+#endif // JSC_SLOT_MAP_H
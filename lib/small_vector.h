@@ -0,0 +1,319 @@
+#ifndef JSC_SMALL_VECTOR_H
+#define JSC_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace jsc {
+
+/**
+ * @brief Vector with inline storage for up to N elements. Spills to the heap only when it grows past N
+ *
+ * Iterators and references are invalidated by any insertion or by moving the container (the inline buffer moves with it)
+ */
+template <class T, std::size_t N>
+class SmallVec {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "SmallVec allocates with the plain operator new");
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+
+    SmallVec() : _data(inline_data()), _size(0), _cap(N) {}
+    SmallVec(std::initializer_list<T> il) : SmallVec() { reserve(il.size()); for (const auto& v : il) push_back(v); }
+
+    SmallVec(const SmallVec& other) : SmallVec()
+    {
+        reserve(other._size);
+        std::uninitialized_copy(other.begin(), other.end(), _data);
+        _size = other._size;
+    }
+
+    SmallVec(SmallVec&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : SmallVec() { steal(std::move(other)); }
+
+    SmallVec& operator=(const SmallVec& other)
+    {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            std::uninitialized_copy(other.begin(), other.end(), _data);
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    SmallVec& operator=(SmallVec&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &other) {
+            clear();
+            release();
+            steal(std::move(other));
+        }
+        return *this;
+    }
+
+    ~SmallVec() { clear(); release(); }
+
+    // ACCESS
+    // ======
+
+    std::size_t size() const { return _size; }
+    std::size_t capacity() const { return _cap; }
+    bool empty() const { return _size == 0; }
+
+    /**
+     * @brief True if the elements live in the inline buffer
+     */
+    bool is_inline() const { return _data == inline_data(); }
+
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return _data; }
+    const_iterator cend() const { return _data + _size; }
+
+    T& operator[](std::size_t i) { return _data[i]; }
+    const T& operator[](std::size_t i) const { return _data[i]; }
+    T& front() { return _data[0]; }
+    const T& front() const { return _data[0]; }
+    T& back() { return _data[_size - 1]; }
+    const T& back() const { return _data[_size - 1]; }
+
+    // MODIFIERS
+    // =========
+
+    void reserve(std::size_t n)
+    {
+        if (n <= _cap)
+            return;
+        relocate(allocate(n), n);
+    }
+
+    template <class... TArgs>
+    T& emplace_back(TArgs&&... args)
+    {
+        if (_size == _cap) [[unlikely]]
+            return grow_emplace_back(std::forward<TArgs>(args)...);
+        T* p = ::new (static_cast<void*>(_data + _size)) T(std::forward<TArgs>(args)...);
+        _size++;
+        return *p;
+    }
+
+    void push_back(const T& v) { emplace_back(v); }
+    void push_back(T&& v) { emplace_back(std::move(v)); }
+
+    void pop_back() { _data[--_size].~T(); }
+
+    /**
+     * @brief Insert an element before pos, shifting the tail by one
+     */
+    template <class TVal>
+    iterator insert(const_iterator pos, TVal&& v)
+    {
+        std::size_t i = pos - _data;
+        emplace_back(std::forward<TVal>(v));
+        std::rotate(_data + i, _data + _size - 1, _data + _size);
+        return _data + i;
+    }
+
+    /**
+     * @brief Erase the element at pos, preserving order
+     */
+    iterator erase(const_iterator pos)
+    {
+        std::size_t i = pos - _data;
+        std::move(_data + i + 1, _data + _size, _data + i);
+        pop_back();
+        return _data + i;
+    }
+
+    /**
+     * @brief Erase the element at position i by moving the last element into its place. Does not preserve order
+     */
+    void swap_erase(std::size_t i)
+    {
+        if (i + 1 != _size)
+            _data[i] = std::move(_data[_size - 1]);
+        pop_back();
+    }
+
+    void clear()
+    {
+        for (std::size_t i = 0; i < _size; i++)
+            _data[i].~T();
+        _size = 0;
+    }
+
+protected:
+    T* inline_data() { return reinterpret_cast<T*>(_inline); }
+    const T* inline_data() const { return reinterpret_cast<const T*>(_inline); }
+
+    // Plain operator new, which is aligned for any T up to the default new alignment
+    static T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n * sizeof(T))); }
+
+    void release()
+    {
+        if (!is_inline())
+            ::operator delete(static_cast<void*>(_data));
+        _data = inline_data();
+        _cap = N;
+    }
+
+    // Move the elements to buf, which holds n elements, and free the old storage
+    void relocate(T* buf, std::size_t n)
+    {
+        for (std::size_t i = 0; i < _size; i++) {
+            ::new (static_cast<void*>(buf + i)) T(std::move(_data[i]));
+            _data[i].~T();
+        }
+        release();
+        _data = buf;
+        _cap = static_cast<std::uint32_t>(n);
+    }
+
+    // The new element is constructed before the old ones move, since the arguments may refer to them (v.push_back(v[0]))
+    template <class... TArgs>
+    T& grow_emplace_back(TArgs&&... args)
+    {
+        const std::size_t n = _cap ? _cap * 2 : 4;
+        T* buf = allocate(n);
+        T* p;
+        try {
+            p = ::new (static_cast<void*>(buf + _size)) T(std::forward<TArgs>(args)...);
+        } catch (...) {
+            ::operator delete(static_cast<void*>(buf));
+            throw;
+        }
+        relocate(buf, n);
+        _size++;
+        return *p;
+    }
+
+    // Expects an empty inline container
+    void steal(SmallVec&& other)
+    {
+        if (other.is_inline()) {
+            for (std::size_t i = 0; i < other._size; i++)
+                ::new (static_cast<void*>(_data + i)) T(std::move(other._data[i]));
+            _size = other._size;
+            other.clear();
+        } else {
+            _data = other._data;
+            _size = other._size;
+            _cap = other._cap;
+            other._data = other.inline_data();
+            other._size = 0;
+            other._cap = N;
+        }
+    }
+
+    T* _data;
+    std::uint32_t _size;
+    std::uint32_t _cap;
+    alignas(T) unsigned char _inline[N ? N * sizeof(T) : 1];
+};
+
+
+/**
+ * @brief Map stored as a key-sorted SmallVec. Lookups are a linear scan for small sizes and a binary search otherwise
+ *
+ * Provides the subset of the std::unordered_map interface used by AttrSet
+ */
+template <class K, class V, std::size_t N>
+class SmallFlatMap {
+public:
+    using value_type = std::pair<K, V>;
+    using storage_type = SmallVec<value_type, N>;
+    using iterator = typename storage_type::iterator;
+    using const_iterator = typename storage_type::const_iterator;
+
+    std::size_t size() const { return _v.size(); }
+    bool empty() const { return _v.empty(); }
+
+    iterator begin() { return _v.begin(); }
+    iterator end() { return _v.end(); }
+    const_iterator begin() const { return _v.begin(); }
+    const_iterator end() const { return _v.end(); }
+    const_iterator cbegin() const { return _v.begin(); }
+    const_iterator cend() const { return _v.end(); }
+
+    iterator find(const K& k) { return const_cast<iterator>(static_cast<const SmallFlatMap*>(this)->find(k)); }
+
+    const_iterator find(const K& k) const
+    {
+        const_iterator it = lower_bound(k);
+        return (it != _v.end() && it->first == k) ? it : _v.end();
+    }
+
+    /**
+     * @brief Insert the value if the key is not present, same as std::unordered_map::emplace
+     */
+    template <class TVal>
+    std::pair<iterator, bool> emplace(const K& k, TVal&& v)
+    {
+        iterator it = const_cast<iterator>(lower_bound(k));
+        if (it != _v.end() && it->first == k)
+            return {it, false};
+        return {_v.insert(it, value_type(k, V(std::forward<TVal>(v)))), true};
+    }
+
+    /**
+     * @brief Insert the value or replace the value of an existing key, same as std::unordered_map::insert_or_assign
+     */
+    template <class TVal>
+    std::pair<iterator, bool> insert_or_assign(const K& k, TVal&& v)
+    {
+        iterator it = const_cast<iterator>(lower_bound(k));
+        if (it != _v.end() && it->first == k) {
+            it->second = std::forward<TVal>(v);
+            return {it, false};
+        }
+        return {_v.insert(it, value_type(k, V(std::forward<TVal>(v)))), true};
+    }
+
+    std::size_t erase(const K& k)
+    {
+        const_iterator it = find(k);
+        if (it == _v.end())
+            return 0;
+        _v.erase(it);
+        return 1;
+    }
+
+    void clear() { _v.clear(); }
+    void reserve(std::size_t n) { _v.reserve(n); }
+
+protected:
+    const_iterator lower_bound(const K& k) const
+    {
+        if (_v.size() <= 8) {
+            const_iterator it = _v.begin();
+            while (it != _v.end() && it->first < k)
+                ++it;
+            return it;
+        }
+        return std::lower_bound(_v.begin(), _v.end(), k, [](const value_type& a, const K& b) { return a.first < b; });
+    }
+
+    storage_type _v;
+};
+
+}
+
+#endif // JSC_SMALL_VECTOR_H
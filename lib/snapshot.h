@@ -0,0 +1,459 @@
+#ifndef JSC_SNAPSHOT_H
+#define JSC_SNAPSHOT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Epoch-based reclamation with a fixed number of reader slots
+ *
+ * A reader pins the current epoch in a free slot before loading a shared pointer and clears the slot when it is done. The writer retires an object
+ * with the epoch that was current when it was unpublished, and the object may be freed once every pinned slot holds a later epoch. Pinning is
+ * lock-free : it claims a slot with one CAS and publishes the epoch with one store
+ */
+class EpochDomain {
+public:
+    static constexpr std::uint64_t unpinned = 0;
+
+    explicit EpochDomain(std::size_t max_readers = 256) : _n_slots(std::max<std::size_t>(max_readers, 1)), _slots(new Slot[_n_slots]) {}
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    /**
+     * @brief Claim a reader slot and pin the current epoch in it. Throws if all the slots are taken
+     */
+    std::size_t pin()
+    {
+        static thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        for (std::size_t k = 0; k < _n_slots; k++) {
+            const std::size_t i = (hint + k) % _n_slots;
+            bool expected = false;
+            if (!_slots[i].used.load(std::memory_order_relaxed) && _slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                hint = i;
+                _slots[i].epoch.store(_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                return i;
+            }
+        }
+        throw std::runtime_error{"EpochDomain : too many concurrent readers"};
+    }
+
+    /**
+     * @brief Clear and free a slot returned by pin()
+     */
+    void unpin(std::size_t slot)
+    {
+        _slots[slot].epoch.store(unpinned, std::memory_order_release);
+        _slots[slot].used.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Move to the next epoch. Returns the previous one, which is the retire epoch of everything unpublished before the call
+     */
+    std::uint64_t advance() { return _epoch.fetch_add(1, std::memory_order_seq_cst); }
+
+    std::uint64_t epoch() const { return _epoch.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Objects retired at an epoch lower than this one are not reachable by any reader
+     */
+    std::uint64_t safe_epoch() const
+    {
+        std::uint64_t min = _epoch.load(std::memory_order_seq_cst);
+        for (std::size_t i = 0; i < _n_slots; i++) {
+            const std::uint64_t e = _slots[i].epoch.load(std::memory_order_seq_cst);
+            if (e != unpinned)
+                min = std::min(min, e);
+        }
+        return min;
+    }
+
+    std::size_t max_readers() const { return _n_slots; }
+
+protected:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{unpinned};
+        std::atomic<bool> used{false};
+    };
+
+    std::atomic<std::uint64_t> _epoch{1};
+    std::size_t _n_slots;
+    std::unique_ptr<Slot[]> _slots;
+};
+
+
+/**
+ * @brief Edge of a VersionedGraph : target node, source widget and attributes
+ */
+template <class TStr = std::string>
+struct SnapshotEdge {
+    std::size_t to;
+    WidgetIdx widget;
+    AttrSet<TStr> attrs;
+};
+
+
+template <class TStr>
+class VersionedGraph;
+
+/**
+ * @brief Immutable published version of a VersionedGraph. Nodes are split into shards of shard_size ids, and each node keeps its payload
+ * and its adjacency behind shared pointers, so that consecutive versions share everything the writer did not touch in between
+ */
+template <class TStr = std::string>
+struct GraphVersion {
+    static constexpr std::size_t shard_bits = 8;
+    static constexpr std::size_t shard_size = std::size_t(1) << shard_bits;
+
+    struct Adjacency {
+        std::shared_ptr<const Node<TStr>> node;
+        std::vector<SnapshotEdge<TStr>> edges;
+        std::vector<std::size_t> backlinks; // source of each incoming edge
+        std::uint64_t stamp = 0;            // writer round which created this copy
+    };
+
+    struct Shard {
+        std::vector<std::shared_ptr<Adjacency>> nodes = std::vector<std::shared_ptr<Adjacency>>(shard_size);
+        std::uint64_t stamp = 0;
+    };
+
+    std::vector<std::shared_ptr<Shard>> shards;
+    std::size_t n_nodes = 0;
+    std::size_t n_edges = 0;
+    std::size_t id_bound = 0; // every node id is lower
+    std::uint64_t number = 0;
+
+    const Adjacency* find(std::size_t id) const
+    {
+        const std::size_t s = id >> shard_bits;
+        if (s >= shards.size())
+            return nullptr;
+        return shards[s]->nodes[id & (shard_size - 1)].get();
+    }
+};
+
+
+/**
+ * @brief Consistent read-only view of a published version of a VersionedGraph
+ *
+ * Holding a snapshot keeps its version and every later one alive, so snapshots should be short-lived. A snapshot may be used from any thread,
+ * but must not outlive its graph
+ */
+template <class TStr = std::string>
+class GraphSnapshot {
+public:
+    using Version = GraphVersion<TStr>;
+
+    GraphSnapshot() = default;
+    GraphSnapshot(const GraphSnapshot&) = delete;
+    GraphSnapshot& operator=(const GraphSnapshot&) = delete;
+    GraphSnapshot(GraphSnapshot&& other) noexcept { *this = std::move(other); }
+    GraphSnapshot& operator=(GraphSnapshot&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            _domain = std::exchange(other._domain, nullptr);
+            _slot = other._slot;
+            _v = std::exchange(other._v, nullptr);
+        }
+        return *this;
+    }
+    ~GraphSnapshot() { release(); }
+
+    /**
+     * @brief Unpin the version. The snapshot is empty afterwards
+     */
+    void release()
+    {
+        if (_domain)
+            _domain->unpin(_slot);
+        _domain = nullptr;
+        _v = nullptr;
+    }
+
+    explicit operator bool() const { return _v != nullptr; }
+
+    std::uint64_t version() const { return _v->number; }
+    std::size_t size() const { return _v->n_nodes; }
+    std::size_t n_edges() const { return _v->n_edges; }
+    std::size_t id_bound() const { return _v->id_bound; }
+
+    bool contains(NodeRef ref) const { return _v->find(ref._internal_id()) != nullptr; }
+
+    /**
+     * @brief Get a node. Throws if it is not in this version
+     */
+    const Node<TStr>& get_node(NodeRef ref) const { return *entry(ref._internal_id()).node; }
+    const std::vector<SnapshotEdge<TStr>>& get_edges(NodeRef ref) const { return entry(ref._internal_id()).edges; }
+
+    /**
+     * @brief Sources of the incoming edges of a node, once per edge
+     */
+    const std::vector<std::size_t>& get_backlinks(NodeRef ref) const { return entry(ref._internal_id()).backlinks; }
+
+    /**
+     * @brief Call func(NodeRef, const Node&) on every node, in id order
+     */
+    template <class F>
+    void each(F&& func) const
+    {
+        for (std::size_t s = 0; s < _v->shards.size(); s++) {
+            const auto& nodes = _v->shards[s]->nodes;
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                if (nodes[i])
+                    func(NodeRef((s << Version::shard_bits) | i), *nodes[i]->node);
+            }
+        }
+    }
+
+protected:
+    friend class VersionedGraph<TStr>;
+
+    GraphSnapshot(EpochDomain* domain, std::size_t slot, const Version* v) : _domain(domain), _slot(slot), _v(v) {}
+
+    const typename Version::Adjacency& entry(std::size_t id) const
+    {
+        const typename Version::Adjacency* a = _v->find(id);
+        if (!a) [[unlikely]]
+            throw std::out_of_range{"GraphSnapshot : the node does not exist"};
+        return *a;
+    }
+
+    EpochDomain* _domain = nullptr;
+    std::size_t _slot = 0;
+    const Version* _v = nullptr;
+};
+
+
+/**
+ * @brief Graph with a single writer and concurrent lock-free readers
+ *
+ * The writer modifies a private working version and publish() makes it visible atomically. Shards and node adjacencies are copied on the first
+ * write after each publish, so a publish costs one pointer per shard plus the nodes touched since the previous one. snapshot() may be called from
+ * any thread and never blocks the writer. Versions are freed by the writer once no snapshot can reach them (epoch-based reclamation).
+ * Node ids are sequential and are not reused
+ */
+template <class TStr = std::string>
+class VersionedGraph {
+public:
+    using Version = GraphVersion<TStr>;
+    using Adjacency = typename Version::Adjacency;
+    using Shard = typename Version::Shard;
+
+    explicit VersionedGraph(std::size_t max_readers = 256) : _domain(max_readers), _published(new Version)
+    {
+        _current.store(_published.get(), std::memory_order_release);
+    }
+
+    VersionedGraph(const VersionedGraph&) = delete;
+    VersionedGraph& operator=(const VersionedGraph&) = delete;
+
+    /**
+     * @brief Pin the latest published version. Thread-safe and lock-free
+     */
+    GraphSnapshot<TStr> snapshot()
+    {
+        const std::size_t slot = _domain.pin();
+        return GraphSnapshot<TStr>(&_domain, slot, _current.load(std::memory_order_seq_cst));
+    }
+
+    // Writer side : the calls below must come from one thread at a time
+
+    /**
+     * @brief Add a node to the working version. Throws if the node already has an id
+     */
+    NodeRef add_node(Node<TStr> node)
+    {
+        if (node._internal_id() != std::numeric_limits<std::size_t>::max())
+            throw std::invalid_argument{"The node cannot be added twice"};
+        const std::size_t id = _work.id_bound++;
+        node._set_internal_id(id);
+        auto a = std::make_shared<Adjacency>();
+        a->node = std::make_shared<const Node<TStr>>(std::move(node));
+        a->stamp = _stamp;
+        slot(id) = std::move(a);
+        _work.n_nodes++;
+        return NodeRef(id);
+    }
+
+    /**
+     * @brief Replace the payload (attributes and widget tree) of a node, keeping its edges
+     */
+    void update_node(NodeRef ref, Node<TStr> node)
+    {
+        Adjacency& a = mut(ref._internal_id());
+        node._set_internal_id(ref._internal_id());
+        a.node = std::make_shared<const Node<TStr>>(std::move(node));
+    }
+
+    /**
+     * @brief Add an edge from a widget of the source node. Throws if a node or the widget does not exist
+     */
+    void add_edge(NodeRef from, NodeRef to, WidgetIdx widget, AttrSet<TStr> attrs = {})
+    {
+        const std::size_t u = from._internal_id(), v = to._internal_id();
+        if (!contains(to))
+            throw std::invalid_argument{"The node does not exist"};
+        Adjacency& src = mut(u);
+        if (widget >= src.node->widget_tree().size())
+            throw std::invalid_argument{"The widget does not exist in the source node"};
+        src.edges.push_back(SnapshotEdge<TStr>{v, widget, std::move(attrs)});
+        mut(v).backlinks.push_back(u);
+        _work.n_edges++;
+    }
+
+    /**
+     * @brief Delete the first edge from the widget of the source node to the target. Returns false if there is none
+     */
+    bool del_edge(NodeRef from, NodeRef to, WidgetIdx widget)
+    {
+        const std::size_t u = from._internal_id(), v = to._internal_id();
+        if (!contains(from) || !contains(to))
+            return false;
+        const auto& edges = _work.find(u)->edges;
+        auto it = std::find_if(edges.begin(), edges.end(), [&](const SnapshotEdge<TStr>& e) { return e.to == v && e.widget == widget; });
+        if (it == edges.end())
+            return false;
+        const std::size_t pos = static_cast<std::size_t>(it - edges.begin());
+        auto& out = mut(u).edges;
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(pos));
+        erase_one(mut(v).backlinks, u);
+        _work.n_edges--;
+        return true;
+    }
+
+    /**
+     * @brief Delete a node with its edges in both directions. Returns false if it does not exist
+     */
+    bool del_node(NodeRef ref)
+    {
+        const std::size_t id = ref._internal_id();
+        if (!contains(ref))
+            return false;
+        const Adjacency& a = *_work.find(id);
+        for (const SnapshotEdge<TStr>& e : a.edges) {
+            if (e.to != id)
+                erase_one(mut(e.to).backlinks, id);
+        }
+        for (std::size_t src : a.backlinks) {
+            if (src == id)
+                continue;
+            auto& edges = mut(src).edges;
+            edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const SnapshotEdge<TStr>& e) { return e.to == id; }), edges.end());
+        }
+        std::size_t self = 0;
+        for (const SnapshotEdge<TStr>& e : a.edges)
+            self += e.to == id;
+        _work.n_edges -= a.edges.size() + a.backlinks.size() - self;
+        slot(id).reset();
+        _work.n_nodes--;
+        return true;
+    }
+
+    bool contains(NodeRef ref) const { return _work.find(ref._internal_id()) != nullptr; }
+
+    /**
+     * @brief Get a node of the working version. Throws if it does not exist
+     */
+    const Node<TStr>& get_node(NodeRef ref) const
+    {
+        const Adjacency* a = _work.find(ref._internal_id());
+        if (!a)
+            throw std::invalid_argument{"The node does not exist"};
+        return *a->node;
+    }
+
+    std::size_t size() const { return _work.n_nodes; }
+    std::size_t n_edges() const { return _work.n_edges; }
+
+    /**
+     * @brief Make the working version visible to new snapshots and free the versions no snapshot can reach. Returns the version number
+     */
+    std::uint64_t publish()
+    {
+        auto v = std::make_unique<Version>(_work);
+        v->number = ++_number;
+        _current.store(v.get(), std::memory_order_seq_cst);
+        const std::uint64_t retired = _domain.advance();
+        _retired.emplace_back(retired, std::move(_published));
+        _published = std::move(v);
+        _stamp++; // every shard and adjacency of the working version is now shared with a published one
+        reclaim();
+        return _number;
+    }
+
+    /**
+     * @brief Free the retired versions no snapshot can reach. Returns the number of versions still waiting
+     */
+    std::size_t reclaim()
+    {
+        const std::uint64_t safe = _domain.safe_epoch();
+        _retired.erase(std::remove_if(_retired.begin(), _retired.end(), [&](const auto& r) { return r.first < safe; }), _retired.end());
+        return _retired.size();
+    }
+
+    std::uint64_t version() const { return _number; }
+    std::size_t n_retired() const { return _retired.size(); }
+
+protected:
+    std::shared_ptr<Adjacency>& slot(std::size_t id)
+    {
+        const std::size_t s = id >> Version::shard_bits;
+        while (_work.shards.size() <= s) {
+            _work.shards.push_back(std::make_shared<Shard>());
+            _work.shards.back()->stamp = _stamp;
+        }
+        std::shared_ptr<Shard>& shard = _work.shards[s];
+        if (shard->stamp != _stamp) {
+            shard = std::make_shared<Shard>(*shard);
+            shard->stamp = _stamp;
+        }
+        return shard->nodes[id & (Version::shard_size - 1)];
+    }
+
+    Adjacency& mut(std::size_t id)
+    {
+        if (!_work.find(id))
+            throw std::invalid_argument{"The node does not exist"};
+        std::shared_ptr<Adjacency>& a = slot(id);
+        if (a->stamp != _stamp) {
+            a = std::make_shared<Adjacency>(*a);
+            a->stamp = _stamp;
+        }
+        return *a;
+    }
+
+    static void erase_one(std::vector<std::size_t>& ids, std::size_t id)
+    {
+        auto it = std::find(ids.begin(), ids.end(), id);
+        if (it != ids.end()) {
+            *it = ids.back();
+            ids.pop_back();
+        }
+    }
+
+    EpochDomain _domain;
+    std::atomic<const Version*> _current{nullptr};
+    std::unique_ptr<Version> _published;
+    std::vector<std::pair<std::uint64_t, std::unique_ptr<Version>>> _retired;
+    Version _work;
+    std::uint64_t _stamp = 1; // shards and adjacencies with this stamp belong to the working version only
+    std::uint64_t _number = 0;
+};
+
+}
+
+#endif // JSC_SNAPSHOT_H
@@ -0,0 +1,375 @@
+#ifndef JSC_SPATIAL_H
+#define JSC_SPATIAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Static spatial index over the widget bounding boxes of a WidgetTree (packed Hilbert R-tree)
+ *
+ * Boxes are read from a geometry attribute (x, y, width, height, f64). Widgets are sorted by the Hilbert value of their center and packed into nodes of
+ * node_size entries, level by level up to the root, so the tree is a few flat arrays and a query only visits the nodes overlapping it. Widgets without
+ * geometry are not indexed, boxes with a non-positive width or height never match. refresh() updates the changed boxes in place and refits their ancestors,
+ * the tree is rebuilt if widgets were added or too many boxes changed. Coordinates of the queries are in the geometry space
+ */
+class WidgetIndex {
+public:
+    static constexpr std::size_t node_size = 16;
+
+    struct Rect {
+        double x0, y0, x1, y1;
+
+        bool intersects(const Rect& r) const { return x0 <= r.x1 && r.x0 <= x1 && y0 <= r.y1 && r.y0 <= y1; }
+        bool contains(double x, double y) const { return x0 <= x && x <= x1 && y0 <= y && y <= y1; }
+        double dist2(double x, double y) const
+        {
+            double dx = x < x0 ? x0 - x : (x > x1 ? x - x1 : 0), dy = y < y0 ? y0 - y : (y > y1 ? y - y1 : 0);
+            return dx * dx + dy * dy;
+        }
+        void expand(const Rect& r)
+        {
+            x0 = std::min(x0, r.x0);
+            y0 = std::min(y0, r.y0);
+            x1 = std::max(x1, r.x1);
+            y1 = std::max(y1, r.y1);
+        }
+        static Rect empty()
+        {
+            constexpr double inf = std::numeric_limits<double>::infinity();
+            return Rect{inf, inf, -inf, -inf};
+        }
+        static Rect from_geometry(double x, double y, double width, double height)
+        {
+            return width > 0 && height > 0 ? Rect{x, y, x + width, y + height} : empty();
+        }
+    };
+
+    WidgetIndex() : _n_widgets(0) {}
+
+    template <class TStr>
+    explicit WidgetIndex(const WidgetTree<TStr>& tree, const TStr& geometry_key = "geometry") : WidgetIndex() { build(tree, geometry_key); }
+
+    /**
+     * @brief Number of indexed widgets
+     */
+    std::size_t size() const { return _items.size(); }
+    bool empty() const { return _items.empty(); }
+
+    /**
+     * @brief Bounding box of the indexed widgets
+     */
+    Rect bounds() const { return _rects.empty() ? Rect::empty() : _rects.back(); }
+
+    /**
+     * @brief Bulk-load the index from the tree
+     */
+    template <class TStr>
+    void build(const WidgetTree<TStr>& tree, const TStr& geometry_key = "geometry")
+    {
+        const AttrKey key = AttrSet<TStr>::key(geometry_key);
+        _n_widgets = tree.size();
+        _leaf_of.assign(_n_widgets, widget_npos);
+
+        std::vector<std::uint32_t> depth(_n_widgets, 0);
+        std::vector<WidgetIdx> items;
+        std::vector<Rect> rects;
+        for (WidgetIdx i = 0; i < _n_widgets; i++) {
+            // Parents are always stored before their children
+            WidgetIdx p = tree.links(i).parent;
+            depth[i] = p == widget_npos ? 0 : depth[p] + 1;
+            Rect r;
+            if (read_geometry(tree.attrs(i), key, r)) {
+                items.push_back(i);
+                rects.push_back(r);
+            }
+        }
+
+        // Hilbert order of the box centers, empty boxes go last
+        const std::size_t n = items.size();
+        Rect all = Rect::empty();
+        for (const Rect& r : rects)
+            all.expand(r);
+        const double sx = all.x1 > all.x0 ? 65535.0 / (all.x1 - all.x0) : 0, sy = all.y1 > all.y0 ? 65535.0 / (all.y1 - all.y0) : 0;
+        std::vector<std::uint32_t> order(n), hilbert(n);
+        for (std::size_t i = 0; i < n; i++) {
+            const Rect& r = rects[i];
+            hilbert[i] = r.x0 > r.x1 ? std::numeric_limits<std::uint32_t>::max()
+                                     : hilbert_d(static_cast<std::uint32_t>(((r.x0 + r.x1) / 2 - all.x0) * sx), static_cast<std::uint32_t>(((r.y0 + r.y1) / 2 - all.y0) * sy));
+        }
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return hilbert[a] < hilbert[b]; });
+
+        _items.resize(n);
+        _depths.resize(n);
+        _rects.clear();
+        _rects.reserve(n + n / (node_size - 1) + 1);
+        for (std::size_t i = 0; i < n; i++) {
+            _items[i] = items[order[i]];
+            _depths[i] = depth[_items[i]];
+            _leaf_of[_items[i]] = static_cast<WidgetIdx>(i);
+            _rects.push_back(rects[order[i]]);
+        }
+
+        // Upper levels, up to a single root entry
+        _level_start.assign(1, 0);
+        std::size_t begin = 0, end = n;
+        while (end - begin > 1 || _level_start.size() == 1) {
+            _level_start.push_back(end);
+            for (std::size_t c = begin; c < end; c += node_size) {
+                Rect r = Rect::empty();
+                for (std::size_t k = c; k < std::min(end, c + node_size); k++)
+                    r.expand(_rects[k]);
+                _rects.push_back(r);
+            }
+            begin = end;
+            end = _rects.size();
+            if (n == 0)
+                break;
+        }
+        _level_start.push_back(end);
+    }
+
+    /**
+     * @brief Bring the index up to date with the geometry of the tree. Changed boxes are updated in place, the index is rebuilt if the tree has new widgets,
+     * a widget gained a geometry or more than max_changed (a fraction of size()) boxes changed. Returns the number of changed widgets
+     */
+    template <class TStr>
+    std::size_t refresh(const WidgetTree<TStr>& tree, const TStr& geometry_key = "geometry", double max_changed = 0.25)
+    {
+        if (tree.size() != _n_widgets) {
+            build(tree, geometry_key);
+            return tree.size();
+        }
+        const AttrKey key = AttrSet<TStr>::key(geometry_key);
+        std::vector<std::pair<WidgetIdx, Rect>> changed;
+        bool rebuild = false;
+        for (WidgetIdx i = 0; i < _n_widgets; i++) {
+            Rect r;
+            bool has = read_geometry(tree.attrs(i), key, r);
+            WidgetIdx leaf = _leaf_of[i];
+            if (leaf == widget_npos) {
+                if (has) {
+                    rebuild = true;
+                    changed.emplace_back(i, r);
+                }
+            } else {
+                if (!has)
+                    r = Rect::empty();
+                if (!same(_rects[leaf], r))
+                    changed.emplace_back(i, r);
+            }
+        }
+        if (changed.empty())
+            return 0;
+        if (rebuild || static_cast<double>(changed.size()) > max_changed * static_cast<double>(size())) {
+            build(tree, geometry_key);
+            return changed.size();
+        }
+        for (const auto& [w, r] : changed)
+            update(w, r);
+        return changed.size();
+    }
+
+    /**
+     * @brief Set the box of an indexed widget and refit its ancestors. Returns false if the widget is not indexed
+     */
+    bool update(WidgetIdx w, const Rect& r)
+    {
+        if (w >= _leaf_of.size() || _leaf_of[w] == widget_npos)
+            return false;
+        std::size_t pos = _leaf_of[w];
+        _rects[pos] = r;
+        for (std::size_t l = 0; l + 2 < _level_start.size(); l++) {
+            std::size_t first = _level_start[l] + (pos - _level_start[l]) / node_size * node_size;
+            std::size_t last = std::min(_level_start[l + 1], first + node_size);
+            pos = _level_start[l + 1] + (pos - _level_start[l]) / node_size;
+            Rect box = Rect::empty();
+            for (std::size_t k = first; k < last; k++)
+                box.expand(_rects[k]);
+            _rects[pos] = box;
+        }
+        return true;
+    }
+
+    // QUERIES
+    // =======
+
+    /**
+     * @brief Call func(widget) for every widget whose box intersects the rectangle (x, y, width, height)
+     */
+    template <class F>
+    void query(double x, double y, double width, double height, F func) const
+    {
+        const Rect q{x, y, x + width, y + height};
+        visit([&](const Rect& r) { return r.intersects(q); }, [&](std::size_t leaf) { func(_items[leaf]); });
+    }
+
+    /**
+     * @brief Widgets intersecting the rectangle (x, y, width, height), in no particular order
+     */
+    std::vector<WidgetIdx> intersecting(double x, double y, double width, double height) const
+    {
+        std::vector<WidgetIdx> out;
+        query(x, y, width, height, [&](WidgetIdx w) { out.push_back(w); });
+        return out;
+    }
+
+    /**
+     * @brief Widgets whose box contains the point, in no particular order
+     */
+    std::vector<WidgetIdx> at(double x, double y) const
+    {
+        std::vector<WidgetIdx> out;
+        visit([&](const Rect& r) { return r.contains(x, y); }, [&](std::size_t leaf) { out.push_back(_items[leaf]); });
+        return out;
+    }
+
+    /**
+     * @brief Hit test : the deepest widget containing the point, the last one in the storage order among equally deep widgets. widget_npos if there is none
+     */
+    WidgetIdx deepest_at(double x, double y) const
+    {
+        WidgetIdx best = widget_npos;
+        std::uint32_t best_depth = 0;
+        visit([&](const Rect& r) { return r.contains(x, y); }, [&](std::size_t leaf) {
+            WidgetIdx w = _items[leaf];
+            if (best == widget_npos || _depths[leaf] > best_depth || (_depths[leaf] == best_depth && w > best)) {
+                best = w;
+                best_depth = _depths[leaf];
+            }
+        });
+        return best;
+    }
+
+    /**
+     * @brief Up to k widgets closest to the point, by distance to the box (0 inside), closest first. Widgets further than max_dist are ignored
+     */
+    std::vector<WidgetIdx> nearest(double x, double y, std::size_t k, double max_dist = std::numeric_limits<double>::infinity()) const
+    {
+        std::vector<WidgetIdx> out;
+        if (_items.empty() || k == 0)
+            return out;
+        const double max_d2 = max_dist * max_dist;
+        // Best-first search : (squared distance, position, level), level 0 entries are widgets
+        using Entry = std::tuple<double, std::size_t, std::size_t>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        const std::size_t root_level = _level_start.size() - 2, root = _level_start[root_level];
+        heap.emplace(_rects[root].dist2(x, y), root, root_level);
+        while (!heap.empty() && out.size() < k) {
+            auto [d2, pos, level] = heap.top();
+            heap.pop();
+            if (d2 > max_d2)
+                break;
+            if (level == 0) {
+                out.push_back(_items[pos]);
+                continue;
+            }
+            auto [first, last] = children(pos, level);
+            for (std::size_t c = first; c < last; c++)
+                if (_rects[c].x0 <= _rects[c].x1)
+                    heap.emplace(_rects[c].dist2(x, y), c, level - 1);
+        }
+        return out;
+    }
+
+protected:
+    template <class TStr>
+    static bool read_geometry(const AttrSet<TStr>& attrs, AttrKey key, Rect& r)
+    {
+        const AttrValue<TStr>* g = attrs.get(key);
+        if (!g || !g->is_vec_f64() || g->size() < 4)
+            return false;
+        r = Rect::from_geometry(g->at_f64(0), g->at_f64(1), g->at_f64(2), g->at_f64(3));
+        return true;
+    }
+
+    static bool same(const Rect& a, const Rect& b) { return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1; }
+
+    /**
+     * @brief Distance of (x, y) along the Hilbert curve over a 2^16 x 2^16 grid
+     */
+    static std::uint32_t hilbert_d(std::uint32_t x, std::uint32_t y)
+    {
+        constexpr std::uint32_t n = 1u << 16;
+        std::uint32_t d = 0;
+        for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+            std::uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    /**
+     * @brief Range of the entries of level - 1 under the entry pos of level
+     */
+    std::pair<std::size_t, std::size_t> children(std::size_t pos, std::size_t level) const
+    {
+        if (level == 0)
+            return {pos, pos}; // leaves have no children
+        std::size_t first = _level_start[level - 1] + (pos - _level_start[level]) * node_size;
+        return {first, std::min(_level_start[level], first + node_size)};
+    }
+
+    /**
+     * @brief Depth-first walk over the entries with overlaps(rect), calls leaf(position) for the matching widgets
+     */
+    template <class FOverlap, class FLeaf>
+    void visit(FOverlap overlaps, FLeaf leaf) const
+    {
+        if (_items.empty())
+            return;
+        // At most node_size - 1 pending siblings per level, and 8 levels hold 2^32 widgets
+        std::size_t stack_pos[node_size * 8], stack_level[node_size * 8], top = 0;
+        const std::size_t root_level = _level_start.size() - 2;
+        if (!overlaps(_rects[_level_start[root_level]]))
+            return;
+        stack_pos[top] = _level_start[root_level];
+        stack_level[top++] = root_level;
+        while (top) {
+            top--;
+            std::size_t pos = stack_pos[top], level = stack_level[top];
+            if (level == 0) {
+                leaf(pos);
+                continue;
+            }
+            auto [first, last] = children(pos, level);
+            for (std::size_t c = first; c < last; c++) {
+                if (overlaps(_rects[c])) {
+                    stack_pos[top] = c;
+                    stack_level[top++] = level - 1;
+                }
+            }
+        }
+    }
+
+    std::size_t _n_widgets;                // size of the indexed tree
+    std::vector<Rect> _rects;              // leaves in Hilbert order, then each upper level, the root last
+    std::vector<std::size_t> _level_start; // first entry of each level, then the total
+    std::vector<WidgetIdx> _items;         // leaf -> widget
+    std::vector<std::uint32_t> _depths;    // leaf -> depth of the widget
+    std::vector<WidgetIdx> _leaf_of;       // widget -> leaf, widget_npos if not indexed
+};
+
+}
+
+#endif // JSC_SPATIAL_H
@@ -0,0 +1,401 @@
+#ifndef JSC_STATS_H
+#define JSC_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace jsc {
+
+/**
+ * @brief Event counters of the hot paths, compiled in with JSC_STATS
+ */
+enum class Counter : std::uint8_t {
+    SlotMapGrow,     // reallocation of the dense value array of a SlotMap (AdjGraph node storage)
+    SlotMapGrowMoves,// values moved by these reallocations
+    AttrSpill,       // AttrValue::push_* moving a full inline array to a vector
+    DelNode,
+    DelNodeEdges,    // edges removed by del_node, in both directions
+    DelEdge,
+    BacklinkMoves,   // backlinks moved into a hole, which repoints the edge of the moved backlink
+    AtI64Array,      // AttrValue::at_i64 on an inline array
+    AtI64Vector,     // AttrValue::at_i64 on a vector
+    AtF64Array,
+    AtF64Vector,
+    count
+};
+
+/**
+ * @brief Scoped timers of the hot paths, compiled in with JSC_STATS and enabled at runtime with stats_enable_timers()
+ */
+enum class Timer : std::uint8_t {
+    SlotMapGrow,
+    AttrSpill,
+    DelNode,
+    DelEdge,
+    count
+};
+
+constexpr std::size_t n_counters = static_cast<std::size_t>(Counter::count);
+constexpr std::size_t n_timers = static_cast<std::size_t>(Timer::count);
+
+inline const char* counter_name(Counter c)
+{
+    static constexpr const char* names[n_counters] = {"slot_map_grow", "slot_map_grow_moves", "attr_spill", "del_node", "del_node_edges", "del_edge",
+                                                      "backlink_moves", "at_i64_array", "at_i64_vector", "at_f64_array", "at_f64_vector"};
+    return names[static_cast<std::size_t>(c)];
+}
+
+inline const char* timer_name(Timer t)
+{
+    static constexpr const char* names[n_timers] = {"slot_map_grow", "attr_spill", "del_node", "del_edge"};
+    return names[static_cast<std::size_t>(t)];
+}
+
+/**
+ * @brief Totals over all threads, see stats_snapshot()
+ */
+struct StatsSnapshot {
+    bool enabled = false; // false if the library was built without JSC_STATS, every value is then 0
+    std::array<std::uint64_t, n_counters> counters{};
+    std::array<std::uint64_t, n_timers> timer_calls{};
+    std::array<std::uint64_t, n_timers> timer_ns{};
+
+    std::uint64_t counter(Counter c) const { return counters[static_cast<std::size_t>(c)]; }
+    std::uint64_t calls(Timer t) const { return timer_calls[static_cast<std::size_t>(t)]; }
+    std::uint64_t ns(Timer t) const { return timer_ns[static_cast<std::size_t>(t)]; }
+};
+
+constexpr bool stats_enabled()
+{
+#ifdef JSC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef JSC_STATS
+
+/**
+ * @brief Counters of one thread. The owner updates them with relaxed load + store pairs (no read-modify-write), other threads only read them
+ */
+struct ThreadStats {
+    std::array<std::atomic<std::uint64_t>, n_counters> counters{};
+    std::array<std::atomic<std::uint64_t>, n_timers> timer_calls{};
+    std::array<std::atomic<std::uint64_t>, n_timers> timer_ns{};
+
+    ThreadStats();
+    ~ThreadStats();
+
+    static void bump(std::atomic<std::uint64_t>& c, std::uint64_t n) { c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    void add_to(StatsSnapshot& s) const
+    {
+        for (std::size_t i = 0; i < n_counters; i++)
+            s.counters[i] += counters[i].load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < n_timers; i++) {
+            s.timer_calls[i] += timer_calls[i].load(std::memory_order_relaxed);
+            s.timer_ns[i] += timer_ns[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    void clear()
+    {
+        for (auto& c : counters)
+            c.store(0, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < n_timers; i++) {
+            timer_calls[i].store(0, std::memory_order_relaxed);
+            timer_ns[i].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+/**
+ * @brief Live threads and the totals of the finished ones
+ */
+struct StatsRegistry {
+    std::mutex mtx;
+    std::vector<const ThreadStats*> threads;
+    StatsSnapshot finished;
+    std::atomic<bool> timers{false};
+
+    static StatsRegistry& instance()
+    {
+        static StatsRegistry* r = new StatsRegistry(); // never destroyed, thread_local ThreadStats may outlive static objects
+        return *r;
+    }
+};
+
+inline ThreadStats::ThreadStats()
+{
+    StatsRegistry& r = StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    r.threads.push_back(this);
+}
+
+inline ThreadStats::~ThreadStats()
+{
+    StatsRegistry& r = StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    add_to(r.finished);
+    for (std::size_t i = 0; i < r.threads.size(); i++) {
+        if (r.threads[i] == this) {
+            r.threads[i] = r.threads.back();
+            r.threads.pop_back();
+            break;
+        }
+    }
+}
+
+inline ThreadStats& thread_stats()
+{
+    thread_local ThreadStats s;
+    return s;
+}
+
+inline void stats_count(Counter c, std::uint64_t n = 1) { ThreadStats::bump(thread_stats().counters[static_cast<std::size_t>(c)], n); }
+
+/**
+ * @brief Adds the duration of the scope to a Timer if timers are enabled
+ */
+class StatsTimer {
+public:
+    explicit StatsTimer(Timer t) : _t(t), _on(StatsRegistry::instance().timers.load(std::memory_order_relaxed))
+    {
+        if (_on)
+            _start = std::chrono::steady_clock::now();
+    }
+
+    ~StatsTimer()
+    {
+        if (!_on)
+            return;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+        ThreadStats& s = thread_stats();
+        ThreadStats::bump(s.timer_calls[static_cast<std::size_t>(_t)], 1);
+        ThreadStats::bump(s.timer_ns[static_cast<std::size_t>(_t)], static_cast<std::uint64_t>(ns));
+    }
+
+    StatsTimer(const StatsTimer&) = delete;
+    StatsTimer& operator=(const StatsTimer&) = delete;
+
+protected:
+    Timer _t;
+    bool _on;
+    std::chrono::steady_clock::time_point _start;
+};
+
+#define JSC_STAT_CONCAT_(a, b) a##b
+#define JSC_STAT_CONCAT(a, b) JSC_STAT_CONCAT_(a, b)
+#define JSC_STAT_COUNT(name) ::jsc::stats_count(::jsc::Counter::name)
+#define JSC_STAT_ADD(name, n) ::jsc::stats_count(::jsc::Counter::name, static_cast<std::uint64_t>(n))
+#define JSC_STAT_TIMER(name) ::jsc::StatsTimer JSC_STAT_CONCAT(jsc_stat_timer_, __LINE__)(::jsc::Timer::name)
+#define JSC_TRACE_SCOPE(name) ::jsc::TraceScope JSC_STAT_CONCAT(jsc_trace_scope_, __LINE__)(name)
+
+#else
+
+#define JSC_STAT_COUNT(name) ((void)0)
+#define JSC_STAT_ADD(name, n) ((void)0)
+#define JSC_STAT_TIMER(name) ((void)0)
+#define JSC_TRACE_SCOPE(name) ((void)0)
+
+#endif // JSC_STATS
+
+/**
+ * @brief Sum the counters and timers of every thread, including the finished ones. Values written concurrently may be missed by a few increments
+ */
+inline StatsSnapshot stats_snapshot()
+{
+    StatsSnapshot s;
+#ifdef JSC_STATS
+    s.enabled = true;
+    StatsRegistry& r = StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    s.counters = r.finished.counters;
+    s.timer_calls = r.finished.timer_calls;
+    s.timer_ns = r.finished.timer_ns;
+    for (const ThreadStats* t : r.threads)
+        t->add_to(s);
+#endif
+    return s;
+}
+
+/**
+ * @brief Set every counter and timer to 0. Increments made concurrently by other threads may survive
+ */
+inline void stats_reset()
+{
+#ifdef JSC_STATS
+    StatsRegistry& r = StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    r.finished = StatsSnapshot{};
+    for (const ThreadStats* t : r.threads)
+        const_cast<ThreadStats*>(t)->clear();
+#endif
+}
+
+/**
+ * @brief Turn the scoped timers on or off (off by default). Without JSC_STATS, does nothing
+ */
+inline void stats_enable_timers([[maybe_unused]] bool on)
+{
+#ifdef JSC_STATS
+    StatsRegistry::instance().timers.store(on, std::memory_order_relaxed);
+#endif
+}
+
+
+/**
+ * @brief Recorder of Chrome trace events (chrome://tracing, Perfetto)
+ *
+ * Between start() and stop(), every TraceScope adds a complete event with its thread. write() saves the trace as JSON along with a final counter
+ * event holding stats_snapshot(). Meant for coarse scopes (an ingestion run, a build phase) : each event takes a lock
+ */
+class Tracer {
+public:
+    struct Event {
+        std::string name;
+        std::uint64_t ts_us;
+        std::uint64_t dur_us;
+        std::uint32_t tid;
+    };
+
+    static Tracer& instance()
+    {
+        static Tracer* t = new Tracer(); // never destroyed, like StatsRegistry
+        return *t;
+    }
+
+    /**
+     * @brief Drop the previous events and start recording
+     */
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _events.clear();
+        _active.store(true, std::memory_order_release);
+    }
+
+    void stop() { _active.store(false, std::memory_order_release); }
+
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+
+    std::size_t n_events()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _events.size();
+    }
+
+    void record(std::string name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+    {
+        Event e{std::move(name), micros(begin), micros(end) - micros(begin), thread_index()};
+        std::lock_guard<std::mutex> lock(_mtx);
+        _events.push_back(std::move(e));
+    }
+
+    /**
+     * @brief Write the events in the Chrome trace format. Returns false if the file cannot be written
+     */
+    bool write(const std::string& path)
+    {
+        std::ofstream out(path);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        std::lock_guard<std::mutex> lock(_mtx);
+        bool first = true;
+        for (const Event& e : _events) {
+            out << (first ? "\n" : ",\n") << "{\"name\": \"" << escape(e.name) << "\", \"cat\": \"jsc\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.tid
+                << ", \"ts\": " << e.ts_us << ", \"dur\": " << e.dur_us << "}";
+            first = false;
+        }
+        const StatsSnapshot s = stats_snapshot();
+        if (s.enabled) {
+            const std::uint64_t ts = micros(std::chrono::steady_clock::now());
+            out << (first ? "\n" : ",\n") << "{\"name\": \"jsc_stats\", \"ph\": \"C\", \"pid\": 1, \"tid\": 0, \"ts\": " << ts << ", \"args\": {";
+            for (std::size_t i = 0; i < n_counters; i++)
+                out << (i ? ", " : "") << "\"" << counter_name(static_cast<Counter>(i)) << "\": " << s.counters[i];
+            out << "}}";
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+protected:
+    Tracer() : _origin(std::chrono::steady_clock::now()) {}
+
+    std::uint64_t micros(std::chrono::steady_clock::time_point t) const
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(t - _origin).count());
+    }
+
+    static std::uint32_t thread_index()
+    {
+        static std::atomic<std::uint32_t> next{1};
+        thread_local std::uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    static std::string escape(const std::string& s)
+    {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                out += c;
+        }
+        return out;
+    }
+
+    std::mutex _mtx;
+    std::vector<Event> _events;
+    std::atomic<bool> _active{false};
+    std::chrono::steady_clock::time_point _origin;
+};
+
+/**
+ * @brief Records its lifetime as a Chrome trace event while the Tracer is active. Costs one atomic load otherwise
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _on(Tracer::instance().active())
+    {
+        if (_on) {
+            _name = name;
+            _begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    explicit TraceScope(std::string name) : _on(Tracer::instance().active())
+    {
+        if (_on) {
+            _name = std::move(name);
+            _begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (_on)
+            Tracer::instance().record(std::move(_name), _begin, std::chrono::steady_clock::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+protected:
+    bool _on;
+    std::string _name;
+    std::chrono::steady_clock::time_point _begin;
+};
+
+}
+
+#endif // JSC_STATS_H
@@ -0,0 +1,563 @@
+#ifndef JSC_TEXT_INDEX_H
+#define JSC_TEXT_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Split text into lowercase tokens : runs of ASCII letters and digits, bytes of multi-byte UTF-8 characters are kept as letters. Calls func(token)
+ */
+template <class F>
+void text_tokenize(std::string_view text, F func)
+{
+    std::string token;
+    for (char ch : text) {
+        auto c = static_cast<unsigned char>(ch);
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) {
+            token.push_back(ch);
+        } else if (c >= 'A' && c <= 'Z') {
+            token.push_back(static_cast<char>(c - 'A' + 'a'));
+        } else if (!token.empty()) {
+            func(std::string_view(token));
+            token.clear();
+        }
+    }
+    if (!token.empty())
+        func(std::string_view(token));
+}
+
+
+/**
+ * @brief Append-only posting list of (doc, term frequency) with increasing docs, compressed as varint doc gaps and frequencies in blocks of 128
+ *
+ * Each block records the doc before it and its last doc, so that a cursor skips whole blocks without decoding them
+ */
+class PostingList {
+public:
+    static constexpr std::size_t block_size = 128;
+
+    struct Block {
+        std::uint32_t base;   // doc before the block, the first gap is relative to it
+        std::uint32_t last;   // last doc of the block
+        std::uint32_t offset; // byte offset of the block
+    };
+
+    void push_back(std::uint32_t doc, std::uint32_t tf, std::uint32_t doc_len)
+    {
+        if (_count % block_size == 0)
+            _blocks.push_back(Block{_last, doc, static_cast<std::uint32_t>(_bytes.size())});
+        put_varint(doc - _last);
+        put_varint(tf);
+        _blocks.back().last = _last = doc;
+        _count++;
+        _max_tf = std::max(_max_tf, tf);
+        _min_len = std::min(_min_len, doc_len);
+    }
+
+    std::size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    std::uint32_t max_tf() const { return _max_tf; }
+    std::uint32_t min_len() const { return _min_len; }
+    std::size_t memory_usage() const { return _bytes.size() + _blocks.size() * sizeof(Block); }
+
+    /**
+     * @brief Forward iterator over a posting list with block skipping
+     */
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& list) : _list(&list) { load(0); }
+
+        bool end() const { return _end; }
+        std::uint32_t doc() const { return _doc; }
+        std::uint32_t tf() const { return _tf; }
+
+        void next()
+        {
+            if (_left == 0) {
+                load(_block + 1);
+                return;
+            }
+            decode();
+        }
+
+        /**
+         * @brief Move to the first doc >= target
+         */
+        void seek(std::uint32_t target)
+        {
+            if (_end || _doc >= target)
+                return;
+            std::size_t b = _block;
+            while (b + 1 < _list->_blocks.size() && _list->_blocks[b].last < target)
+                b++;
+            if (b != _block)
+                load(b);
+            while (!_end && _doc < target)
+                next();
+        }
+
+    protected:
+        void load(std::size_t b)
+        {
+            _block = b;
+            if (b >= _list->_blocks.size()) {
+                _end = true;
+                return;
+            }
+            _p = _list->_bytes.data() + _list->_blocks[b].offset;
+            _doc = _list->_blocks[b].base;
+            _left = std::min(block_size, _list->_count - b * block_size);
+            decode();
+        }
+
+        void decode()
+        {
+            _doc += get_varint(_p);
+            _tf = get_varint(_p);
+            _left--;
+        }
+
+        const PostingList* _list;
+        const std::uint8_t* _p = nullptr;
+        std::size_t _block = 0, _left = 0;
+        std::uint32_t _doc = 0, _tf = 0;
+        bool _end = false;
+    };
+
+protected:
+    void put_varint(std::uint32_t v)
+    {
+        while (v >= 0x80) {
+            _bytes.push_back(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        _bytes.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    static std::uint32_t get_varint(const std::uint8_t*& p)
+    {
+        std::uint32_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            std::uint8_t byte = *p++;
+            v |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return v;
+        }
+    }
+
+    std::vector<std::uint8_t> _bytes;
+    std::vector<Block> _blocks;
+    std::size_t _count = 0;
+    std::uint32_t _last = 0, _max_tf = 0, _min_len = std::numeric_limits<std::uint32_t>::max();
+};
+
+
+/**
+ * @brief Options of TextIndex
+ */
+struct TextIndexOptions {
+    std::vector<std::string> keys = {"name"}; // string attributes of the widgets to index
+    bool widget_names = true;                 // also index Widget::name()
+    double k1 = 1.2, b = 0.75;                // BM25 parameters
+};
+
+/**
+ * @brief Result of a TextIndex search
+ */
+struct TextHit {
+    NodeRef node;
+    WidgetIdx widget = widget_npos;
+    double score = 0;
+};
+
+
+/**
+ * @brief Inverted index over the widget texts of an AdjGraph with BM25 ranking
+ *
+ * Every widget with some text is a document : the tokens of its name and of the indexed string attributes. Posting lists are compressed (see
+ * PostingList) and only grow, a node added later gets larger doc ids. remove_node() tombstones the docs of the node and updates the statistics at once,
+ * the postings are rewritten without them once the tombstones outnumber the live docs. search() returns the top k with WAND : documents are visited in
+ * doc order and the ones whose terms cannot reach the k-th score with their BM25 upper bounds are skipped along with whole posting blocks.
+ * search_exhaustive() scores every matching doc and gives the same result
+ */
+template <class TStr = std::string>
+class TextIndex {
+public:
+    explicit TextIndex(TextIndexOptions opts = {}) : _opts(std::move(opts))
+    {
+        for (const auto& k : _opts.keys)
+            _keys.push_back(AttrSet<TStr>::key(TStr(k.data(), k.size())));
+    }
+
+    /**
+     * @brief Index every node of the graph, dropping the previous content. Returns the number of docs
+     */
+    std::size_t build(const AdjGraph<TStr>& g)
+    {
+        *this = TextIndex(std::move(_opts));
+        std::size_t n = 0;
+        g.each([&](const typename AdjGraph<TStr>::NodeData& nd) { n += add_node(nd.node); });
+        return n;
+    }
+
+    /**
+     * @brief Index the widgets of a node, replacing its previous docs. Returns the number of docs
+     */
+    std::size_t add_node(const Node<TStr>& node)
+    {
+        remove_node(NodeRef(node));
+        const WidgetTree<TStr>& tree = node.widget_tree();
+        const std::uint32_t first = static_cast<std::uint32_t>(_doc_node.size());
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> tfs; // (term, tf)
+
+        for (WidgetIdx w = 0; w < tree.size(); w++) {
+            tfs.clear();
+            std::uint32_t len = 0;
+            auto add_text = [&](const TStr& text) {
+                text_tokenize(std::string_view(text.data(), text.size()), [&](std::string_view token) {
+                    tfs.emplace_back(term_id(token), 1);
+                    len++;
+                });
+            };
+            if (_opts.widget_names)
+                add_text(tree.name(w));
+            for (AttrKey key : _keys) {
+                const AttrValue<TStr>* v = tree.attrs(w).get(key);
+                if (v && v->is_str() && !(_opts.widget_names && v->str() == tree.name(w))) // e.g. the AX name of WebUI widgets
+                    add_text(v->str());
+            }
+            if (tfs.empty())
+                continue;
+            if (_doc_node.size() >= std::numeric_limits<std::uint32_t>::max()) [[unlikely]]
+                throw std::length_error{"TextIndex : too many documents"};
+
+            // Merge the duplicate terms
+            std::sort(tfs.begin(), tfs.end());
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < tfs.size(); i++) {
+                if (n && tfs[n - 1].first == tfs[i].first)
+                    tfs[n - 1].second++;
+                else
+                    tfs[n++] = tfs[i];
+            }
+            tfs.resize(n);
+
+            const std::uint32_t doc = static_cast<std::uint32_t>(_doc_node.size());
+            for (auto [term, tf] : tfs) {
+                _postings[term].push_back(doc, tf, len);
+                _df[term]++;
+                _doc_terms.push_back(term);
+            }
+            _doc_node.push_back(node._internal_id());
+            _doc_widget.push_back(w);
+            _doc_len.push_back(len);
+            _deleted.push_back(0);
+            _doc_terms_end.push_back(_doc_terms.size());
+            _n_live++;
+            _total_len += len;
+        }
+
+        const std::uint32_t count = static_cast<std::uint32_t>(_doc_node.size()) - first;
+        if (count)
+            _by_node.emplace(node._internal_id(), std::make_pair(first, count));
+        return count;
+    }
+
+    /**
+     * @brief Drop the docs of a node. Returns false if it had none
+     */
+    bool remove_node(const NodeRef& node)
+    {
+        auto it = _by_node.find(node._internal_id());
+        if (it == _by_node.end())
+            return false;
+        auto [first, count] = it->second;
+        for (std::uint32_t doc = first; doc < first + count; doc++) {
+            _deleted[doc] = 1;
+            for (std::size_t i = doc ? _doc_terms_end[doc - 1] : 0; i < _doc_terms_end[doc]; i++)
+                _df[_doc_terms[i]]--;
+            _n_live--;
+            _total_len -= _doc_len[doc];
+        }
+        _by_node.erase(it);
+        _n_deleted += count;
+        if (_n_deleted > 64 && _n_deleted > _n_live)
+            compact();
+        return true;
+    }
+
+    /**
+     * @brief Top k widgets for the query by BM25, best first (ties by insertion order), using WAND
+     */
+    std::vector<TextHit> search(std::string_view query, std::size_t k) const
+    {
+        std::vector<Term> terms = query_terms(query);
+        TopK top(k);
+        if (terms.empty() || k == 0)
+            return hits(top);
+
+        std::vector<Term*> order; // by current doc
+        for (Term& t : terms)
+            order.push_back(&t);
+        auto by_doc = [](const Term* a, const Term* b) { return a->cursor.doc() < b->cursor.doc(); };
+
+        while (true) {
+            order.erase(std::remove_if(order.begin(), order.end(), [](const Term* t) { return t->cursor.end(); }), order.end());
+            if (order.empty())
+                break;
+            std::sort(order.begin(), order.end(), by_doc);
+
+            // Pivot : first term where the bounds of the terms up to it can beat the k-th score
+            const double threshold = top.threshold();
+            double bound = 0;
+            std::size_t pivot = order.size();
+            for (std::size_t i = 0; i < order.size(); i++) {
+                bound += order[i]->bound;
+                if (bound > threshold) {
+                    pivot = i;
+                    break;
+                }
+            }
+            if (pivot == order.size())
+                break;
+
+            const std::uint32_t doc = order[pivot]->cursor.doc();
+            if (order.front()->cursor.doc() == doc) {
+                if (!_deleted[doc])
+                    top.push(score(terms, doc), doc);
+                for (Term* t : order)
+                    if (t->cursor.doc() == doc)
+                        t->cursor.next();
+            } else {
+                for (std::size_t i = 0; i < pivot; i++)
+                    order[i]->cursor.seek(doc);
+            }
+        }
+        return hits(top);
+    }
+
+    /**
+     * @brief Same result as search(), scoring every doc which contains a query term
+     */
+    std::vector<TextHit> search_exhaustive(std::string_view query, std::size_t k) const
+    {
+        std::vector<Term> terms = query_terms(query);
+        if (terms.empty() || k == 0)
+            return {};
+
+        std::vector<std::uint32_t> docs;
+        for (Term& t : terms)
+            for (PostingList::Cursor c(*t.list); !c.end(); c.next())
+                docs.push_back(c.doc());
+        std::sort(docs.begin(), docs.end());
+        docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+
+        TopK top(k);
+        for (std::uint32_t doc : docs) {
+            if (_deleted[doc])
+                continue;
+            for (Term& t : terms)
+                t.cursor.seek(doc);
+            top.push(score(terms, doc), doc);
+        }
+        return hits(top);
+    }
+
+    /**
+     * @brief Rewrite the posting lists and the docs without the tombstones
+     */
+    void compact()
+    {
+        std::vector<std::uint32_t> remap(_doc_node.size(), std::numeric_limits<std::uint32_t>::max());
+        std::uint32_t n = 0;
+        for (std::uint32_t doc = 0; doc < _doc_node.size(); doc++)
+            if (!_deleted[doc])
+                remap[doc] = n++;
+
+        for (PostingList& list : _postings) {
+            PostingList fresh;
+            for (PostingList::Cursor c(list); !c.end(); c.next())
+                if (remap[c.doc()] != std::numeric_limits<std::uint32_t>::max())
+                    fresh.push_back(remap[c.doc()], c.tf(), _doc_len[c.doc()]);
+            list = std::move(fresh);
+        }
+
+        std::vector<std::uint32_t> terms;
+        std::vector<std::size_t> terms_end;
+        std::size_t start = 0;
+        for (std::uint32_t doc = 0; doc < _doc_node.size(); doc++) {
+            const std::size_t end = _doc_terms_end[doc];
+            if (!_deleted[doc]) {
+                std::uint32_t to = remap[doc];
+                _doc_node[to] = _doc_node[doc];
+                _doc_widget[to] = _doc_widget[doc];
+                _doc_len[to] = _doc_len[doc];
+                terms.insert(terms.end(), _doc_terms.begin() + start, _doc_terms.begin() + end);
+                terms_end.push_back(terms.size());
+            }
+            start = end;
+        }
+        _doc_node.resize(n);
+        _doc_widget.resize(n);
+        _doc_len.resize(n);
+        _deleted.assign(n, 0);
+        _doc_terms.swap(terms);
+        _doc_terms_end.swap(terms_end);
+        for (auto& [node, range] : _by_node)
+            range.first = remap[range.first];
+        _n_deleted = 0;
+    }
+
+    std::size_t n_docs() const { return _n_live; }
+    std::size_t n_terms() const { return _term_ids.size(); }
+    std::size_t n_deleted() const { return _n_deleted; }
+
+    /**
+     * @brief Bytes used by the posting lists
+     */
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = 0;
+        for (const PostingList& list : _postings)
+            bytes += list.memory_usage();
+        return bytes;
+    }
+
+protected:
+    struct Term {
+        const PostingList* list;
+        PostingList::Cursor cursor;
+        double idf;
+        double bound; // BM25 upper bound of the term in any doc
+    };
+
+    // Min-heap of the k best (score, doc), worse = lower score, then later doc
+    class TopK {
+    public:
+        explicit TopK(std::size_t k) : _k(k) {}
+
+        double threshold() const { return _heap.size() < _k ? 0.0 : _heap.top().first; }
+
+        void push(double score, std::uint32_t doc)
+        {
+            if (_heap.size() < _k) {
+                _heap.emplace(score, doc);
+            } else if (score > _heap.top().first) {
+                _heap.pop();
+                _heap.emplace(score, doc);
+            }
+        }
+
+        std::vector<std::pair<double, std::uint32_t>> sorted()
+        {
+            std::vector<std::pair<double, std::uint32_t>> out;
+            for (; !_heap.empty(); _heap.pop())
+                out.push_back(_heap.top());
+            std::reverse(out.begin(), out.end());
+            return out;
+        }
+
+    protected:
+        struct Worse {
+            bool operator()(const std::pair<double, std::uint32_t>& a, const std::pair<double, std::uint32_t>& b) const
+            {
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            }
+        };
+        std::size_t _k;
+        std::priority_queue<std::pair<double, std::uint32_t>, std::vector<std::pair<double, std::uint32_t>>, Worse> _heap;
+    };
+
+    std::uint32_t term_id(std::string_view token)
+    {
+        auto [it, inserted] = _term_ids.emplace(std::string(token), static_cast<std::uint32_t>(_postings.size()));
+        if (inserted) {
+            _postings.emplace_back();
+            _df.push_back(0);
+        }
+        return it->second;
+    }
+
+    double avg_len() const { return _n_live ? static_cast<double>(_total_len) / static_cast<double>(_n_live) : 1.0; }
+
+    double bm25(double idf, std::uint32_t tf, std::uint32_t len) const
+    {
+        const double f = static_cast<double>(tf);
+        return idf * f * (_opts.k1 + 1.0) / (f + _opts.k1 * (1.0 - _opts.b + _opts.b * static_cast<double>(len) / avg_len()));
+    }
+
+    std::vector<Term> query_terms(std::string_view query) const
+    {
+        std::vector<std::uint32_t> ids;
+        text_tokenize(query, [&](std::string_view token) {
+            auto it = _term_ids.find(std::string(token));
+            if (it != _term_ids.end() && _df[it->second] > 0)
+                ids.push_back(it->second);
+        });
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        std::vector<Term> terms;
+        const double n = static_cast<double>(_n_live);
+        for (std::uint32_t id : ids) {
+            const PostingList& list = _postings[id];
+            const double df = static_cast<double>(_df[id]);
+            const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+            terms.push_back(Term{&list, PostingList::Cursor(list), idf, bm25(idf, list.max_tf(), list.min_len())});
+        }
+        return terms;
+    }
+
+    // Sum over the terms in query order, so that both searches add the same numbers in the same order
+    double score(const std::vector<Term>& terms, std::uint32_t doc) const
+    {
+        double s = 0;
+        for (const Term& t : terms)
+            if (!t.cursor.end() && t.cursor.doc() == doc)
+                s += bm25(t.idf, t.cursor.tf(), _doc_len[doc]);
+        return s;
+    }
+
+    std::vector<TextHit> hits(TopK& top) const
+    {
+        std::vector<TextHit> out;
+        for (auto [score, doc] : top.sorted())
+            out.push_back(TextHit{NodeRef(_doc_node[doc]), _doc_widget[doc], score});
+        return out;
+    }
+
+    TextIndexOptions _opts;
+    std::vector<AttrKey> _keys;
+
+    std::unordered_map<std::string, std::uint32_t> _term_ids;
+    std::vector<PostingList> _postings;
+    std::vector<std::uint32_t> _df; // live docs per term
+
+    std::vector<std::size_t> _doc_node;
+    std::vector<WidgetIdx> _doc_widget;
+    std::vector<std::uint32_t> _doc_len;
+    std::vector<std::uint8_t> _deleted;
+    std::vector<std::uint32_t> _doc_terms;    // distinct terms of each doc
+    std::vector<std::size_t> _doc_terms_end;  // end of the terms of each doc in _doc_terms
+    std::unordered_map<std::size_t, std::pair<std::uint32_t, std::uint32_t>> _by_node; // node id -> (first doc, count)
+
+    std::size_t _n_live = 0, _n_deleted = 0, _total_len = 0;
+};
+
+}
+
+#endif // JSC_TEXT_INDEX_H
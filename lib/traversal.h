@@ -0,0 +1,259 @@
+#ifndef JSC_TRAVERSAL_H
+#define JSC_TRAVERSAL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "csr.h"
+#include "graph.h"
+#include "parallel.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Edge direction followed by a traversal : hyperlinks, backlinks or both
+ */
+enum class Direction : std::uint8_t {
+    Out = 1,
+    In = 2,
+    Both = 3,
+};
+
+/**
+ * @brief Options of bfs()
+ */
+struct BfsOptions {
+    static constexpr std::uint32_t unlimited = std::numeric_limits<std::uint32_t>::max();
+
+    Direction direction = Direction::Out;
+    std::uint32_t max_hops = unlimited; // nodes further than max_hops from every seed are not reached
+    std::size_t n_threads = 0;          // 0 = all cores
+    double alpha = 15.0;                // switch to bottom-up when the frontier has more than 1/alpha of the unexplored edges
+    double beta = 18.0;                 // switch back to top-down when the frontier has less than 1/beta of the nodes
+};
+
+/**
+ * @brief Result of bfs(), indexed by the CsrGraph node index
+ */
+struct BfsResult {
+    using index_type = std::uint32_t;
+    static constexpr std::uint32_t unreached = std::numeric_limits<std::uint32_t>::max();
+    static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+    std::vector<std::uint32_t> distance; // hops from the closest seed, unreached if not reached
+    std::vector<index_type> parent;      // node the BFS came from, the node itself for seeds, npos if not reached
+    std::uint32_t n_levels = 0;
+    std::uint32_t n_bottom_up = 0;       // levels expanded bottom-up
+    std::size_t n_reached = 0;
+
+    bool reached(index_type u) const { return distance[u] != unreached; }
+};
+
+/**
+ * @brief Edge filter which accepts every edge
+ */
+struct AllEdges {
+    bool operator()(std::size_t) const { return true; }
+};
+
+
+/**
+ * @brief Multi-source direction-optimizing breadth-first search over a CsrGraph snapshot
+ *
+ * Levels are expanded top-down (the frontier is a queue, every frontier node claims its unvisited neighbors with a CAS) while the frontier is small, and
+ * bottom-up (the frontier is a bitmap, every unvisited node looks for a parent in it and stops at the first one) when the frontier edges outnumber the
+ * unexplored ones, see Beamer et al., "Direction-Optimizing Breadth-First Search". Both steps run on n_threads threads. filter(e) is called with the CSR edge
+ * index (see CsrGraph::edge_attrs()) in both directions and rejected edges are not followed. Parents depend on the thread schedule, distances do not
+ */
+template <class TStr, class FFilter = AllEdges>
+BfsResult bfs(const CsrGraph<TStr>& g, const std::vector<typename CsrGraph<TStr>::index_type>& seeds, const BfsOptions& opts = {}, FFilter filter = {})
+{
+    using index_type = typename CsrGraph<TStr>::index_type;
+    constexpr index_type npos = BfsResult::npos;
+    const std::size_t n = g.n_nodes(), n_words = (n + 63) / 64;
+    const bool follow_out = static_cast<std::uint8_t>(opts.direction) & static_cast<std::uint8_t>(Direction::Out);
+    const bool follow_in = static_cast<std::uint8_t>(opts.direction) & static_cast<std::uint8_t>(Direction::In);
+    const std::size_t n_threads = opts.n_threads ? opts.n_threads : default_threads();
+
+    // Edges followed from u : func(v, e), stops when func returns true
+    auto expand = [&](index_type u, bool forward, auto&& func) {
+        if (forward ? follow_out : follow_in) {
+            for (std::size_t e = g.out_offset(u), end = e + g.out_degree(u); e < end; e++)
+                if (filter(e) && func(g.edge_target(e), e))
+                    return;
+        }
+        if (forward ? follow_in : follow_out) {
+            auto sources = g.backlinks(u);
+            auto edges = g.in_edges(u);
+            for (std::size_t i = 0; i < sources.size(); i++)
+                if (filter(edges[i]) && func(sources[i], edges[i]))
+                    return;
+        }
+    };
+    auto degree = [&](index_type u) { return (follow_out ? g.out_degree(u) : 0) + (follow_in ? g.in_degree(u) : 0); };
+
+    BfsResult res;
+    res.distance.assign(n, BfsResult::unreached);
+    std::unique_ptr<std::atomic<index_type>[]> parent(new std::atomic<index_type>[n]);
+    parallel_for(n, [&](std::size_t u) { parent[u].store(npos, std::memory_order_relaxed); }, n_threads);
+
+    std::vector<index_type> queue;
+    std::size_t scout = 0; // edges out of the frontier
+    for (index_type s : seeds) {
+        if (s >= n) [[unlikely]]
+            throw std::out_of_range{"bfs : the seed is not in the graph"};
+        if (parent[s].load(std::memory_order_relaxed) != npos)
+            continue;
+        parent[s].store(s, std::memory_order_relaxed);
+        res.distance[s] = 0;
+        queue.push_back(s);
+        scout += degree(s);
+    }
+    res.n_reached = queue.size();
+
+    std::size_t unexplored = (follow_out ? g.n_edges() : 0) + (follow_in ? g.n_edges() : 0);
+    std::size_t n_front = queue.size();
+    std::vector<std::uint64_t> front, next;
+    std::vector<std::vector<index_type>> locals(n_threads);
+    bool bottom_up = false;
+    std::uint32_t level = 0;
+
+    while (n_front > 0 && level < opts.max_hops) {
+        // Direction switch
+        if (!bottom_up && static_cast<double>(scout) > static_cast<double>(unexplored) / opts.alpha) {
+            front.assign(n_words, 0);
+            for (index_type u : queue)
+                front[u / 64] |= std::uint64_t(1) << (u % 64);
+            bottom_up = true;
+        } else if (bottom_up && static_cast<double>(n_front) < static_cast<double>(n) / opts.beta) {
+            queue.clear();
+            for (std::size_t w = 0; w < n_words; w++)
+                for (std::uint64_t bits = front[w]; bits; bits &= bits - 1)
+                    queue.push_back(static_cast<index_type>(w * 64 + __builtin_ctzll(bits)));
+            bottom_up = false;
+        }
+        unexplored -= std::min(unexplored, scout);
+        const std::uint32_t d = level + 1;
+        std::atomic<std::size_t> n_next(0), next_scout(0);
+
+        if (bottom_up) {
+            // Threads own whole words of the next bitmap, each node is only written by its owner
+            next.assign(n_words, 0);
+            parallel_chunks(n_words, [&](std::size_t begin, std::size_t end, std::size_t) {
+                std::size_t found = 0, found_scout = 0;
+                for (std::size_t w = begin; w < end; w++) {
+                    for (std::size_t v = w * 64; v < std::min(n, w * 64 + 64); v++) {
+                        if (parent[v].load(std::memory_order_relaxed) != npos)
+                            continue;
+                        expand(static_cast<index_type>(v), false, [&](index_type u, std::size_t) {
+                            if (!(front[u / 64] >> (u % 64) & 1))
+                                return false;
+                            parent[v].store(u, std::memory_order_relaxed);
+                            res.distance[v] = d;
+                            next[w] |= std::uint64_t(1) << (v % 64);
+                            found++;
+                            found_scout += degree(static_cast<index_type>(v));
+                            return true;
+                        });
+                    }
+                }
+                n_next.fetch_add(found, std::memory_order_relaxed);
+                next_scout.fetch_add(found_scout, std::memory_order_relaxed);
+            }, n_threads, 64);
+            front.swap(next);
+            res.n_bottom_up++;
+        } else {
+            parallel_chunks(queue.size(), [&](std::size_t begin, std::size_t end, std::size_t t) {
+                std::vector<index_type>& local = locals[t];
+                local.clear();
+                std::size_t found_scout = 0;
+                for (std::size_t i = begin; i < end; i++) {
+                    index_type u = queue[i];
+                    expand(u, true, [&](index_type v, std::size_t) {
+                        index_type expected = npos;
+                        if (parent[v].load(std::memory_order_relaxed) == npos &&
+                            parent[v].compare_exchange_strong(expected, u, std::memory_order_relaxed)) {
+                            res.distance[v] = d;
+                            local.push_back(v);
+                            found_scout += degree(v);
+                        }
+                        return false;
+                    });
+                }
+                next_scout.fetch_add(found_scout, std::memory_order_relaxed);
+            }, n_threads, 64);
+
+            queue.clear();
+            for (auto& local : locals) {
+                queue.insert(queue.end(), local.begin(), local.end());
+                local.clear();
+            }
+            n_next.store(queue.size(), std::memory_order_relaxed);
+        }
+
+        n_front = n_next.load(std::memory_order_relaxed);
+        scout = next_scout.load(std::memory_order_relaxed);
+        res.n_reached += n_front;
+        level++;
+    }
+
+    res.n_levels = level;
+    res.parent.resize(n);
+    parallel_for(n, [&](std::size_t u) { res.parent[u] = parent[u].load(std::memory_order_relaxed); }, n_threads);
+    return res;
+}
+
+/**
+ * @brief Nodes within k hops of the seeds, ordered by distance then by index
+ */
+template <class TStr, class FFilter = AllEdges>
+std::vector<typename CsrGraph<TStr>::index_type> k_hop(const CsrGraph<TStr>& g, const std::vector<typename CsrGraph<TStr>::index_type>& seeds, std::uint32_t k,
+                                                       Direction direction = Direction::Both, std::size_t n_threads = 0, FFilter filter = {})
+{
+    BfsOptions opts;
+    opts.direction = direction;
+    opts.max_hops = k;
+    opts.n_threads = n_threads;
+    BfsResult res = bfs(g, seeds, opts, filter);
+
+    // Counting sort by distance
+    std::vector<std::size_t> offsets(static_cast<std::size_t>(res.n_levels) + 2, 0);
+    for (std::uint32_t d : res.distance)
+        if (d != BfsResult::unreached)
+            offsets[d + 1]++;
+    for (std::size_t d = 1; d < offsets.size(); d++)
+        offsets[d] += offsets[d - 1];
+    std::vector<typename CsrGraph<TStr>::index_type> out(res.n_reached);
+    for (std::size_t u = 0; u < res.distance.size(); u++)
+        if (res.distance[u] != BfsResult::unreached)
+            out[offsets[res.distance[u]]++] = static_cast<typename CsrGraph<TStr>::index_type>(u);
+    return out;
+}
+
+/**
+ * @brief Nodes of an AdjGraph within k hops of the seeds. Freezes the graph first, use the CsrGraph overload for repeated queries
+ */
+template <class TStr>
+std::vector<NodeRef> k_hop(const AdjGraph<TStr>& g, const std::vector<NodeRef>& seeds, std::uint32_t k, Direction direction = Direction::Both,
+                           std::size_t n_threads = 0)
+{
+    CsrGraph<TStr> csr(g, n_threads);
+    std::vector<typename CsrGraph<TStr>::index_type> idx;
+    idx.reserve(seeds.size());
+    for (const NodeRef& s : seeds)
+        idx.push_back(csr.index_of(s));
+    std::vector<NodeRef> out;
+    for (auto u : k_hop(csr, idx, k, direction, n_threads))
+        out.push_back(csr.node_ref(u));
+    return out;
+}
+
+}
+
+#endif // JSC_TRAVERSAL_H
@@ -0,0 +1,412 @@
+#ifndef JSC_WEBUI_H
+#define JSC_WEBUI_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "graph.h"
+#include "json_reader.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Byte source over a gzip file, for JsonReader. Plain files are read as is
+ */
+class GzipSource {
+public:
+    explicit GzipSource(const std::string& path) : _file(gzopen(path.c_str(), "rb"))
+    {
+        if (!_file) [[unlikely]]
+            throw std::runtime_error{"GzipSource : cannot open " + path};
+        gzbuffer(_file, 1 << 18);
+    }
+    GzipSource(const GzipSource&) = delete;
+    GzipSource& operator=(const GzipSource&) = delete;
+    ~GzipSource() { gzclose(_file); }
+
+    std::size_t read(char* buf, std::size_t n)
+    {
+        int r = gzread(_file, buf, static_cast<unsigned>(std::min<std::size_t>(n, 1u << 30)));
+        if (r < 0) [[unlikely]] {
+            int err = 0;
+            throw std::runtime_error{std::string("GzipSource : ") + gzerror(_file, &err)};
+        }
+        return static_cast<std::size_t>(r);
+    }
+
+protected:
+    gzFile _file;
+};
+
+
+/**
+ * @brief Options of the WebUI page loader
+ */
+struct WebuiOptions {
+    bool keep_ignored = false; // materialize ignored AX nodes as widgets with ignored = 1 instead of splicing their children into the parent
+    bool with_geometry = true; // join the bounding boxes by backendDOMNodeId
+};
+
+/**
+ * @brief Bounding box of a DOM node : x, y, width, height
+ */
+using WebuiBox = std::array<double, 4>;
+
+/**
+ * @brief Stream a WebUI bb.json(.gz) / box.json(.gz) file : {"<backendDOMNodeId>": {"x", "y", "width", "height"} | null}. Null boxes are skipped
+ */
+template <class TSource>
+std::unordered_map<std::int64_t, WebuiBox> read_webui_boxes(TSource& src)
+{
+    JsonReader<TSource> json(src);
+    std::unordered_map<std::int64_t, WebuiBox> boxes;
+    std::string_view key, field;
+
+    json.begin_object();
+    while (json.next_key(key)) {
+        std::int64_t id;
+        if (!parse_json_int(key, id))
+            id = std::strtoll(std::string(key).c_str(), nullptr, 10);
+        if (json.read_null())
+            continue;
+        WebuiBox box{0, 0, 0, 0};
+        json.begin_object();
+        while (json.next_key(field)) {
+            if (field == "x") box[0] = json.read_double();
+            else if (field == "y") box[1] = json.read_double();
+            else if (field == "width") box[2] = json.read_double();
+            else if (field == "height") box[3] = json.read_double();
+            else json.skip();
+        }
+        boxes.emplace(id, box);
+    }
+    return boxes;
+}
+
+inline std::unordered_map<std::int64_t, WebuiBox> read_webui_boxes(const std::string& path)
+{
+    GzipSource src(path);
+    return read_webui_boxes(src);
+}
+
+
+/**
+ * @brief Streaming loader of the WebUI dataset accessibility trees
+ *
+ * Reads axtree.json(.gz) ({"nodes": [AX node, ...]} as produced by the Chrome DevTools Accessibility domain) in one pass and builds the WidgetTree of
+ * the page. Each widget is named after its AX name and gets the attributes role, name, ignored and geometry (x, y, width, height, from bb.json joined by
+ * backendDOMNodeId). Ignored nodes are not materialized : their role and name are skipped by the parser and their children are attached to the closest
+ * non-ignored ancestor. Fields other than nodeId, parentId, childIds, ignored, role, name and backendDOMNodeId are skipped without allocation
+ */
+template <class TStr = std::string>
+class WebuiPageLoader {
+public:
+    explicit WebuiPageLoader(WebuiOptions opts = {}) : _opts(opts),
+        _k_role(AttrSet<TStr>::key("role")), _k_name(AttrSet<TStr>::key("name")), _k_ignored(AttrSet<TStr>::key("ignored")),
+        _k_geometry(AttrSet<TStr>::key("geometry")), _k_box(AttrSet<TStr>::key("box")) {}
+
+    /**
+     * @brief Load a page. bb_path and box_path may be empty. box.json is expected to have the bb.json layout and is stored in the box attribute
+     */
+    Node<TStr> load(const TStr& page_name, const std::string& axtree_path, const std::string& bb_path = {}, const std::string& box_path = {})
+    {
+        if (_opts.with_geometry && !bb_path.empty())
+            _bb = read_webui_boxes(bb_path);
+        if (_opts.with_geometry && !box_path.empty())
+            _box = read_webui_boxes(box_path);
+        GzipSource src(axtree_path);
+        Node<TStr> node = load_source(page_name, src);
+        _bb.clear();
+        _box.clear();
+        return node;
+    }
+
+    /**
+     * @brief Load a page of the dataset directory layout : <dir>/<screen_type>-axtree.json.gz, -bb.json.gz, -box.json.gz and -url.txt (all but axtree optional,
+     * url.txt is used as the node name; the name is <dir>/<screen_type> otherwise)
+     */
+    Node<TStr> load_dir(const std::string& dir, const std::string& screen_type)
+    {
+        const std::string prefix = dir + "/" + screen_type + "-";
+        std::string name = dir + "/" + screen_type;
+        std::ifstream url(prefix + "url.txt");
+        if (url)
+            std::getline(url, name);
+        auto optional = [&](const std::string& suffix) { return std::ifstream(prefix + suffix) ? prefix + suffix : std::string(); };
+        return load(TStr(name), prefix + "axtree.json.gz", optional("bb.json.gz"), optional("box.json.gz"));
+    }
+
+    /**
+     * @brief Parse the AX tree from a byte source, using the boxes loaded by load()
+     */
+    template <class TSource>
+    Node<TStr> load_source(const TStr& page_name, TSource& src)
+    {
+        parse(src);
+        Node<TStr> node(page_name);
+        node.set_widget(build_tree());
+        return node;
+    }
+
+    /**
+     * @brief Number of AX nodes read by the last load(), including the ignored ones
+     */
+    std::size_t n_ax_nodes() const { return _records.size(); }
+
+protected:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    struct Record {
+        bool present = false;
+        bool ignored = false;
+        bool has_parent = false;
+        std::int64_t backend = -1;
+        std::uint32_t child_begin = 0, child_end = 0; // range in _children
+        std::uint32_t role = 0, role_len = 0;         // range in _text
+        std::uint32_t name = 0, name_len = 0;
+    };
+
+    /**
+     * @brief Record of an AX node id. CDP ids are decimal strings, which are looked up as numbers in an open addressing table
+     */
+    std::uint32_t intern(std::string_view id)
+    {
+        std::int64_t v;
+        if (!id.empty() && (id[0] != '0' || id.size() == 1) && parse_json_int(id, v) && v >= 0)
+            return intern(v);
+        auto [it, inserted] = _str_ids.emplace(std::string(id), static_cast<std::uint32_t>(_records.size()));
+        if (inserted)
+            _records.emplace_back();
+        return it->second;
+    }
+
+    std::uint32_t intern(std::int64_t id)
+    {
+        if (id < 0)
+            return intern(std::string_view(std::to_string(id)));
+        if (2 * (_n_num_ids + 1) > _num_ids.size()) {
+            std::vector<std::pair<std::int64_t, std::uint32_t>> old(std::max<std::size_t>(1024, 2 * _num_ids.size()), {-1, 0});
+            old.swap(_num_ids);
+            for (const auto& e : old)
+                if (e.first >= 0)
+                    *find_slot(e.first) = e;
+        }
+        auto* slot = find_slot(id);
+        if (slot->first < 0) {
+            *slot = {id, static_cast<std::uint32_t>(_records.size())};
+            _n_num_ids++;
+            _records.emplace_back();
+        }
+        return slot->second;
+    }
+
+    std::pair<std::int64_t, std::uint32_t>* find_slot(std::int64_t id)
+    {
+        const std::size_t mask = _num_ids.size() - 1;
+        std::size_t h = static_cast<std::size_t>((static_cast<std::uint64_t>(id) * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+        while (_num_ids[h].first >= 0 && _num_ids[h].first != id)
+            h = (h + 1) & mask;
+        return &_num_ids[h];
+    }
+
+    /**
+     * @brief Copy of a range of _text
+     */
+    TStr text(std::uint32_t begin, std::uint32_t len) const { return TStr(_text.substr(begin, len)); }
+
+    template <class TSource>
+    void parse(TSource& src)
+    {
+        _str_ids.clear();
+        std::fill(_num_ids.begin(), _num_ids.end(), std::pair<std::int64_t, std::uint32_t>{-1, 0});
+        _n_num_ids = 0;
+        _text.clear();
+        _records.clear();
+        _children.clear();
+        _order.clear();
+
+        JsonReader<TSource> json(src);
+        json.begin_object();
+        std::string_view key;
+        while (json.next_key(key)) {
+            if (key != "nodes") {
+                json.skip();
+                continue;
+            }
+            json.begin_array();
+            while (json.next_element())
+                parse_node(json);
+        }
+    }
+
+    template <class TSource>
+    void parse_node(JsonReader<TSource>& json)
+    {
+        Record rec;
+        std::uint32_t self = none;
+        std::size_t child_begin = _children.size();
+
+        std::string_view key;
+        json.begin_object();
+        while (json.next_key(key)) {
+            if (key == "nodeId") {
+                self = read_id(json);
+            } else if (key == "parentId") {
+                rec.has_parent = !json.read_null();
+                if (rec.has_parent)
+                    json.skip();
+            } else if (key == "ignored") {
+                rec.ignored = json.read_bool();
+            } else if (key == "backendDOMNodeId") {
+                rec.backend = json.read_int();
+            } else if (key == "childIds") {
+                json.begin_array();
+                while (json.next_element())
+                    _children.push_back(read_id(json));
+            } else if (key == "role" && !rec.ignored) {
+                read_ax_value(json, rec.role, rec.role_len);
+            } else if (key == "name" && !rec.ignored) {
+                read_ax_value(json, rec.name, rec.name_len);
+            } else {
+                json.skip();
+            }
+        }
+        if (self == none) [[unlikely]]
+            throw std::runtime_error{"WebuiPageLoader : AX node without nodeId"};
+
+        if (rec.ignored)
+            rec.role_len = rec.name_len = 0;
+        rec.present = true;
+        rec.child_begin = static_cast<std::uint32_t>(child_begin);
+        rec.child_end = static_cast<std::uint32_t>(_children.size());
+        _records[self] = rec;
+        _order.push_back(self);
+    }
+
+    // Node ids are strings in CDP, but some dumps store them as numbers
+    template <class TSource>
+    std::uint32_t read_id(JsonReader<TSource>& json)
+    {
+        if (json.peek_type() == JsonReader<TSource>::Type::String)
+            return intern(json.read_string_view());
+        return intern(json.read_int());
+    }
+
+    // {"type": ..., "value": ...} -> value as a string appended to _text
+    template <class TSource>
+    void read_ax_value(JsonReader<TSource>& json, std::uint32_t& begin, std::uint32_t& len)
+    {
+        if (json.read_null())
+            return;
+        std::string_view field;
+        json.begin_object();
+        while (json.next_key(field)) {
+            if (field != "value") {
+                json.skip();
+                continue;
+            }
+            begin = static_cast<std::uint32_t>(_text.size());
+            auto t = json.peek_type();
+            if (t == JsonReader<TSource>::Type::String)
+                _text += json.read_string_view();
+            else if (t == JsonReader<TSource>::Type::Number)
+                _text += std::to_string(json.read_double());
+            else if (t == JsonReader<TSource>::Type::Bool)
+                _text += json.read_bool() ? "true" : "false";
+            else
+                json.skip();
+            len = static_cast<std::uint32_t>(_text.size()) - begin;
+        }
+    }
+
+    void set_attrs(AttrSet<TStr>& attrs, const Record& rec)
+    {
+        attrs.set(_k_role, text(rec.role, rec.role_len));
+        if (rec.name_len)
+            attrs.set(_k_name, text(rec.name, rec.name_len));
+        attrs.set(_k_ignored, AttrValue<TStr>(static_cast<std::int64_t>(rec.ignored)));
+        if (rec.backend < 0)
+            return;
+        auto bb = _bb.find(rec.backend);
+        if (bb != _bb.end())
+            attrs.set(_k_geometry, {bb->second[0], bb->second[1], bb->second[2], bb->second[3]});
+        auto box = _box.find(rec.backend);
+        if (box != _box.end())
+            attrs.set(_k_box, {box->second[0], box->second[1], box->second[2], box->second[3]});
+    }
+
+    /**
+     * @brief Depth-first walk from the root, widgets are appended in preorder
+     */
+    WidgetTree<TStr> build_tree()
+    {
+        WidgetTree<TStr> tree;
+        std::uint32_t root = none;
+        for (std::uint32_t i : _order) {
+            if (!_records[i].has_parent) {
+                root = i;
+                break;
+            }
+        }
+        if (root == none)
+            return tree;
+        tree.reserve(_order.size());
+
+        std::vector<bool> visited(_records.size(), false);
+        std::vector<std::pair<std::uint32_t, WidgetIdx>> stack{{root, widget_npos}}; // (record, parent widget)
+        while (!stack.empty()) {
+            auto [r, parent] = stack.back();
+            stack.pop_back();
+            const Record& rec = _records[r];
+            if (!rec.present || visited[r])
+                continue;
+            visited[r] = true;
+
+            WidgetIdx w = parent;
+            if (!rec.ignored || _opts.keep_ignored || parent == widget_npos) {
+                w = parent == widget_npos ? tree.add_root(text(rec.name, rec.name_len)) : tree.add_child(parent, text(rec.name, rec.name_len));
+                set_attrs(tree.attrs(w), rec);
+            }
+            for (std::uint32_t c = rec.child_end; c > rec.child_begin; c--)
+                stack.emplace_back(_children[c - 1], w);
+        }
+        return tree;
+    }
+
+    WebuiOptions _opts;
+    AttrKey _k_role, _k_name, _k_ignored, _k_geometry, _k_box;
+
+    std::unordered_map<std::int64_t, WebuiBox> _bb, _box;
+    std::vector<std::pair<std::int64_t, std::uint32_t>> _num_ids; // numeric AX node id -> record, open addressing with -1 as the empty key
+    std::size_t _n_num_ids = 0;
+    std::unordered_map<std::string, std::uint32_t> _str_ids;     // other AX node ids
+    std::string _text;                                            // roles and names of the records
+    std::vector<Record> _records;
+    std::vector<std::uint32_t> _children;
+    std::vector<std::uint32_t> _order; // records in the file order
+};
+
+/**
+ * @brief Load one WebUI page (see WebuiPageLoader::load_dir())
+ */
+template <class TStr = std::string>
+Node<TStr> load_webui_page(const std::string& dir, const std::string& screen_type, WebuiOptions opts = {})
+{
+    return WebuiPageLoader<TStr>(opts).load_dir(dir, screen_type);
+}
+
+}
+
+#endif // JSC_WEBUI_H
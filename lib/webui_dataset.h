@@ -0,0 +1,294 @@
+#ifndef JSC_WEBUI_DATASET_H
+#define JSC_WEBUI_DATASET_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+#include "webui.h"
+
+
+namespace jsc {
+
+/**
+ * @brief Files of one screen variant of a WebUI page, <screen_type>-<suffix>. A variant is complete when all of them are present
+ */
+inline const std::vector<std::string>& webui_file_types()
+{
+    static const std::vector<std::string> types = {
+        "axtree.json.gz", "bb.json.gz", "box.json.gz", "class.json.gz", "html.html", "links.json",
+        "screenshot-full.webp", "screenshot.webp", "style.json.gz", "url.txt", "viewport.json.gz"};
+    return types;
+}
+
+/**
+ * @brief Screen variant of a WebUI page. Desktop variants are named default_<width>-<height>, the size of the other ones is 0
+ */
+struct WebuiScreen {
+    std::string screen_type;
+    int width = 0, height = 0;
+
+    explicit WebuiScreen(std::string type = {}) : screen_type(std::move(type))
+    {
+        if (screen_type.rfind("default", 0) != 0)
+            return;
+        std::size_t us = screen_type.find('_');
+        if (us == std::string::npos)
+            return;
+        char* end = nullptr;
+        width = static_cast<int>(std::strtol(screen_type.c_str() + us + 1, &end, 10));
+        if (*end == '-')
+            height = static_cast<int>(std::strtol(end + 1, nullptr, 10));
+    }
+};
+
+/**
+ * @brief Pick the screen variant of a page directory given its (file name, file size) list, as the dataset notebook does: the widest variant with a non-empty
+ * full screenshot, among the complete ones (or the ones with an AX tree if require_complete is false). Equal widths are ordered by name. Returns an empty
+ * screen type if there is no such variant
+ */
+inline WebuiScreen webui_best_screen(const std::vector<std::pair<std::string, std::uintmax_t>>& files, bool require_complete = true)
+{
+    auto size_of = [&](const std::string& name) -> std::intmax_t {
+        for (const auto& [n, size] : files)
+            if (n == name)
+                return static_cast<std::intmax_t>(size);
+        return -1;
+    };
+
+    // Screen types are the file prefixes before the last '-', screenshot-full.webp gives an extra "<type>-screenshot" prefix
+    std::vector<std::string> types;
+    for (const auto& [name, size] : files) {
+        std::size_t dash = name.rfind('-');
+        if (dash == std::string::npos || name.find("screenshot") < dash)
+            continue;
+        types.push_back(name.substr(0, dash));
+    }
+    std::sort(types.begin(), types.end());
+    types.erase(std::unique(types.begin(), types.end()), types.end());
+
+    WebuiScreen best;
+    bool found = false;
+    for (const auto& type : types) {
+        const std::string prefix = type + "-";
+        bool complete = size_of(prefix + "axtree.json.gz") >= 0;
+        for (std::size_t i = 0; require_complete && complete && i < webui_file_types().size(); i++)
+            complete = size_of(prefix + webui_file_types()[i]) >= 0;
+        if (!complete || size_of(prefix + "screenshot-full.webp") <= 0)
+            continue;
+        WebuiScreen screen(type);
+        if (!found || screen.width > best.width) {
+            best = std::move(screen);
+            found = true;
+        }
+    }
+    return best;
+}
+
+
+/**
+ * @brief Options of the WebUI dataset loader
+ */
+struct WebuiDatasetOptions {
+    std::size_t n_threads = 0;        // page workers, 0 = all cores. Directory scanning runs on one more thread, graph insertion on the calling thread
+    std::size_t queue_capacity = 0;   // bound of the directory and page queues, 0 = 4 per worker
+    bool require_complete = true;     // only use screen variants with all the files of webui_file_types()
+    bool skip_errors = false;         // count pages which fail to load instead of stopping and rethrowing
+    std::size_t progress_every = 0;   // call the progress callback every N directories, 0 = never
+    WebuiOptions page;
+};
+
+/**
+ * @brief Statistics of a dataset load
+ */
+struct WebuiDatasetStats {
+    std::size_t n_dirs = 0;     // page directories processed
+    std::size_t n_pages = 0;    // pages added to the graph
+    std::size_t n_skipped = 0;  // directories without a usable screen variant
+    std::size_t n_failed = 0;   // pages which failed to load (skip_errors)
+    std::size_t n_widgets = 0;
+    std::size_t bytes = 0;      // compressed bytes of the AX tree and geometry files read
+    double seconds = 0;
+
+    double pages_per_sec() const { return seconds > 0 ? static_cast<double>(n_pages) / seconds : 0; }
+    double mb_per_sec() const { return seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0; }
+};
+
+/**
+ * @brief Page added to the graph by the dataset loader
+ */
+struct WebuiPageInfo {
+    std::string page_id; // name of the page directory
+    WebuiScreen screen;
+    NodeRef ref;
+};
+
+
+/**
+ * @brief Parallel loader of a WebUI dataset split (a directory with one directory per page) into an AdjGraph
+ *
+ * The load is a three stage pipeline connected by bounded queues: a scanner thread lists the page directories, n_threads workers pick the screen variant of
+ * a page and stream its gzip files through WebuiPageLoader (each worker reuses its buffers), and the calling thread inserts the finished nodes into the graph.
+ * Only the calling thread touches the graph, so the callbacks may use it. Full queues block the previous stage, which bounds the memory to a few pages
+ * per worker. Pages are inserted in completion order.
+ */
+template <class TStr = std::string>
+class WebuiDatasetLoader {
+public:
+    using PageCallback = std::function<void(const WebuiPageInfo&)>;
+    using ProgressCallback = std::function<void(const WebuiDatasetStats&)>;
+
+    explicit WebuiDatasetLoader(WebuiDatasetOptions opts = {}) : _opts(std::move(opts)) {}
+
+    void on_page(PageCallback cb) { _on_page = std::move(cb); }
+    void on_progress(ProgressCallback cb) { _on_progress = std::move(cb); }
+
+    /**
+     * @brief Load every page directory of root_dir into g. Throws the first error of a worker or a callback unless skip_errors is set
+     */
+    WebuiDatasetStats load(const std::string& root_dir, AdjGraph<TStr>& g)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t n_workers = _opts.n_threads ? _opts.n_threads : default_threads();
+        const std::size_t capacity = _opts.queue_capacity ? _opts.queue_capacity : 4 * n_workers;
+
+        BoundedQueue<std::string> dirs(capacity);
+        BoundedQueue<Result> results(capacity);
+        std::atomic<std::size_t> active(n_workers);
+        std::exception_ptr error;
+        std::mutex error_mtx;
+        auto fail = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(error_mtx);
+                if (!error)
+                    error = e;
+            }
+            dirs.close();
+            results.close();
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers + 1);
+        threads.emplace_back([&]() {
+            try {
+                for (const auto& entry : std::filesystem::directory_iterator(root_dir))
+                    if (entry.is_directory() && !dirs.push(entry.path().string()))
+                        break;
+                dirs.close();
+            } catch (...) {
+                fail(std::current_exception());
+            }
+        });
+        for (std::size_t t = 0; t < n_workers; t++) {
+            threads.emplace_back([&]() {
+                try {
+                    WebuiPageLoader<TStr> loader(_opts.page);
+                    std::string dir;
+                    while (dirs.pop(dir))
+                        if (!results.push(load_page(loader, dir)))
+                            break;
+                } catch (...) {
+                    fail(std::current_exception());
+                }
+                if (active.fetch_sub(1) == 1)
+                    results.close();
+            });
+        }
+
+        // Merge stage, runs on the calling thread
+        WebuiDatasetStats stats;
+        try {
+            Result r;
+            while (results.pop(r)) {
+                stats.n_dirs++;
+                stats.bytes += r.bytes;
+                if (r.error) {
+                    stats.n_failed++;
+                    if (!_opts.skip_errors)
+                        std::rethrow_exception(r.error);
+                } else if (r.info.screen.screen_type.empty()) {
+                    stats.n_skipped++;
+                } else {
+                    stats.n_pages++;
+                    stats.n_widgets += r.node.widget_tree().size();
+                    r.info.ref = g.add_node(r.node);
+                    if (_on_page)
+                        _on_page(r.info);
+                }
+                if (_on_progress && _opts.progress_every && stats.n_dirs % _opts.progress_every == 0) {
+                    stats.seconds = elapsed(start);
+                    _on_progress(stats);
+                }
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+
+        for (auto& t : threads)
+            t.join();
+        if (error)
+            std::rethrow_exception(error);
+        stats.seconds = elapsed(start);
+        return stats;
+    }
+
+protected:
+    struct Result {
+        WebuiPageInfo info;
+        Node<TStr> node;
+        std::size_t bytes = 0;
+        std::exception_ptr error;
+    };
+
+    static double elapsed(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Result load_page(WebuiPageLoader<TStr>& loader, const std::string& dir)
+    {
+        Result r;
+        r.info.page_id = std::filesystem::path(dir).filename().string();
+        try {
+            std::vector<std::pair<std::string, std::uintmax_t>> files;
+            for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+                std::error_code ec;
+                std::uintmax_t size = entry.file_size(ec);
+                files.emplace_back(entry.path().filename().string(), ec ? 0 : size);
+            }
+            r.info.screen = webui_best_screen(files, _opts.require_complete);
+            if (r.info.screen.screen_type.empty())
+                return r;
+
+            const std::string prefix = r.info.screen.screen_type + "-";
+            for (const auto& [name, size] : files)
+                if (name == prefix + "axtree.json.gz" || (_opts.page.with_geometry && (name == prefix + "bb.json.gz" || name == prefix + "box.json.gz")))
+                    r.bytes += static_cast<std::size_t>(size);
+            r.node = loader.load_dir(dir, r.info.screen.screen_type);
+        } catch (...) {
+            r.error = std::current_exception();
+        }
+        return r;
+    }
+
+    WebuiDatasetOptions _opts;
+    PageCallback _on_page;
+    ProgressCallback _on_progress;
+};
+
+}
+
+#endif // JSC_WEBUI_DATASET_H
@@ -0,0 +1,170 @@
+#pragma once
+#include "ann.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Random vectors around a few centers, like embeddings of similar pages
+ */
+inline std::vector<std::vector<float>> make_clustered_vectors(std::size_t n, std::size_t dim, std::mt19937& rng)
+{
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<std::vector<float>> centers(16, std::vector<float>(dim)), out(n, std::vector<float>(dim));
+    for (auto& c : centers)
+        for (float& x : c)
+            x = normal(rng);
+    for (auto& v : out) {
+        const auto& c = centers[rng() % centers.size()];
+        for (std::size_t i = 0; i < dim; i++)
+            v[i] = c[i] + 0.5f * normal(rng);
+    }
+    return out;
+}
+
+/**
+ * @brief Exact k nearest labels among the live vectors, by brute force
+ */
+inline std::vector<std::uint64_t> brute_force_knn(const std::vector<std::vector<float>>& data, const std::vector<bool>& live, const std::vector<float>& q,
+                                                  std::size_t k, jsc::AnnMetric metric)
+{
+    std::vector<std::pair<double, std::uint64_t>> all;
+    for (std::size_t i = 0; i < data.size(); i++) {
+        if (!live[i])
+            continue;
+        double d = 0, dot = 0, na = 0, nb = 0;
+        for (std::size_t j = 0; j < q.size(); j++) {
+            d += (q[j] - data[i][j]) * (q[j] - data[i][j]);
+            dot += q[j] * data[i][j];
+            na += q[j] * q[j];
+            nb += data[i][j] * data[i][j];
+        }
+        all.emplace_back(metric == jsc::AnnMetric::L2 ? d : 1.0 - dot / std::sqrt(na * nb), i);
+    }
+    std::sort(all.begin(), all.end());
+    std::vector<std::uint64_t> out;
+    for (std::size_t i = 0; i < k && i < all.size(); i++)
+        out.push_back(all[i].second);
+    return out;
+}
+
+inline bool test_ann_index()
+{
+    using namespace jsc;
+    std::cout << "test_ann_index()" << std::endl;
+
+    // Kernels, with tails
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (std::size_t n : {1, 7, 8, 16, 31, 100}) {
+        std::vector<float> a(n), b(n);
+        std::vector<std::int8_t> c(n);
+        double ref_f = 0, ref_i = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            a[i] = unit(rng), b[i] = unit(rng), c[i] = static_cast<std::int8_t>(static_cast<int>(rng() % 255) - 127);
+            ref_f += a[i] * b[i];
+            ref_i += a[i] * c[i];
+        }
+        for (SimdLevel level : {SimdLevel::Scalar, simd_level()}) {
+            assert(std::abs(ann_dot(a.data(), b.data(), n, level) - ref_f) < 1e-4);
+            assert(std::abs(ann_dot(a.data(), c.data(), n, level) - ref_i) < 1e-2);
+        }
+    }
+
+    constexpr std::size_t n = 3000, dim = 24, k = 10;
+    auto data = make_clustered_vectors(n, dim, rng);
+    auto queries = make_clustered_vectors(50, dim, rng);
+
+    for (AnnMetric metric : {AnnMetric::L2, AnnMetric::Cosine}) {
+        for (AnnStorage storage : {AnnStorage::Float32, AnnStorage::Int8}) {
+            AnnOptions opts;
+            opts.metric = metric;
+            opts.storage = storage;
+            opts.M = 12;
+            opts.ef_construction = 100;
+            HnswIndex index(dim, opts);
+            for (std::size_t i = 0; i < n; i++)
+                index.insert(i, data[i]);
+            assert(index.size() == n);
+
+            std::vector<bool> live(n, true);
+            auto recall = [&]() {
+                std::size_t found = 0;
+                for (const auto& q : queries) {
+                    auto expected = brute_force_knn(data, live, q, k, metric);
+                    auto hits = index.search(q, k, 64);
+                    assert(hits.size() == k);
+                    for (std::size_t i = 0; i < hits.size(); i++) {
+                        assert(live[hits[i].first]);
+                        assert(i == 0 || hits[i - 1].second <= hits[i].second);
+                        found += std::find(expected.begin(), expected.end(), hits[i].first) != expected.end();
+                    }
+                }
+                return static_cast<double>(found) / (queries.size() * k);
+            };
+            const double min_recall = storage == AnnStorage::Float32 ? 0.9 : 0.85;
+            assert(recall() >= min_recall);
+
+            // Tombstones are never returned, replacing a label moves it
+            for (std::size_t i = 0; i < n; i += 3) {
+                assert(index.remove(i));
+                live[i] = false;
+            }
+            assert(!index.remove(0) && !index.contains(0) && index.n_deleted() == n / 3);
+            assert(recall() >= min_recall);
+            index.insert(1, data[2]);
+            auto hits = index.search(data[2], 2);
+            assert(hits[0].first == 1 || hits[0].first == 2);
+            index.insert(1, data[1]);
+
+            // Deleting more than half rebuilds the graph without the tombstones
+            for (std::size_t i = 1; i < n; i += 3) {
+                index.remove(i);
+                live[i] = false;
+            }
+            assert(index.n_deleted() < index.size());
+            assert(index.size() == n - 2 * (n / 3));
+            assert(recall() >= min_recall);
+            auto v = index.get(2);
+            assert(v.size() == dim && index.get(0).empty());
+        }
+    }
+
+    // Node and widget embeddings of a graph
+    AdjGraph<std::string> g;
+    std::vector<NodeRef> refs;
+    for (std::size_t i = 0; i < 200; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        for (std::size_t j = 0; j < 3; j++) {
+            WidgetIdx w = tree.add_child(0, "button");
+            AttrValue<std::string> emb(std::vector<double>(data[i * 3 + j].begin(), data[i * 3 + j].end()));
+            tree.attrs(w).set("embedding", emb);
+        }
+        node.set_widget(std::move(tree));
+        node.set("embedding", AttrValue<std::string>(std::vector<double>(data[i].begin(), data[i].end())));
+        refs.push_back(g.add_node(node));
+    }
+    g.get_node(refs[5]).widget_tree().attrs(1).get("embedding")->push_f64(0.0); // wrong size
+
+    EmbeddingIndex<std::string> nodes("embedding", dim);
+    assert(nodes.build(g) == 200);
+    auto hit = nodes.search(data[42], 1);
+    assert(hit.size() == 1 && hit[0].node._internal_id() == refs[42]._internal_id() && hit[0].widget == widget_npos);
+
+    EmbeddingIndex<std::string> widgets("embedding", dim, AnnOptions{}, true);
+    assert(widgets.build(g) == 599 && widgets.n_skipped() == 1);
+    hit = widgets.search(data[7 * 3 + 2], 1);
+    assert(hit[0].node._internal_id() == refs[7]._internal_id() && hit[0].widget == 3);
+
+    // Removed nodes disappear, added nodes show up
+    assert(widgets.remove_node(refs[7]) && !widgets.remove_node(refs[7]));
+    hit = widgets.search(data[7 * 3 + 2], 5);
+    for (const auto& h : hit)
+        assert(h.node._internal_id() != refs[7]._internal_id());
+    assert(widgets.add_node(g.get_node(refs[7])) == 3 && widgets.size() == 599);
+    assert(widgets.search(data[7 * 3 + 2], 1)[0].node._internal_id() == refs[7]._internal_id());
+    return true;
+}
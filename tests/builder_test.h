@@ -0,0 +1,111 @@
+#pragma once
+#include "graph_builder.h"
+#include <cassert>
+#include <iostream>
+#include <random>
+
+inline bool test_graph_builder()
+{
+    using namespace jsc;
+    std::cout << "test_graph_builder()" << std::endl;
+    using NodeData = AdjGraph<std::string>::NodeData;
+
+    // Random multigraph with self-loops, every widget links at most once
+    constexpr std::size_t n = 3000, n_links = 6;
+    std::mt19937 rng(7);
+    std::vector<Node<std::string>> nodes;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        for (std::size_t j = 0; j < n_links; j++)
+            tree.add_child(0, "link");
+        node.set_widget(std::move(tree));
+        nodes.push_back(std::move(node));
+    }
+    std::vector<GraphBuilder<std::string>::EdgeSpec> edges;
+    std::vector<std::size_t> used(n, 0);
+    for (std::size_t k = 0; k < 4 * n; k++) {
+        std::size_t from = rng() % n, to = rng() % 8 == 0 ? from : rng() % n;
+        if (used[from] == n_links)
+            continue;
+        AttrSet<std::string> attrs;
+        attrs.set("k", AttrValue<std::string>(static_cast<std::int64_t>(k)));
+        edges.push_back({from, to, static_cast<WidgetIdx>(1 + used[from]++), attrs});
+    }
+
+    // Sequential insertion
+    AdjGraph<std::string> seq;
+    std::vector<NodeRef> refs;
+    for (auto node : nodes)
+        refs.push_back(seq.add_node(node));
+    for (const auto& spec : edges) {
+        Hyperlink<std::string> h(seq.get_node(refs[spec.from]), seq.get_node(refs[spec.to]), seq.get_node(refs[spec.from]).widget_tree().view(spec.widget));
+        static_cast<AttrSet<std::string>&>(h) = spec.attrs;
+        seq.add_edge(h);
+    }
+
+    GraphBuilder<std::string> builder;
+    builder.reserve(n, edges.size());
+    assert(builder.add_nodes(std::vector<Node<std::string>>(nodes.begin(), nodes.begin() + n / 2)) == 0);
+    for (std::size_t i = n / 2; i < n; i++)
+        builder.add_node(nodes[i]);
+    builder.add_edges(std::vector<GraphBuilder<std::string>::EdgeSpec>(edges.begin(), edges.begin() + edges.size() / 2));
+    for (std::size_t e = edges.size() / 2; e < edges.size(); e++)
+        builder.add_edge(edges[e].from, edges[e].to, edges[e].widget, edges[e].attrs);
+    AdjGraph<std::string> bulk = builder.build(4);
+    assert(builder.n_nodes() == 0 && builder.n_edges() == 0);
+
+    // Both graphs must be identical
+    std::vector<const NodeData*> a, b;
+    seq.each([&](const NodeData& nd) { a.push_back(&nd); });
+    bulk.each([&](const NodeData& nd) { b.push_back(&nd); });
+    assert(a.size() == n && b.size() == n);
+    for (std::size_t i = 0; i < n; i++) {
+        assert(GraphBuilder<std::string>::node_ref(i)._internal_id() == refs[i]._internal_id());
+        assert(a[i]->node._internal_id() == b[i]->node._internal_id() && a[i]->node.name() == b[i]->node.name());
+        assert(a[i]->node._widget_hyperlinks_cnt() == b[i]->node._widget_hyperlinks_cnt());
+        assert(a[i]->node.widget_tree().hyperlink_ids_column() == b[i]->node.widget_tree().hyperlink_ids_column());
+        assert(a[i]->edges.size() == b[i]->edges.size() && a[i]->backlinks.size() == b[i]->backlinks.size());
+        for (std::size_t e = 0; e < a[i]->edges.size(); e++) {
+            const auto &ea = a[i]->edges[e], &eb = b[i]->edges[e];
+            assert(ea._id_from() == eb._id_from() && ea._id_to() == eb._id_to() && ea._widget_id() == eb._widget_id());
+            assert(ea.get("k")->i64() == eb.get("k")->i64());
+        }
+        for (std::size_t k = 0; k < a[i]->backlinks.size(); k++)
+            assert(a[i]->backlinks[k].source == b[i]->backlinks[k].source && a[i]->backlinks[k].hyperlink == b[i]->backlinks[k].hyperlink);
+        assert(a[i]->edge_slots == b[i]->edge_slots && a[i]->edge_backs == b[i]->edge_backs);
+    }
+
+    // The built graph is a regular AdjGraph
+    bulk.del_node(GraphBuilder<std::string>::node_ref(0));
+    assert(bulk.size() == n - 1);
+
+    // Invalid edges
+    bool thrown = false;
+    GraphBuilder<std::string> bad;
+    bad.add_node(nodes[0]);
+    bad.add_edge(0, 1, 1);
+    try { bad.build(); } catch (const std::out_of_range&) { thrown = true; }
+    assert(thrown);
+
+    thrown = false;
+    GraphBuilder<std::string> dup;
+    dup.add_node(nodes[0]);
+    dup.add_edge(0, 0, 1);
+    dup.add_edge(0, 0, 1);
+    try { dup.build(); } catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown);
+
+    // The builder is left unchanged, a duplicate among many edges loses no node
+    thrown = false;
+    GraphBuilder<std::string> late;
+    for (std::size_t i = 0; i < n; i++)
+        late.add_node(nodes[i]);
+    for (std::size_t i = 0; i < n; i++)
+        late.add_edge(i, (i + 1) % n, 1);
+    late.add_edge(n - 1, 0, 1);
+    try { late.build(2); } catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown && late.n_nodes() == n && late.n_edges() == n + 1);
+    assert(dup.n_nodes() == 1 && dup.n_edges() == 2);
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "csr.h"
+#include <cassert>
+#include <iostream>
+
+/**
+ * @brief Build a graph where node i links to nodes (i + 1) % n and (i + 2) % n, plus a multi-edge 0 -> 1
+ */
+inline jsc::AdjGraph<std::string> make_ring_graph(std::size_t n, std::vector<jsc::NodeRef>& refs)
+{
+    using namespace jsc;
+    AdjGraph<std::string> g;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        Widget<std::string> root("root");
+        for (int j = 0; j < 3; j++)
+            root.add_child(Widget<std::string>("link"));
+        refs.push_back(g.add_node(node, root));
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t j = 1; j <= 2; j++) {
+            Hyperlink<std::string> h(g.get_node(refs[i]), g.get_node(refs[(i + j) % n]), g.get_widget(refs[i]).child(j - 1));
+            h.set("weight", AttrValue<std::string>(static_cast<std::int64_t>(j)));
+            g.add_edge(h);
+        }
+    }
+    Hyperlink<std::string> multi(g.get_node(refs[0]), g.get_node(refs[1]), g.get_widget(refs[0]).child(2));
+    g.add_edge(multi);
+    return g;
+}
+
+inline bool test_csr_snapshot()
+{
+    using namespace jsc;
+    std::cout << "test_csr_snapshot()" << std::endl;
+
+    std::vector<NodeRef> refs;
+    AdjGraph<std::string> g = make_ring_graph(5000, refs);
+    CsrGraph<std::string> csr = g.freeze(4);
+
+    assert(csr.n_nodes() == 5000 && csr.n_edges() == 10001);
+    for (std::size_t i = 0; i < refs.size(); i++) {
+        auto u = csr.index_of(refs[i]);
+        assert(csr.node_ref(u)._internal_id() == refs[i]._internal_id());
+        assert(csr.out_degree(u) == (i == 0 ? 3 : 2) && csr.in_degree(u) == (i == 1 ? 3 : 2));
+        assert(csr.backlinks(u).size() == g.get_backlinks(refs[i]).size());
+
+        for (std::size_t e = csr.out_offset(u); e < csr.out_offset(u) + csr.out_degree(u); e++) {
+            assert(csr.edge_source(e) == u);
+            const auto& h = g.get_edge(csr.edge_ref(e));
+            assert(h.get("weight") == nullptr || h.get("weight")->i64() == csr.edge_attrs(e).get("weight")->i64());
+        }
+        // Backlinks point back into the out-edges
+        for (std::size_t k = 0; k < csr.in_degree(u); k++)
+            assert(csr.edge_target(csr.in_edges(u)[k]) == u && csr.edge_source(csr.in_edges(u)[k]) == csr.backlinks(u)[k]);
+    }
+
+    // Snapshots are deterministic
+    CsrGraph<std::string> csr2 = g.freeze(1);
+    assert(csr2.in_sources() == csr.in_sources() && csr2.out_targets() == csr.out_targets());
+    return true;
+}
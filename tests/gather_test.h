@@ -0,0 +1,132 @@
+#pragma once
+#include "gather.h"
+#include "graph_builder.h"
+#include <cassert>
+#include <iostream>
+
+inline bool test_gather()
+{
+    using namespace jsc;
+    std::cout << "test_gather()" << std::endl;
+
+    // Raw storage of inline arrays and vectors
+    AttrValue<std::string> small{1.0, 2.0, 3.0};
+    assert(small.data_f64()[2] == 3.0);
+    small.data_f64()[0] = 5.0;
+    assert(small.at_f64(0) == 5.0);
+    AttrValue<std::string> big(std::vector<std::int64_t>{1, 2, 3, 4, 5, 6});
+    assert(big.data_i64()[5] == 6 && big.data_i64() == &big.at_i64(0));
+    bool thrown = false;
+    try {
+        big.data_f64();
+    } catch (const std::bad_variant_access&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Node i has emb = [i, 2i, 3i] except every 4th one, widget w of node i has emb = [i, w] except the root
+    AdjGraph<std::string> g;
+    std::vector<NodeRef> refs;
+    for (std::size_t i = 0; i < 50; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        for (std::size_t j = 0; j < i % 3 + 1; j++) {
+            WidgetIdx w = tree.add_child(0, "button");
+            tree.attrs(w).set("emb", AttrValue<std::string>(std::vector<std::int64_t>{static_cast<std::int64_t>(i), static_cast<std::int64_t>(w)}));
+        }
+        node.set_widget(std::move(tree));
+        if (i % 4)
+            node.set("emb", AttrValue<std::string>(std::vector<double>{1.0 * i, 2.0 * i, 3.0 * i}));
+        else
+            node.set("emb", AttrValue<std::string>(std::string("missing")));
+        refs.push_back(g.add_node(node));
+    }
+    const AttrKey key = AttrSet<std::string>::key("emb");
+    assert(attr_dim(g, key) == 3 && attr_dim(g, key, true) == 2 && attr_dim(g, AttrSet<std::string>::key("nope")) == 0);
+
+    std::vector<float> nodes(g.size() * 3, -1.0f);
+    std::vector<std::uint8_t> found(g.size());
+    std::vector<std::size_t> ids(g.size());
+    assert(gather_node_attr(g, key, 3, nodes.data(), found.data(), ids.data()) == 50 - 13);
+    for (std::size_t row = 0; row < g.size(); row++) {
+        const std::size_t i = row; // each() follows insertion order here
+        assert(ids[row] == refs[i]._internal_id());
+        assert(found[row] == (i % 4 != 0));
+        assert(nodes[row * 3 + 2] == (i % 4 ? 3.0f * i : 0.0f));
+    }
+
+    const std::size_t n_widgets = count_widgets(g);
+    assert(n_widgets == 50 + 17 * 1 + 17 * 2 + 16 * 3);
+    std::vector<double> widgets(n_widgets * 2);
+    std::vector<std::uint8_t> wfound(n_widgets);
+    std::vector<std::size_t> wids(n_widgets);
+    std::vector<WidgetIdx> widx(n_widgets);
+    assert(gather_widget_attr(g, key, 2, widgets.data(), wfound.data(), wids.data(), widx.data()) == n_widgets - 50);
+    for (std::size_t row = 0; row < n_widgets; row++) {
+        assert(wfound[row] == (widx[row] != 0));
+        if (wfound[row]) {
+            assert(widgets[row * 2] == static_cast<double>(wids[row]) && widgets[row * 2 + 1] == widx[row]);
+        }
+    }
+
+    // A single tree, rows of another size are skipped
+    assert(attr_dim(g.get_node(refs[2]).widget_tree(), key) == 2);
+    assert(gather_widget_attr(g.get_node(refs[2]).widget_tree(), key, 3, nodes.data()) == 0);
+    assert(gather_widget_attr(g.get_node(refs[2]).widget_tree(), key, 2, widgets.data(), wfound.data()) == 3);
+    assert(!wfound[0] && wfound[3] && widgets[6] == 2.0 && widgets[7] == 3.0);
+
+    // COO export : node i has x = [i] and y = [i, i, i] (not on node 0), edges from widget 1 carry w = [i, 2i]
+    constexpr std::size_t n = 30;
+    GraphBuilder<std::string> builder;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        tree.add_child(0, "link");
+        tree.add_child(0, "link");
+        node.set_widget(std::move(tree));
+        node.set("x", AttrValue<std::string>(static_cast<std::int64_t>(i)));
+        if (i)
+            node.set("y", AttrValue<std::string>(std::vector<double>(3, 1.0 * i)));
+        builder.add_node(std::move(node));
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        AttrSet<std::string> attrs;
+        attrs.set("w", AttrValue<std::string>(std::vector<double>{1.0 * i, 2.0 * i}));
+        builder.add_edge(i, (i * 7 + 1) % n, 1, std::move(attrs));
+        builder.add_edge(i, (i + 1) % n, 2);
+    }
+    AdjGraph<std::string> linked = builder.build();
+    CsrGraph<std::string> csr = linked.freeze();
+    const AttrKey x = AttrSet<std::string>::key("x"), y = AttrSet<std::string>::key("y"), w = AttrSet<std::string>::key("w");
+
+    std::vector<std::int64_t> coo(2 * csr.n_edges());
+    edge_index(csr, coo.data());
+    for (std::size_t e = 0; e < csr.n_edges(); e++)
+        assert(coo[e] == csr.edge_source(e) && coo[csr.n_edges() + e] == csr.edge_target(e));
+
+    std::vector<float> feats(n * 4);
+    std::vector<std::uint8_t> ffound(n * 2);
+    gather_node_features(linked, {x, y}, {attr_dim(linked, x), attr_dim(linked, y)}, feats.data(), ffound.data());
+    for (std::size_t u = 0; u < n; u++) {
+        const auto i = static_cast<float>(u); // builder order is the dense order
+        assert(csr.node_ref(static_cast<std::uint32_t>(u))._internal_id() == GraphBuilder<std::string>::node_ref(u)._internal_id());
+        assert(feats[u * 4] == i && feats[u * 4 + 3] == i && ffound[u * 2] && ffound[u * 2 + 1] == (u != 0));
+    }
+
+    assert(attr_dim(csr, w) == 2 && attr_dim(csr, x) == 0);
+    std::vector<double> eattr(csr.n_edges() * 2);
+    std::vector<std::uint8_t> efound(csr.n_edges());
+    gather_edge_features(csr, {w}, {2}, eattr.data(), efound.data());
+    std::size_t n_found = 0;
+    for (std::size_t e = 0; e < csr.n_edges(); e++) {
+        if (efound[e]) {
+            n_found++;
+            assert(eattr[e * 2] == csr.edge_source(e) && eattr[e * 2 + 1] == 2.0 * csr.edge_source(e));
+            assert(csr.edge_target(e) == (csr.edge_source(e) * 7 + 1) % n);
+        } else {
+            assert(eattr[e * 2] == 0.0 && eattr[e * 2 + 1] == 0.0);
+        }
+    }
+    assert(n_found == n);
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "geometry.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+inline jsc::BoxArray make_random_boxes(std::size_t n, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> pos(0.0, 1000.0), size(-20.0, 300.0); // some inverted boxes
+    jsc::BoxArray boxes;
+    for (std::size_t i = 0; i < n; i++) {
+        double x = pos(rng), y = pos(rng);
+        boxes.push_back(x, y, x + size(rng), y + size(rng), static_cast<jsc::WidgetIdx>(i));
+    }
+    return boxes;
+}
+
+inline bool test_box_kernels()
+{
+    using namespace jsc;
+    std::cout << "test_box_kernels() : " << (simd_level() == SimdLevel::AVX2 ? "avx2" : simd_level() == SimdLevel::NEON ? "neon" : "scalar") << std::endl;
+
+    // Known values
+    BoxArray a;
+    a.push_back(0, 0, 10, 10);
+    a.push_back(5, 5, 15, 15);
+    a.push_back(20, 20, 10, 10); // inverted
+    assert(box_area(a) == (std::vector<double>{100, 100, 0}));
+    std::vector<double> iou = box_iou(a, a);
+    assert(iou[0] == 1 && std::abs(iou[1] - 25.0 / 175.0) < 1e-15 && iou[2] == 0 && iou[8] == 0);
+    BoxArray inner;
+    inner.push_back(2, 2, 8, 8);
+    inner.push_back(-1, 2, 8, 8);
+    assert(box_contains(a, inner) == (std::vector<std::uint8_t>{1, 0, 0, 0, 0, 0}));
+    assert(box_contains(inner, a) == (std::vector<std::uint8_t>{0, 0, 0, 0, 0, 0}));
+
+    // The vector kernels match the scalar code, including the tails
+    std::mt19937 rng(21);
+    for (std::size_t n : {1, 3, 4, 7, 64, 257}) {
+        BoxArray x = make_random_boxes(n, rng), y = make_random_boxes(n + 2, rng);
+        assert(box_area(x) == box_area(x, SimdLevel::Scalar));
+        assert(box_iou(x, y) == box_iou(x, y, SimdLevel::Scalar));
+        assert(box_contains(y, x) == box_contains(y, x, SimdLevel::Scalar));
+
+        BoxArray clipped = x, expected = x;
+        box_clip(clipped, 100, 200, 500, 300);
+        box_clip(expected, 100, 200, 500, 300, SimdLevel::Scalar);
+        for (std::size_t i = 0; i < n; i++) {
+            assert(clipped.x0()[i] == expected.x0()[i] && clipped.y1()[i] == expected.y1()[i]);
+            assert(clipped.x0()[i] >= 100 && clipped.x1()[i] <= 600 && clipped.y0()[i] >= 200 && clipped.y1()[i] <= 500);
+        }
+    }
+
+    // Extraction from a tree keeps the widget indices, the columns survive growth
+    WidgetTree<std::string> tree("root");
+    tree.attrs(0).set("geometry", {0.0, 0.0, 1280.0, 720.0});
+    tree.add_child(0, "no geometry");
+    for (int i = 0; i < 40; i++) {
+        WidgetIdx w = tree.add_child(0, "box");
+        tree.attrs(w).set("geometry", {static_cast<double>(i), 10.0, 5.0, 5.0});
+    }
+    BoxArray boxes = BoxArray::from_tree(tree);
+    assert(boxes.size() == 41 && boxes.widgets()[0] == 0 && boxes.widgets()[1] == 2 && boxes.x1()[40] == 44 && boxes.y1()[40] == 15);
+    assert(BoxArray::from_tree(tree, std::string("geometry"), true).size() == 42);
+    BoxArray grown;
+    for (int i = 0; i < 100; i++)
+        grown.push_back(i, i, i + 1, i + 2);
+    assert(grown.size() == 100 && grown.x0()[99] == 99 && grown.y1()[0] == 2 && grown.stride() >= 100);
+    return true;
+}
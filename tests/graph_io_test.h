@@ -0,0 +1,115 @@
+#pragma once
+#include "graph_io.h"
+#include "csr_test.h"
+#include "graph_test.h"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+inline bool test_graph_io()
+{
+    using namespace jsc;
+    std::cout << "test_graph_io()" << std::endl;
+    using NodeData = AdjGraph<std::string>::NodeData;
+
+    std::vector<NodeRef> refs;
+    AdjGraph<std::string> g = make_ring_graph(500, refs);
+
+    // Attributes of every kind, a reused node slot, a node without widgets and a non-sequential hyperlink id
+    g.get_node(refs[3]).set("url", std::string("https://example.com"));
+    g.get_node(refs[3]).set("geometry", {0.0, 0.0, 1920.0, 1080.0});
+    g.get_node(refs[3]).set("scores", std::vector<double>{1, 2, 3, 4, 5, 6});
+    g.get_node(refs[3]).set("ids", std::vector<std::int64_t>{7, 8, 9, 10, 11});
+    g.get_node(refs[3]).set("depth", {std::int64_t(2)});
+    g.get_widget(refs[4]).child(1).set("role", std::string("link"));
+    g.del_node(refs[7]);
+    Node<std::string> fresh("fresh");
+    NodeRef rf = g.add_node(fresh, Widget<std::string>("root"));
+    Node<std::string> bare("bare");
+    NodeRef rb = g.add_node(bare);
+    g.del_edge(EdgeRef(refs[5]._internal_id(), refs[6]._internal_id(), g.get_widget(refs[5]).child(0)._hyperlink_id()));
+    // A raw edge whose hyperlink id is above the counter of its node
+    g.get_widget(rf)._set_hyperlink_id(100);
+    Hyperlink<std::string> raw(rf._internal_id(), refs[0]._internal_id(), 100);
+    g.add_edge(raw);
+    assert(g.get_node(rf)._widget_hyperlinks_cnt() == 0);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "jsc_test_graph.bin").string();
+    g.save(path);
+
+    {
+        MappedGraph m(path, MappedGraph::verify_all);
+        assert(m.n_nodes() == g.size() && m.n_nodes() == 501);
+        std::size_t n_edges = 0;
+        g.each([&](const NodeData& nd) { n_edges += nd.edges.size(); });
+        assert(m.n_edges() == n_edges);
+
+        assert(m.index_of(refs[7]) == MappedGraph::npos && m.index_of(rf) != MappedGraph::npos);
+        auto u = m.index_of(refs[3]);
+        assert(m.node_name(u) == "page 3" && m.node_id(u) == refs[3]._internal_id());
+        assert(m.node_attrs(u).get("url").str() == "https://example.com");
+        assert(m.node_attrs(u).get("geometry").at_f64(2) == 1920.0 && m.node_attrs(u).get("geometry").size() == 4);
+        assert(m.node_attrs(u).get("scores").kind() == AttrKind::VecF64 && m.node_attrs(u).get("scores").at_f64(5) == 6);
+        assert(m.node_attrs(u).get("ids").at_i64(4) == 11 && m.node_attrs(u).get("depth").i64() == 2);
+        assert(!m.node_attrs(u).contains("missing"));
+
+        auto w = m.index_of(refs[4]);
+        assert(m.n_widgets(w) == 4 && m.widget_name(w, 0) == "root" && m.widget(w, 2).parent == 0);
+        assert(m.widget_attrs(w, 2).get("role").str() == "link");
+        assert(m.n_widgets(m.index_of(rb)) == 0);
+
+        // Adjacency and backlinks match the live graph
+        g.each([&](const NodeData& nd) {
+            auto v = m.index_of(NodeRef(nd.node._internal_id()));
+            assert(m.out_degree(v) == nd.edges.size() && m.in_degree(v) == nd.backlinks.size());
+            for (std::size_t k = 0; k < nd.edges.size(); k++) {
+                std::size_t e = m.out_offset(v) + k;
+                assert(m.node_id(m.neighbors(v)[k]) == nd.edges[k]._id_to() && m.edge_hyperlink(e) == nd.edges[k]._widget_id());
+                const AttrValue<std::string>* weight = nd.edges[k].get("weight");
+                assert(!weight || m.edge_attrs(e).get("weight").i64() == weight->i64());
+            }
+            for (std::size_t k = 0; k < nd.backlinks.size(); k++)
+                assert(m.node_id(m.backlinks(v)[k]) == nd.backlinks[k].source);
+        });
+
+        // Loading gives the same graph with dense ids
+        AdjGraph<std::string> loaded = m.load<std::string>(true, 4);
+        assert(loaded.size() == g.size());
+        check_backlinks(loaded);
+        std::vector<const NodeData*> a, b;
+        g.each([&](const NodeData& nd) { a.push_back(&nd); });
+        loaded.each([&](const NodeData& nd) { b.push_back(&nd); });
+        for (std::size_t i = 0; i < a.size(); i++) {
+            assert(a[i]->node.name() == b[i]->node.name() && b[i]->node._internal_id() == GraphBuilder<std::string>::node_ref(i)._internal_id());
+            assert(a[i]->node.widget_tree().hyperlink_ids_column() == b[i]->node.widget_tree().hyperlink_ids_column());
+            assert(a[i]->node.widget_tree().names_column() == b[i]->node.widget_tree().names_column());
+            assert(a[i]->node._widget_hyperlinks_cnt() == b[i]->node._widget_hyperlinks_cnt());
+            assert(a[i]->edges.size() == b[i]->edges.size() && a[i]->edge_slots == b[i]->edge_slots && a[i]->edge_backs == b[i]->edge_backs);
+            assert(a[i]->node.size() == b[i]->node.size());
+        }
+        const Node<std::string>& n3 = loaded.get_node(GraphBuilder<std::string>::node_ref(m.index_of(refs[3])));
+        assert(n3.get("scores")->kind() == AttrKind::VecF64 && n3.get("geometry")->kind() == AttrKind::ArrayF64 && n3.get("url")->str() == "https://example.com");
+        const Node<std::string>& nb = loaded.get_node(GraphBuilder<std::string>::node_ref(m.index_of(rb)));
+        assert(nb.name() == "bare" && nb.widget_tree().empty() && !nb.widget().valid());
+        assert(n3.get("ids")->at_i64(0) == 7 && n3.get("depth")->kind() == AttrKind::ArrayI64);
+
+        AdjGraph<std::string> topology = m.load<std::string>(false);
+        assert(topology.size() == g.size() && topology.get_node(GraphBuilder<std::string>::node_ref(u)).size() == 0);
+    }
+
+    // A flipped byte in the string data is caught by the section checksum
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(-1, std::ios::end);
+        f.put('#');
+    }
+    bool thrown = false;
+    try { MappedGraph m(path, MappedGraph::verify_all); } catch (const std::runtime_error&) { thrown = true; }
+    assert(thrown);
+    MappedGraph lazy(path);
+    assert(!lazy.verify(GraphSection::StringData) && lazy.verify(GraphSection::OutTargets));
+
+    std::filesystem::remove(path);
+    return true;
+}
@@ -42,5 +42,351 @@ inline bool test_graph_access()
 
     a.set_widget(b);
     assert(a.widget().name() == "root");
+
+    // Nodes without widgets have an invalid root view
+    Node<std::string> bare("bare");
+    assert(!bare.widget().valid());
+    bare.set_widget(WidgetTree<std::string>());
+    AdjGraph<std::string> g;
+    const NodeRef r = g.add_node(bare);
+    assert(!g.get_widget(r).valid() && g.get_node(r).widget_tree().empty());
+    return true;
+}
+
+inline bool test_attr_keys()
+{
+    using namespace jsc;
+    std::cout << "test_attr_keys()" << std::endl;
+    AttrSet<std::string> a, b;
+
+    a.set("role", std::string("button"));
+    b.set(AttrSet<std::string>::key("role"), std::string("link"));
+
+    AttrKey role = AttrSet<std::string>::key("role");
+    assert(role == KeyInterner<std::string>::global().find("role"));
+    assert(AttrSet<std::string>::key_name(role) == "role");
+    assert(a.get(role)->str() == "button" && b.get("role")->str() == "link");
+
+    // Lookups of unknown keys do not grow the interner
+    std::size_t n_keys = KeyInterner<std::string>::global().size();
+    assert(!a.contains("missing_key") && a.get("missing_key") == nullptr);
+    assert(KeyInterner<std::string>::global().size() == n_keys);
+
+    for (const auto& kv : a)
+        assert(kv.first == "role" && kv.second.str() == "button");
+    return true;
+}
+
+template <class TSet>
+inline void check_attr_storage(TSet& a)
+{
+    for (int i = 0; i < 16; i++)
+        a.set("attr_" + std::to_string(15 - i), jsc::AttrValue<std::string>(i));
+    a.set("attr_3", jsc::AttrValue<std::string>(100)); // set() does not overwrite
+
+    assert(a.size() == 16);
+    for (int i = 0; i < 16; i++)
+        assert(a.contains("attr_" + std::to_string(i)) && a.get("attr_" + std::to_string(i))->i64() == 15 - i);
+
+    std::size_t n = 0;
+    a.each([&](const std::string& k, const jsc::AttrValue<std::string>& v) { assert(a.get(k) == &v); n++; });
+    assert(n == 16);
+
+    // assign() replaces the value of an existing key, including its kind, and inserts a missing one
+    a.assign("attr_3", jsc::AttrValue<std::string>(std::string("replaced")));
+    a.assign(jsc::AttrSet<std::string>::key("attr_16"), jsc::AttrValue<std::string>(16));
+    assert(a.size() == 17 && a.get("attr_3")->str() == "replaced" && a.get("attr_16")->i64() == 16 && a.get("attr_4")->i64() == 11);
+}
+
+inline bool test_attr_storage()
+{
+    using namespace jsc;
+    std::cout << "test_attr_storage()" << std::endl;
+
+    AttrSet<std::string, HashAttrStorage<std::string>> hash_set;
+    AttrSet<std::string, FlatAttrStorage<std::string, 2>> flat_set;
+    check_attr_storage(hash_set);
+    check_attr_storage(flat_set);
+
+    SmallVec<std::string, 2> v{"a", "b"};
+    assert(v.is_inline());
+    v.push_back("c");
+    assert(!v.is_inline() && v.size() == 3 && v[2] == "c");
+    SmallVec<std::string, 2> moved(std::move(v));
+    assert(moved.size() == 3 && v.empty() && v.is_inline());
+    moved.erase(moved.begin());
+    moved.swap_erase(0);
+    assert(moved.size() == 1 && moved[0] == "c");
+
+    // Pushing an element of the vector itself while it grows
+    SmallVec<std::string, 2> self{"first element, longer than the small string buffer", "b"};
+    self.push_back(self[0]);
+    self.push_back(self[0]);
+    self.push_back(self[0]);
+    self.push_back(self[0]);
+    assert(self.size() == 6 && self[2] == self[0] && self[5] == self[0] && self[1] == "b");
+    return true;
+}
+
+inline bool test_attr_value()
+{
+    using namespace jsc;
+    std::cout << "test_attr_value()" << std::endl;
+
+    AttrValue<std::string> v({1.0, 2.0, 3.0});
+    assert(v.is_vec_f64() && v.kind() == AttrKind::ArrayF64 && v.size() == 3);
+    v.push_f64(4.0);
+    assert(v.kind() == AttrKind::ArrayF64 && v.size() == 4);
+    v.push_f64(5.0); // spills to the heap
+    assert(v.kind() == AttrKind::VecF64 && v.size() == 5 && v.at_f64(0) == 1.0 && v.at_f64(4) == 5.0);
+    v.pop();
+    assert(v.size() == 4 && v.at_f64(3) == 4.0);
+
+    AttrValue<std::string> s(std::string("a long string which does not fit into the inline buffer"));
+    AttrValue<std::string> s_copy(s), s_moved(std::move(s_copy));
+    assert(s_moved.str() == s.str());
+    s_copy = s_moved;
+    s_moved = AttrValue<std::string>(42);
+    assert(s_copy.str() == s.str() && s_moved.i64() == 42 && s_moved.size() == 1);
+
+    bool thrown = false;
+    try { s_moved.at_i64(1); } catch (const std::out_of_range&) { thrown = true; }
+    assert(thrown);
+    return true;
+}
+
+inline bool test_widget_tree()
+{
+    using namespace jsc;
+    std::cout << "test_widget_tree()" << std::endl;
+
+    Widget<std::string> root("root"), list("list");
+    list.add_child(Widget<std::string>("item 1")).set("geometry", {0.0, 0.0, 10.0, 10.0});
+    list.add_child(Widget<std::string>("item 2"));
+    root.add_child(list);
+    root.add_child(Widget<std::string>("footer"));
+
+    WidgetTree<std::string> tree(root);
+    assert(tree.size() == 5 && tree.is_preorder());
+    assert(tree.root().children().size() == 2 && tree.root().child(1).name() == "footer");
+    assert(tree.root().child(0).child(0).get("geometry")->at_f64(2) == 10.0);
+    assert(tree.subtree_end(1) == 4 && tree.subtree_end(0) == 5);
+
+    // Appending to the last subtree keeps the preorder, the indices stay stable
+    WidgetView<std::string> footer = tree.root().child(1);
+    WidgetView<std::string> link = footer.add_child("link");
+    assert(tree.is_preorder() && link.index() == 5 && link.parent().index() == footer.index());
+    assert(tree.subtree_end(0) == 6);
+
+    // Appending elsewhere breaks the storage preorder, but not the traversal
+    WidgetView<std::string> item = tree.root().child(0).add_child("item 3");
+    assert(!tree.is_preorder() && item.index() == 6 && link.name() == "link");
+
+    std::vector<std::string> order;
+    tree.each_preorder([&](ConstWidgetView<std::string> w) { order.push_back(w.name()); });
+    assert((order == std::vector<std::string>{"root", "list", "item 1", "item 2", "item 3", "footer", "link"}));
+
+    Widget<std::string> back = tree.to_widget();
+    assert(back.child(0).children().size() == 3 && back.child(1).child(0).name() == "link");
+
+    Node<std::string> page("page");
+    page.set_widget(std::move(tree));
+    assert(page.widget().child(1).name() == "footer");
+    return true;
+}
+
+inline bool test_graph_edges()
+{
+    using namespace jsc;
+    std::cout << "test_graph_edges()" << std::endl;
+
+    AdjGraph<std::string> g;
+    Node<std::string> a("A"), b("B");
+    Widget<std::string> page("root");
+    page.add_child(Widget<std::string>("link 1"));
+    page.add_child(Widget<std::string>("link 2"));
+    page.add_child(Widget<std::string>("link 3"));
+
+    NodeRef ra = g.add_node(a, page), rb = g.add_node(b, page);
+
+    std::vector<EdgeRef> edges;
+    for (std::size_t i = 0; i < 3; i++) {
+        Hyperlink<std::string> h(g.get_node(ra), g.get_node(rb), g.get_widget(ra).child(i));
+        edges.push_back(g.add_edge(h));
+    }
+    Hyperlink<std::string> back(g.get_node(rb), g.get_node(ra), g.get_widget(rb).child(0));
+    g.add_edge(back);
+
+    assert(g.get_edges(ra).size() == 3 && g.get_backlinks(rb).size() == 3);
+    assert(g.get_backlinks(rb)[1].source == ra._internal_id() && g.get_backlinks(rb)[1].hyperlink == edges[1]._widget_id());
+    assert(g.get_widget(WidgetRef(ra._internal_id(), edges[1]._widget_id())).name() == "link 2");
+
+    // A widget keeps its hyperlink id, so a second edge from it is rejected and the first one stays addressable
+    bool linked = false;
+    try {
+        Hyperlink<std::string> again(g.get_node(ra), g.get_node(rb), g.get_widget(ra).child(1));
+        g.add_edge(again);
+    } catch (const std::invalid_argument&) { linked = true; }
+    assert(linked && g.get_edges(ra).size() == 3 && g.get_node(ra)._widget_hyperlinks_cnt() == 3);
+    assert(g.get_widget(WidgetRef(ra._internal_id(), edges[1]._widget_id())).name() == "link 2");
+
+    // add_edge() by widget index checks everything before assigning the hyperlink id
+    Node<std::string> c("C"), d("D");
+    NodeRef rc = g.add_node(c, page), rd = g.add_node(d);
+    g.del_node(rd);
+    const std::size_t npos = std::numeric_limits<std::size_t>::max();
+    for (auto [to, widget] : {std::pair<NodeRef, WidgetIdx>{rd, 1}, {rb, 9}}) {
+        bool rejected = false;
+        try { g.add_edge(rc, to, widget); } catch (const std::invalid_argument&) { rejected = true; }
+        assert(rejected);
+    }
+    assert(g.get_widget(rc).child(0)._hyperlink_id() == npos && g.get_node(rc)._widget_hyperlinks_cnt() == 0);
+    EdgeRef rc_edge = g.add_edge(rc, rb, 2);
+    linked = false;
+    try { g.add_edge(rc, ra, 2); } catch (const std::invalid_argument&) { linked = true; }
+    assert(linked && g.get_edges(rc).size() == 1 && g.get_node(rc)._widget_hyperlinks_cnt() == 1);
+    assert(g.get_widget(WidgetRef(rc._internal_id(), rc_edge._widget_id())).name() == "link 2");
+    g.del_node(rc);
+
+    // Deleting an edge unsets the widget hyperlink id and keeps the other edges addressable
+    g.del_edge(edges[0]);
+    assert(g.get_edges(ra).size() == 2 && g.get_backlinks(rb).size() == 2);
+    assert(g.get_widget(ra).child(0)._hyperlink_id() == std::numeric_limits<std::size_t>::max());
+    assert(g.get_edge(edges[2])._widget_id() == edges[2]._widget_id());
+    assert(g.get_widget(WidgetRef(ra._internal_id(), edges[2]._widget_id())).name() == "link 3");
+
+#ifdef ALWAYS_THROW_ON_ERROR
+    bool thrown = false;
+    try { g.del_edge(edges[0]); } catch (const std::out_of_range&) { thrown = true; }
+    assert(thrown);
+#else
+    assert(!g.del_edge(edges[0]));
+#endif
+
+    g.del_node(g.get_node(ra));
+    assert(g.size() == 1 && g.get_backlinks(rb).empty() && g.get_edges(rb).empty());
+    assert(!g.contains(ra) && g.contains(rb));
+    return true;
+}
+
+
+inline bool test_graph_stale_refs()
+{
+    using namespace jsc;
+    std::cout << "test_graph_stale_refs()" << std::endl;
+
+    AdjGraph<std::string> g;
+    Node<std::string> a("A"), b("B");
+    NodeRef ra = g.add_node(a), rb = g.add_node(b);
+    g.del_node(ra);
+
+    // The freed slot is reused, but the old reference must not resolve to the new node
+    Node<std::string> c("C");
+    NodeRef rc = g.add_node(c);
+    assert(SlotMap<int>::slot_of(rc._internal_id()) == SlotMap<int>::slot_of(ra._internal_id()));
+    assert(rc._internal_id() != ra._internal_id());
+    assert(!g.contains(ra) && g.contains(rb) && g.contains(rc));
+    assert(g.get_node(rc).name() == "C" && g.get_node(rb).name() == "B");
+
+    bool thrown = false;
+    try { g.get_node(ra); } catch (const std::invalid_argument&) { thrown = true; }
+    assert(thrown);
+
+    // Churn keeps the slot table bounded by the peak node count
+    for (int i = 0; i < 1000; i++) {
+        Node<std::string> n("tmp");
+        g.del_node(g.add_node(n));
+    }
+    assert(g.size() == 2 && g.slot_count() == 3);
+
+    SlotMap<int> sm;
+    auto i0 = sm.insert(0), i1 = sm.insert(1), i2 = sm.insert(2);
+    sm.erase(i0);
+    assert(sm.at(i1) == 1 && sm.at(i2) == 2 && !sm.find(i0));
+    sm.clear();
+    assert(sm.empty() && !sm.contains(i1) && !sm.contains(i2));
+    return true;
+}
+
+
+/**
+ * @brief Check that every edge points to its own backlink and that there are no extra backlinks
+ */
+inline bool check_backlinks(const jsc::AdjGraph<std::string>& g)
+{
+    using namespace jsc;
+    std::size_t n_edges = 0, n_backlinks = 0;
+    g.each([&](const AdjGraph<std::string>::NodeData& nd) {
+        n_edges += nd.edges.size();
+        n_backlinks += nd.backlinks.size();
+        assert(nd.edge_backs.size() == nd.edges.size());
+        for (std::size_t i = 0; i < nd.edges.size(); i++) {
+            const auto& b = g.get_backlinks(NodeRef(nd.edges[i]._id_to()))[nd.edge_backs[i]];
+            assert(b.source == nd.node._internal_id() && b.hyperlink == nd.edges[i]._widget_id());
+        }
+    });
+    assert(n_edges == n_backlinks);
+    return true;
+}
+
+inline bool test_graph_del_hub()
+{
+    using namespace jsc;
+    std::cout << "test_graph_del_hub()" << std::endl;
+
+    // Every page links to the hub twice (multi-edge), the hub links to every page and to itself
+    constexpr std::size_t n = 200;
+    AdjGraph<std::string> g;
+    Node<std::string> hub_node("hub");
+    WidgetTree<std::string> hub_tree(std::string("root"));
+    for (std::size_t i = 0; i <= n; i++)
+        hub_tree.add_child(0, "link");
+    hub_node.set_widget(std::move(hub_tree));
+    NodeRef hub = g.add_node(hub_node);
+
+    std::vector<NodeRef> refs;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        Widget<std::string> root("root");
+        for (int j = 0; j < 3; j++)
+            root.add_child(Widget<std::string>("link"));
+        refs.push_back(g.add_node(node, root));
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t j = 0; j < 2; j++) {
+            Hyperlink<std::string> h(g.get_node(refs[i]), g.get_node(hub), g.get_widget(refs[i]).child(j));
+            g.add_edge(h);
+        }
+        Hyperlink<std::string> next(g.get_node(refs[i]), g.get_node(refs[(i + 1) % n]), g.get_widget(refs[i]).child(2));
+        g.add_edge(next);
+        Hyperlink<std::string> out(g.get_node(hub), g.get_node(refs[i]), g.get_widget(hub).child(i));
+        g.add_edge(out);
+    }
+    Hyperlink<std::string> self(g.get_node(hub), g.get_node(hub), g.get_widget(hub).child(n));
+    EdgeRef self_ref = g.add_edge(self);
+    assert(g.get_backlinks(hub).size() == 2 * n + 1);
+    check_backlinks(g);
+
+    // Removing a single multi-edge keeps its twin
+    EdgeRef twin(refs[0]._internal_id(), hub._internal_id(), g.get_widget(refs[0]).child(0)._hyperlink_id());
+    g.del_edge(twin);
+    assert(g.get_edges(refs[0]).size() == 2 && g.get_backlinks(hub).size() == 2 * n);
+    g.del_edge(self_ref);
+    check_backlinks(g);
+
+    g.del_node(hub);
+    assert(g.size() == n);
+    for (std::size_t i = 0; i < n; i++) {
+        assert(g.get_edges(refs[i]).size() == 1 && g.get_backlinks(refs[i]).size() == 1);
+        assert(g.get_backlinks(refs[i])[0].source == refs[(i + n - 1) % n]._internal_id());
+    }
+    check_backlinks(g);
+
+    // Deleting the ring one page at a time leaves no dangling backlinks
+    for (std::size_t i = 0; i < n; i += 2)
+        g.del_node(refs[i]);
+    check_backlinks(g);
+    for (std::size_t i = 1; i < n; i += 2)
+        assert(g.get_edges(refs[i]).empty() && g.get_backlinks(refs[i]).empty());
     return true;
 }
@@ -1,5 +1,20 @@
 #include "graph.h"
 #include "graph_test.h"
+#include "csr_test.h"
+#include "builder_test.h"
+#include "graph_io_test.h"
+#include "webui_test.h"
+#include "webui_dataset_test.h"
+#include "spatial_test.h"
+#include "geometry_test.h"
+#include "traversal_test.h"
+#include "pagerank_test.h"
+#include "ann_test.h"
+#include "text_index_test.h"
+#include "gather_test.h"
+#include "snapshot_test.h"
+#include "sharded_graph_test.h"
+#include "stats_test.h"
 
 #include <iostream>
 
@@ -7,6 +22,30 @@ int main()
 {
     test_graph_init();
     test_graph_access();
+    test_attr_keys();
+    test_attr_storage();
+    test_attr_value();
+    test_widget_tree();
+    test_graph_edges();
+    test_graph_stale_refs();
+    test_graph_del_hub();
+    test_csr_snapshot();
+    test_graph_builder();
+    test_graph_io();
+    test_json_reader();
+    test_webui_loader();
+    test_webui_best_screen();
+    test_webui_dataset();
+    test_widget_index();
+    test_box_kernels();
+    test_bfs();
+    test_pagerank();
+    test_ann_index();
+    test_text_index();
+    test_gather();
+    test_graph_snapshot();
+    test_sharded_graph();
+    test_stats();
     std::cout << "===========" << std::endl << "TESTS PASSED" << std::endl;
     return 0;
 }
@@ -0,0 +1,118 @@
+#pragma once
+#include "pagerank.h"
+#include "traversal_test.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Sequential power iteration which pushes the scores along the edges, the reference for jsc::personalized_pagerank()
+ */
+inline std::vector<double> reference_pagerank(const jsc::CsrGraph<std::string>& g, const std::vector<std::uint32_t>& seeds, jsc::Direction dir, double damping,
+                                              std::size_t n_iter)
+{
+    using namespace jsc;
+    const std::size_t n = g.n_nodes();
+    std::vector<double> restart(n, seeds.empty() ? 1.0 / n : 0.0), x, y(n);
+    for (auto s : seeds)
+        restart[s] += 1.0 / seeds.size();
+    x = restart;
+    for (std::size_t it = 0; it < n_iter; it++) {
+        std::fill(y.begin(), y.end(), 0.0);
+        double lost = 0;
+        for (std::uint32_t u = 0; u < n; u++) {
+            const bool out = dir != Direction::In, in = dir != Direction::Out;
+            const std::size_t deg = (out ? g.out_degree(u) : 0) + (in ? g.in_degree(u) : 0);
+            if (deg == 0)
+                lost += x[u];
+            for (auto v : g.neighbors(u))
+                y[v] += out ? damping * x[u] / deg : 0.0;
+            for (auto v : g.backlinks(u))
+                y[v] += in ? damping * x[u] / deg : 0.0;
+        }
+        for (std::size_t v = 0; v < n; v++)
+            y[v] += (damping * lost + 1.0 - damping) * restart[v];
+        x.swap(y);
+    }
+    return x;
+}
+
+inline double l1_distance(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double sum = 0;
+    for (std::size_t i = 0; i < a.size(); i++)
+        sum += std::abs(a[i] - b[i]);
+    return sum;
+}
+
+inline bool test_pagerank()
+{
+    using namespace jsc;
+    std::cout << "test_pagerank()" << std::endl;
+
+    constexpr std::size_t n = 5000;
+    std::mt19937 rng(23);
+    AdjGraph<std::string> adj = make_hub_graph(n, 6, rng);
+    CsrGraph<std::string> g = adj.freeze();
+
+    for (Direction dir : {Direction::Out, Direction::In, Direction::Both}) {
+        for (const std::vector<std::uint32_t>& seeds : {std::vector<std::uint32_t>{}, {3}, {0, 50, 50, 4999}}) {
+            auto expected = reference_pagerank(g, seeds, dir, 0.85, 200);
+            for (std::size_t n_threads : {1, 4}) {
+                PageRankOptions opts;
+                opts.direction = dir;
+                opts.n_threads = n_threads;
+                opts.tol = 1e-12;
+                opts.max_iter = 500;
+                PageRankResult res = personalized_pagerank(g, seeds, opts);
+                assert(res.delta < 1e-12 && res.n_iter < 500);
+                assert(l1_distance(res.scores, expected) < 1e-9);
+                double sum = 0;
+                for (double s : res.scores)
+                    sum += s;
+                assert(std::abs(sum - 1.0) < 1e-9);
+            }
+        }
+
+        // Local pushes, the buffers are reused between queries
+        PprPush<std::string> push(g, dir);
+        for (const std::vector<std::uint32_t>& seeds : {std::vector<std::uint32_t>{3}, {0, 50, 50, 4999}, {3}}) {
+            auto expected = reference_pagerank(g, seeds, dir, 0.85, 200);
+            for (double epsilon : {1e-4, 1e-7}) {
+                push.run(seeds, 0.85, epsilon);
+                std::vector<double> approx(n);
+                for (std::uint32_t u = 0; u < n; u++)
+                    approx[u] = push.score(u);
+                const double err = l1_distance(approx, expected);
+                assert(err <= push.residual() + 1e-9);
+                assert(epsilon > 1e-6 || err < 1e-3);
+
+                auto top = push.top_k(10);
+                assert(top.size() <= 10 && top.front().second == *std::max_element(approx.begin(), approx.end()));
+                for (std::size_t i = 1; i < top.size(); i++)
+                    assert(top[i - 1].second >= top[i].second);
+            }
+        }
+        // A coarse epsilon only touches the neighborhood of the seed
+        push.run({3}, 0.85, 1e-3);
+        assert(push.n_touched() < n);
+    }
+
+    // Top-k of the AdjGraph overload
+    auto scores = personalized_pagerank(g, {7}).scores;
+    auto top = top_k_scores(scores, 20);
+    auto refs = personalized_pagerank(adj, {g.node_ref(7)}, 20);
+    assert(top.size() == 20 && refs.size() == 20 && top.front().first == 7);
+    for (std::size_t i = 0; i < top.size(); i++)
+        assert(refs[i].first._internal_id() == g.node_ref(top[i].first)._internal_id() && std::abs(refs[i].second - top[i].second) < 1e-12);
+
+    bool thrown = false;
+    try {
+        PprPush<std::string>(g).run({static_cast<std::uint32_t>(n)});
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "sharded_graph.h"
+#include "snapshot_test.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+
+inline bool test_sharded_graph()
+{
+    using namespace jsc;
+    std::cout << "test_sharded_graph()" << std::endl;
+
+    // One writer : backlinks wait in the mailboxes until sync(), dangling ones stay queued
+    {
+        ShardedGraph<std::string> g(4);
+        auto w = g.writer(8, 2);
+        NodeRef a = w.add_node(make_link_page(0, 3)), b = w.add_node(make_link_page(1, 1));
+        const NodeRef later(2), never(1000);
+        w.add_edge(a, b, 1);
+        w.add_edge(a, later, 2);
+        w.add_edge(a, never, 3);
+        w.add_edge(b, a, 0);
+        bool thrown = false;
+        try {
+            w.add_edge(a, b, 1); // widget already linked
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+        thrown = false;
+        try {
+            w.add_edge(b, a, 5); // no such widget
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+        w.flush();
+        assert(g.get_backlinks(b).empty());
+        assert(g.sync() == 2 && g.get_backlinks(b).size() == 1 && g.get_backlinks(a).size() == 1);
+        assert(w.add_node(make_link_page(2, 0))._internal_id() == later._internal_id());
+        assert(g.sync() == 1 && g.get_backlinks(later).size() == 1);
+        assert(g.n_edges() == 4 && g.sync(true) == 0 && g.n_edges() == 3 && g.get_edges(a).size() == 2);
+        assert(g.size() == 3 && g.id_bound() == 8 && g.get_node(b).get("i")->at_i64(0) == 1);
+    }
+
+    // Several writers : nodes first, then edges to nodes of every writer
+    constexpr std::size_t n_threads = 4, per_thread = 300, out_deg = 3;
+    ShardedGraph<std::string> g(8);
+    std::vector<std::vector<NodeRef>> refs(n_threads);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t] {
+            auto w = g.writer(64, 16);
+            for (std::size_t i = 0; i < per_thread; i++)
+                refs[t].push_back(w.add_node(make_link_page(t * per_thread + i, out_deg)));
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    threads.clear();
+    for (std::size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t] {
+            auto w = g.writer(64, 16);
+            for (std::size_t i = 0; i < per_thread; i++) {
+                for (std::size_t j = 0; j < out_deg; j++)
+                    w.add_edge(refs[t][i], refs[(t + j) % n_threads][(i * 7 + j) % per_thread], static_cast<WidgetIdx>(1 + j));
+            }
+        });
+    }
+    std::thread syncer([&] { g.sync(); }); // concurrent with the writers
+    for (auto& th : threads)
+        th.join();
+    syncer.join();
+    assert(g.sync() == 0);
+    assert(g.size() == n_threads * per_thread && g.n_edges() == n_threads * per_thread * out_deg);
+
+    std::size_t n_back = 0;
+    g.each([&](const ShardedGraph<std::string>::NodeData& nd) {
+        const NodeRef ref(nd.node._internal_id());
+        for (const auto& e : nd.edges) {
+            const auto& back = g.get_backlinks(e.to);
+            assert(std::find(back.begin(), back.end(), ref._internal_id()) != back.end());
+        }
+        n_back += nd.backlinks.size();
+    });
+    assert(n_back == g.n_edges());
+
+    // Conversion to an AdjGraph in id order
+    const std::size_t edges_before = g.n_edges();
+    const std::size_t some = refs[2][17]._internal_id();
+    const std::size_t some_out = g.get_edges(refs[2][17]).size(), some_in = g.get_backlinks(refs[2][17]).size();
+    std::vector<std::size_t> ids;
+    AdjGraph<std::string> adj = g.build(&ids);
+    assert(g.size() == 0 && adj.size() == n_threads * per_thread && std::is_sorted(ids.begin(), ids.end()));
+    std::size_t n_adj_edges = 0;
+    adj.each([&](const AdjGraph<std::string>::NodeData& nd) { n_adj_edges += nd.edges.size(); });
+    assert(n_adj_edges == edges_before);
+    const std::size_t k = static_cast<std::size_t>(std::lower_bound(ids.begin(), ids.end(), some) - ids.begin());
+    const NodeRef converted = GraphBuilder<std::string>::node_ref(k);
+    assert(adj.get_node(converted).get("i")->at_i64(0) == 2 * per_thread + 17);
+    assert(adj.get_edges(converted).size() == some_out && adj.get_backlinks(converted).size() == some_in);
+    return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "snapshot.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <thread>
+
+/**
+ * @brief Page "page i" with n_links link widgets under the root and the attribute i, shared by the snapshot and sharded graph tests
+ */
+inline jsc::Node<std::string> make_link_page(std::size_t i, std::size_t n_links)
+{
+    using namespace jsc;
+    Node<std::string> node("page " + std::to_string(i));
+    WidgetTree<std::string> tree(std::string("root"));
+    for (std::size_t j = 0; j < n_links; j++)
+        tree.add_child(0, "link");
+    node.set_widget(std::move(tree));
+    node.set("i", AttrValue<std::string>(static_cast<std::int64_t>(i)));
+    return node;
+}
+
+/**
+ * @brief Checks that a snapshot is closed : every edge has a backlink and the counts match
+ */
+inline bool snapshot_consistent(const jsc::GraphSnapshot<std::string>& s)
+{
+    using namespace jsc;
+    std::size_t n = 0, out = 0, in = 0;
+    bool ok = true;
+    s.each([&](NodeRef ref, const Node<std::string>& node) {
+        n++;
+        ok = ok && node._internal_id() == ref._internal_id();
+        for (const auto& e : s.get_edges(ref)) {
+            ok = ok && s.contains(e.to);
+            const auto& back = s.get_backlinks(e.to);
+            ok = ok && std::find(back.begin(), back.end(), ref._internal_id()) != back.end();
+        }
+        out += s.get_edges(ref).size();
+        in += s.get_backlinks(ref).size();
+    });
+    return ok && n == s.size() && out == s.n_edges() && in == s.n_edges();
+}
+
+inline bool test_graph_snapshot()
+{
+    using namespace jsc;
+    std::cout << "test_graph_snapshot()" << std::endl;
+
+    VersionedGraph<std::string> g(8);
+    GraphSnapshot<std::string> empty = g.snapshot();
+    assert(empty.version() == 0 && empty.size() == 0);
+
+    std::vector<NodeRef> refs;
+    for (std::size_t i = 0; i < 600; i++)
+        refs.push_back(g.add_node(make_link_page(i, 2)));
+    for (std::size_t i = 0; i < 600; i++) {
+        g.add_edge(refs[i], refs[(i + 1) % 600], 1);
+        g.add_edge(refs[i], refs[(i * 7) % 600], 2);
+    }
+    assert(g.snapshot().size() == 0); // not published yet
+    assert(g.publish() == 1);
+
+    GraphSnapshot<std::string> s1 = g.snapshot();
+    assert(s1.version() == 1 && s1.size() == 600 && s1.n_edges() == 1200 && snapshot_consistent(s1));
+    assert(s1.get_node(refs[42]).get("i")->at_i64(0) == 42);
+
+    // Writes after a publish do not show in the pinned version
+    Node<std::string> updated = make_link_page(1042, 2);
+    g.update_node(refs[42], std::move(updated));
+    assert(g.del_node(refs[7]) && !g.del_node(refs[7]));
+    assert(g.del_edge(refs[0], refs[1], 1) && !g.del_edge(refs[0], refs[1], 1));
+    NodeRef added = g.add_node(make_link_page(600, 1));
+    g.add_edge(added, refs[42], 1);
+    g.publish();
+
+    GraphSnapshot<std::string> s2 = g.snapshot();
+    assert(s1.size() == 600 && s1.contains(refs[7]) && !s1.contains(added) && snapshot_consistent(s1));
+    assert(s1.get_node(refs[42]).get("i")->at_i64(0) == 42);
+    assert(s2.size() == 600 && !s2.contains(refs[7]) && s2.contains(added) && snapshot_consistent(s2));
+    assert(s2.get_node(refs[42]).get("i")->at_i64(0) == 1042 && s2.get_node(refs[42])._internal_id() == refs[42]._internal_id());
+    assert(s2.n_edges() == 1200 - 1 - 4 + 1); // node 7 : 2 out edges, 2 in edges (6 -> 7 and 1 -> 7)
+    bool thrown = false;
+    try {
+        s2.get_edges(refs[7]);
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        g.add_edge(refs[0], refs[1], 5); // no such widget
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Versions pinned by s1 (and the empty snapshot) stay until released
+    assert(g.n_retired() == 2);
+    empty.release();
+    s1.release();
+    s2.release();
+    assert(g.reclaim() == 0);
+
+    // Readers against a writer publishing after every batch
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> n_checked{0};
+    std::atomic<bool> all_ok{true};
+    std::vector<std::thread> readers;
+    for (std::size_t t = 0; t < 3; t++) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            do {
+                GraphSnapshot<std::string> s = g.snapshot();
+                if (s.version() < last || !snapshot_consistent(s))
+                    all_ok = false;
+                last = s.version();
+                n_checked++;
+            } while (!done.load());
+        });
+    }
+    std::size_t n_nodes = 601;
+    for (std::size_t round = 0; round < 50; round++) {
+        for (std::size_t i = 0; i < 20; i++) {
+            NodeRef ref = g.add_node(make_link_page(n_nodes, 1));
+            g.add_edge(ref, refs[10 + (round * 20 + i) % 490], 1);
+            g.add_edge(refs[10 + (round * 13 + i) % 490], ref, 0);
+            n_nodes++;
+        }
+        g.del_node(refs[500 + round]); // nodes 500+ are never linked to in this loop
+        g.publish();
+    }
+    done = true;
+    for (auto& t : readers)
+        t.join();
+    assert(all_ok && n_checked > 0);
+    assert(g.reclaim() == 0);
+    GraphSnapshot<std::string> last = g.snapshot();
+    assert(last.version() == 52 && last.size() == g.size() && snapshot_consistent(last));
+    return true;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "spatial.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Random page layout : every widget gets a box inside its parent's box, some have no geometry or an empty box
+ */
+inline jsc::WidgetTree<std::string> make_layout_tree(std::size_t n, std::mt19937& rng)
+{
+    using namespace jsc;
+    WidgetTree<std::string> tree("RootWebArea");
+    tree.attrs(0).set("geometry", {0.0, 0.0, 1920.0, 4000.0});
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    while (tree.size() < n) {
+        WidgetIdx parent = static_cast<WidgetIdx>(rng() % tree.size());
+        WidgetIdx w = tree.add_child(parent, "generic");
+        const AttrValue<std::string>* pg = tree.attrs(parent).get("geometry");
+        double px = 0, py = 0, pw = 1920, ph = 4000;
+        if (pg)
+            px = pg->at_f64(0), py = pg->at_f64(1), pw = pg->at_f64(2), ph = pg->at_f64(3);
+        std::size_t kind = rng() % 10;
+        if (kind == 0)
+            continue; // no geometry
+        double x = px + unit(rng) * pw * 0.7, y = py + unit(rng) * ph * 0.7;
+        double width = kind == 1 ? 0.0 : unit(rng) * (px + pw - x), height = unit(rng) * (py + ph - y);
+        tree.attrs(w).set("geometry", {x, y, width, height});
+    }
+    return tree;
+}
+
+inline bool spatial_contains(const jsc::WidgetTree<std::string>& tree, jsc::WidgetIdx w, double x, double y, double width = 0, double height = 0)
+{
+    const auto* g = tree.attrs(w).get("geometry");
+    if (!g || g->at_f64(2) <= 0 || g->at_f64(3) <= 0)
+        return false;
+    return g->at_f64(0) <= x + width && x <= g->at_f64(0) + g->at_f64(2) && g->at_f64(1) <= y + height && y <= g->at_f64(1) + g->at_f64(3);
+}
+
+inline double spatial_dist2(const jsc::WidgetTree<std::string>& tree, jsc::WidgetIdx w, double x, double y)
+{
+    const auto* g = tree.attrs(w).get("geometry");
+    return jsc::WidgetIndex::Rect::from_geometry(g->at_f64(0), g->at_f64(1), g->at_f64(2), g->at_f64(3)).dist2(x, y);
+}
+
+/**
+ * @brief Compare every query with a scan of the whole tree
+ */
+inline void check_widget_index(const jsc::WidgetTree<std::string>& tree, const jsc::WidgetIndex& index, std::mt19937& rng)
+{
+    using namespace jsc;
+    std::vector<std::size_t> depth(tree.size(), 0);
+    for (WidgetIdx i = 1; i < tree.size(); i++)
+        depth[i] = depth[tree.links(i).parent] + 1;
+
+    std::uniform_real_distribution<double> px(-100.0, 2000.0), py(-100.0, 4100.0), size(0.0, 400.0);
+    for (int q = 0; q < 200; q++) {
+        double x = px(rng), y = py(rng), width = size(rng), height = size(rng);
+
+        std::vector<WidgetIdx> hits = index.at(x, y), expected;
+        WidgetIdx deepest = widget_npos;
+        for (WidgetIdx w = 0; w < tree.size(); w++) {
+            if (!spatial_contains(tree, w, x, y))
+                continue;
+            expected.push_back(w);
+            if (deepest == widget_npos || depth[w] >= depth[deepest])
+                deepest = w;
+        }
+        std::sort(hits.begin(), hits.end());
+        assert(hits == expected && index.deepest_at(x, y) == deepest);
+
+        std::vector<WidgetIdx> inter = index.intersecting(x, y, width, height);
+        expected.clear();
+        for (WidgetIdx w = 0; w < tree.size(); w++)
+            if (spatial_contains(tree, w, x, y, width, height))
+                expected.push_back(w);
+        std::sort(inter.begin(), inter.end());
+        assert(inter == expected);
+
+        // k nearest : the distances must match the k smallest ones
+        std::vector<double> all;
+        for (WidgetIdx w = 0; w < tree.size(); w++)
+            if (spatial_contains(tree, w, -1e18, -1e18, 2e18, 2e18))
+                all.push_back(spatial_dist2(tree, w, x, y));
+        std::sort(all.begin(), all.end());
+        std::vector<WidgetIdx> near = index.nearest(x, y, 10);
+        assert(near.size() == std::min<std::size_t>(10, all.size()));
+        for (std::size_t i = 0; i < near.size(); i++)
+            assert(spatial_dist2(tree, near[i], x, y) == all[i]);
+    }
+}
+
+inline bool test_widget_index()
+{
+    using namespace jsc;
+    std::cout << "test_widget_index()" << std::endl;
+
+    std::mt19937 rng(13);
+    WidgetTree<std::string> tree = make_layout_tree(3000, rng);
+    WidgetIndex index(tree);
+    check_widget_index(tree, index, rng);
+
+    // Empty and single widget trees
+    WidgetTree<std::string> none;
+    WidgetIndex empty_index(none);
+    assert(empty_index.empty() && empty_index.at(0, 0).empty() && empty_index.deepest_at(0, 0) == widget_npos && empty_index.nearest(0, 0, 3).empty());
+    WidgetTree<std::string> one("root");
+    one.attrs(0).set("geometry", {10.0, 10.0, 5.0, 5.0});
+    WidgetIndex one_index(one);
+    assert(one_index.deepest_at(12, 12) == 0 && one_index.deepest_at(0, 0) == widget_npos && one_index.nearest(0, 0, 3) == std::vector<WidgetIdx>{0});
+
+    // Moving a few widgets refits in place, an emptied box stops matching
+    std::size_t moved = 0;
+    for (WidgetIdx w = 1; w < 200; w += 7) {
+        if (AttrValue<std::string>* g = tree.attrs(w).get("geometry")) {
+            g->at_f64(0) = static_cast<double>(w);
+            g->at_f64(1) = 3900.0;
+            moved += g->at_f64(2) > 0; // empty boxes stay empty
+        }
+    }
+    tree.attrs(0).get("geometry")->at_f64(2) = 0.0;
+    assert(index.refresh(tree) == moved + 1 && index.refresh(tree) == 0);
+    check_widget_index(tree, index, rng);
+
+    // New widgets rebuild the index
+    WidgetIdx added = tree.add_child(0, "dialog");
+    tree.attrs(added).set("geometry", {-50.0, -50.0, 10.0, 10.0});
+    index.refresh(tree);
+    assert(index.deepest_at(-45, -45) == added);
+    check_widget_index(tree, index, rng);
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "csr.h"
+#include "graph_builder.h"
+#include "json_reader.h"
+#include "stats.h"
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+inline bool test_stats()
+{
+    using namespace jsc;
+    std::cout << "test_stats()" << std::endl;
+
+    stats_reset();
+    stats_enable_timers(true);
+
+    AttrValue<std::string> v{1.0, 2.0, 3.0, 4.0};
+    v.push_f64(5.0); // spill
+    v.push_f64(6.0);
+    double sum = v.at_f64(0) + AttrValue<std::string>{1.0}.at_f64(0);
+    assert(sum == 2.0);
+
+    // A star around a ring : deleting the hub removes its 10 backlinks and its edge
+    GraphBuilder<std::string> builder;
+    for (std::size_t i = 0; i < 11; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        tree.add_child(0, "link");
+        tree.add_child(0, "link");
+        node.set_widget(std::move(tree));
+        builder.add_node(std::move(node));
+    }
+    for (std::size_t i = 1; i < 11; i++) {
+        builder.add_edge(i, 0, 1);
+        builder.add_edge(i, 1 + i % 10, 2);
+    }
+    builder.add_edge(0, 5, 1);
+    AdjGraph<std::string> g = builder.build();
+    const NodeRef hub = GraphBuilder<std::string>::node_ref(0);
+    g.del_node(hub);
+
+    // Another thread's counters are kept after it exits
+    std::thread([] {
+        AttrValue<std::string> w(std::vector<std::int64_t>{1, 2, 3, 4, 5});
+        assert(w.at_i64(4) == 5);
+    }).join();
+
+    const StatsSnapshot s = stats_snapshot();
+    assert(s.enabled == stats_enabled());
+    if (stats_enabled()) {
+        assert(s.counter(Counter::AttrSpill) == 1);
+        assert(s.counter(Counter::AtF64Vector) == 1 && s.counter(Counter::AtF64Array) >= 1 && s.counter(Counter::AtI64Vector) == 1);
+        assert(s.counter(Counter::DelNode) == 1 && s.counter(Counter::DelNodeEdges) == 11);
+        assert(s.calls(Timer::DelNode) == 1 && s.calls(Timer::AttrSpill) == 1);
+        assert(std::string(counter_name(Counter::DelNodeEdges)) == "del_node_edges");
+        stats_reset();
+        assert(stats_snapshot().counter(Counter::DelNode) == 0);
+    } else {
+        assert(s.counter(Counter::DelNode) == 0);
+    }
+    stats_enable_timers(false);
+
+    // Chrome trace of a build and a freeze inside a user scope
+    Tracer& tracer = Tracer::instance();
+    tracer.start();
+    {
+        TraceScope scope("ingest");
+        AdjGraph<std::string> built = GraphBuilder<std::string>().build();
+        built.freeze();
+    }
+    tracer.stop();
+    {
+        TraceScope ignored("after stop");
+    }
+    const std::size_t n_events = tracer.n_events();
+    assert(n_events == (stats_enabled() ? 3 : 1));
+
+    const std::string path = "jsc_test_trace.json";
+    assert(tracer.write(path));
+    std::ifstream in(path);
+    const std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    MemorySource src(data);
+    JsonReader<MemorySource> reader(src);
+    std::string key, field, name;
+    std::size_t n_complete = 0;
+    bool ingest = false;
+    reader.begin_object();
+    while (reader.next_key(key)) {
+        if (key != "traceEvents") {
+            reader.skip();
+            continue;
+        }
+        reader.begin_array();
+        while (reader.next_element()) {
+            reader.begin_object();
+            while (reader.next_key(field)) {
+                if (field == "name") {
+                    reader.read_string(name);
+                    ingest = ingest || name == "ingest";
+                } else if (field == "ph") {
+                    n_complete += reader.read_string() == "X";
+                } else {
+                    reader.skip();
+                }
+            }
+        }
+    }
+    assert(ingest && n_complete == n_events);
+    std::remove(path.c_str());
+    return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "text_index.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Random sentence over a skewed vocabulary of w0..w199, so that a few terms are in most docs and most terms are rare
+ */
+inline std::string make_text(std::size_t n_words, std::mt19937& rng)
+{
+    std::string out;
+    for (std::size_t i = 0; i < n_words; i++) {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        out += (i ? " " : "") + std::string(i % 3 ? "w" : "W") + std::to_string(static_cast<std::size_t>(200.0 * u * u * u));
+    }
+    return out;
+}
+
+inline jsc::Node<std::string> make_text_page(std::size_t i, std::mt19937& rng)
+{
+    using namespace jsc;
+    static const char* roles[] = {"button", "link", "heading", "textbox"};
+    Node<std::string> node("https://example.com/" + std::to_string(i));
+    WidgetTree<std::string> tree{std::string()};
+    const std::size_t n_widgets = 1 + rng() % 6;
+    for (std::size_t j = 0; j < n_widgets; j++) {
+        // Named like WebUI widgets : the AX name is both the widget name and the name attribute
+        const char* role = roles[rng() % 4];
+        const std::string name = rng() % 4 ? make_text(1 + rng() % 8, rng) : std::string();
+        WidgetIdx w = tree.add_child(0, name);
+        tree.attrs(w).set("role", AttrValue<std::string>(std::string(role)));
+        if (!name.empty())
+            tree.attrs(w).set("name", AttrValue<std::string>(name));
+        if (rng() % 3 == 0)
+            tree.attrs(w).set("text", AttrValue<std::string>(make_text(1 + rng() % 20, rng)));
+    }
+    node.set_widget(std::move(tree));
+    return node;
+}
+
+inline bool same_hits(const std::vector<jsc::TextHit>& a, const std::vector<jsc::TextHit>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+        if (a[i].node._internal_id() != b[i].node._internal_id() || a[i].widget != b[i].widget || a[i].score != b[i].score)
+            return false;
+    return true;
+}
+
+inline bool test_text_index()
+{
+    using namespace jsc;
+    std::cout << "test_text_index()" << std::endl;
+
+    std::vector<std::string> tokens;
+    text_tokenize("Sign-in, NOW!  2fa\xc3\xa9t\xc3\xa9 ", [&](std::string_view t) { tokens.emplace_back(t); });
+    assert((tokens == std::vector<std::string>{"sign", "in", "now", "2fa\xc3\xa9t\xc3\xa9"}));
+
+    // Posting lists over several blocks, seeks across and inside blocks
+    PostingList list;
+    for (std::uint32_t doc = 0; doc < 1000; doc++)
+        list.push_back(doc * 7, doc % 5 + 1, 3);
+    assert(list.size() == 1000 && list.max_tf() == 5 && list.min_len() == 3);
+    PostingList::Cursor c(list);
+    assert(c.doc() == 0 && c.tf() == 1);
+    c.seek(700);
+    assert(c.doc() == 700 && c.tf() == 1);
+    c.seek(701);
+    assert(c.doc() == 707);
+    c.next();
+    assert(c.doc() == 714 && c.tf() == 3);
+    c.seek(6993);
+    assert(c.doc() == 6993 && !c.end());
+    c.next();
+    assert(c.end());
+
+    // BM25 of a single doc : idf = log(1 + 0.5 / 1.5), tf part = 1 at the average length. The name attribute equals the widget name and is
+    // indexed once
+    AdjGraph<std::string> small;
+    Node<std::string> one("https://one");
+    WidgetTree<std::string> one_tree(std::string("Submit form"));
+    one_tree.attrs(0).set("name", AttrValue<std::string>(std::string("Submit form")));
+    one_tree.attrs(0).set("label", AttrValue<std::string>(std::string("button")));
+    one.set_widget(std::move(one_tree));
+    NodeRef one_ref = small.add_node(one);
+    TextIndexOptions small_opts;
+    small_opts.keys = {"name", "label"};
+    TextIndex<std::string> small_index(small_opts);
+    assert(small_index.build(small) == 1 && small_index.n_terms() == 3);
+    auto hits = small_index.search("SUBMIT", 5);
+    assert(hits.size() == 1 && hits[0].node._internal_id() == one_ref._internal_id() && hits[0].widget == 0);
+    assert(std::abs(hits[0].score - std::log(1.0 + 0.5 / 1.5)) < 1e-12);
+    assert(small_index.search("button", 5).size() == 1 && small_index.search("missing", 5).empty());
+
+    // WAND gives the exhaustive top k
+    std::mt19937 rng(18);
+    AdjGraph<std::string> g;
+    std::vector<Node<std::string>> pages;
+    std::vector<NodeRef> refs;
+    for (std::size_t i = 0; i < 600; i++) {
+        pages.push_back(make_text_page(i, rng));
+        Node<std::string> node = pages.back();
+        refs.push_back(g.add_node(node));
+    }
+
+    TextIndexOptions opts;
+    opts.keys = {"name", "text", "role"};
+    TextIndex<std::string> index(opts);
+    const std::size_t n_docs = index.build(g);
+    assert(n_docs > 1000 && index.n_docs() == n_docs && index.memory_usage() > 0);
+
+    std::vector<std::string> queries = {"w0", "w1 w2", "W0 w150 w199", "button w3 w40", "heading w0 w1 w2 w3 w4 w5", "nothing here"};
+    for (std::size_t i = 0; i < 40; i++)
+        queries.push_back(make_text(1 + i % 6, rng));
+    auto check = [&](const TextIndex<std::string>& idx) {
+        for (const auto& q : queries) {
+            for (std::size_t k : {0, 1, 10, 50}) {
+                auto fast = idx.search(q, k), slow = idx.search_exhaustive(q, k);
+                assert(same_hits(fast, slow) && (k || fast.empty()));
+                for (std::size_t i = 1; i < fast.size(); i++)
+                    assert(fast[i - 1].score >= fast[i].score);
+            }
+        }
+    };
+    check(index);
+
+    // Removed nodes disappear, re-added nodes come back
+    assert(index.remove_node(refs[3]) && !index.remove_node(refs[3]));
+    for (const auto& h : index.search("w0 w1 button link heading textbox", 10000))
+        assert(h.node._internal_id() != refs[3]._internal_id());
+    check(index);
+    assert(index.add_node(g.get_node(refs[3])) > 0);
+    bool found = false;
+    for (const auto& h : index.search("w0 w1 button link heading textbox", 10000))
+        found |= h.node._internal_id() == refs[3]._internal_id();
+    assert(found && index.n_docs() == n_docs);
+
+    // Removing most nodes compacts the postings, the result matches a fresh index
+    for (std::size_t i = 0; i < refs.size(); i++)
+        if (i % 5)
+            index.remove_node(refs[i]);
+    assert(index.n_deleted() < index.n_docs());
+    check(index);
+
+    AdjGraph<std::string> kept;
+    for (std::size_t i = 0; i < refs.size(); i += 5)
+        kept.add_node(pages[i]);
+    TextIndex<std::string> fresh(opts);
+    assert(fresh.build(kept) == index.n_docs());
+    for (const auto& q : queries) {
+        auto a = index.search(q, 20), b = fresh.search(q, 20);
+        assert(a.size() == b.size());
+        for (std::size_t i = 0; i < a.size(); i++)
+            assert(std::abs(a[i].score - b[i].score) < 1e-9);
+    }
+    return true;
+}
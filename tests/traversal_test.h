@@ -0,0 +1,158 @@
+#pragma once
+#include "graph_builder.h"
+#include "traversal.h"
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <random>
+
+/**
+ * @brief Sequential BFS distances, the reference for jsc::bfs()
+ */
+template <class FFilter>
+std::vector<std::uint32_t> reference_bfs(const jsc::CsrGraph<std::string>& g, const std::vector<std::uint32_t>& seeds, jsc::Direction dir, std::uint32_t max_hops,
+                                         FFilter filter)
+{
+    using namespace jsc;
+    std::vector<std::uint32_t> dist(g.n_nodes(), BfsResult::unreached);
+    std::deque<std::uint32_t> queue;
+    for (auto s : seeds) {
+        if (dist[s] == BfsResult::unreached)
+            queue.push_back(s);
+        dist[s] = 0;
+    }
+    while (!queue.empty()) {
+        std::uint32_t u = queue.front();
+        queue.pop_front();
+        if (dist[u] == max_hops)
+            continue;
+        auto visit = [&](std::uint32_t v, std::size_t e) {
+            if (filter(e) && dist[v] == BfsResult::unreached) {
+                dist[v] = dist[u] + 1;
+                queue.push_back(v);
+            }
+        };
+        if (dir != Direction::In)
+            for (std::size_t e = g.out_offset(u); e < g.out_offset(u) + g.out_degree(u); e++)
+                visit(g.edge_target(e), e);
+        if (dir != Direction::Out)
+            for (std::size_t k = 0; k < g.in_degree(u); k++)
+                visit(g.backlinks(u)[k], g.in_edges(u)[k]);
+    }
+    return dist;
+}
+
+/**
+ * @brief Random link graph with a few hubs and many nodes without edges. Every edge has a "kind" attribute in [0, 3)
+ */
+inline jsc::AdjGraph<std::string> make_hub_graph(std::size_t n, std::size_t n_links, std::mt19937& rng)
+{
+    using namespace jsc;
+    GraphBuilder<std::string> builder;
+    for (std::size_t i = 0; i < n; i++) {
+        Node<std::string> node("page " + std::to_string(i));
+        WidgetTree<std::string> tree(std::string("root"));
+        for (std::size_t j = 0; j < n_links; j++)
+            tree.add_child(0, "link");
+        node.set_widget(std::move(tree));
+        builder.add_node(node);
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        std::size_t deg = i % 50 == 0 ? n_links : rng() % 3;
+        for (std::size_t j = 0; j < deg; j++) {
+            std::size_t to = rng() % 4 == 0 ? rng() % 100 : rng() % n;
+            AttrSet<std::string> attrs;
+            attrs.set("kind", AttrValue<std::string>(static_cast<std::int64_t>(rng() % 3)));
+            builder.add_edge(i, to, static_cast<WidgetIdx>(1 + j), attrs);
+        }
+    }
+    return builder.build();
+}
+
+inline bool test_bfs()
+{
+    using namespace jsc;
+    std::cout << "test_bfs()" << std::endl;
+
+    // The large levels of the hub graph go bottom-up
+    constexpr std::size_t n = 20000;
+    std::mt19937 rng(11);
+    AdjGraph<std::string> adj = make_hub_graph(n, 8, rng);
+    CsrGraph<std::string> g = adj.freeze();
+
+    const AttrKey kind = AttrSet<std::string>::key("kind");
+    auto no_kind_0 = [&](std::size_t e) { return g.edge_attrs(e).get(kind)->i64() != 0; };
+    const std::vector<std::uint32_t> seeds = {0, 1, 0, 12345};
+
+    for (Direction dir : {Direction::Out, Direction::In, Direction::Both}) {
+        for (std::uint32_t max_hops : {BfsOptions::unlimited, 0u, 2u}) {
+            auto expected = reference_bfs(g, seeds, dir, max_hops, AllEdges{});
+            auto expected_filtered = reference_bfs(g, seeds, dir, max_hops, no_kind_0);
+            for (std::size_t n_threads : {1, 4}) {
+                for (double alpha : {15.0, 1e9}) {
+                    BfsOptions opts;
+                    opts.direction = dir;
+                    opts.max_hops = max_hops;
+                    opts.n_threads = n_threads;
+                    opts.alpha = alpha; // 1e9 : bottom-up from the first level
+                    BfsResult res = bfs(g, seeds, opts);
+                    assert(res.distance == expected);
+                    assert(max_hops != BfsOptions::unlimited || alpha < 1e9 || dir == Direction::In || res.n_bottom_up > 0);
+
+                    std::size_t reached = 0;
+                    for (std::uint32_t u = 0; u < n; u++) {
+                        if (!res.reached(u)) {
+                            assert(res.parent[u] == BfsResult::npos);
+                            continue;
+                        }
+                        reached++;
+                        // The parent is one hop closer and linked in the right direction
+                        std::uint32_t p = res.parent[u];
+                        if (res.distance[u] == 0) {
+                            assert(p == u);
+                            continue;
+                        }
+                        assert(res.distance[p] + 1 == res.distance[u]);
+                        bool linked = false;
+                        if (dir != Direction::In)
+                            for (auto v : g.backlinks(u))
+                                linked |= v == p;
+                        if (dir != Direction::Out)
+                            for (auto v : g.neighbors(u))
+                                linked |= v == p;
+                        assert(linked);
+                    }
+                    assert(reached == res.n_reached);
+
+                    BfsResult filtered = bfs(g, seeds, opts, no_kind_0);
+                    assert(filtered.distance == expected_filtered);
+                }
+            }
+        }
+    }
+
+    // k-hop neighborhoods are ordered by distance, then by index
+    auto expected = reference_bfs(g, {7}, Direction::Both, 2, AllEdges{});
+    auto hood = k_hop(g, std::vector<std::uint32_t>{7}, 2, Direction::Both, 4);
+    assert(hood.front() == 7);
+    std::size_t count = 0;
+    for (auto d : expected)
+        count += d != BfsResult::unreached;
+    assert(hood.size() == count);
+    for (std::size_t i = 1; i < hood.size(); i++)
+        assert(expected[hood[i - 1]] < expected[hood[i]] || (expected[hood[i - 1]] == expected[hood[i]] && hood[i - 1] < hood[i]));
+
+    auto refs = k_hop(adj, {g.node_ref(7)}, 2);
+    assert(refs.size() == hood.size());
+    for (std::size_t i = 0; i < refs.size(); i++)
+        assert(refs[i]._internal_id() == g.node_ref(hood[i])._internal_id());
+
+    bool thrown = false;
+    try {
+        bfs(g, {static_cast<std::uint32_t>(n)});
+    } catch (const std::out_of_range&) {
+        thrown = true;
+    }
+    assert(thrown);
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "webui_dataset.h"
+#include "webui_test.h"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+inline void write_webui_screen(const std::filesystem::path& dir, const std::string& screen_type, const std::string& title, bool screenshot = true)
+{
+    std::filesystem::create_directories(dir);
+    for (const auto& type : jsc::webui_file_types())
+        std::ofstream((dir / (screen_type + "-" + type)).string());
+    write_gzip((dir / (screen_type + "-axtree.json.gz")).string(),
+               R"({"nodes": [{"nodeId": "1", "ignored": false, "role": {"type": "role", "value": "RootWebArea"}, "name": {"type": "computedString", "value": ")" + title +
+               R"("}, "childIds": ["2"], "backendDOMNodeId": 1}, {"nodeId": "2", "ignored": false, "role": {"type": "role", "value": "link"}, "parentId": "1", "childIds": []}]})");
+    write_gzip((dir / (screen_type + "-bb.json.gz")).string(), R"({"1": {"x": 0, "y": 0, "width": 10, "height": 20}})");
+    write_gzip((dir / (screen_type + "-box.json.gz")).string(), "{}");
+    std::ofstream((dir / (screen_type + "-url.txt")).string()) << "https://" << title;
+    if (screenshot)
+        std::ofstream((dir / (screen_type + "-screenshot-full.webp")).string()) << "RIFF";
+}
+
+inline bool test_webui_best_screen()
+{
+    using namespace jsc;
+    std::cout << "test_webui_best_screen()" << std::endl;
+
+    std::vector<std::pair<std::string, std::uintmax_t>> files;
+    auto add = [&](const std::string& type, std::uintmax_t screenshot_size) {
+        for (const auto& t : webui_file_types())
+            files.emplace_back(type + "-" + t, t == "screenshot-full.webp" ? screenshot_size : 10);
+    };
+    add("default_1280-720", 10);
+    add("default_1920-1080", 0); // empty screenshot
+    add("iPhone-13 Pro", 10);
+    WebuiScreen best = webui_best_screen(files);
+    assert(best.screen_type == "default_1280-720" && best.width == 1280 && best.height == 720);
+
+    add("default_1366-768", 10);
+    files.erase(std::remove_if(files.begin(), files.end(), [](const auto& f) { return f.first == "default_1366-768-style.json.gz"; }), files.end());
+    assert(webui_best_screen(files).screen_type == "default_1280-720");
+    assert(webui_best_screen(files, false).screen_type == "default_1366-768");
+
+    assert(WebuiScreen("iPhone-13 Pro").width == 0);
+    assert(webui_best_screen({{"default_1920-1080-screenshot-full.webp", 10}}).screen_type.empty());
+
+    BoundedQueue<int> q(2);
+    assert(q.push(1) && q.push(2) && q.size() == 2);
+    q.close();
+    int v = 0;
+    assert(!q.push(3) && q.pop(v) && v == 1 && q.pop(v) && v == 2 && !q.pop(v));
+    return true;
+}
+
+inline bool test_webui_dataset()
+{
+    using namespace jsc;
+    std::cout << "test_webui_dataset()" << std::endl;
+
+    const auto root = std::filesystem::temp_directory_path() / "jsc_webui_dataset_test";
+    std::filesystem::remove_all(root);
+    const std::size_t n_pages = 40;
+    for (std::size_t i = 0; i < n_pages; i++) {
+        const auto dir = root / std::to_string(1000 + i);
+        write_webui_screen(dir, "default_1280-720", "small" + std::to_string(i));
+        write_webui_screen(dir, "default_1920-1080", "page" + std::to_string(i));
+        write_webui_screen(dir, "iPhone-13 Pro", "mobile" + std::to_string(i));
+    }
+    write_webui_screen(root / "partial", "default_1920-1080", "partial", false); // no full screenshot
+    std::ofstream((root / "README.txt").string()) << "not a page";
+
+    for (std::size_t threads : {1, 4}) {
+        WebuiDatasetOptions opts;
+        opts.n_threads = threads;
+        opts.queue_capacity = 2;
+        opts.progress_every = 10;
+        WebuiDatasetLoader<> loader(opts);
+
+        AdjGraph<> g;
+        std::map<std::string, WebuiPageInfo> pages;
+        std::size_t n_progress = 0;
+        loader.on_page([&](const WebuiPageInfo& info) { pages[info.page_id] = info; });
+        loader.on_progress([&](const WebuiDatasetStats&) { n_progress++; });
+        WebuiDatasetStats stats = loader.load(root.string(), g);
+
+        assert(stats.n_dirs == n_pages + 1 && stats.n_pages == n_pages && stats.n_skipped == 1 && stats.n_failed == 0);
+        assert(stats.n_widgets == 2 * n_pages && stats.bytes > 0 && n_progress == (n_pages + 1) / 10);
+        assert(g.size() == n_pages && pages.size() == n_pages);
+        for (std::size_t i = 0; i < n_pages; i++) {
+            const WebuiPageInfo& info = pages.at(std::to_string(1000 + i));
+            assert(info.screen.screen_type == "default_1920-1080" && info.screen.width == 1920);
+            const Node<>& node = g.get_node(info.ref);
+            assert(node.name() == "https://page" + std::to_string(i));
+            assert(node.widget_tree().attrs(0).get("geometry")->at_f64(3) == 20);
+        }
+    }
+
+    // A corrupt page stops the load, or is counted with skip_errors
+    write_gzip((root / "1000" / "default_1920-1080-axtree.json.gz").string(), R"({"nodes": [{"nodeId": )");
+    bool thrown = false;
+    AdjGraph<> g;
+    WebuiDatasetOptions opts;
+    opts.n_threads = 2;
+    try { WebuiDatasetLoader<>(opts).load(root.string(), g); } catch (const std::runtime_error&) { thrown = true; }
+    assert(thrown);
+    opts.skip_errors = true;
+    AdjGraph<> g2;
+    WebuiDatasetStats stats = WebuiDatasetLoader<>(opts).load(root.string(), g2);
+    assert(stats.n_failed == 1 && stats.n_pages == n_pages - 1 && g2.size() == n_pages - 1);
+
+    std::filesystem::remove_all(root);
+    return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "webui.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <zlib.h>
+
+inline void write_gzip(const std::string& path, const std::string& data)
+{
+    gzFile f = gzopen(path.c_str(), "wb");
+    assert(f);
+    gzwrite(f, data.data(), static_cast<unsigned>(data.size()));
+    gzclose(f);
+}
+
+inline bool test_json_reader()
+{
+    using namespace jsc;
+    std::cout << "test_json_reader()" << std::endl;
+
+    std::string doc = R"({"a": [1, -2.5e1, true, null, {"x": "y"}], "s": "q\"\\\/\né😀", "skip": {"deep": [[[]], {}]}, "n": 7})";
+    MemorySource src(doc);
+    JsonReader<MemorySource> json(src, 4); // tiny buffer to cross refills everywhere
+    std::string key, s;
+    json.begin_object();
+    assert(json.next_key(key) && key == "a");
+    json.begin_array();
+    assert(json.next_element() && json.read_int() == 1);
+    assert(json.next_element() && json.read_double() == -25.0);
+    assert(json.next_element() && json.read_bool());
+    assert(json.next_element() && json.read_null());
+    assert(json.next_element() && json.peek_type() == JsonReader<MemorySource>::Type::Object);
+    json.skip();
+    assert(!json.next_element());
+    assert(json.next_key(key) && key == "s");
+    json.read_string(s);
+    assert(s == "q\"\\/\n\xc3\xa9\xf0\x9f\x98\x80");
+    assert(json.next_key(key) && key == "skip");
+    json.skip();
+    assert(json.next_key(key) && key == "n" && json.read_int() == 7);
+    assert(!json.next_key(key));
+
+    // Views and the number fast path give the same values with a large buffer and across refills
+    for (std::size_t buffer : {4, 1 << 16}) {
+        MemorySource vsrc(R"({"key": "value", "esc\"aped": "a\u00e9", "nums": [0.1, -120.5, 3.14159, 1e3, 12345678901234567890, 0.000001]})");
+        JsonReader<MemorySource> v(vsrc, buffer);
+        std::string_view k;
+        v.begin_object();
+        assert(v.next_key(k) && k == "key" && v.read_string_view() == "value");
+        assert(v.next_key(k) && k == "esc\"aped" && v.read_string_view() == "a\xc3\xa9");
+        assert(v.next_key(k) && k == "nums");
+        v.begin_array();
+        for (double expected : {0.1, -120.5, 3.14159, 1e3, 12345678901234567890.0, 0.000001})
+            assert(v.next_element() && v.read_double() == expected);
+        assert(!v.next_element() && !v.next_key(k));
+    }
+    std::mt19937_64 rng(11);
+    std::string nums = "[";
+    for (int i = 0; i < 2000; i++) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%s%.*f", i ? ", " : "", static_cast<int>(rng() % 18), static_cast<double>(rng() % 100000000) / (1 + rng() % 1000));
+        nums += buf;
+    }
+    nums += "]";
+    MemorySource nsrc(nums);
+    JsonReader<MemorySource> njson(nsrc, 64);
+    njson.begin_array();
+    for (std::size_t pos = 1; njson.next_element(); ) {
+        const double v = njson.read_double();
+        char* end = nullptr;
+        assert(v == std::strtod(nums.c_str() + pos, &end));
+        pos = static_cast<std::size_t>(end - nums.c_str()) + 1;
+    }
+
+    bool thrown = false;
+    MemorySource bad(R"({"a": [1 2]})");
+    JsonReader<MemorySource> bad_json(bad);
+    try { bad_json.skip(); } catch (const std::runtime_error&) { thrown = true; }
+    assert(thrown);
+    return true;
+}
+
+inline bool test_webui_loader()
+{
+    using namespace jsc;
+    std::cout << "test_webui_loader()" << std::endl;
+
+    // root -> [ignored generic -> [link, text], heading]. The ignored node has a box, which must not leak
+    const std::string axtree = R"({"nodes": [
+        {"nodeId": "1", "ignored": false, "role": {"type": "role", "value": "RootWebArea"}, "name": {"type": "computedString", "value": "Page", "sources": [{"type": "relatedElement"}]},
+         "childIds": ["2", "5"], "backendDOMNodeId": 10, "properties": [{"name": "focusable", "value": {"type": "booleanOrUndefined", "value": true}}]},
+        {"nodeId": "2", "ignored": true, "ignoredReasons": [{"name": "uninteresting"}], "role": {"type": "role", "value": "none"}, "parentId": "1", "childIds": ["3", "4"], "backendDOMNodeId": 11},
+        {"nodeId": "3", "ignored": false, "role": {"type": "role", "value": "link"}, "name": {"type": "computedString", "value": "Home"}, "parentId": "2", "childIds": [], "backendDOMNodeId": 12},
+        {"nodeId": "4", "ignored": false, "role": {"type": "internalRole", "value": "StaticText"}, "name": {"type": "computedString", "value": "café"}, "parentId": "2", "childIds": [], "backendDOMNodeId": 13},
+        {"nodeId": "5", "ignored": false, "role": {"type": "role", "value": "heading"}, "name": {"type": "computedString", "value": ""}, "parentId": "1", "childIds": ["6"]}
+    ]})";
+    const std::string bb = R"({"10": {"x": 0, "y": 0, "width": 1280, "height": 720}, "11": {"x": 1, "y": 2, "width": 3, "height": 4},
+        "12": {"x": 10.5, "y": 20, "width": 30, "height": 40, "top": 20}, "13": null})";
+
+    const auto dir = std::filesystem::temp_directory_path() / "jsc_webui_test";
+    std::filesystem::create_directories(dir);
+    write_gzip((dir / "default_1280-720-axtree.json.gz").string(), axtree);
+    write_gzip((dir / "default_1280-720-bb.json.gz").string(), bb);
+
+    Node<std::string> page = load_webui_page<std::string>(dir.string(), "default_1280-720");
+    const WidgetTree<std::string>& tree = page.widget_tree();
+    assert(page.name() == dir.string() + "/default_1280-720");
+    assert(tree.size() == 4 && tree.is_preorder());
+    assert(tree.name(0) == "Page" && tree.name(1) == "Home" && tree.name(2) == "caf\xc3\xa9" && tree.name(3).empty());
+    assert(tree.links(1).parent == 0 && tree.links(2).parent == 0 && tree.links(0).n_children == 3);
+
+    assert(tree.attrs(0).get("role")->str() == "RootWebArea" && tree.attrs(0).get("geometry")->at_f64(2) == 1280);
+    assert(tree.attrs(1).get("role")->str() == "link" && tree.attrs(1).get("name")->str() == "Home");
+    assert(tree.attrs(1).get("geometry")->at_f64(0) == 10.5 && tree.attrs(1).get("ignored")->i64() == 0);
+    assert(tree.attrs(2).get("name")->str() == "caf\xc3\xa9" && !tree.attrs(2).contains("geometry"));
+    assert(!tree.attrs(3).contains("name") && tree.attrs(3).get("role")->str() == "heading");
+
+    // Ignored nodes can be kept
+    WebuiOptions opts;
+    opts.keep_ignored = true;
+    Node<std::string> full = load_webui_page<std::string>(dir.string(), "default_1280-720", opts);
+    assert(full.widget_tree().size() == 5 && full.widget_tree().attrs(1).get("ignored")->i64() == 1);
+    assert(full.widget_tree().attrs(1).get("role")->str().empty() && full.widget_tree().attrs(1).get("geometry")->at_f64(3) == 4);
+
+    std::filesystem::remove_all(dir);
+    return true;
+}